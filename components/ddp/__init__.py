@@ -97,6 +97,7 @@ async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     cg.add(var.set_stats_interval(config[CONF_STATS_INTERVAL]))
+    cg.add_define("USE_DDP")
 
 
 @register_rgb_effect(
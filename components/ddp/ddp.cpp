@@ -12,11 +12,14 @@ namespace ddp {
 
 static const char *const TAG = "ddp";
 
-DDPComponent::DDPComponent() {}
+DDPComponent *global_ddp_component = nullptr;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+DDPComponent::DDPComponent() { global_ddp_component = this; }
 DDPComponent::~DDPComponent() {}
 void DDPComponent::setup() {}
 
 void DDPComponent::note_packet_(const char *source, uint16_t size) {
+  this->packets_total_++;
   if (this->stats_interval_ms_ == 0) {
     return;
   }
@@ -44,6 +44,8 @@ class DDPComponent : public esphome::Component {
     this->stats_last_ms_ = 0;
     this->stats_packets_ = 0;
   }
+  /// Packets received since boot, for the web server's /metrics.
+  uint32_t get_packets_total() const { return this->packets_total_; }
 
  protected:
 
@@ -61,11 +63,14 @@ class DDPComponent : public esphome::Component {
   uint32_t stats_interval_ms_{0};
   uint32_t stats_last_ms_{0};
   uint32_t stats_packets_{0};
+  uint32_t packets_total_{0};
   uint16_t last_packet_size_{0};
   char last_source_[64]{};
   bool have_source_{false};
 };
 
+extern DDPComponent *global_ddp_component;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
 }  // namespace ddp
 }  // namespace esphome
 
@@ -145,6 +145,15 @@ uint16_t DDPAddressableLightEffect::process_(const uint8_t *payload, uint16_t si
       break; // Multiply mode is default ESPHome behavior, no need to do anything to handle it.
   }
 
+  // no per-pixel scaling needed, write the whole packet through the bulk API.
+  bool scaled = (this->scaling_mode_ == DDP_SCALE_PIXEL) ||
+                ( (this->scaling_mode_ == DDP_SCALE_PACKET || this->scaling_mode_ == DDP_SCALE_STRIP) && multiplier != 1.0f );
+  if ( !scaled ) {
+    it->blit_rgb(0, payload + used, num_pixels);
+    it->schedule_show();
+    return (num_pixels*3);
+  }
+
   // loop through all pixels being displayed now.
   for (uint16_t i = used; i < used+(num_pixels*3); i+=3) {
 
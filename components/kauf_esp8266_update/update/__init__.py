@@ -4,7 +4,6 @@ import esphome.config_validation as cv
 from esphome.const import CONF_SOURCE
 from esphome.components.http_request import CONF_HTTP_REQUEST_ID, HttpRequestComponent
 
-AUTO_LOAD = ["json"]
 DEPENDENCIES = ["http_request"]
 
 
@@ -3,32 +3,63 @@
 #include "esphome/core/application.h"
 #include "esphome/core/version.h"
 
-#include "esphome/components/json/json_util.h"
 #include "esphome/components/network/util.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+
 namespace esphome::kauf_esp8266_update {
 
-using http_request::http_read_fully;
-using http_request::HttpReadStatus;
+using http_request::HTTP_STATUS_NOT_MODIFIED;
 using http_request::HTTP_STATUS_OK;
 
-static const char *const TAG = "kauf_esp8266_update";
+static constexpr int HTTP_STATUS_TOO_MANY_REQUESTS = 429;
+static constexpr int HTTP_STATUS_SERVICE_UNAVAILABLE = 503;
 
-// Wraps UpdateInfo + error for the task→main-loop handoff.
-struct TaskResult {
-  update::UpdateInfo info;
-  const LogString *error_str{nullptr};
-};
+static const char *const TAG = "kauf_esp8266_update";
 
 static const size_t MAX_READ_SIZE = 256;
+// KAUF: the manifest is a few hundred bytes; anything larger is not read
+static constexpr size_t MAX_MANIFEST_SIZE = 4096;
+// Collected response header names are lower case
+static const char *const HEADER_ETAG = "etag";
+static const char *const HEADER_CACHE_CONTROL = "cache-control";
+static const char *const HEADER_RETRY_AFTER = "retry-after";
 static constexpr uint32_t INITIAL_CHECK_INTERVAL_ID = 0;
 static constexpr uint32_t INITIAL_CHECK_INTERVAL_MS = 10000;
 static constexpr uint8_t INITIAL_CHECK_MAX_ATTEMPTS = 6;
-static constexpr uint32_t RETRY_INTERVAL_MS = 10 * 60 * 1000; // minutes * seconds * ms
-static constexpr uint8_t MAX_RETRIES = 3;
-static constexpr uint32_t MIN_INTERVAL_FOR_RETRY_MS = 24 * 60 * 60 * 1000UL; // hours * minutes * seconds * ms
+// KAUF: devices that boot together (e.g. after a power outage) spread their checks over these windows
+static constexpr uint32_t INITIAL_CHECK_JITTER_MS = 5 * 60 * 1000;  // minutes * seconds * ms
+static constexpr uint32_t POLL_JITTER_MAX_MS = 30 * 60 * 1000;      // minutes * seconds * ms
+// Failed checks are retried after 1, 2, 4, ... minutes, at most 1 hour and never later than the next regular check
+static constexpr uint32_t RETRY_BASE_MS = 60 * 1000;
+static constexpr uint32_t RETRY_MAX_MS = 60 * 60 * 1000;
+static constexpr uint8_t MAX_RETRIES = 6;
+// Cap for server supplied delays (Cache-Control max-age, Retry-After)
+static constexpr uint32_t MAX_SERVER_DELAY_S = 24 * 60 * 60;
+
+// Seconds from a "Retry-After: <seconds>" or "Cache-Control: ..., max-age=<seconds>" value, 0 if absent
+static uint32_t parse_delay_seconds(const std::string &value, const char *key) {
+  const char *start = value.c_str();
+  if (key != nullptr) {
+    const char *found = strstr(start, key);
+    if (found == nullptr)
+      return 0;
+    start = found + strlen(key);
+  }
+  // HTTP dates in Retry-After are not supported and parse as 0
+  const unsigned long seconds = strtoul(start, nullptr, 10);
+  return std::min<unsigned long>(seconds, MAX_SERVER_DELAY_S);
+}
+
+uint32_t KaufEsp8266Update::jitter_(uint32_t window) const { return window == 0 ? 0 : this->device_hash_ % window; }
 
 void KaufEsp8266Update::setup() {
+  // KAUF: per-device offset, the same on every boot
+  this->device_hash_ = fnv1_hash(get_mac_address());
+
   // Check periodically until network is ready
   // Only if update interval is > total retry window to avoid redundant checks
   if (this->get_update_interval() != SCHEDULER_DONT_RUN &&
@@ -39,11 +70,31 @@ void KaufEsp8266Update::setup() {
       if (--this->initial_check_remaining_ == 0 || connected) {
         this->cancel_interval(INITIAL_CHECK_INTERVAL_ID);
         if (connected) {
-          this->update();
+          const uint32_t delay = this->jitter_(INITIAL_CHECK_JITTER_MS);
+          ESP_LOGD(TAG, "First update check in %" PRIu32 " s", delay / 1000);
+          this->set_timeout("initial", delay, [this]() { this->update(); });
         }
       }
     });
   }
+
+  // KAUF: shift the regular checks by the device offset so a site's devices do not poll in lockstep
+  if (this->get_update_interval() != SCHEDULER_DONT_RUN) {
+    this->stop_poller();
+    this->set_timeout("jitter", this->jitter_(std::min(this->get_update_interval() / 4, POLL_JITTER_MAX_MS)),
+                      [this]() { this->start_poller(); });
+  }
+  // KAUF: loop() only runs while a manifest is being read
+  this->disable_loop();
+}
+
+void KaufEsp8266Update::dump_config() {
+  ESP_LOGCONFIG(TAG, "KAUF ESP8266 Update:");
+  ESP_LOGCONFIG(TAG, "  Source URL: %s", this->source_url_);
+  ESP_LOGCONFIG(TAG, "  Poll offset window: %" PRIu32 " s",
+                std::min(this->get_update_interval() / 4, POLL_JITTER_MAX_MS) / 1000);
+  ESP_LOGCONFIG(TAG, "  Checks: %" PRIu32 ", failed: %" PRIu32 ", not modified: %" PRIu32, this->checks_,
+                this->checks_failed_, this->checks_not_modified_);
 }
 
 void KaufEsp8266Update::update() {
@@ -54,172 +105,212 @@ void KaufEsp8266Update::update() {
   // Cancel early-boot interval (no-op if already cancelled by the interval callback itself).
   // Must be after the network check so a boot-time call with no network doesn't kill the interval.
   this->cancel_interval(INITIAL_CHECK_INTERVAL_ID);
+  this->cancel_timeout("initial");
+  // KAUF: the server asked not to be contacted before this (Cache-Control max-age or Retry-After). A pending retry
+  // is already scheduled past it and stays.
+  if (this->hold_off_ && static_cast<int32_t>(millis() - this->hold_off_until_ms_) < 0) {
+    ESP_LOGD(TAG, "Server asked to wait another %" PRIu32 " s, skipping update check",
+             (this->hold_off_until_ms_ - millis()) / 1000);
+    return;
+  }
+  this->hold_off_ = false;
   this->cancel_timeout("retry");
-  this->update_task(this);
+  if (this->fetching_) {
+    ESP_LOGD(TAG, "Update check already running");
+    return;
+  }
+  this->start_fetch_();
 }
 
-void KaufEsp8266Update::update_task(void *params) {
-  KaufEsp8266Update *this_update = (KaufEsp8266Update *) params;
-
-  // Allocate once — every path below returns via the single defer at the end.
-  // On failure, error_str is set; on success it is nullptr.
-  auto *result = new TaskResult();
-  auto *info = &result->info;
-
-  ESP_LOGD(TAG, "Checking for update at %s", this_update->source_url_);
-  auto container = this_update->request_parent_->get(this_update->source_url_);
-
-  if (container == nullptr || container->status_code != HTTP_STATUS_OK) {
-    ESP_LOGE(TAG, "Failed to fetch manifest from %s", this_update->source_url_);
-    if (container != nullptr)
-      container->end();
-    result->error_str = LOG_STR("Failed to fetch manifest");
-    goto defer;  // NOLINT(cppcoreguidelines-avoid-goto)
-  }
-
-  {
-    RAMAllocator<uint8_t> allocator;
-    uint8_t *data = allocator.allocate(container->content_length);
-    if (data == nullptr) {
-      ESP_LOGE(TAG, "Failed to allocate %zu bytes for manifest", container->content_length);
-      container->end();
-      result->error_str = LOG_STR("Failed to allocate memory for manifest");
-      goto defer;  // NOLINT(cppcoreguidelines-avoid-goto)
-    }
+void KaufEsp8266Update::loop() {
+  if (this->fetching_) {
+    this->read_manifest_();
+  } else {
+    this->disable_loop();
+  }
+}
 
-    auto read_result = http_read_fully(container.get(), data, container->content_length, MAX_READ_SIZE,
-                                       this_update->request_parent_->get_timeout());
-    if (read_result.status != HttpReadStatus::OK) {
-      if (read_result.status == HttpReadStatus::TIMEOUT) {
-        ESP_LOGE(TAG, "Timeout reading manifest");
-      } else {
-        ESP_LOGE(TAG, "Error reading manifest: %d", read_result.error_code);
-      }
-      allocator.deallocate(data, container->content_length);
-      container->end();
-      result->error_str = LOG_STR("Failed to read manifest");
-      goto defer;  // NOLINT(cppcoreguidelines-avoid-goto)
+void KaufEsp8266Update::start_fetch_() {
+  this->checks_++;
+  ESP_LOGD(TAG, "Checking for update at %s (check %" PRIu32 ")", this->source_url_, this->checks_);
+  std::list<http_request::Header> headers;
+  if (!this->etag_.empty())
+    headers.push_back({"If-None-Match", this->etag_});
+  // Connecting and sending the request still happen here; the body is read from loop() in small slices.
+  this->container_ = this->request_parent_->get(this->source_url_, headers,
+                                                {HEADER_ETAG, HEADER_CACHE_CONTROL, HEADER_RETRY_AFTER});
+
+  if (this->container_ != nullptr && this->container_->status_code == HTTP_STATUS_NOT_MODIFIED) {
+    ESP_LOGD(TAG, "Manifest not modified");
+    this->checks_not_modified_++;
+    this->finish_fetch_(nullptr);
+    this->publish_manifest_(this->update_info_.title, this->update_info_.latest_version);
+    return;
+  }
+  if (this->container_ == nullptr || this->container_->status_code != HTTP_STATUS_OK) {
+    ESP_LOGE(TAG, "Failed to fetch manifest from %s", this->source_url_);
+    this->finish_fetch_(LOG_STR("Failed to fetch manifest"));
+    return;
+  }
+  const size_t content_length = this->container_->content_length;
+  if (content_length == 0 || content_length > MAX_MANIFEST_SIZE) {
+    ESP_LOGE(TAG, "Manifest size %zu is outside 1..%zu bytes", content_length, MAX_MANIFEST_SIZE);
+    this->finish_fetch_(LOG_STR("Manifest too large"));
+    return;
+  }
+
+  this->scanner_.reset();
+  this->last_data_ms_ = millis();
+  this->fetching_ = true;
+  this->enable_loop();
+}
+
+void KaufEsp8266Update::read_manifest_() {
+  uint8_t buf[MAX_READ_SIZE];
+  const int len = this->container_->read(buf, sizeof(buf));
+  if (len < 0) {
+    ESP_LOGE(TAG, "Error reading manifest: %d", len);
+    this->finish_fetch_(LOG_STR("Failed to read manifest"));
+    return;
+  }
+
+  const uint32_t now = millis();
+  if (len > 0) {
+    this->last_data_ms_ = now;
+    if (!this->scanner_.feed(reinterpret_cast<const char *>(buf), len)) {
+      ESP_LOGE(TAG, "Failed to parse JSON from %s", this->source_url_);
+      this->finish_fetch_(LOG_STR("Failed to parse manifest JSON"));
+      return;
     }
-    size_t read_index = container->get_bytes_read();
-    size_t content_length = container->content_length;
-
-    container->end();
-    container.reset();  // Release ownership of the container's shared_ptr
-
-    bool valid = false;
-    {  // Scope to ensure JsonDocument is destroyed before deallocating buffer
-      valid = json::parse_json(data, read_index, [info](JsonObject root) -> bool {
-        if (!root[ESPHOME_F("name")].is<const char *>() || !root[ESPHOME_F("version")].is<const char *>()) {
-          ESP_LOGE(TAG, "Manifest does not contain required fields");
-          return false;
-        }
-        info->title = root[ESPHOME_F("name")].as<std::string>();
-        info->latest_version = root[ESPHOME_F("version")].as<std::string>();
-        return true;
-      });
+  }
+
+  if (this->container_->get_bytes_read() < this->container_->content_length) {
+    if (len == 0 && now - this->last_data_ms_ > this->request_parent_->get_timeout()) {
+      ESP_LOGE(TAG, "Timeout reading manifest");
+      this->finish_fetch_(LOG_STR("Failed to read manifest"));
     }
-    allocator.deallocate(data, content_length);
+    return;
+  }
 
-    if (!valid) {
-      ESP_LOGE(TAG, "Failed to parse JSON from %s", this_update->source_url_);
-      result->error_str = LOG_STR("Failed to parse manifest JSON");
-      goto defer;  // NOLINT(cppcoreguidelines-avoid-goto)
+  if (!this->scanner_.is_complete()) {
+    ESP_LOGE(TAG, "Manifest does not contain required fields");
+    this->finish_fetch_(LOG_STR("Failed to parse manifest JSON"));
+    return;
+  }
+  this->etag_ = this->container_->get_response_header(HEADER_ETAG);
+  this->finish_fetch_(nullptr);
+  this->publish_manifest_(this->scanner_.name(), this->scanner_.version());
+}
+
+void KaufEsp8266Update::finish_fetch_(const LogString *error) {
+  uint32_t server_delay_s = 0;
+  if (this->container_ != nullptr) {
+    // KAUF: honor the server's caching and rate limiting hints
+    const int status = this->container_->status_code;
+    if (status == HTTP_STATUS_OK || status == HTTP_STATUS_NOT_MODIFIED) {
+      server_delay_s = parse_delay_seconds(this->container_->get_response_header(HEADER_CACHE_CONTROL), "max-age=");
+    } else if (status == HTTP_STATUS_TOO_MANY_REQUESTS || status == HTTP_STATUS_SERVICE_UNAVAILABLE) {
+      server_delay_s = parse_delay_seconds(this->container_->get_response_header(HEADER_RETRY_AFTER), nullptr);
     }
+    this->container_->end();
+    this->container_.reset();
+  }
+  this->fetching_ = false;
+  this->disable_loop();
+  if (server_delay_s > 0) {
+    this->hold_off_ = true;
+    this->hold_off_until_ms_ = millis() + server_delay_s * 1000;
+  }
+  if (error == nullptr)
+    return;
 
+  this->checks_failed_++;
+  this->status_set_error(error);
+  // Exponential backoff with the device offset on top, so failed devices do not retry together
+  uint32_t delay = std::min(RETRY_BASE_MS << this->retry_count_, RETRY_MAX_MS);
+  delay += this->jitter_(delay / 4);
+  delay = std::max(delay, server_delay_s * 1000);
+  if (this->retry_count_ < MAX_RETRIES && delay < this->get_update_interval()) {
+    this->retry_count_++;
+    ESP_LOGD(TAG, "Scheduling retry %d/%d in %" PRIu32 " s", this->retry_count_, MAX_RETRIES, delay / 1000);
+    this->set_timeout("retry", delay, [this]() { this->update(); });
+  }
+}
+
+void KaufEsp8266Update::publish_manifest_(const std::string &name, const std::string &version) {
+  this->retry_count_ = 0;
+
+  update::UpdateInfo info;
+  info.title = name;
+  info.latest_version = version;
 #ifdef ESPHOME_PROJECT_VERSION
-    info->current_version = ESPHOME_PROJECT_VERSION;
+  info.current_version = ESPHOME_PROJECT_VERSION;
 #else
-    info->current_version = ESPHOME_VERSION;
+  info.current_version = ESPHOME_VERSION;
 #endif
-    // Strip trailing non-digit suffix (e.g. "1.993u" -> "1.993", "1.982(y)" -> "1.982")
-    while (!info->current_version.empty() && !std::isdigit((unsigned char) info->current_version.back()))
-      info->current_version.pop_back();
-    ESP_LOGD(TAG, "Manifest version: %s, current version: %s", info->latest_version.c_str(), info->current_version.c_str());
-
-    // Both URLs are hardcoded in firmware — not read from manifest to prevent MITM spoofing.
-    // release_url → GitHub releases page, used by HA as "release notes" link.
-    // firmware_url → direct .bin.gz download with {version} substitution, used by web UI.
-    info->summary = "The Update button below does not work for this device. To update:\n\n"
-                    "1. Click the three-dot menu in the top-right of this popup\n"
-                    "2. Select **Device Info**\n"
-                    "3. Click **Visit** to open the device web UI\n\n"
-                    "Under the **OTA Update** heading in the web UI, there is a link to download the firmware file and a file upload field to apply it. Note: you must be on the same local network as the device to access the web UI.";
-    info->release_url = this_update->release_url_;
-    if (this_update->firmware_url_ != nullptr) {
-      std::string url = this_update->firmware_url_;
-      size_t pos = url.find("{version}");
-      if (pos != std::string::npos)
-        url.replace(pos, 9, info->latest_version);
-      info->firmware_url = std::move(url);
-    }
+  // Strip trailing non-digit suffix (e.g. "1.993u" -> "1.993", "1.982(y)" -> "1.982")
+  while (!info.current_version.empty() && !std::isdigit((unsigned char) info.current_version.back()))
+    info.current_version.pop_back();
+  ESP_LOGD(TAG, "Manifest version: %s, current version: %s", info.latest_version.c_str(), info.current_version.c_str());
+
+  // Both URLs are hardcoded in firmware — not read from manifest to prevent MITM spoofing.
+  // release_url → GitHub releases page, used by HA as "release notes" link.
+  // firmware_url → direct .bin.gz download with {version} substitution, used by web UI.
+  info.summary = "The Update button below does not work for this device. To update:\n\n"
+                 "1. Click the three-dot menu in the top-right of this popup\n"
+                 "2. Select **Device Info**\n"
+                 "3. Click **Visit** to open the device web UI\n\n"
+                 "Under the **OTA Update** heading in the web UI, there is a link to download the firmware file and a file upload field to apply it. Note: you must be on the same local network as the device to access the web UI.";
+  info.release_url = this->release_url_;
+  if (this->firmware_url_ != nullptr) {
+    std::string url = this->firmware_url_;
+    size_t pos = url.find("{version}");
+    if (pos != std::string::npos)
+      url.replace(pos, 9, info.latest_version);
+    info.firmware_url = std::move(url);
   }
 
-defer:
-  // Release container before vTaskDelete (which doesn't call destructors)
-  container.reset();
-
-  // Defer to the main loop so all update_info_ and state_ writes happen on the
-  // same thread as readers (API, MQTT, web server). This is a single defer for
-  // both success and error paths to avoid multiple std::function instantiations.
-  // Lambda captures only 2 pointers (8 bytes) — fits in std::function SBO on supported toolchains.
-  this_update->defer([this_update, result]() {
-    if (result->error_str != nullptr) {
-      this_update->status_set_error(result->error_str);
-      delete result;
-      if (this_update->get_update_interval() >= MIN_INTERVAL_FOR_RETRY_MS &&
-          this_update->retry_count_ < MAX_RETRIES) {
-        this_update->retry_count_++;
-        ESP_LOGD(TAG, "Scheduling retry %d/%d in 10 minutes", this_update->retry_count_, MAX_RETRIES);
-        this_update->set_timeout("retry", RETRY_INTERVAL_MS, [this_update]() { this_update->update(); });
-      }
-      return;
-    }
-    this_update->retry_count_ = 0;
-
-    const std::string &latest = result->info.latest_version;
-    const std::string &current = result->info.current_version;
-
-    // Parse "major.minor" version strings and compare numerically.
-    // current >= latest means no update needed (handles device ahead of manifest).
-    auto parse_version = [](const std::string &v, int &major, int &minor) {
-      const char *s = v.c_str();
-      major = atoi(s);
-      const char *dot = strchr(s, '.');
-      minor = dot ? atoi(dot + 1) : 0;
-    };
-    int cur_maj, cur_min, lat_maj, lat_min;
-    parse_version(current, cur_maj, cur_min);
-    parse_version(latest, lat_maj, lat_min);
-    bool up_to_date = latest.empty() ||
-                      (cur_maj > lat_maj) ||
-                      (cur_maj == lat_maj && cur_min >= lat_min);
-
-    bool trigger_update_available = false;
-    update::UpdateState new_state;
-    if (up_to_date) {
-      ESP_LOGD(TAG, "Firmware is up to date");
-      new_state = update::UPDATE_STATE_NO_UPDATE;
-    } else {
-      ESP_LOGD(TAG, "Update available: %s -> %s, release URL: %s",
-               result->info.current_version.c_str(), result->info.latest_version.c_str(),
-               result->info.release_url.c_str());
-      new_state = update::UPDATE_STATE_AVAILABLE;
-      if (this_update->state_ != update::UPDATE_STATE_AVAILABLE) {
-        trigger_update_available = true;
-      }
+  const std::string &latest = info.latest_version;
+  const std::string &current = info.current_version;
+
+  // Parse "major.minor" version strings and compare numerically.
+  // current >= latest means no update needed (handles device ahead of manifest).
+  auto parse_version = [](const std::string &v, int &major, int &minor) {
+    const char *s = v.c_str();
+    major = atoi(s);
+    const char *dot = strchr(s, '.');
+    minor = dot ? atoi(dot + 1) : 0;
+  };
+  int cur_maj, cur_min, lat_maj, lat_min;
+  parse_version(current, cur_maj, cur_min);
+  parse_version(latest, lat_maj, lat_min);
+  bool up_to_date = latest.empty() ||
+                    (cur_maj > lat_maj) ||
+                    (cur_maj == lat_maj && cur_min >= lat_min);
+
+  bool trigger_update_available = false;
+  update::UpdateState new_state;
+  if (up_to_date) {
+    ESP_LOGD(TAG, "Firmware is up to date");
+    new_state = update::UPDATE_STATE_NO_UPDATE;
+  } else {
+    ESP_LOGD(TAG, "Update available: %s -> %s, release URL: %s",
+             info.current_version.c_str(), info.latest_version.c_str(), info.release_url.c_str());
+    new_state = update::UPDATE_STATE_AVAILABLE;
+    if (this->state_ != update::UPDATE_STATE_AVAILABLE) {
+      trigger_update_available = true;
     }
+  }
 
-    this_update->update_info_ = std::move(result->info);
-    this_update->state_ = new_state;
-    delete result;  // Safe: moved-from state is valid for destruction
+  this->update_info_ = std::move(info);
+  this->state_ = new_state;
 
-    this_update->status_clear_error();
-    this_update->publish_state();
+  this->status_clear_error();
+  this->publish_state();
 
-    if (trigger_update_available) {
-      this_update->get_update_available_trigger()->trigger(this_update->update_info_);
-    }
-  });
+  if (trigger_update_available) {
+    this->get_update_available_trigger()->trigger(this->update_info_);
+  }
 }
 
 void KaufEsp8266Update::perform(bool force) {
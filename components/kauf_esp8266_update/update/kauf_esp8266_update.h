@@ -6,15 +6,26 @@
 #include "esphome/components/http_request/http_request.h"
 #include "esphome/components/update/update_entity.h"
 
+#include "manifest_scanner.h"
+
+#include <memory>
+#include <string>
+
 namespace esphome::kauf_esp8266_update {
 
 class KaufEsp8266Update final : public update::UpdateEntity, public PollingComponent {
  public:
   void setup() override;
   void update() override;
+  void loop() override;
+  void dump_config() override;
 
   void perform(bool force) override;
-  void check() override { this->update(); }
+  // KAUF: a manual check ignores the server's Cache-Control / Retry-After hold-off
+  void check() override {
+    this->hold_off_ = false;
+    this->update();
+  }
 
   void set_source_url(const char *source_url) { this->source_url_ = source_url; }
   void set_release_url(const char *release_url) { this->release_url_ = release_url; }
@@ -24,13 +35,36 @@ class KaufEsp8266Update final : public update::UpdateEntity, public PollingCompo
 
   float get_setup_priority() const override { return setup_priority::AFTER_WIFI; }
 
+  /// KAUF: manifest requests sent since boot.
+  uint32_t get_checks() const { return this->checks_; }
+  uint32_t get_checks_failed() const { return this->checks_failed_; }
+  uint32_t get_checks_not_modified() const { return this->checks_not_modified_; }
+
  protected:
   http_request::HttpRequestComponent *request_parent_;
   const char *source_url_{nullptr};
   const char *release_url_{nullptr};   // GitHub releases page — used by HA as "release notes" link
   const char *firmware_url_{nullptr};  // Direct firmware download — used by web UI
 
-  static void update_task(void *params);
+  // KAUF: the manifest is fetched by a state machine driven from loop(), one small read per iteration
+  void start_fetch_();
+  void read_manifest_();
+  void finish_fetch_(const LogString *error);
+  void publish_manifest_(const std::string &name, const std::string &version);
+  /// Deterministic per-device offset in [0, window), derived from the MAC address.
+  uint32_t jitter_(uint32_t window) const;
+
+  std::shared_ptr<http_request::HttpContainer> container_;
+  ManifestScanner scanner_;
+  std::string etag_;  // of the last manifest parsed, sent as If-None-Match
+  uint32_t last_data_ms_{0};
+  uint32_t device_hash_{0};
+  uint32_t hold_off_until_ms_{0};
+  uint32_t checks_{0};
+  uint32_t checks_failed_{0};
+  uint32_t checks_not_modified_{0};
+  bool fetching_{false};
+  bool hold_off_{false};
   uint8_t initial_check_remaining_{0};
   uint8_t retry_count_{0};
 };
@@ -0,0 +1,117 @@
+#include "manifest_scanner.h"
+
+#include <cstring>
+
+namespace esphome::kauf_esp8266_update {
+
+static constexpr uint8_t MAX_DEPTH = 16;
+
+void ManifestScanner::reset() {
+  this->name_.clear();
+  this->version_.clear();
+  this->string_len_ = 0;
+  this->depth_ = 0;
+  this->field_ = FIELD_NONE;
+  this->in_string_ = false;
+  this->escape_ = false;
+  this->expect_key_ = false;
+  this->done_ = false;
+}
+
+void ManifestScanner::end_string_() {
+  // Only top-level keys and values matter
+  if (this->depth_ != 1)
+    return;
+  if (this->expect_key_) {
+    if (this->string_len_ == 4 && memcmp(this->string_, "name", 4) == 0) {
+      this->field_ = FIELD_NAME;
+    } else if (this->string_len_ == 7 && memcmp(this->string_, "version", 7) == 0) {
+      this->field_ = FIELD_VERSION;
+    } else {
+      this->field_ = FIELD_NONE;
+    }
+    return;
+  }
+  if (this->field_ == FIELD_NAME) {
+    this->name_.assign(this->string_, this->string_len_);
+  } else if (this->field_ == FIELD_VERSION) {
+    this->version_.assign(this->string_, this->string_len_);
+  }
+  this->field_ = FIELD_NONE;
+}
+
+bool ManifestScanner::feed(const char *data, size_t len) {
+  for (size_t i = 0; i < len && !this->done_; i++) {
+    char c = data[i];
+    if (this->in_string_) {
+      if (this->escape_) {
+        this->escape_ = false;
+        if (c == 'n') {
+          c = '\n';
+        } else if (c == 't') {
+          c = '\t';
+        }
+      } else if (c == '\\') {
+        this->escape_ = true;
+        continue;
+      } else if (c == '"') {
+        this->in_string_ = false;
+        this->end_string_();
+        continue;
+      }
+      if (this->depth_ == 1 && this->string_len_ < MAX_STRING_LENGTH)
+        this->string_[this->string_len_++] = c;
+      continue;
+    }
+
+    switch (c) {
+      case '{':
+      case '[':
+        if ((this->depth_ == 0 && c != '{') || this->depth_ == MAX_DEPTH)
+          return false;
+        this->depth_++;
+        if (this->depth_ == 1)
+          this->expect_key_ = true;
+        break;
+      case '}':
+      case ']':
+        if (this->depth_ == 0)
+          return false;
+        // A nested object or array as the value of "name" / "version" does not count
+        if (this->depth_ == 2)
+          this->field_ = FIELD_NONE;
+        if (--this->depth_ == 0)
+          this->done_ = true;
+        break;
+      case '"':
+        if (this->depth_ == 0)
+          return false;
+        this->in_string_ = true;
+        this->string_len_ = 0;
+        break;
+      case ':':
+        if (this->depth_ == 1)
+          this->expect_key_ = false;
+        break;
+      case ',':
+        if (this->depth_ == 1) {
+          this->expect_key_ = true;
+          this->field_ = FIELD_NONE;
+        }
+        break;
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        break;
+      default:
+        // Numbers and literals are skipped; anything outside the object is not a manifest
+        if (this->depth_ == 0)
+          return false;
+        break;
+    }
+  }
+  return true;
+}
+
+}  // namespace esphome::kauf_esp8266_update
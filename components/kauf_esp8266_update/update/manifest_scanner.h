@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace esphome::kauf_esp8266_update {
+
+/** KAUF: Incremental scanner for the update manifest.
+ *
+ * Fed the manifest in slices as it arrives and keeps only the top-level "name" and "version" strings, so no buffer
+ * for the whole document and no JsonDocument are needed. Everything else (nested objects, arrays, numbers) is
+ * skipped. Strings longer than MAX_STRING_LENGTH are truncated.
+ */
+class ManifestScanner {
+ public:
+  static constexpr size_t MAX_STRING_LENGTH = 64;
+
+  void reset();
+  /// Scan the next slice. Returns false once the input is not valid enough to continue.
+  bool feed(const char *data, size_t len);
+  /// Whether a complete top-level object with both fields was seen.
+  bool is_complete() const { return this->done_ && !this->name_.empty() && !this->version_.empty(); }
+
+  std::string &name() { return this->name_; }
+  std::string &version() { return this->version_; }
+
+ protected:
+  enum Field : uint8_t { FIELD_NONE, FIELD_NAME, FIELD_VERSION };
+
+  void end_string_();
+
+  std::string name_;
+  std::string version_;
+  char string_[MAX_STRING_LENGTH];
+  uint8_t string_len_{0};
+  uint8_t depth_{0};
+  Field field_{FIELD_NONE};
+  bool in_string_{false};
+  bool escape_{false};
+  bool expect_key_{false};
+  bool done_{false};
+};
+
+}  // namespace esphome::kauf_esp8266_update
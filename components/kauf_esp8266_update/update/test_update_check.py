@@ -0,0 +1,907 @@
+#!/usr/bin/env python3
+"""KAUF: host test for the update checker.
+
+Builds kauf_esp8266_update.cpp and manifest_scanner.cpp with g++ against
+minimal stand-ins for the ESPHome and http_request headers. The stand-in
+scheduler runs on a simulated clock, and the stand-in HTTP client answers
+requests from a queue of canned responses. A driver reads a script of
+commands on stdin (respond, update, run <ms>, ...) and prints every request,
+timer and published state as one JSON object per line.
+
+Checks the streaming manifest scanner fed in slices of every size, ETag /
+If-None-Match handling, parse_delay_seconds() and the loop()-driven read, and
+the check schedule: per-device offsets from the FNV-1 hash of the MAC, the
+retry backoff and its cap, and the Cache-Control / Retry-After hold-off.
+
+    python3 test_update_check.py [--cxx g++] [--keep]
+"""
+
+import argparse
+import json
+import os
+from pathlib import Path
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+HERE = Path(__file__).resolve().parent
+
+STUBS = {
+    "esphome/core/log.h": """
+#pragma once
+#include <cinttypes>
+namespace esphome {
+struct LogString;
+// Arguments are used, nothing is printed
+template<typename... Args> inline void stub_log(const char *tag, const char *format, Args &&...args) {}
+}  // namespace esphome
+#define ESP_LOGD(tag, ...) esphome::stub_log(tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) esphome::stub_log(tag, __VA_ARGS__)
+#define ESP_LOGE(tag, ...) esphome::stub_log(tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) esphome::stub_log(tag, __VA_ARGS__)
+#define LOG_STR(s) (reinterpret_cast<const esphome::LogString *>(s))
+""",
+    "esphome/core/hal.h": """
+#pragma once
+#include <cstdint>
+namespace esphome {
+// Simulated clock, moved by the driver
+inline uint32_t now_ms = 0;
+inline uint32_t millis() { return now_ms; }
+}  // namespace esphome
+""",
+    # Timers run on the simulated clock when the driver calls run_next_timer(). Intervals first run one interval
+    # after they are set. Every timer that is set is reported to on_timer.
+    "esphome/core/component.h": """
+#pragma once
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+namespace esphome {
+static const uint32_t SCHEDULER_DONT_RUN = 4294967295UL;
+namespace setup_priority {
+inline constexpr float AFTER_WIFI = 250.0f;
+}  // namespace setup_priority
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return 0.0f; }
+  virtual void call_setup() { this->setup(); }
+  void enable_loop() { this->loop_enabled = true; }
+  void disable_loop() { this->loop_enabled = false; }
+  void status_set_error(const LogString *message = nullptr) { this->error = true; }
+  void status_clear_error() { this->error = false; }
+
+  void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+    this->add_timer_(name, timeout, 0, std::move(f));
+  }
+  bool cancel_timeout(const std::string &name) { return this->cancel_timer_(name); }
+  void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+    this->add_timer_(name, interval, interval, std::move(f));
+  }
+  void set_interval(uint32_t id, uint32_t interval, std::function<void()> &&f) {
+    this->set_interval("#" + std::to_string(id), interval, std::move(f));
+  }
+  bool cancel_interval(uint32_t id) { return this->cancel_timer_("#" + std::to_string(id)); }
+
+  /// Earliest due time of all timers, false if there are none.
+  bool next_due(uint32_t &due) const {
+    for (const auto &timer : this->timers_) {
+      if (&timer == &this->timers_.front() || timer.due < due)
+        due = timer.due;
+    }
+    return !this->timers_.empty();
+  }
+  /// Moves the clock to the earliest timer and runs it, in the order they were set when several are due.
+  void run_next_timer() {
+    size_t next = 0;
+    for (size_t i = 1; i < this->timers_.size(); i++) {
+      const Timer &t = this->timers_[i];
+      if (t.due < this->timers_[next].due || (t.due == this->timers_[next].due && t.seq < this->timers_[next].seq))
+        next = i;
+    }
+    now_ms = this->timers_[next].due;
+    std::function<void()> f = this->timers_[next].f;
+    if (this->timers_[next].interval != 0) {
+      this->timers_[next].due += this->timers_[next].interval;
+      this->timers_[next].seq = this->seq_++;
+    } else {
+      this->timers_.erase(this->timers_.begin() + next);
+    }
+    f();
+  }
+
+  bool loop_enabled{true};
+  bool error{false};
+  std::function<void(const std::string &name, uint32_t delay)> on_timer;
+
+ protected:
+  struct Timer {
+    std::string name;
+    uint32_t due;
+    uint32_t interval;
+    uint64_t seq;
+    std::function<void()> f;
+  };
+  void add_timer_(const std::string &name, uint32_t delay, uint32_t interval, std::function<void()> &&f) {
+    this->cancel_timer_(name);
+    this->timers_.push_back({name, now_ms + delay, interval, this->seq_++, std::move(f)});
+    if (this->on_timer)
+      this->on_timer(name, delay);
+  }
+  bool cancel_timer_(const std::string &name) {
+    for (auto it = this->timers_.begin(); it != this->timers_.end(); ++it) {
+      if (it->name == name) {
+        this->timers_.erase(it);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<Timer> timers_;
+  uint64_t seq_{0};
+};
+class PollingComponent : public Component {
+ public:
+  virtual void update() = 0;
+  // Like the real one the poller starts before setup(), so setup() can stop it
+  void call_setup() override {
+    this->start_poller();
+    Component::call_setup();
+  }
+  void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+  uint32_t get_update_interval() const { return this->update_interval_; }
+  void start_poller() {
+    if (this->update_interval_ != SCHEDULER_DONT_RUN)
+      this->set_interval("update", this->update_interval_, [this]() { this->update(); });
+  }
+  void stop_poller() { this->cancel_timer_("update"); }
+
+ protected:
+  uint32_t update_interval_{SCHEDULER_DONT_RUN};
+};
+}  // namespace esphome
+""",
+    "esphome/core/helpers.h": """
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <string>
+namespace esphome {
+// Set by the driver, lower case hex without separators like the real one
+inline std::string stub_mac_address = "000000000000";
+inline std::string get_mac_address() { return stub_mac_address; }
+inline uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+}  // namespace esphome
+""",
+    "esphome/core/application.h": """
+#pragma once
+""",
+    "esphome/core/version.h": """
+#pragma once
+#define ESPHOME_VERSION "1.90"
+""",
+    "esphome/components/network/util.h": """
+#pragma once
+namespace esphome::network {
+inline bool stub_connected = true;
+inline bool is_connected() { return stub_connected; }
+}  // namespace esphome::network
+""",
+    "esphome/components/update/update_entity.h": """
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+namespace esphome::update {
+enum UpdateState : uint8_t {
+  UPDATE_STATE_UNKNOWN,
+  UPDATE_STATE_NO_UPDATE,
+  UPDATE_STATE_AVAILABLE,
+  UPDATE_STATE_INSTALLING,
+};
+struct UpdateInfo {
+  std::string latest_version;
+  std::string current_version;
+  std::string title;
+  std::string summary;
+  std::string release_url;
+  std::string firmware_url;
+};
+class UpdateAvailableTrigger {
+ public:
+  void trigger(const UpdateInfo &info) { this->count++; }
+  int count{0};
+};
+class UpdateEntity {
+ public:
+  virtual ~UpdateEntity() = default;
+  virtual void perform(bool force) = 0;
+  virtual void check() = 0;
+  void publish_state() {
+    if (this->on_publish)
+      this->on_publish(this->update_info_, this->state_);
+  }
+  UpdateAvailableTrigger *get_update_available_trigger() { return &this->update_available_trigger_; }
+  const UpdateInfo &get_update_info() const { return this->update_info_; }
+
+  std::function<void(const UpdateInfo &info, UpdateState state)> on_publish;
+
+ protected:
+  UpdateState state_{UPDATE_STATE_UNKNOWN};
+  UpdateInfo update_info_;
+  UpdateAvailableTrigger update_available_trigger_;
+};
+}  // namespace esphome::update
+""",
+    # Responses are taken from a queue, a null entry (or an empty queue) is a failed connection. read() hands out
+    # at most `chunk` bytes per call and 0 once the body is used up, even if content_length promised more.
+    "esphome/components/http_request/http_request.h": """
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+namespace esphome::http_request {
+static constexpr int HTTP_STATUS_OK = 200;
+static constexpr int HTTP_STATUS_NOT_MODIFIED = 304;
+struct Header {
+  std::string name;
+  std::string value;
+};
+class HttpContainer {
+ public:
+  int read(uint8_t *buf, size_t max_len) {
+    this->reads++;
+    this->max_read = std::max(this->max_read, max_len);
+    const size_t len = std::min({max_len, this->chunk, this->body.size() - this->bytes_read_});
+    memcpy(buf, this->body.data() + this->bytes_read_, len);
+    this->bytes_read_ += len;
+    return static_cast<int>(len);
+  }
+  size_t get_bytes_read() const { return this->bytes_read_; }
+  void end() { this->ended = true; }
+  std::string get_response_header(const std::string &name) {
+    auto it = this->headers.find(name);
+    return it == this->headers.end() ? std::string() : it->second;
+  }
+
+  int status_code{0};
+  size_t content_length{0};
+  std::string body;
+  size_t chunk{256};
+  std::map<std::string, std::string> headers;
+  int reads{0};
+  size_t max_read{0};
+  bool ended{false};
+
+ protected:
+  size_t bytes_read_{0};
+};
+class HttpRequestComponent {
+ public:
+  std::shared_ptr<HttpContainer> get(const std::string &url, const std::list<Header> &request_headers,
+                                     const std::vector<std::string> &collect_headers) {
+    if (this->on_request)
+      this->on_request(url, request_headers, collect_headers);
+    if (this->responses.empty())
+      return nullptr;
+    auto response = this->responses.front();
+    this->responses.pop_front();
+    this->last = response;
+    return response;
+  }
+  uint32_t get_timeout() const { return 4500; }
+
+  std::deque<std::shared_ptr<HttpContainer>> responses;
+  std::shared_ptr<HttpContainer> last;
+  std::function<void(const std::string &, const std::list<Header> &, const std::vector<std::string> &)> on_request;
+};
+}  // namespace esphome::http_request
+""",
+}
+
+# Reads one command per line, fields separated by "|", byte strings hex encoded:
+#   mac|<mac>  interval|<ms>  connected|<0/1>  setup  update  check  run|<ms>  stats
+#   respond|<status>|<etag>|<cache-control>|<retry-after>|<body hex>|<chunk>|<content length>  (empty = absent)
+#   fail                        next request does not connect
+#   parse|<value>|<key>         parse_delay_seconds(), empty key = nullptr
+#   scan|<chunk>|<hex>          feeds a fresh ManifestScanner in slices of <chunk> bytes
+DRIVER = r"""
+// parse_delay_seconds() is file static
+#include "kauf_esp8266_update.cpp"
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+using namespace esphome;
+using namespace esphome::kauf_esp8266_update;
+
+static constexpr uint32_t LOOP_INTERVAL_MS = 16;
+
+static std::string quote(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+static std::string unhex(const std::string &hex) {
+  std::string out;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2)
+    out += static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16));
+  return out;
+}
+
+static std::vector<std::string> split(const std::string &line) {
+  std::vector<std::string> fields;
+  std::stringstream ss(line);
+  std::string field;
+  while (std::getline(ss, field, '|'))
+    fields.push_back(field);
+  if (!line.empty() && line.back() == '|')
+    fields.emplace_back();
+  return fields;
+}
+
+static std::string field(const std::vector<std::string> &fields, size_t i) {
+  return i < fields.size() ? fields[i] : std::string();
+}
+
+// Runs loop() every LOOP_INTERVAL_MS while it is enabled and the timers in between
+static void run(KaufEsp8266Update &update, uint32_t ms) {
+  const uint32_t end = now_ms + ms;
+  for (;;) {
+    uint32_t due = 0;
+    const bool timer = update.next_due(due) && due <= end;
+    const uint32_t next_loop = now_ms + LOOP_INTERVAL_MS;
+    if (update.loop_enabled && next_loop <= end && (!timer || next_loop < due)) {
+      now_ms = next_loop;
+      update.loop();
+    } else if (timer) {
+      update.run_next_timer();
+    } else {
+      break;
+    }
+  }
+  now_ms = end;
+}
+
+int main() {
+  http_request::HttpRequestComponent http;
+  KaufEsp8266Update update;
+  update.set_request_parent(&http);
+  update.set_source_url("http://example.com/manifest.json");
+  update.set_release_url("http://example.com/releases");
+
+  http.on_request = [](const std::string &url, const std::list<http_request::Header> &headers,
+                       const std::vector<std::string> &collect) {
+    std::string if_none_match = "null";
+    for (const auto &header : headers) {
+      if (header.name == "If-None-Match")
+        if_none_match = quote(header.value);
+    }
+    std::string collected;
+    for (const auto &name : collect)
+      collected += (collected.empty() ? "" : ", ") + quote(name);
+    printf("{\"event\": \"request\", \"t\": %u, \"if_none_match\": %s, \"collect\": [%s]}\n", now_ms,
+           if_none_match.c_str(), collected.c_str());
+  };
+  update.on_timer = [](const std::string &name, uint32_t delay) {
+    printf("{\"event\": \"timer\", \"t\": %u, \"name\": %s, \"delay\": %u}\n", now_ms, quote(name).c_str(), delay);
+  };
+  update.on_publish = [&update](const update::UpdateInfo &info, update::UpdateState state) {
+    printf("{\"event\": \"publish\", \"t\": %u, \"title\": %s, \"latest\": %s, \"current\": %s, \"state\": %d, "
+           "\"triggers\": %d}\n",
+           now_ms, quote(info.title).c_str(), quote(info.latest_version).c_str(), quote(info.current_version).c_str(),
+           state, update.get_update_available_trigger()->count);
+  };
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    const std::vector<std::string> f = split(line);
+    if (f.empty())
+      continue;
+    const std::string &cmd = f[0];
+    if (cmd == "mac") {
+      stub_mac_address = field(f, 1);
+    } else if (cmd == "interval") {
+      update.set_update_interval(std::stoul(field(f, 1)));
+    } else if (cmd == "connected") {
+      network::stub_connected = field(f, 1) == "1";
+    } else if (cmd == "setup") {
+      update.call_setup();
+    } else if (cmd == "update") {
+      update.update();
+    } else if (cmd == "check") {
+      update.check();
+    } else if (cmd == "run") {
+      run(update, std::stoul(field(f, 1)));
+    } else if (cmd == "fail") {
+      http.responses.push_back(nullptr);
+    } else if (cmd == "respond") {
+      auto response = std::make_shared<http_request::HttpContainer>();
+      response->status_code = std::stoi(field(f, 1));
+      if (!field(f, 2).empty())
+        response->headers["etag"] = field(f, 2);
+      if (!field(f, 3).empty())
+        response->headers["cache-control"] = field(f, 3);
+      if (!field(f, 4).empty())
+        response->headers["retry-after"] = field(f, 4);
+      response->body = unhex(field(f, 5));
+      if (!field(f, 6).empty())
+        response->chunk = std::stoul(field(f, 6));
+      response->content_length = field(f, 7).empty() ? response->body.size() : std::stoul(field(f, 7));
+      http.responses.push_back(response);
+    } else if (cmd == "parse") {
+      const std::string key = field(f, 2);
+      printf("{\"event\": \"parse\", \"seconds\": %u}\n",
+             parse_delay_seconds(field(f, 1), key.empty() ? nullptr : key.c_str()));
+    } else if (cmd == "scan") {
+      const size_t chunk = std::stoul(field(f, 1));
+      const std::string data = unhex(field(f, 2));
+      ManifestScanner scanner;
+      scanner.reset();
+      bool ok = true;
+      for (size_t i = 0; i < data.size() && ok; i += chunk)
+        ok = scanner.feed(data.data() + i, std::min(chunk, data.size() - i));
+      printf("{\"event\": \"scan\", \"ok\": %s, \"complete\": %s, \"name\": %s, \"version\": %s}\n",
+             ok ? "true" : "false", scanner.is_complete() ? "true" : "false", quote(scanner.name()).c_str(),
+             quote(scanner.version()).c_str());
+    } else if (cmd == "stats") {
+      const auto &last = http.last;
+      printf("{\"event\": \"stats\", \"t\": %u, \"checks\": %u, \"failed\": %u, \"not_modified\": %u, \"error\": %s, "
+             "\"loop\": %s, \"reads\": %d, \"max_read\": %zu, \"ended\": %s}\n",
+             now_ms, update.get_checks(), update.get_checks_failed(), update.get_checks_not_modified(),
+             update.error ? "true" : "false", update.loop_enabled ? "true" : "false", last ? last->reads : 0,
+             last ? last->max_read : 0, last == nullptr || last->ended ? "true" : "false");
+    } else {
+      fprintf(stderr, "unknown command %s\n", cmd.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
+"""
+
+MANIFEST = (
+    b'{\n  "name": "KAUF Plug",\n  "version": "1.95",\n'
+    b'  "builds": [{"chipFamily": "ESP8266", "parts": [{"path": "x.bin", "offset": 0}]}]\n}\n'
+)
+
+
+def respond(
+    status: int = 200,
+    body: bytes = MANIFEST,
+    etag: str = "",
+    cache_control: str = "",
+    retry_after: str = "",
+    chunk: int = 0,
+    content_length: int = -1,
+) -> str:
+    fields = [str(status), etag, cache_control, retry_after, body.hex(), str(chunk) if chunk else ""]
+    fields.append(str(content_length) if content_length >= 0 else "")
+    return "respond|" + "|".join(fields)
+
+
+def setUpModule() -> None:
+    # One driver for all test classes, module cleanups also run when the build fails
+    tmp = Path(tempfile.mkdtemp(prefix="update_check_test_"))
+    unittest.addModuleCleanup(_remove_tmp, tmp)
+    for name, text in STUBS.items():
+        path = tmp / "include" / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(text)
+    src = tmp / "src"
+    src.mkdir()
+    for name in ("kauf_esp8266_update.h", "kauf_esp8266_update.cpp", "manifest_scanner.h", "manifest_scanner.cpp"):
+        shutil.copy(HERE / name, src / name)
+    (src / "driver.cpp").write_text(DRIVER)
+    UpdateCheckTestBase.driver = tmp / "driver"
+    subprocess.run(
+        [
+            UpdateCheckTestBase.cxx,
+            "-std=gnu++17",
+            "-O1",
+            "-Wall",
+            "-Werror",
+            "-fsanitize=address,undefined",
+            "-I",
+            str(tmp / "include"),
+            str(src / "manifest_scanner.cpp"),
+            str(src / "driver.cpp"),
+            "-o",
+            str(UpdateCheckTestBase.driver),
+        ],
+        check=True,
+    )
+
+
+def _remove_tmp(tmp: Path) -> None:
+    if UpdateCheckTestBase.keep:
+        print(f"test files kept in {tmp}")
+    else:
+        shutil.rmtree(tmp)
+
+
+class UpdateCheckTestBase(unittest.TestCase):
+    cxx = "g++"
+    keep = False
+    driver: Path
+
+    def _run(self, *commands: str) -> list:
+        proc = subprocess.run(
+            [str(self.driver)],
+            input="\n".join(commands) + "\n",
+            check=True,
+            capture_output=True,
+            text=True,
+        )
+        return [json.loads(line) for line in proc.stdout.splitlines()]
+
+    @staticmethod
+    def _events(events: list, kind: str) -> list:
+        return [e for e in events if e["event"] == kind]
+
+
+class ManifestScannerTest(UpdateCheckTestBase):
+    def _scan(self, data: bytes, chunk: int = 1024) -> dict:
+        return self._run(f"scan|{chunk}|{data.hex()}")[0]
+
+    def test_every_slice_size(self) -> None:
+        commands = [f"scan|{chunk}|{MANIFEST.hex()}" for chunk in range(1, len(MANIFEST) + 1)]
+        for result in self._run(*commands):
+            self.assertTrue(result["ok"])
+            self.assertTrue(result["complete"])
+            self.assertEqual(result["name"], "KAUF Plug")
+            self.assertEqual(result["version"], "1.95")
+
+    def test_nested_keys_ignored(self) -> None:
+        result = self._scan(b'{"builds": {"name": "inner", "version": "0.1"}, "name": "outer", "version": "2.0"}')
+        self.assertEqual((result["name"], result["version"]), ("outer", "2.0"))
+        # An object as the value of "name" is not a name
+        result = self._scan(b'{"name": {"x": "y"}, "version": "2.0"}')
+        self.assertTrue(result["ok"])
+        self.assertFalse(result["complete"])
+
+    def test_escapes_and_truncation(self) -> None:
+        result = self._scan(b'{"name": "a \\"b\\" \\\\ c", "version": "1.\\t2"}')
+        self.assertEqual(result["name"], 'a "b" \\ c')
+        self.assertEqual(result["version"], "1.\t2")
+        long_name = "n" * 100
+        result = self._scan(b'{"name": "%s", "version": "1"}' % long_name.encode())
+        self.assertTrue(result["complete"])
+        self.assertEqual(result["name"], long_name[:64])
+
+    def test_incomplete(self) -> None:
+        for data in (b'{"name": "x"}', b'{"name": "x", "version": "1"', b'{"version": "1", "name": ""}'):
+            with self.subTest(data=data):
+                result = self._scan(data)
+                self.assertTrue(result["ok"])
+                self.assertFalse(result["complete"])
+
+    def test_invalid(self) -> None:
+        for data in (b'["name", "version"]', b'<html>{"name": "x", "version": "1"}', b'"x"'):
+            with self.subTest(data=data):
+                self.assertFalse(self._scan(data)["ok"])
+        self.assertFalse(self._scan(b"{" * 20)["ok"])
+
+    def test_trailing_data_ignored(self) -> None:
+        result = self._scan(b'{"name": "x", "version": "1"} trailing garbage {')
+        self.assertTrue(result["ok"])
+        self.assertTrue(result["complete"])
+
+
+class ParseDelaySecondsTest(UpdateCheckTestBase):
+    def test_values(self) -> None:
+        cases = [
+            ("max-age=300", "max-age=", 300),
+            ("public, max-age=600, must-revalidate", "max-age=", 600),
+            ("no-cache", "max-age=", 0),
+            ("", "max-age=", 0),
+            ("120", "", 120),
+            ("Wed, 21 Oct 2015 07:28:00 GMT", "", 0),
+            # Capped at a day
+            ("max-age=31536000", "max-age=", 86400),
+            ("99999999999999999999", "", 86400),
+        ]
+        results = self._run(*(f"parse|{value}|{key}" for value, key, _ in cases))
+        for (value, key, seconds), result in zip(cases, results):
+            with self.subTest(value=value):
+                self.assertEqual(result["seconds"], seconds)
+
+
+class ManifestFetchTest(UpdateCheckTestBase):
+    def test_etag(self) -> None:
+        events = self._run(
+            respond(etag='"v1"'),
+            "update",
+            "run|1000",
+            respond(304),
+            "update",
+            "run|1000",
+            # A 304 keeps the ETag of the manifest it refers to
+            respond(304, body=b"", etag='"other"'),
+            "update",
+            "run|1000",
+            "stats",
+        )
+        requests = self._events(events, "request")
+        self.assertEqual([r["if_none_match"] for r in requests], [None, '"v1"', '"v1"'])
+        self.assertEqual(requests[0]["collect"], ["etag", "cache-control", "retry-after"])
+        publishes = self._events(events, "publish")
+        self.assertEqual(len(publishes), 3)
+        for publish in publishes:
+            self.assertEqual((publish["title"], publish["latest"]), ("KAUF Plug", "1.95"))
+        # Update available is triggered once after the first publish, not on the 304 re-publishes
+        self.assertEqual([p["triggers"] for p in publishes], [0, 1, 1])
+        stats = self._events(events, "stats")[0]
+        self.assertEqual((stats["checks"], stats["not_modified"], stats["failed"]), (3, 2, 0))
+
+    def test_etag_only_from_parsed_manifest(self) -> None:
+        events = self._run(
+            respond(etag='"v1"'),
+            "update",
+            "run|1000",
+            respond(body=b'{"name": "x"}', etag='"broken"'),
+            "update",
+            "run|1000",
+            respond(etag='"v2"'),
+            "update",
+            "run|1000",
+            respond(304),
+            "update",
+            "run|1000",
+        )
+        requests = self._events(events, "request")
+        self.assertEqual([r["if_none_match"] for r in requests], [None, '"v1"', '"v1"', '"v2"'])
+
+    def test_read_in_slices_from_loop(self) -> None:
+        events = self._run(respond(chunk=10), "update", "stats", "run|10000", "stats")
+        before, after = self._events(events, "stats")
+        # Nothing is read before loop() runs
+        self.assertEqual(before["reads"], 0)
+        self.assertTrue(before["loop"])
+        self.assertEqual(after["reads"], -(-len(MANIFEST) // 10))
+        self.assertEqual(after["max_read"], 256)
+        self.assertFalse(after["loop"])
+        self.assertTrue(after["ended"])
+        self.assertEqual(len(self._events(events, "publish")), 1)
+
+    def test_read_timeout(self) -> None:
+        events = self._run(
+            respond(body=MANIFEST[:20], content_length=len(MANIFEST)),
+            "update",
+            "run|4000",
+            "stats",
+            "run|1000",
+            "stats",
+        )
+        waiting, timed_out = self._events(events, "stats")
+        self.assertTrue(waiting["loop"])
+        self.assertFalse(waiting["error"])
+        self.assertFalse(timed_out["loop"])
+        self.assertTrue(timed_out["error"])
+        self.assertTrue(timed_out["ended"])
+        self.assertEqual(timed_out["failed"], 1)
+        self.assertEqual(self._events(events, "publish"), [])
+
+    def test_rejected(self) -> None:
+        cases = {
+            "too large": respond(body=b" " * 4097),
+            "empty": respond(body=b""),
+            "not json": respond(body=b"<html></html>"),
+            "not found": respond(404, body=b"not found"),
+            "no connection": "fail",
+        }
+        for name, response in cases.items():
+            with self.subTest(name):
+                events = self._run(response, "update", "run|10000", "stats")
+                stats = self._events(events, "stats")[0]
+                self.assertEqual((stats["checks"], stats["failed"]), (1, 1))
+                self.assertTrue(stats["error"])
+                self.assertTrue(stats["ended"])
+                self.assertFalse(stats["loop"])
+                self.assertEqual(self._events(events, "publish"), [])
+
+
+
+MACS = ("c45bbe112233", "c45bbe112234", "84f3eb000001", "5ccf7f9a8b7c")
+HOUR_MS = 60 * 60 * 1000
+INTERVAL_MS = 6 * HOUR_MS
+
+
+def fnv1(text: str) -> int:
+    value = 2166136261
+    for c in text.encode():
+        value = (value * 16777619) & 0xFFFFFFFF
+        value ^= c
+    return value
+
+
+def retry_delay(mac: str, retry: int, server_delay_ms: int = 0) -> int:
+    delay = min(60000 << retry, HOUR_MS)
+    delay += fnv1(mac) % (delay // 4)
+    return max(delay, server_delay_ms)
+
+
+class UpdateScheduleTest(UpdateCheckTestBase):
+    def _timers(self, events: list, name: str) -> list:
+        return [e for e in self._events(events, "timer") if e["name"] == name]
+
+    def test_offsets_from_mac(self) -> None:
+        initial = set()
+        for mac in MACS:
+            with self.subTest(mac=mac):
+                events = self._run(f"mac|{mac}", f"interval|{INTERVAL_MS}", "setup", respond(), "run|600000")
+                # Regular checks start after an offset within a quarter of the interval, at most 30 minutes
+                (jitter,) = self._timers(events, "jitter")
+                self.assertEqual(jitter["delay"], fnv1(mac) % (30 * 60 * 1000))
+                # The first check waits for the network (10 s polls), then for an offset within 5 minutes
+                (first,) = self._timers(events, "initial")
+                self.assertEqual(first["t"], 10000)
+                self.assertEqual(first["delay"], fnv1(mac) % (5 * 60 * 1000))
+                (request,) = self._events(events, "request")
+                self.assertEqual(request["t"], 10000 + first["delay"])
+                initial.add(request["t"])
+        # Devices that boot together do not check together
+        self.assertEqual(len(initial), len(MACS))
+
+    def test_poll_offset_window(self) -> None:
+        mac = MACS[0]
+        for interval, window in ((HOUR_MS, HOUR_MS // 4), (INTERVAL_MS, 30 * 60 * 1000)):
+            with self.subTest(interval=interval):
+                events = self._run(f"mac|{mac}", "connected|0", f"interval|{interval}", "setup", f"run|{window}")
+                (jitter,) = self._timers(events, "jitter")
+                self.assertEqual(jitter["delay"], fnv1(mac) % window)
+                # The poller set up front is replaced by one started at the offset
+                polls = self._timers(events, "update")
+                self.assertEqual([(p["t"], p["delay"]) for p in polls], [(0, interval), (jitter["delay"], interval)])
+
+    def test_backoff(self) -> None:
+        for mac in MACS:
+            with self.subTest(mac=mac):
+                # Every request fails to connect
+                events = self._run(f"mac|{mac}", f"interval|{INTERVAL_MS}", "setup", "run|7200000", "stats")
+                retries = self._timers(events, "retry")
+                self.assertEqual([r["delay"] for r in retries], [retry_delay(mac, n) for n in range(6)])
+                requests = self._events(events, "request")
+                self.assertEqual(len(requests), 7)
+                # Each retry goes out when its timer is due
+                for retry, request in zip(retries, requests[1:]):
+                    self.assertEqual(request["t"], retry["t"] + retry["delay"])
+                self.assertEqual(self._events(events, "stats")[0]["failed"], 7)
+
+    def test_backoff_capped_by_interval(self) -> None:
+        mac = MACS[1]
+        interval = 5 * 60 * 1000
+        events = self._run(f"mac|{mac}", f"interval|{interval}", "setup", "run|3600000")
+        # Retries later than the next regular check are left to the poller
+        retries = self._timers(events, "retry")
+        expected = [d for d in (retry_delay(mac, n) for n in range(6)) if d < interval]
+        self.assertEqual([r["delay"] for r in retries], expected)
+        self.assertGreater(len(self._events(events, "request")), len(expected) + 1)
+
+    def test_success_resets_backoff(self) -> None:
+        mac = MACS[2]
+        events = self._run(
+            f"mac|{mac}",
+            f"interval|{INTERVAL_MS}",
+            "setup",
+            "fail",
+            "fail",
+            respond(),
+            "run|1000000",
+            "update",
+            "run|1000",
+        )
+        delays = [r["delay"] for r in self._timers(events, "retry")]
+        self.assertEqual(delays, [retry_delay(mac, 0), retry_delay(mac, 1), retry_delay(mac, 0)])
+
+    def test_retry_after(self) -> None:
+        mac = MACS[3]
+        for status in (429, 503):
+            with self.subTest(status=status):
+                events = self._run(
+                    f"mac|{mac}",
+                    f"interval|{INTERVAL_MS}",
+                    "connected|0",
+                    "setup",
+                    "connected|1",
+                    respond(status, body=b"", retry_after="7200"),
+                    "update",
+                    # Regular checks inside the hold-off don't reach the server
+                    "run|3600000",
+                    "update",
+                    respond(),
+                    "run|3601000",
+                )
+                (retry,) = self._timers(events, "retry")
+                # The server's delay wins over the 1 minute backoff
+                self.assertEqual(retry["delay"], retry_delay(mac, 0, 7200 * 1000))
+                requests = self._events(events, "request")
+                self.assertEqual([r["t"] for r in requests], [0, 7200 * 1000])
+                self.assertEqual(len(self._events(events, "publish")), 1)
+
+    def test_retry_after_beyond_interval(self) -> None:
+        events = self._run(
+            f"interval|{INTERVAL_MS}",
+            respond(429, body=b"", retry_after="86400"),
+            "update",
+            f"run|{INTERVAL_MS}",
+            "update",
+            respond(),
+            "check",
+            "run|1000",
+        )
+        # No retry later than the next regular check, the hold-off still applies to it but not to a manual check
+        self.assertEqual(self._timers(events, "retry"), [])
+        self.assertEqual([r["t"] for r in self._events(events, "request")], [0, INTERVAL_MS])
+
+    def test_cache_control_hold_off(self) -> None:
+        events = self._run(
+            f"interval|{INTERVAL_MS}",
+            respond(cache_control="public, max-age=600"),
+            "update",
+            "run|300000",
+            "update",
+            # The hold-off counts from the end of the fetch, one loop() pass later
+            "run|300100",
+            respond(),
+            "update",
+            "run|1000",
+            "stats",
+        )
+        self.assertEqual([r["t"] for r in self._events(events, "request")], [0, 600100])
+        stats = self._events(events, "stats")[0]
+        self.assertEqual((stats["checks"], stats["failed"]), (2, 0))
+        # Retry-After only counts on 429 / 503
+        events = self._run(respond(retry_after="600"), "update", "run|1000", respond(), "update", "run|1000")
+        self.assertEqual(len(self._events(events, "request")), 2)
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--keep", action="store_true", help="keep the build directory")
+    args, rest = parser.parse_known_args()
+    UpdateCheckTestBase.cxx = args.cxx
+    UpdateCheckTestBase.keep = args.keep
+    program = unittest.main(argv=[sys.argv[0], *rest], exit=False)
+    return 0 if program.result.wasSuccessful() else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
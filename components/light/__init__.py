@@ -194,6 +194,13 @@ def _final_validate(config: ConfigType) -> ConfigType:
 FINAL_VALIDATE_SCHEMA = _final_validate
 
 
+# KAUF: effect frame scheduling
+FramePolicy = light_ns.enum("FramePolicy")
+FRAME_POLICIES = {
+    "SKIP": FramePolicy.FRAME_POLICY_SKIP,
+    "CATCH_UP": FramePolicy.FRAME_POLICY_CATCH_UP,
+}
+
 LightRestoreMode = light_ns.enum("LightRestoreMode")
 RESTORE_MODES = {
     "RESTORE_DEFAULT_OFF": LightRestoreMode.LIGHT_RESTORE_DEFAULT_OFF,
@@ -243,6 +250,14 @@ LIGHT_SCHEMA = (
             # false = migrate hash only
             # true = migrate hash and data format
             cv.Optional("migrate_from_old_hash"): cv.boolean,
+
+            # KAUF: coalesce preference writes; only the last value within the delay is saved
+            cv.Optional("save_delay"): cv.positive_time_period_milliseconds,
+
+            # KAUF: effect frame scheduling
+            cv.Optional("effect_frame_rate"): cv.int_range(min=0, max=1000),
+            cv.Optional("effect_frame_budget"): cv.positive_time_period_microseconds,
+            cv.Optional("effect_frame_policy"): cv.enum(FRAME_POLICIES, upper=True),
         }
     )
 )
@@ -425,6 +440,24 @@ async def setup_light_core_(light_var, config, output_var):
         cg.add_define("USE_KAUF_LIGHT_HASH_MIGRATION")
         if config["migrate_from_old_hash"]:
             cg.add_define("USE_KAUF_LIGHT_DATA_MIGRATION")
+    # KAUF: save coalescing
+    if "save_delay" in config:
+        cg.add(light_var.set_save_delay(config["save_delay"]))
+    # KAUF: effect frame scheduling
+    if "effect_frame_rate" in config:
+        cg.add(
+            light_var.get_frame_scheduler().set_target_fps(config["effect_frame_rate"])
+        )
+    if "effect_frame_budget" in config:
+        cg.add(
+            light_var.get_frame_scheduler().set_frame_budget(
+                config["effect_frame_budget"]
+            )
+        )
+    if "effect_frame_policy" in config:
+        cg.add(
+            light_var.get_frame_scheduler().set_policy(config["effect_frame_policy"])
+        )
 
 
 async def register_light(output_var, config):
@@ -34,6 +34,39 @@ Color color_from_light_color_values(LightColorValues val) {
   return Color(r, g, b, w);
 }
 
+void AddressableLight::fill(int32_t from, int32_t to, const Color &color) {
+  const Color corrected = this->correction_.color_correct(color);
+  for (int32_t i = from; i < to; i++)
+    this->get_tracked_view_(i).set_raw(corrected);
+}
+
+void AddressableLight::move(int32_t dst, int32_t src, int32_t count) {
+  if (count <= 0 || dst == src)
+    return;
+  // Same correction on both sides, so raw values can be copied as-is.
+  if (dst < src) {
+    for (int32_t i = 0; i < count; i++)
+      this->get_tracked_view_(dst + i).set_raw(this->get_view_internal(src + i).get_raw());
+  } else {
+    for (int32_t i = count - 1; i >= 0; i--)
+      this->get_tracked_view_(dst + i).set_raw(this->get_view_internal(src + i).get_raw());
+  }
+}
+
+void AddressableLight::blit(int32_t from, const Color *colors, int32_t count) {
+  count = std::min(count, this->size() - from);
+  const bool use_lut = this->use_bulk_lut_(count);
+  for (int32_t i = 0; i < count; i++)
+    this->get_tracked_view_(from + i).set_raw(this->correct_bulk_(colors[i], use_lut));
+}
+
+void AddressableLight::blit_rgb(int32_t from, const uint8_t *rgb, int32_t count) {
+  count = std::min(count, this->size() - from);
+  const bool use_lut = this->use_bulk_lut_(count);
+  for (int32_t i = 0; i < count; i++, rgb += 3)
+    this->get_tracked_view_(from + i).set_raw(this->correct_bulk_(Color(rgb[0], rgb[1], rgb[2], 0), use_lut));
+}
+
 void AddressableLight::update_state(LightState *state) {
   auto val = state->current_values;
   auto max_brightness = to_uint8_scale(val.get_brightness() * val.get_state());
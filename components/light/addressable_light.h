@@ -28,8 +28,8 @@ class AddressableLightState : public LightState {
 class AddressableLight : public LightOutput, public Component {
  public:
   virtual int32_t size() const = 0;
-  ESPColorView operator[](int32_t index) const { return this->get_view_internal(interpret_index(index, this->size())); }
-  ESPColorView get(int32_t index) { return this->get_view_internal(interpret_index(index, this->size())); }
+  ESPColorView operator[](int32_t index) const { return this->get_tracked_view_(interpret_index(index, this->size())); }
+  ESPColorView get(int32_t index) { return this->get_tracked_view_(interpret_index(index, this->size())); }
   virtual void clear_effect_data() = 0;
   ESPRangeView range(int32_t from, int32_t to) {
     from = interpret_index(from, this->size());
@@ -37,6 +37,34 @@ class AddressableLight : public LightOutput, public Component {
     return ESPRangeView(this, from, to);
   }
   ESPRangeView all() { return ESPRangeView(this, 0, this->size()); }
+
+  // Bulk operations. These apply color correction once (or through the correction lookup tables) instead of per
+  // pixel and channel, and copy raw buffer values instead of round-tripping through color_uncorrect().
+
+  /// Set pixels [from, to) to a single color.
+  void fill(int32_t from, int32_t to, const Color &color);
+  /// Copy `count` pixels starting at `src` to `dst`. The ranges may overlap.
+  void move(int32_t dst, int32_t src, int32_t count);
+  /// Set `count` pixels starting at `from` from an array of colors.
+  void blit(int32_t from, const Color *colors, int32_t count);
+  /// Set `count` pixels starting at `from` from a packed RGB buffer (3 bytes per pixel). White is set to 0.
+  void blit_rgb(int32_t from, const uint8_t *rgb, int32_t count);
+  /// Set pixels [from, to) to `generator(index)`.
+  template<typename F> void generate(int32_t from, int32_t to, F &&generator) {
+    const bool use_lut = this->use_bulk_lut_(to - from);
+    for (int32_t i = from; i < to; i++)
+      this->get_tracked_view_(i).set_raw(this->correct_bulk_(generator(i), use_lut));
+  }
+  /// Set the RGB channels of pixels [from, to) to `generator(index)`. The white channel is left untouched,
+  /// matching ESPColorSettable::set_rgb().
+  template<typename F> void generate_rgb(int32_t from, int32_t to, F &&generator) {
+    const bool use_lut = this->use_bulk_lut_(to - from);
+    for (int32_t i = from; i < to; i++) {
+      Color c = this->correct_bulk_(generator(i), use_lut);
+      this->get_tracked_view_(i).set_raw_rgb(c.r, c.g, c.b);
+    }
+  }
+
   ESPRangeIterator begin() { return this->all().begin(); }
   ESPRangeIterator end() { return this->all().end(); }
   void shift_left(int32_t amnt) {
@@ -46,7 +74,7 @@ class AddressableLight : public LightOutput, public Component {
     }
     if (amnt > this->size())
       amnt = this->size();
-    this->range(0, -amnt) = this->range(amnt, this->size());
+    this->move(0, amnt, this->size() - amnt);
   }
   void shift_right(int32_t amnt) {
     if (amnt < 0) {
@@ -55,7 +83,7 @@ class AddressableLight : public LightOutput, public Component {
     }
     if (amnt > this->size())
       amnt = this->size();
-    this->range(amnt, this->size()) = this->range(0, -amnt);
+    this->move(amnt, 0, this->size() - amnt);
   }
   // Indicates whether an effect that directly updates the output buffer is active to prevent overwriting
   bool is_effect_active() const { return this->effect_active_; }
@@ -72,7 +100,25 @@ class AddressableLight : public LightOutput, public Component {
     this->state_parent_ = state;
   }
   void update_state(LightState *state) override;
-  void schedule_show() { this->state_parent_->schedule_write_(); }
+  /// Request a write of the output buffer. Does nothing if no pixel changed since the last show.
+  void schedule_show() {
+    if (this->dirty_.is_dirty())
+      this->state_parent_->schedule_write_();
+  }
+
+  /// Whether any pixel changed since the last show. Drivers can skip pushing a frame when this is false.
+  bool is_dirty() const { return this->dirty_.is_dirty(); }
+  /// The span of pixels changed since the last show (empty if nothing changed).
+  ESPRangeView dirty_range() {
+    if (!this->dirty_.is_dirty())
+      return ESPRangeView(this, 0, 0);
+    return ESPRangeView(this, this->dirty_.get_begin(), std::min(this->dirty_.get_end(), this->size()));
+  }
+  /// Mark the whole strip as changed, e.g. after the driver modified its buffer without going through ESPColorView.
+  void mark_all_dirty() {
+    this->dirty_.mark_all(this->size());
+    this->dirty_.invalidate_lit_count();
+  }
 
 #ifdef USE_POWER_SUPPLY
   void set_power_supply(power_supply::PowerSupply *power_supply) { this->power_.set_parent(power_supply); }
@@ -83,24 +129,52 @@ class AddressableLight : public LightOutput, public Component {
  protected:
   friend class AddressableLightTransformer;
 
+  /// Called by drivers after the buffer was pushed out. Updates the power supply state and resets the dirty span.
   void mark_shown_() {
 #ifdef USE_POWER_SUPPLY
-    for (const auto &c : *this) {
-      if (c.get_red_raw() > 0 || c.get_green_raw() > 0 || c.get_blue_raw() > 0 || c.get_white_raw() > 0) {
-        this->power_.request();
-        return;
+    // Count lit pixels once; afterwards ESPColorView keeps the count up to date on every write.
+    if (!this->dirty_.has_lit_count()) {
+      int32_t lit_count = 0;
+      for (const auto &c : *this) {
+        if (c.get_red_raw() > 0 || c.get_green_raw() > 0 || c.get_blue_raw() > 0 || c.get_white_raw() > 0)
+          lit_count++;
       }
+      this->dirty_.set_lit_count(lit_count);
+    }
+    if (this->dirty_.get_lit_count() > 0) {
+      this->power_.request();
+    } else {
+      this->power_.unrequest();
     }
-    this->power_.unrequest();
 #endif
+    this->dirty_.clear();
   }
   virtual ESPColorView get_view_internal(int32_t index) const = 0;
+  /// Building the correction tables costs 4 x 256 channel corrections, a direct RGB write 3 per pixel, so the
+  /// tables pay off from about 1024 / 3 pixels on, even when they are rebuilt for a single write (a brightness
+  /// change every frame during a transition).
+  static constexpr int32_t BULK_LUT_MIN_PIXELS = 342;
+  /// Whether a bulk write of `pixels` pixels should go through the correction tables. Tables that are already
+  /// built are always used.
+  bool use_bulk_lut_(int32_t pixels) const {
+    return this->correction_.has_lut() || pixels >= BULK_LUT_MIN_PIXELS;
+  }
+  Color correct_bulk_(const Color &color, bool use_lut) const {
+    return use_lut ? this->correction_.color_correct_lut(color) : this->correction_.color_correct(color);
+  }
+  ESPColorView get_tracked_view_(int32_t index) const {
+    ESPColorView view = this->get_view_internal(index);
+    view.raw_set_dirty_tracker(&this->dirty_, index);
+    return view;
+  }
 
   ESPColorCorrection correction_{};
   LightState *state_parent_{nullptr};
 #ifdef USE_POWER_SUPPLY
   power_supply::PowerSupplyRequester power_;
 #endif
+  /// Pixels written since the last show. Mutable because const views still write through to the buffer.
+  mutable ESPDirtyTracker dirty_{};
   bool effect_active_{false};
 };
 
@@ -50,8 +50,18 @@ class AddressableLightEffect : public LightEffect {
   /// Check if this is the currently running addressable effect.
   bool is_current_effect() const { return this->is_active() && this->get_addressable_()->is_effect_active(); }
 
+  /// Render into `target` instead of the light's output, e.g. a layer buffer of AddressableLayersEffect.
+  /// Pass nullptr to render to the light's output again.
+  void set_render_target(AddressableLight *target) { this->render_target_ = target; }
+
  protected:
-  AddressableLight *get_addressable_() const { return (AddressableLight *) this->state_->get_output(); }
+  AddressableLight *get_addressable_() const {
+    if (this->render_target_ != nullptr)
+      return this->render_target_;
+    return (AddressableLight *) this->state_->get_output();
+  }
+
+  AddressableLight *render_target_{nullptr};
 };
 
 class AddressableLambdaLightEffect : public AddressableLightEffect {
@@ -86,11 +96,11 @@ class AddressableRainbowLightEffect : public AddressableLightEffect {
     hsv.saturation = 240;
     uint16_t hue = (millis() * this->speed_) % 0xFFFF;
     const uint16_t add = 0xFFFF / this->width_;
-    for (auto var : it) {
+    it.generate_rgb(0, it.size(), [&hsv, &hue, add](int32_t) {
       hsv.hue = hue >> 8;
-      var = hsv;
       hue += add;
-    }
+      return hsv.to_rgb();
+    });
     it.schedule_show();
   }
   void set_speed(uint32_t speed) { this->speed_ = speed; }
@@ -0,0 +1,145 @@
+#include "addressable_light_layers.h"
+#include "light_state.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace esphome::light {
+
+static const char *const TAG = "light.layers";
+
+void AddressableLayersEffect::init() {
+  for (auto &layer : this->layers_) {
+    // Names are validated at config time to reference addressable effects of this light.
+    uint32_t index = this->state_->get_effect_index(layer.effect, strlen(layer.effect));
+    auto *effect = this->state_->get_effect_by_index(index);
+    layer.effect_ptr = static_cast<AddressableLightEffect *>(effect);
+    if (layer.effect_ptr == nullptr)
+      ESP_LOGE(TAG, "'%s': layer effect '%s' not found", this->name_, layer.effect);
+  }
+}
+
+bool AddressableLayersEffect::allocate_pool_() {
+  if (this->pool_ != nullptr)
+    return true;
+  if (this->pool_failed_)
+    return false;
+
+  // One block for all layers: 4 color bytes + 1 effect data byte per pixel and layer.
+  const int32_t size = this->get_addressable_()->size();
+  const size_t per_layer = size * 5;
+  RAMAllocator<uint8_t> allocator;
+  this->pool_ = allocator.allocate(per_layer * this->layers_.size());
+  if (this->pool_ == nullptr) {
+    ESP_LOGE(TAG, "'%s': failed to allocate %zu bytes for layers", this->name_, per_layer * this->layers_.size());
+    this->pool_failed_ = true;
+    return false;
+  }
+
+  uint8_t *next = this->pool_;
+  for (auto &layer : this->layers_) {
+    layer.buffer = new AddressableLayer(this->state_, next, next + size * 4, size);  // NOLINT
+    next += per_layer;
+  }
+  return true;
+}
+
+void AddressableLayersEffect::start() {
+  if (!this->allocate_pool_())
+    return;
+  for (auto &layer : this->layers_) {
+    if (layer.effect_ptr == nullptr)
+      continue;
+    layer.buffer->clear();
+    layer.effect_ptr->set_render_target(layer.buffer);
+    layer.effect_ptr->start_internal();
+    layer.was_active = layer.buffer->is_effect_active();
+    layer.buffer->take_state_changed();
+  }
+  auto *it = this->get_addressable_();
+  it->setup_state(this->state_);
+  // Force the first frame out
+  this->last_color_ = Color::BLACK;
+  it->mark_all_dirty();
+}
+
+void AddressableLayersEffect::stop() {
+  if (this->pool_ != nullptr) {
+    for (auto &layer : this->layers_) {
+      if (layer.effect_ptr == nullptr)
+        continue;
+      layer.effect_ptr->stop();
+      layer.effect_ptr->set_render_target(nullptr);
+      layer.buffer->take_state_changed();
+    }
+    // A stopped DDP layer restored the gamma table on the light state, but only set it up on its layer buffer
+    this->get_addressable_()->setup_state(this->state_);
+  }
+  AddressableLightEffect::stop();
+}
+
+void AddressableLayersEffect::apply(AddressableLight &it, const Color &current_color) {
+  if (this->pool_ == nullptr)
+    return;
+
+  bool changed = current_color != this->last_color_ || it.is_dirty();
+  bool state_changed = false;
+  for (auto &layer : this->layers_) {
+    if (layer.effect_ptr == nullptr)
+      continue;
+    layer.effect_ptr->apply(*layer.buffer, current_color);
+    const bool active = layer.buffer->is_effect_active();
+    changed |= layer.buffer->is_dirty() || active != layer.was_active;
+    layer.was_active = active;
+    state_changed |= layer.buffer->take_state_changed();
+  }
+
+  // Layer effects changed gamma or brightness on the light state; apply that to the output once for this frame.
+  if (state_changed) {
+    it.setup_state(this->state_);
+    it.update_state(this->state_);
+    changed = true;
+  }
+  if (!changed)
+    return;
+  this->last_color_ = current_color;
+
+  it.generate(0, it.size(), [this, &current_color](int32_t i) {
+    Color out = Color::BLACK;
+    for (auto &layer : this->layers_) {
+      if (layer.effect_ptr == nullptr)
+        continue;
+      const Color above = layer.was_active ? layer.buffer->get_color(i) : current_color;
+      out = blend_(layer.blend, out, above, layer.opacity);
+    }
+    return out;
+  });
+
+  for (auto &layer : this->layers_) {
+    if (layer.buffer != nullptr)
+      layer.buffer->clear_dirty();
+  }
+  it.schedule_show();
+}
+
+Color AddressableLayersEffect::blend_(AddressableBlendMode mode, const Color &below, const Color &above,
+                                      uint8_t opacity) {
+  switch (mode) {
+    case BLEND_ADD:
+      return below + above * opacity;
+    case BLEND_MAX: {
+      const Color a = above * opacity;
+      return Color(std::max(below.r, a.r), std::max(below.g, a.g), std::max(below.b, a.b), std::max(below.w, a.w));
+    }
+    case BLEND_MASK: {
+      const uint8_t mask = std::max(std::max(above.r, above.g), std::max(above.b, above.w));
+      return below.gradient(below * mask, opacity);
+    }
+    case BLEND_ALPHA:
+    default:
+      return below.gradient(above, opacity);
+  }
+}
+
+}  // namespace esphome::light
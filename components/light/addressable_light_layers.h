@@ -0,0 +1,116 @@
+#pragma once
+
+#include "esphome/core/color.h"
+#include "esphome/core/helpers.h"
+#include "addressable_light.h"
+#include "addressable_light_effect.h"
+
+namespace esphome::light {
+
+enum AddressableBlendMode : uint8_t {
+  /// Mix the layer over the layers below by its opacity (100% replaces them).
+  BLEND_ALPHA,
+  /// Add the layer to the layers below, saturating at full brightness.
+  BLEND_ADD,
+  /// Per channel maximum of the layer and the layers below.
+  BLEND_MAX,
+  /// Scale the layers below by the brightness of the layer.
+  BLEND_MASK,
+};
+
+/** Off-screen pixel buffer an effect can render into instead of the light output.
+ *
+ * Stores uncorrected colors (identity color correction), so gamma and brightness are only applied once when the
+ * composited frame is written to the real output. Pixel memory is owned by the AddressableLayersEffect pool.
+ */
+class AddressableLayer : public AddressableLight {
+ public:
+  AddressableLayer(LightState *parent, uint8_t *colors, uint8_t *effect_data, int32_t size)
+      : colors_(colors), effect_data_(effect_data), size_(size) {
+    this->state_parent_ = parent;
+  }
+
+  int32_t size() const override { return this->size_; }
+  void clear_effect_data() override {
+    for (int32_t i = 0; i < this->size_; i++)
+      this->effect_data_[i] = 0;
+  }
+  LightTraits get_traits() override { return this->state_parent_->get_traits(); }
+  // Keep identity correction; brightness and gamma belong to the real output. Layer effects (e.g. DDP) call these
+  // after changing gamma or brightness on the light state, the compositor then re-runs them on the real output.
+  void setup_state(LightState *state) override { this->state_changed_ = true; }
+  void update_state(LightState *state) override { this->state_changed_ = true; }
+  void write_state(LightState *state) override {}
+  /// Whether the layer effect changed gamma or brightness since the last call.
+  bool take_state_changed() {
+    const bool changed = this->state_changed_;
+    this->state_changed_ = false;
+    return changed;
+  }
+
+  Color get_color(int32_t index) const {
+    const uint8_t *c = &this->colors_[index * 4];
+    return Color(c[0], c[1], c[2], c[3]);
+  }
+  void clear() {
+    for (int32_t i = 0; i < this->size_ * 4; i++)
+      this->colors_[i] = 0;
+    this->clear_effect_data();
+    this->mark_all_dirty();
+  }
+  /// Called once the layer was composited into the output.
+  void clear_dirty() { this->dirty_.clear(); }
+
+ protected:
+  ESPColorView get_view_internal(int32_t index) const override {
+    uint8_t *c = &this->colors_[index * 4];
+    return {c, c + 1, c + 2, c + 3, &this->effect_data_[index], &this->correction_};
+  }
+
+  uint8_t *colors_;
+  uint8_t *effect_data_;
+  int32_t size_;
+  bool state_changed_{false};
+};
+
+struct AddressableLayerConfig {
+  const char *effect;
+  AddressableBlendMode blend;
+  uint8_t opacity;
+  // Resolved at runtime
+  AddressableLightEffect *effect_ptr;
+  AddressableLayer *buffer;
+  bool was_active;
+};
+
+/** Runs several addressable effects of the same light at once and blends their output.
+ *
+ * Each layer effect renders into its own AddressableLayer. Layer pixel memory is taken from a single pool that is
+ * allocated the first time the effect starts and reused afterwards, so running the compositor does not allocate
+ * per frame. A layer whose effect is not currently driving its buffer (e.g. DDP without a stream) shows the
+ * light's current color instead.
+ *
+ * Each effect appears at most once. DDP may only be the first layer: while streaming it sets the light's brightness
+ * to full, which then applies to the whole composite (the other layers are not dimmed by the light's brightness).
+ */
+class AddressableLayersEffect : public AddressableLightEffect {
+ public:
+  explicit AddressableLayersEffect(const char *name) : AddressableLightEffect(name) {}
+  void set_layers(const std::initializer_list<AddressableLayerConfig> &layers) { this->layers_ = layers; }
+
+  void init() override;
+  void start() override;
+  void stop() override;
+  void apply(AddressableLight &it, const Color &current_color) override;
+
+ protected:
+  bool allocate_pool_();
+  static Color blend_(AddressableBlendMode mode, const Color &below, const Color &above, uint8_t opacity);
+
+  FixedVector<AddressableLayerConfig> layers_;
+  uint8_t *pool_{nullptr};
+  Color last_color_{};
+  bool pool_failed_{false};
+};
+
+}  // namespace esphome::light
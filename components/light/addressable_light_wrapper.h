@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 #include "esphome/core/component.h"
 #include "addressable_light.h"
 
@@ -70,6 +72,14 @@ class AddressableLightWrapper : public light::AddressableLight {
   void write_state(light::LightState *state) override {
     // Don't overwrite state if the underlying light is turned on
     if (this->light_state_->remote_values.is_on()) {
+      this->mark_shown_();
+      // Nothing was pushed to the underlying light, so the next write has to push again.
+      this->pushed_ = false;
+      return;
+    }
+
+    // The wrapped color is the one last pushed to the underlying light
+    if (this->pushed_ && memcmp(this->pushed_state_, this->wrapper_state_, sizeof(this->pushed_state_)) == 0) {
       this->mark_shown_();
       return;
     }
@@ -105,6 +115,8 @@ class AddressableLightWrapper : public light::AddressableLight {
     call.set_save(false);
     call.perform();
 
+    memcpy(this->pushed_state_, this->wrapper_state_, sizeof(this->pushed_state_));
+    this->pushed_ = true;
     this->mark_shown_();
   }
 
@@ -116,6 +128,9 @@ class AddressableLightWrapper : public light::AddressableLight {
 
   light::LightState *light_state_;
   mutable uint8_t wrapper_state_[5]{};
+  // R, G, B, W of the last call made on the underlying light
+  uint8_t pushed_state_[4]{};
+  bool pushed_{false};
   ColorMode color_mode_{ColorMode::UNKNOWN};
 };
 
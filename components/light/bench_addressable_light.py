@@ -0,0 +1,498 @@
+#!/usr/bin/env python3
+"""KAUF: host benchmark for the addressable light write path.
+
+Builds the real AddressableLight sources (addressable_light, esp_color_view,
+esp_color_correction, esp_range_view, esp_hsv_color) with g++ against minimal
+stand-ins for LightState/LightOutput and the ESPHome core headers, then drives
+a 600 pixel RGB strip with a few effect-like workloads and reports the CPU time
+per frame and a modeled frame rate. Where the sources have the bulk API
+(blit(), fill()), the buffer workloads use it, otherwise they write per pixel.
+
+The modeled frame rate adds the WS2812 wire time to the CPU time: 30 us per
+pixel clocked out plus a 280 us latch. Pixels are shifted through the strip, so
+a driver that only pushes changed pixels still has to clock out every pixel up
+to the last changed one. The baseline driver pushes the whole strip on every
+scheduled write, the dirty-range driver skips clean frames and stops after the
+dirty span. Host CPU time is far below an ESP8266's, so the wire time dominates
+there; on the device the CPU share is larger and the gap between the rows wider.
+
+    python3 bench_addressable_light.py [--pixels 600] [--frames 2000] [--before REV] [--cxx g++] [--keep]
+
+--before REV also builds the light sources from a git revision (for example the
+commit before a change) and prints both results side by side. Columns are per
+frame: pushes to the strip, pixels clocked out and their wire time.
+"""
+
+import sys
+
+# This directory has a types.py (the light platform's codegen types), which would shadow the stdlib module
+del sys.path[0]
+
+import argparse  # noqa: E402
+import json  # noqa: E402
+import os  # noqa: E402
+from pathlib import Path  # noqa: E402
+import shutil  # noqa: E402
+import subprocess  # noqa: E402
+import tempfile  # noqa: E402
+
+HERE = Path(__file__).resolve().parent
+
+SOURCES = [
+    "addressable_light.h",
+    "addressable_light.cpp",
+    "esp_color_correction.h",
+    "esp_color_correction.cpp",
+    "esp_color_view.h",
+    "esp_hsv_color.h",
+    "esp_hsv_color.cpp",
+    "esp_range_view.h",
+    "esp_range_view.cpp",
+]
+
+# Gamma 2.8, as generated for the gamma_correct option
+GAMMA_TABLE = ", ".join(str(round(65535 * (i / 255) ** 2.8)) for i in range(256))
+
+STUBS = {
+    "esphome/core/defines.h": """
+#pragma once
+#define USE_POWER_SUPPLY
+#define USE_LIGHT_GAMMA_LUT
+""",
+    "esphome/core/hal.h": """
+#pragma once
+#include <cstdint>
+#define ESPHOME_ALWAYS_INLINE __attribute__((always_inline))
+#define HOT __attribute__((hot))
+namespace esphome {
+inline uint16_t progmem_read_uint16(const uint16_t *addr) { return *addr; }
+}  // namespace esphome
+""",
+    "esphome/core/color.h": """
+#pragma once
+#include <cstdint>
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+namespace esphome {
+inline uint8_t esp_scale8(uint8_t i, uint8_t scale) { return (uint16_t(i) * (1 + uint16_t(scale))) / 256; }
+inline uint8_t esp_scale8_twice(uint8_t i, uint8_t scale1, uint8_t scale2) {
+  return (uint32_t(i) * (1 + uint32_t(scale1)) * (1 + uint32_t(scale2))) >> 16;
+}
+struct Color {
+  union {
+    struct {
+      union { uint8_t r; uint8_t red; };
+      union { uint8_t g; uint8_t green; };
+      union { uint8_t b; uint8_t blue; };
+      union { uint8_t w; uint8_t white; };
+    };
+    uint8_t raw[4];
+  };
+  Color() : r(0), g(0), b(0), w(0) {}
+  Color(uint8_t red, uint8_t green, uint8_t blue, uint8_t white = 0) : r(red), g(green), b(blue), w(white) {}
+  bool operator==(const Color &o) const { return r == o.r && g == o.g && b == o.b && w == o.w; }
+  bool operator!=(const Color &o) const { return !(*this == o); }
+  Color operator*(uint8_t s) const { return Color(esp_scale8(r, s), esp_scale8(g, s), esp_scale8(b, s), esp_scale8(w, s)); }
+  Color &operator*=(uint8_t s) { return *this = *this * s; }
+  Color operator+(uint8_t d) const { return Color(add_(r, d), add_(g, d), add_(b, d), add_(w, d)); }
+  Color &operator+=(uint8_t d) { return *this = *this + d; }
+  Color operator-(uint8_t d) const { return Color(sub_(r, d), sub_(g, d), sub_(b, d), sub_(w, d)); }
+  Color operator-(const Color &o) const { return Color(sub_(r, o.r), sub_(g, o.g), sub_(b, o.b), sub_(w, o.w)); }
+  Color fade_to_white(uint8_t amnt) { return Color(255, 255, 255, 255) - (*this * amnt); }
+  Color fade_to_black(uint8_t amnt) { return *this * amnt; }
+  Color lighten(uint8_t delta) { return *this + delta; }
+  Color darken(uint8_t delta) { return *this - delta; }
+ private:
+  static uint8_t add_(uint8_t a, uint8_t b) { return a + b > 255 ? 255 : a + b; }
+  static uint8_t sub_(uint8_t a, uint8_t b) { return a < b ? 0 : a - b; }
+};
+}  // namespace esphome
+""",
+    "esphome/core/helpers.h": """
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <optional>
+namespace esphome {
+using std::make_unique;
+template<typename T> using optional = std::optional<T>;
+}  // namespace esphome
+""",
+    "esphome/core/component.h": """
+#pragma once
+#include <cstdint>
+#include <functional>
+namespace esphome {
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void call_setup() { this->setup(); }
+  void set_interval(uint32_t interval, std::function<void()> &&f) {}
+};
+}  // namespace esphome
+""",
+    "esphome/core/log.h": """
+#pragma once
+#define ESP_LOGVV(tag, ...) ((void) 0)
+#define YESNO(b) ((b) ? "YES" : "NO")
+""",
+    "esphome/components/power_supply/power_supply.h": """
+#pragma once
+namespace esphome::power_supply {
+class PowerSupply;
+class PowerSupplyRequester {
+ public:
+  void set_parent(PowerSupply *parent) {}
+  void request() { this->requested_ = true; }
+  void unrequest() { this->requested_ = false; }
+  bool is_requested() const { return this->requested_; }
+ protected:
+  bool requested_{false};
+};
+}  // namespace esphome::power_supply
+""",
+}
+
+# Stand-ins for the light headers next to the copied sources
+LIGHT_STUBS = {
+    "light_color_values.h": """
+#pragma once
+#include <cmath>
+#include <cstdint>
+namespace esphome::light {
+inline static uint8_t to_uint8_scale(float x) { return static_cast<uint8_t>(roundf(x * 255.0f)); }
+class LightColorValues {
+ public:
+  static LightColorValues lerp(const LightColorValues &start, const LightColorValues &end, float completion) {
+    return end;
+  }
+  float get_state() const { return this->state; }
+  float get_brightness() const { return this->brightness; }
+  float get_color_brightness() const { return this->color_brightness; }
+  float get_red() const { return this->red; }
+  float get_green() const { return this->green; }
+  float get_blue() const { return this->blue; }
+  float get_white() const { return this->white; }
+  float state{1.0f}, brightness{1.0f}, color_brightness{1.0f}, red{1.0f}, green{1.0f}, blue{1.0f}, white{0.0f};
+};
+}  // namespace esphome::light
+""",
+    "light_transformer.h": """
+#pragma once
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "light_color_values.h"
+namespace esphome::light {
+class LightTransformer {
+ public:
+  virtual ~LightTransformer() = default;
+  virtual void start() {}
+  virtual optional<LightColorValues> apply() = 0;
+  const LightColorValues &get_start_values() const { return this->start_values_; }
+  const LightColorValues &get_target_values() const { return this->target_values_; }
+ protected:
+  static float smoothed_progress(float x) { return x * x * x * (x * (x * 6.0f - 15.0f) + 10.0f); }
+  float get_progress_() { return 1.0f; }
+  LightColorValues start_values_;
+  LightColorValues target_values_;
+};
+}  // namespace esphome::light
+""",
+    "light_state.h": """
+#pragma once
+#include <cstdint>
+#include <string>
+#include "light_color_values.h"
+namespace esphome::light {
+class LightOutput;
+class LightState {
+ public:
+  explicit LightState(LightOutput *output) : output_(output) {}
+  const std::string &get_name() const { return this->name_; }
+  const uint16_t *get_gamma_table() const { return this->gamma_table_; }
+  void set_gamma_table(const uint16_t *table) { this->gamma_table_ = table; }
+  void schedule_write_() { this->next_write_ = true; }
+  /// Like LightState::loop(): write the output if something asked for it.
+  bool take_write() {
+    const bool write = this->next_write_;
+    this->next_write_ = false;
+    return write;
+  }
+  LightColorValues current_values;
+ protected:
+  LightOutput *output_;
+  std::string name_{"bench"};
+  const uint16_t *gamma_table_{nullptr};
+  bool next_write_{false};
+};
+}  // namespace esphome::light
+""",
+    "light_output.h": """
+#pragma once
+#include <memory>
+#include "esphome/core/component.h"
+#include "light_state.h"
+#include "light_transformer.h"
+namespace esphome::light {
+struct LightTraits {};
+class LightOutput {
+ public:
+  virtual ~LightOutput() = default;
+  virtual LightTraits get_traits() = 0;
+  virtual std::unique_ptr<LightTransformer> create_default_transition() { return nullptr; }
+  virtual void setup_state(LightState *state) {}
+  virtual void update_state(LightState *state) {}
+  virtual void write_state(LightState *state) = 0;
+};
+}  // namespace esphome::light
+""",
+}
+
+DRIVER = r"""
+#include "addressable_light.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::light;
+
+static const uint16_t GAMMA_TABLE[256] = {@GAMMA@};
+
+static constexpr uint32_t WIRE_US_PER_PIXEL = 30;
+static constexpr uint32_t LATCH_US = 280;
+
+class BenchLight : public AddressableLight {
+ public:
+  explicit BenchLight(int32_t size) : size_(size), buf_(size * 4), out_(size * 3) {}
+  int32_t size() const override { return this->size_; }
+  void clear_effect_data() override {}
+  LightTraits get_traits() override { return {}; }
+  void write_state(LightState *state) override {
+    int32_t end = this->size_;
+#ifdef BENCH_DIRTY_RANGE
+    if (!this->is_dirty())
+      return;
+    end = std::min(this->dirty_.get_end(), this->size_);
+#endif
+    // Encode the strip prefix up to the last changed pixel, GRB order like a WS2812 driver
+    for (int32_t i = 0; i < end; i++) {
+      this->out_[i * 3 + 0] = this->buf_[i * 4 + 1];
+      this->out_[i * 3 + 1] = this->buf_[i * 4 + 0];
+      this->out_[i * 3 + 2] = this->buf_[i * 4 + 2];
+    }
+    this->pushed_pixels += end;
+    this->pushes++;
+    this->mark_shown_();
+  }
+  uint64_t pushed_pixels{0};
+  uint32_t pushes{0};
+
+ protected:
+  ESPColorView get_view_internal(int32_t index) const override {
+    uint8_t *p = const_cast<uint8_t *>(&this->buf_[index * 4]);
+    return ESPColorView(p, p + 1, p + 2, nullptr, p + 3, &this->correction_);
+  }
+  int32_t size_;
+  std::vector<uint8_t> buf_;
+  std::vector<uint8_t> out_;
+};
+
+struct Scenario {
+  const char *name;
+  std::function<void(BenchLight &, uint32_t)> frame;
+  /// Change the light brightness every frame, like a transition running under the effect.
+  bool fade{false};
+};
+
+static std::vector<Color> g_pattern;
+
+/// Copy `count` pattern colors to the strip, through blit() where the sources have the bulk API.
+static void draw_pattern(BenchLight &it, int32_t offset, int32_t count) {
+#ifdef BENCH_BULK_API
+  it.blit(0, &g_pattern[offset], count);
+#else
+  for (int32_t i = 0; i < count; i++)
+    it[i] = g_pattern[offset + i];
+#endif
+}
+
+int main(int argc, char **argv) {
+  const int32_t pixels = argc > 1 ? atoi(argv[1]) : 600;
+  const uint32_t frames = argc > 2 ? atoi(argv[2]) : 2000;
+
+  const Scenario scenarios[] = {
+      // A 10 pixel dot running along a black strip, drawn like the scan effect
+      {"scan", [](BenchLight &it, uint32_t f) {
+         const int32_t pos = f % (it.size() - 10);
+         it.all() = Color(0, 0, 0);
+         it.range(pos, pos + 10) = Color(255, 120, 40);
+       }},
+      // A 60 pixel segment updated per pixel (DDP stream or a lambda), the rest static
+      {"segment_60", [](BenchLight &it, uint32_t f) {
+         for (int32_t i = 0; i < 60; i++)
+           it[100 + i] = ESPHSVColor(uint8_t(f * 3 + i * 4), 255, 255);
+       }},
+      // The effect rewrites the same color every frame
+      {"static", [](BenchLight &it, uint32_t f) { it.all() = Color(20, 80, 255); }},
+      // Every pixel changes every frame
+      {"rainbow", [](BenchLight &it, uint32_t f) {
+         for (int32_t i = 0; i < it.size(); i++)
+           it[i] = ESPHSVColor(uint8_t(f + i), 255, 255);
+       }},
+      // A full frame of colors from a buffer (DDP), at steady and at changing brightness
+      {"blit", [](BenchLight &it, uint32_t f) { draw_pattern(it, f % 256, it.size()); }},
+      {"blit_fade", [](BenchLight &it, uint32_t f) { draw_pattern(it, f % 256, it.size()); }, true},
+      // Marquee: shift the strip by one and draw the new pixel
+      {"shift", [](BenchLight &it, uint32_t f) {
+         it.shift_left(1);
+         it[it.size() - 1] = ESPHSVColor(uint8_t(f * 7), 255, 255);
+       }},
+      // Solid color while the brightness changes
+      {"fill_fade", [](BenchLight &it, uint32_t f) { it.all() = Color(255, 140, 20); }, true},
+  };
+
+  g_pattern.resize(pixels + 256);
+  for (size_t i = 0; i < g_pattern.size(); i++)
+    g_pattern[i] = ESPHSVColor(uint8_t(i * 3), 255, 255).to_rgb();
+
+  printf("[");
+  bool first = true;
+  for (const auto &scenario : scenarios) {
+    BenchLight light(pixels);
+    LightState state(&light);
+    state.set_gamma_table(GAMMA_TABLE);
+    light.setup_state(&state);
+    light.set_effect_active(true);
+    // Warm-up frame: buffer allocation, first full push and lit count scan are not part of the steady state
+    scenario.frame(light, 0);
+    light.schedule_show();
+    if (state.take_write())
+      light.write_state(&state);
+    light.pushed_pixels = light.pushes = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 1; f <= frames; f++) {
+      if (scenario.fade)
+        state.current_values.brightness = 0.2f + 0.8f * float(f % 100) / 100.0f;
+      light.update_state(&state);
+      scenario.frame(light, f);
+      light.schedule_show();
+      if (state.take_write())
+        light.write_state(&state);
+    }
+    const double cpu_us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+    const double wire_us =
+        double(light.pushed_pixels * WIRE_US_PER_PIXEL + uint64_t(light.pushes) * LATCH_US) / frames;
+    printf("%s{\"name\": \"%s\", \"cpu_us\": %.2f, \"pixels_pushed\": %.1f, \"pushes\": %.3f, \"wire_us\": %.1f}",
+           first ? "" : ", ", scenario.name, cpu_us, double(light.pushed_pixels) / frames, double(light.pushes) / frames,
+           wire_us);
+    first = false;
+  }
+  printf("]\n");
+  return 0;
+}
+"""
+
+
+def _copy_sources(dest: Path, rev: str | None) -> str:
+    """Copy the light sources into dest, from the work tree or a git revision. Returns addressable_light.h."""
+    dest.mkdir(parents=True)
+    for name in SOURCES:
+        if rev is None:
+            text = (HERE / name).read_text()
+        else:
+            text = subprocess.run(
+                ["git", "show", f"{rev}:./{name}"], cwd=HERE, check=True, capture_output=True, text=True
+            ).stdout
+        (dest / name).write_text(text)
+    for name, text in LIGHT_STUBS.items():
+        (dest / name).write_text(text)
+    return (dest / "addressable_light.h").read_text()
+
+
+def _build(tmp: Path, label: str, rev: str | None, cxx: str) -> Path:
+    src = tmp / label
+    header = _copy_sources(src, rev)
+    defines = []
+    if "dirty_range()" in header:
+        defines.append("-DBENCH_DIRTY_RANGE")
+    if "void blit(" in header:
+        defines.append("-DBENCH_BULK_API")
+    (src / "driver.cpp").write_text(DRIVER.replace("@GAMMA@", GAMMA_TABLE))
+    binary = tmp / f"bench_{label}"
+    subprocess.run(
+        [cxx, "-std=gnu++17", "-O2", "-Wall", "-Werror", *defines, "-I", str(tmp / "include"), "-I", str(src)]
+        + [str(src / name) for name in SOURCES if name.endswith(".cpp")]
+        + [str(src / "driver.cpp"), "-o", str(binary)],
+        check=True,
+    )
+    return binary
+
+
+def _run(binary: Path, pixels: int, frames: int, repeat: int) -> dict[str, dict]:
+    """Best of `repeat` runs per scenario, so scheduler noise does not inflate the CPU time."""
+    best: dict[str, dict] = {}
+    for _ in range(repeat):
+        out = subprocess.run([str(binary), str(pixels), str(frames)], check=True, capture_output=True, text=True)
+        for row in json.loads(out.stdout):
+            if row["name"] not in best or row["cpu_us"] < best[row["name"]]["cpu_us"]:
+                best[row["name"]] = row
+    return best
+
+
+def _fps(row: dict) -> str:
+    if row["pushes"] == 0:
+        # Nothing is pushed, the frame rate is whatever the main loop allows
+        return "no push"
+    return f"{1e6 / (row['cpu_us'] + row['wire_us']):.1f}"
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--pixels", type=int, default=600, help="strip length")
+    parser.add_argument("--frames", type=int, default=2000, help="frames per scenario")
+    parser.add_argument("--repeat", type=int, default=5, help="runs per scenario, the fastest is reported")
+    parser.add_argument("--before", metavar="REV", help="also benchmark the light sources of this git revision")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--keep", action="store_true", help="keep the build directory")
+    args = parser.parse_args()
+
+    tmp = Path(tempfile.mkdtemp(prefix="light_bench_"))
+    try:
+        for name, text in STUBS.items():
+            path = tmp / "include" / name
+            path.parent.mkdir(parents=True, exist_ok=True)
+            path.write_text(text)
+        builds = []
+        if args.before:
+            builds.append((args.before, _build(tmp, "before", args.before, args.cxx)))
+        builds.append(("work tree", _build(tmp, "after", None, args.cxx)))
+        results = [(label, _run(binary, args.pixels, args.frames, args.repeat)) for label, binary in builds]
+
+        print(f"{args.pixels} pixels, {args.frames} frames, {WIRE_NOTE}")
+        print(f"{'scenario':<12} {'build':<12} {'cpu us':>9} {'pushes':>7} {'pixels':>7} {'wire us':>9} {'fps':>8}")
+        for scenario in results[0][1]:
+            for label, rows in results:
+                row = rows[scenario]
+                print(
+                    f"{scenario:<12} {label[:12]:<12} {row['cpu_us']:>9.2f} {row['pushes']:>7.2f} "
+                    f"{row['pixels_pushed']:>7.1f} {row['wire_us']:>9.1f} {_fps(row):>8}"
+                )
+    finally:
+        if args.keep:
+            print(f"build files kept in {tmp}")
+        else:
+            shutil.rmtree(tmp)
+    return 0
+
+
+WIRE_NOTE = "fps modeled as 1 / (host cpu + 30 us/pixel pushed + 280 us latch per push)"
+
+if __name__ == "__main__":
+    sys.exit(main())
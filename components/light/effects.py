@@ -11,6 +11,7 @@ from esphome.const import (
     CONF_COLOR_TEMPERATURE,
     CONF_COLORS,
     CONF_DURATION,
+    CONF_EFFECT,
     CONF_GREEN,
     CONF_INTENSITY,
     CONF_LAMBDA,
@@ -34,12 +35,15 @@ from esphome.schema_extractors import SCHEMA_EXTRACT, schema_extractor
 from esphome.util import Registry
 
 from .types import (
+    BLEND_MODES,
     COLOR_MODES,
     AddressableColorWipeEffect,
     AddressableColorWipeEffectColor,
     AddressableFireworksEffect,
     AddressableFlickerEffect,
     AddressableLambdaLightEffect,
+    AddressableLayerConfig,
+    AddressableLayersEffect,
     AddressableLightRef,
     AddressableRainbowLightEffect,
     AddressableRandomTwinkleEffect,
@@ -77,6 +81,10 @@ CONF_ADDRESSABLE_TWINKLE = "addressable_twinkle"
 CONF_ADDRESSABLE_RANDOM_TWINKLE = "addressable_random_twinkle"
 CONF_ADDRESSABLE_FIREWORKS = "addressable_fireworks"
 CONF_ADDRESSABLE_FLICKER = "addressable_flicker"
+CONF_ADDRESSABLE_LAYERS = "addressable_layers"
+CONF_LAYERS = "layers"
+CONF_BLEND = "blend"
+CONF_OPACITY = "opacity"
 CONF_AUTOMATION = "automation"
 CONF_ON_LENGTH = "on_length"
 CONF_OFF_LENGTH = "off_length"
@@ -541,6 +549,96 @@ async def addressable_flicker_effect_to_code(config, effect_id):
     return var
 
 
+@register_addressable_effect(
+    CONF_ADDRESSABLE_LAYERS,
+    AddressableLayersEffect,
+    "Layers",
+    {
+        cv.Required(CONF_LAYERS): cv.All(
+            cv.ensure_list(
+                {
+                    cv.Required(CONF_EFFECT): cv.string_strict,
+                    cv.Optional(CONF_BLEND, default="ALPHA"): cv.enum(
+                        BLEND_MODES, upper=True
+                    ),
+                    cv.Optional(CONF_OPACITY, default="100%"): cv.percentage,
+                }
+            ),
+            cv.Length(min=1),
+        ),
+    },
+)
+async def addressable_layers_effect_to_code(config, effect_id):
+    var = cg.new_Pvariable(effect_id, config[CONF_NAME])
+    layers = [
+        cg.StructInitializer(
+            AddressableLayerConfig,
+            ("effect", layer[CONF_EFFECT]),
+            ("blend", layer[CONF_BLEND]),
+            ("opacity", int(round(layer[CONF_OPACITY] * 255))),
+        )
+        for layer in config[CONF_LAYERS]
+    ]
+    cg.add(var.set_layers(layers))
+    return var
+
+
+def _validate_layers(value):
+    """Check that addressable_layers only reference addressable effects of the same light.
+
+    Each effect can only be used once per compositor (layers share the effect instance and would render into one
+    buffer). addressable_ddp sets the light's brightness to full while it streams, so it is only allowed as the
+    first (base) layer, where that brightness applies to the whole composite anyway.
+    """
+    layerable = {
+        effect_conf[key][CONF_NAME].lower(): key
+        for effect_conf in value
+        for key in effect_conf
+    }
+    addressable_only = set(ADDRESSABLE_EFFECTS) - set(RGB_EFFECTS)
+    errors = []
+    for i, effect_conf in enumerate(value):
+        if CONF_ADDRESSABLE_LAYERS not in effect_conf:
+            continue
+        seen = set()
+        for j, layer in enumerate(effect_conf[CONF_ADDRESSABLE_LAYERS][CONF_LAYERS]):
+            path = [i, CONF_ADDRESSABLE_LAYERS, CONF_LAYERS, j, CONF_EFFECT]
+            name = layer[CONF_EFFECT].lower()
+            key = layerable.get(name)
+            if name in seen:
+                errors.append(
+                    cv.Invalid(
+                        f"Layer effect '{layer[CONF_EFFECT]}' is used more than once",
+                        path,
+                    )
+                )
+                continue
+            seen.add(name)
+            if key is None:
+                errors.append(
+                    cv.Invalid(
+                        f"Layer effect '{layer[CONF_EFFECT]}' not found",
+                        path,
+                    )
+                )
+            elif key not in addressable_only or key == CONF_ADDRESSABLE_LAYERS:
+                errors.append(
+                    cv.Invalid(
+                        f"Layer effect '{layer[CONF_EFFECT]}' must be an addressable effect",
+                        path,
+                    )
+                )
+            elif key == "addressable_ddp" and j > 0:
+                errors.append(
+                    cv.Invalid(
+                        f"Layer effect '{layer[CONF_EFFECT]}' is a DDP effect and can only be the first layer",
+                        path,
+                    )
+                )
+    if errors:
+        raise cv.MultipleInvalid(errors)
+
+
 def validate_effects(allowed_effects):
     @schema_extractor("effects")
     def validator(value):
@@ -572,6 +670,7 @@ def validate_effects(allowed_effects):
             names.add(name)
         if errors:
             raise cv.MultipleInvalid(errors)
+        _validate_layers(value)
         return value
 
     return validator
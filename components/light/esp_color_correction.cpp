@@ -22,6 +22,22 @@ uint8_t ESPColorCorrection::gamma_uncorrect_(uint8_t value) const {
   return (target - a <= b - target) ? lo : lo + 1;
 }
 
+const uint8_t *ESPColorCorrection::get_lut_() const {
+  if (this->lut_valid_)
+    return this->lut_.get();
+  if (!this->lut_)
+    this->lut_.reset(new uint8_t[4 * 256]);  // NOLINT(cppcoreguidelines-owning-memory)
+  uint8_t *lut = this->lut_.get();
+  for (uint16_t i = 0; i < 256; i++) {
+    lut[i] = this->color_correct_red(i);
+    lut[256 + i] = this->color_correct_green(i);
+    lut[512 + i] = this->color_correct_blue(i);
+    lut[768 + i] = this->color_correct_white(i);
+  }
+  this->lut_valid_ = true;
+  return lut;
+}
+
 Color ESPColorCorrection::color_uncorrect(Color color) const {
   // uncorrected = corrected^(1/gamma) / (max_brightness * local_brightness)
   return Color(this->color_uncorrect_red(color.red), this->color_uncorrect_green(color.green),
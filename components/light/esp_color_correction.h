@@ -3,6 +3,8 @@
 #include "esphome/core/color.h"
 #include "esphome/core/hal.h"
 
+#include <memory>
+
 namespace esphome::light {
 
 /// Binary search a monotonically increasing uint16[256] PROGMEM table.
@@ -22,9 +24,21 @@ inline uint8_t gamma_table_reverse_search(const uint16_t *table, uint16_t target
 
 class ESPColorCorrection {
  public:
-  void set_max_brightness(const Color &max_brightness) { this->max_brightness_ = max_brightness; }
-  void set_local_brightness(uint8_t local_brightness) { this->local_brightness_ = local_brightness; }
-  void set_gamma_table(const uint16_t *table) { this->gamma_table_ = table; }
+  void set_max_brightness(const Color &max_brightness) {
+    if (max_brightness != this->max_brightness_)
+      this->lut_valid_ = false;
+    this->max_brightness_ = max_brightness;
+  }
+  void set_local_brightness(uint8_t local_brightness) {
+    if (local_brightness != this->local_brightness_)
+      this->lut_valid_ = false;
+    this->local_brightness_ = local_brightness;
+  }
+  void set_gamma_table(const uint16_t *table) {
+    if (table != this->gamma_table_)
+      this->lut_valid_ = false;
+    this->gamma_table_ = table;
+  }
   inline Color color_correct(Color color) const ESPHOME_ALWAYS_INLINE {
     // corrected = (uncorrected * max_brightness * local_brightness) ^ gamma
     return Color(this->color_correct_red(color.red), this->color_correct_green(color.green),
@@ -46,6 +60,14 @@ class ESPColorCorrection {
     uint8_t res = esp_scale8_twice(white, this->max_brightness_.white, this->local_brightness_);
     return this->gamma_correct_(res);
   }
+  /// Same result as color_correct(), but through per-channel 256-entry lookup tables. The tables are built on
+  /// first use and rebuilt only after brightness or gamma changed, so this is meant for bulk writes.
+  inline Color color_correct_lut(Color color) const ESPHOME_ALWAYS_INLINE {
+    const uint8_t *lut = this->get_lut_();
+    return Color(lut[color.red], lut[256 + color.green], lut[512 + color.blue], lut[768 + color.white]);
+  }
+  /// Whether the correction tables are built for the current brightness and gamma.
+  bool has_lut() const { return this->lut_valid_; }
   Color color_uncorrect(Color color) const;
   inline uint8_t color_uncorrect_red(uint8_t red) const ESPHOME_ALWAYS_INLINE {
     return this->color_uncorrect_channel_(red, this->max_brightness_.red);
@@ -68,10 +90,15 @@ class ESPColorCorrection {
   /// Shared body of color_uncorrect_{red,green,blue,white}. Kept out-of-line
   /// to avoid duplicating two 16-bit divides at every call site.
   uint8_t color_uncorrect_channel_(uint8_t value, uint8_t max_brightness) const;
+  /// Return the red/green/blue/white correction tables (4 x 256 bytes), rebuilding them if stale.
+  const uint8_t *get_lut_() const;
 
   const uint16_t *gamma_table_{nullptr};
   Color max_brightness_{255, 255, 255, 255};
   uint8_t local_brightness_{255};
+  /// Lazily allocated so lights that never use bulk writes don't pay the 1 KiB.
+  mutable std::unique_ptr<uint8_t[]> lut_;
+  mutable bool lut_valid_{false};
 };
 
 }  // namespace esphome::light
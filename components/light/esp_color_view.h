@@ -4,8 +4,58 @@
 #include "esp_hsv_color.h"
 #include "esp_color_correction.h"
 
+#include <limits>
+
 namespace esphome::light {
 
+/** Tracks which pixels of an addressable light were written since the last show, and optionally how many
+ * pixels are lit.
+ *
+ * Drivers can use the dirty span to skip unchanged frames or only push the changed pixels, and the power
+ * supply check uses the lit count instead of scanning the whole strip. The lit count is only maintained once
+ * it has been established by a full scan (see AddressableLight::mark_shown_()).
+ */
+class ESPDirtyTracker {
+ public:
+  void mark(int32_t index) {
+    if (index < this->begin_)
+      this->begin_ = index;
+    if (index >= this->end_)
+      this->end_ = index + 1;
+  }
+  void mark(int32_t index, bool was_lit, bool is_lit) {
+    this->mark(index);
+    if (was_lit != is_lit)
+      this->lit_count_ += is_lit ? 1 : -1;
+  }
+  void mark_all(int32_t size) {
+    this->begin_ = 0;
+    this->end_ = size;
+  }
+  void clear() {
+    this->begin_ = std::numeric_limits<int32_t>::max();
+    this->end_ = 0;
+  }
+  bool is_dirty() const { return this->begin_ < this->end_; }
+  int32_t get_begin() const { return this->begin_; }
+  int32_t get_end() const { return this->end_; }
+
+  bool has_lit_count() const { return this->lit_count_valid_; }
+  int32_t get_lit_count() const { return this->lit_count_; }
+  void set_lit_count(int32_t lit_count) {
+    this->lit_count_ = lit_count;
+    this->lit_count_valid_ = true;
+  }
+  void invalidate_lit_count() { this->lit_count_valid_ = false; }
+
+ protected:
+  // Everything is dirty until the first show.
+  int32_t begin_{0};
+  int32_t end_{std::numeric_limits<int32_t>::max()};
+  int32_t lit_count_{0};
+  bool lit_count_valid_{false};
+};
+
 class ESPColorSettable {
  public:
   virtual void set(const Color &color) = 0;
@@ -53,13 +103,28 @@ class ESPColorView : public ESPColorSettable {
     return *this;
   }
   void set(const Color &color) override { this->set_rgbw(color.r, color.g, color.b, color.w); }
-  void set_red(uint8_t red) override { *this->red_ = this->color_correction_->color_correct_red(red); }
-  void set_green(uint8_t green) override { *this->green_ = this->color_correction_->color_correct_green(green); }
-  void set_blue(uint8_t blue) override { *this->blue_ = this->color_correction_->color_correct_blue(blue); }
+  void set_red(uint8_t red) override { this->write_raw_(this->red_, this->color_correction_->color_correct_red(red)); }
+  void set_green(uint8_t green) override {
+    this->write_raw_(this->green_, this->color_correction_->color_correct_green(green));
+  }
+  void set_blue(uint8_t blue) override {
+    this->write_raw_(this->blue_, this->color_correction_->color_correct_blue(blue));
+  }
   void set_white(uint8_t white) override {
     if (this->white_ == nullptr)
       return;
-    *this->white_ = this->color_correction_->color_correct_white(white);
+    this->write_raw_(this->white_, this->color_correction_->color_correct_white(white));
+  }
+  /// Write an already color-corrected value straight to the output buffer.
+  void set_raw(const Color &color) {
+    this->set_raw_rgb(color.r, color.g, color.b);
+    if (this->white_ != nullptr)
+      this->write_raw_(this->white_, color.w);
+  }
+  void set_raw_rgb(uint8_t red, uint8_t green, uint8_t blue) {
+    this->write_raw_(this->red_, red);
+    this->write_raw_(this->green_, green);
+    this->write_raw_(this->blue_, blue);
   }
   void set_effect_data(uint8_t effect_data) override {
     if (this->effect_data_ == nullptr)
@@ -71,6 +136,10 @@ class ESPColorView : public ESPColorSettable {
   void lighten(uint8_t delta) override { this->set(this->get().lighten(delta)); }
   void darken(uint8_t delta) override { this->set(this->get().darken(delta)); }
   Color get() const { return Color(this->get_red(), this->get_green(), this->get_blue(), this->get_white()); }
+  /// The output buffer value, without undoing color correction.
+  Color get_raw() const {
+    return Color(this->get_red_raw(), this->get_green_raw(), this->get_blue_raw(), this->get_white_raw());
+  }
   uint8_t get_red() const { return this->color_correction_->color_uncorrect_red(*this->red_); }
   uint8_t get_red_raw() const { return *this->red_; }
   uint8_t get_green() const { return this->color_correction_->color_uncorrect_green(*this->green_); }
@@ -95,14 +164,45 @@ class ESPColorView : public ESPColorSettable {
   void raw_set_color_correction(const ESPColorCorrection *color_correction) {
     this->color_correction_ = color_correction;
   }
+  /// Attach a dirty tracker so writes that change the output buffer are recorded for pixel `index`.
+  void raw_set_dirty_tracker(ESPDirtyTracker *dirty, int32_t index) {
+    this->dirty_ = dirty;
+    this->index_ = index;
+  }
 
  protected:
+  bool is_lit_raw_() const {
+    return *this->red_ != 0 || *this->green_ != 0 || *this->blue_ != 0 ||
+           (this->white_ != nullptr && *this->white_ != 0);
+  }
+  inline void write_raw_(uint8_t *channel, uint8_t value) ESPHOME_ALWAYS_INLINE {
+    if (*channel == value)
+      return;
+    if (this->dirty_ == nullptr) {
+      *channel = value;
+    } else if (!this->dirty_->has_lit_count()) {
+      *channel = value;
+      this->dirty_->mark(this->index_);
+    } else if (value != 0) {
+      // Lit afterwards; lit before if this or another channel was, so at most one scan
+      const bool was_lit = *channel != 0 || this->is_lit_raw_();
+      *channel = value;
+      this->dirty_->mark(this->index_, was_lit, true);
+    } else {
+      // This channel was non-zero, so the pixel was lit; it stays lit if another channel is
+      *channel = value;
+      this->dirty_->mark(this->index_, true, this->is_lit_raw_());
+    }
+  }
+
   uint8_t *const red_;
   uint8_t *const green_;
   uint8_t *const blue_;
   uint8_t *const white_;
   uint8_t *const effect_data_;
   const ESPColorCorrection *color_correction_;
+  ESPDirtyTracker *dirty_{nullptr};
+  int32_t index_{0};
 };
 
 }  // namespace esphome::light
@@ -0,0 +1,55 @@
+#include "light_frame_scheduler.h"
+
+namespace esphome::light {
+
+void LightFrameScheduler::reset(uint32_t now_us) {
+  this->next_frame_us_ = now_us;
+  this->window_start_us_ = now_us;
+  this->window_busy_us_ = 0;
+  this->window_frames_ = 0;
+  this->skipped_ = 0;
+  this->overruns_ = 0;
+  this->fps_ = 0.0f;
+  this->load_ = 0.0f;
+}
+
+bool LightFrameScheduler::frame_due(uint32_t now_us) {
+  if (this->interval_us_ == 0)
+    return true;
+  if (static_cast<int32_t>(now_us - this->next_frame_us_) < 0)
+    return false;
+
+  const uint32_t missed = (now_us - this->next_frame_us_) / this->interval_us_;
+  if (missed > 0 && (this->policy_ == FRAME_POLICY_SKIP || missed > MAX_CATCH_UP_FRAMES)) {
+    // Too far behind (or not catching up at all): drop the missed frames and resync to now.
+    this->skipped_ += missed;
+    this->next_frame_us_ = now_us + this->interval_us_;
+  } else {
+    this->next_frame_us_ += this->interval_us_;
+  }
+  return true;
+}
+
+void LightFrameScheduler::frame_done(uint32_t start_us, uint32_t end_us) {
+  const uint32_t duration = end_us - start_us;
+  this->window_busy_us_ += duration;
+  this->window_frames_++;
+
+  if (this->budget_us_ > 0 && duration > this->budget_us_) {
+    this->overruns_++;
+    // Give the rest of the loop the time this frame took beyond its budget.
+    if (this->interval_us_ > 0)
+      this->next_frame_us_ += duration - this->budget_us_;
+  }
+
+  const uint32_t elapsed = end_us - this->window_start_us_;
+  if (elapsed >= STATS_WINDOW_US) {
+    this->fps_ = this->window_frames_ * 1e6f / elapsed;
+    this->load_ = this->window_busy_us_ * 100.0f / elapsed;
+    this->window_start_us_ = end_us;
+    this->window_busy_us_ = 0;
+    this->window_frames_ = 0;
+  }
+}
+
+}  // namespace esphome::light
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome::light {
+
+/// What to do when effect frames were missed because the loop was busy.
+enum FramePolicy : uint8_t {
+  /// Drop missed frames and resume at the target rate from now.
+  FRAME_POLICY_SKIP,
+  /// Render missed frames on the following loop iterations (up to MAX_CATCH_UP_FRAMES) to keep the frame count.
+  FRAME_POLICY_CATCH_UP,
+};
+
+/** Decides when a light's effect renders a frame, and measures how much time effects take.
+ *
+ * Without a target frame rate, effects render on every LightState::loop() call, as before. With one, the effect
+ * only renders when a frame is due, so the rest of the loop (Wi-Fi, web server, DDP) is not starved by effects that
+ * would otherwise recompute on every iteration. A frame that takes longer than the frame budget pushes the next
+ * frame back by the overrun.
+ */
+class LightFrameScheduler {
+ public:
+  static constexpr uint32_t MAX_CATCH_UP_FRAMES = 4;
+  static constexpr uint32_t STATS_WINDOW_US = 1000000;
+
+  /// Target frames per second, 0 to render on every loop.
+  void set_target_fps(uint16_t fps) { this->interval_us_ = fps == 0 ? 0 : 1000000UL / fps; }
+  uint16_t get_target_fps() const { return this->interval_us_ == 0 ? 0 : 1000000UL / this->interval_us_; }
+  /// Maximum render time per frame in microseconds, 0 for no budget.
+  void set_frame_budget(uint32_t budget_us) { this->budget_us_ = budget_us; }
+  void set_policy(FramePolicy policy) { this->policy_ = policy; }
+
+  /// Restart scheduling and statistics, e.g. when a new effect starts.
+  void reset(uint32_t now_us);
+  /// Whether a frame should be rendered now. Advances the schedule if so.
+  bool frame_due(uint32_t now_us);
+  /// Record a rendered frame.
+  void frame_done(uint32_t start_us, uint32_t end_us);
+
+  /// Frames rendered per second over the last statistics window.
+  float get_fps() const { return this->fps_; }
+  /// Percentage of wall time spent rendering over the last statistics window.
+  float get_load() const { return this->load_; }
+  /// Frames dropped by the skip policy since the effect started.
+  uint32_t get_skipped_frames() const { return this->skipped_; }
+  /// Frames that exceeded the frame budget since the effect started.
+  uint32_t get_overruns() const { return this->overruns_; }
+
+ protected:
+  uint32_t interval_us_{0};
+  uint32_t budget_us_{0};
+  uint32_t next_frame_us_{0};
+  uint32_t window_start_us_{0};
+  uint32_t window_busy_us_{0};
+  uint32_t window_frames_{0};
+  uint32_t skipped_{0};
+  uint32_t overruns_{0};
+  float fps_{0.0f};
+  float load_{0.0f};
+  FramePolicy policy_{FRAME_POLICY_SKIP};
+};
+
+}  // namespace esphome::light
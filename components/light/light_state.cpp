@@ -1,3 +1,4 @@
+#include <cinttypes>
 #include "light_state.h"
 #include "esp_color_correction.h"
 #include "esphome/core/defines.h"
@@ -103,6 +104,7 @@ void LightState::setup() {
       this->rtc_ = global_preferences->make_preference<LightStateRTCState>(this->forced_hash);
 #endif
       this->rtc_.save(&recovered);
+      this->set_last_saved_(recovered);
     }
   }
 #endif  // USE_KAUF_LIGHT_HASH_MIGRATION
@@ -124,6 +126,8 @@ void LightState::setup() {
         else
           this->rtc_ = this->make_entity_preference<LightStateRTCState>();
         loaded = this->rtc_.load(&recovered);
+        if (loaded)
+          this->set_last_saved_(recovered);
       }
 
       // Attempt to load from preferences, else fall back to default values
@@ -149,7 +153,8 @@ void LightState::setup() {
 #endif
         else
           this->rtc_ = this->make_entity_preference<LightStateRTCState>();
-        this->rtc_.load(&recovered);
+        if (this->rtc_.load(&recovered))
+          this->set_last_saved_(recovered);
       }
 
       recovered.state = (this->restore_mode_ == LIGHT_RESTORE_AND_ON);
@@ -224,12 +229,23 @@ void LightState::dump_config() {
                   "  Max Mireds: %.1f",
                   traits.get_min_mireds(), traits.get_max_mireds());
   }
+  if (this->save_delay_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Save Delay: %" PRIu32 "ms", this->save_delay_);
+  }
+  if (this->frame_scheduler_.get_target_fps() > 0) {
+    ESP_LOGCONFIG(TAG, "  Effect Frame Rate: %u fps", this->frame_scheduler_.get_target_fps());
+  }
 }
 void LightState::loop() {
   // Apply effect (if any)
   auto *effect = this->get_active_effect_();
   if (effect != nullptr) {
-    effect->apply();
+    // KAUF: only render when the frame scheduler says a frame is due
+    const uint32_t start = micros();
+    if (this->frame_scheduler_.frame_due(start)) {
+      effect->apply();
+      this->frame_scheduler_.frame_done(start, micros());
+    }
   }
 
   // Apply transformer (if any)
@@ -456,6 +472,7 @@ void LightState::start_effect_(uint32_t effect_index) {
 
   this->active_effect_index_ = effect_index;
   auto *effect = this->get_active_effect_();
+  this->frame_scheduler_.reset(micros());
   effect->start_internal();
   // Enable loop while effect is active
   this->enable_loop();
@@ -523,7 +540,52 @@ void LightState::disable_loop_if_idle_() {
   }
 }
 
+// KAUF: Saves are coalesced so that slider drags and automation ramps only produce one preference write.
+// On/off transitions are always written immediately so a power cut right after switching still restores
+// the correct state.
 void LightState::save_remote_values_() {
+  LightStateRTCState saved = this->make_rtc_state_();
+
+  bool state_changed = !this->has_last_saved_ || saved.state != this->last_saved_.state;
+  if (this->save_delay_ == 0 || state_changed) {
+    if (this->save_pending_) {
+      this->cancel_timeout("save");
+      this->save_pending_ = false;
+    }
+    this->write_rtc_state_(saved);
+    return;
+  }
+
+  // Last value wins: rescheduling replaces the previous pending save.
+  if (this->save_pending_) {
+    this->suppressed_save_count_++;
+  }
+  this->save_pending_ = true;
+  this->set_timeout("save", this->save_delay_, [this]() { this->flush_pending_save(); });
+}
+
+void LightState::flush_pending_save() {
+  if (!this->save_pending_)
+    return;
+  this->cancel_timeout("save");
+  this->save_pending_ = false;
+  this->write_rtc_state_(this->make_rtc_state_());
+}
+
+void LightState::on_shutdown() { this->flush_pending_save(); }
+
+void LightState::write_rtc_state_(const LightStateRTCState &saved) {
+  if (this->has_last_saved_ && saved == this->last_saved_) {
+    this->suppressed_save_count_++;
+    ESP_LOGV(TAG, "'%s': state unchanged, skipping save", this->get_name().c_str());
+    return;
+  }
+  this->rtc_.save(&saved);
+  this->set_last_saved_(saved);
+  this->save_count_++;
+}
+
+LightStateRTCState LightState::make_rtc_state_() {
   LightStateRTCState saved;
   saved.color_mode = this->remote_values.get_color_mode();
 
@@ -539,7 +601,7 @@ void LightState::save_remote_values_() {
   saved.cold_white = this->remote_values.get_cold_white();
   saved.warm_white = this->remote_values.get_warm_white();
   saved.effect = this->active_effect_index_;
-  this->rtc_.save(&saved);
+  return saved;
 }
 
 }  // namespace esphome::light
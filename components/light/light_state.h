@@ -8,6 +8,7 @@
 #include "light_call.h"
 #include "light_color_values.h"
 #include "light_effect.h"
+#include "light_frame_scheduler.h"
 #include "light_traits.h"
 #include "light_transformer.h"
 
@@ -104,6 +105,16 @@ struct LightStateRTCState {
   // Group smaller members at the end
   ColorMode color_mode{ColorMode::UNKNOWN};
   bool state{false};
+
+  // KAUF: field-wise compare (padding bytes are indeterminate, so memcmp is not safe)
+  bool operator==(const LightStateRTCState &rhs) const {
+    return this->brightness == rhs.brightness && this->color_brightness == rhs.color_brightness &&
+           this->red == rhs.red && this->green == rhs.green && this->blue == rhs.blue && this->white == rhs.white &&
+           this->color_temp == rhs.color_temp && this->cold_white == rhs.cold_white &&
+           this->warm_white == rhs.warm_white && this->effect == rhs.effect && this->color_mode == rhs.color_mode &&
+           this->state == rhs.state;
+  }
+  bool operator!=(const LightStateRTCState &rhs) const { return !(*this == rhs); }
 };
 
 /** This class represents the communication layer between the front-end MQTT layer and the
@@ -127,6 +138,8 @@ class LightState : public EntityBase, public Component {
   void setup() override;
   void dump_config() override;
   void loop() override;
+  /// KAUF: flush a pending coalesced save before reboot.
+  void on_shutdown() override;
   /// Shortly after HARDWARE.
   float get_setup_priority() const override;
 
@@ -311,6 +324,21 @@ class LightState : public EntityBase, public Component {
   void set_forced_hash(uint32_t hash_value) { this->forced_hash = hash_value; }
   void set_forced_addr(uint32_t addr_value) { this->forced_addr = addr_value; }
 
+  // KAUF: save coalescing. Saves are delayed by save_delay ms and only the last value is written.
+  // On/off transitions are flushed immediately, and saves matching the stored value are skipped.
+  void set_save_delay(uint32_t save_delay) { this->save_delay_ = save_delay; }
+  uint32_t get_save_delay() const { return this->save_delay_; }
+  /// Number of preference writes actually performed.
+  uint32_t get_save_count() const { return this->save_count_; }
+  /// Number of save requests that were coalesced or skipped because nothing changed.
+  uint32_t get_suppressed_save_count() const { return this->suppressed_save_count_; }
+  /// Write a pending coalesced save now, if there is one.
+  void flush_pending_save();
+
+  // KAUF: effect frame scheduling. Effects render at most at the target frame rate instead of on every loop.
+  LightFrameScheduler &get_frame_scheduler() { return this->frame_scheduler_; }
+  const LightFrameScheduler &get_frame_scheduler() const { return this->frame_scheduler_; }
+
  protected:
   friend LightOutput;
   friend LightCall;
@@ -333,6 +361,15 @@ class LightState : public EntityBase, public Component {
 
   /// Internal method to save the current remote_values to the preferences
   void save_remote_values_();
+  /// KAUF: Build the persisted representation of the current remote_values
+  LightStateRTCState make_rtc_state_();
+  /// KAUF: Write the given state unless it matches what was last written
+  void write_rtc_state_(const LightStateRTCState &saved);
+  /// KAUF: Remember the value currently held in preferences so unchanged saves can be skipped
+  void set_last_saved_(const LightStateRTCState &saved) {
+    this->last_saved_ = saved;
+    this->has_last_saved_ = true;
+  }
 
   /// Disable loop if neither transformer nor effect is active
   void disable_loop_if_idle_();
@@ -393,6 +430,18 @@ class LightState : public EntityBase, public Component {
   bool is_transformer_active_{false};
   /// Restore mode of the light.
   LightRestoreMode restore_mode_;
+
+  /// KAUF: decides when the active effect renders and measures its frame rate and load.
+  LightFrameScheduler frame_scheduler_{};
+
+  // KAUF: save coalescing state
+  /// Value last written to (or loaded from) preferences.
+  LightStateRTCState last_saved_{};
+  uint32_t save_delay_{0};
+  uint32_t save_count_{0};
+  uint32_t suppressed_save_count_{0};
+  bool has_last_saved_{false};
+  bool save_pending_{false};
 };
 
 }  // namespace esphome::light
@@ -0,0 +1,75 @@
+import esphome.codegen as cg
+from esphome.components import sensor
+import esphome.config_validation as cv
+from esphome.const import (
+    CONF_ID,
+    CONF_LIGHT_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_PERCENT,
+)
+
+from .. import LightState, light_ns
+
+# KAUF: effect frame scheduler statistics
+LightFrameSensor = light_ns.class_("LightFrameSensor", cg.PollingComponent)
+
+CONF_FPS = "fps"
+CONF_LOAD = "load"
+CONF_SKIPPED_FRAMES = "skipped_frames"
+CONF_OVERRUNS = "overruns"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(LightFrameSensor),
+        cv.Required(CONF_LIGHT_ID): cv.use_id(LightState),
+        cv.Optional(CONF_FPS): sensor.sensor_schema(
+            unit_of_measurement="fps",
+            icon="mdi:speedometer",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_LOAD): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            icon="mdi:chip",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_SKIPPED_FRAMES): sensor.sensor_schema(
+            icon="mdi:skip-next",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_OVERRUNS): sensor.sensor_schema(
+            icon="mdi:timer-alert-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+).extend(cv.polling_component_schema("10s"))
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    light = await cg.get_variable(config[CONF_LIGHT_ID])
+    cg.add(var.set_light(light))
+
+    if fps_config := config.get(CONF_FPS):
+        sens = await sensor.new_sensor(fps_config)
+        cg.add(var.set_fps_sensor(sens))
+    if load_config := config.get(CONF_LOAD):
+        sens = await sensor.new_sensor(load_config)
+        cg.add(var.set_load_sensor(sens))
+    if skipped_config := config.get(CONF_SKIPPED_FRAMES):
+        sens = await sensor.new_sensor(skipped_config)
+        cg.add(var.set_skipped_frames_sensor(sens))
+    if overruns_config := config.get(CONF_OVERRUNS):
+        sens = await sensor.new_sensor(overruns_config)
+        cg.add(var.set_overruns_sensor(sens))
@@ -0,0 +1,31 @@
+#include "light_frame_sensor.h"
+#include "esphome/core/log.h"
+
+namespace esphome::light {
+
+static const char *const TAG = "light.frame_sensor";
+
+void LightFrameSensor::update() {
+  const auto &scheduler = this->light_->get_frame_scheduler();
+  // Statistics are only meaningful while an effect is running.
+  const bool active = this->light_->get_current_effect_index() != 0;
+
+  if (this->fps_sensor_ != nullptr)
+    this->fps_sensor_->publish_state(active ? scheduler.get_fps() : 0.0f);
+  if (this->load_sensor_ != nullptr)
+    this->load_sensor_->publish_state(active ? scheduler.get_load() : 0.0f);
+  if (this->skipped_frames_sensor_ != nullptr)
+    this->skipped_frames_sensor_->publish_state(scheduler.get_skipped_frames());
+  if (this->overruns_sensor_ != nullptr)
+    this->overruns_sensor_->publish_state(scheduler.get_overruns());
+}
+
+void LightFrameSensor::dump_config() {
+  ESP_LOGCONFIG(TAG, "Light Frame Sensor for '%s'", this->light_->get_name().c_str());
+  LOG_SENSOR("  ", "FPS", this->fps_sensor_);
+  LOG_SENSOR("  ", "Load", this->load_sensor_);
+  LOG_SENSOR("  ", "Skipped Frames", this->skipped_frames_sensor_);
+  LOG_SENSOR("  ", "Overruns", this->overruns_sensor_);
+}
+
+}  // namespace esphome::light
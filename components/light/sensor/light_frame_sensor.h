@@ -0,0 +1,29 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "../light_state.h"
+
+namespace esphome::light {
+
+/// KAUF: publishes the effect frame scheduler statistics of a light.
+class LightFrameSensor : public PollingComponent {
+ public:
+  void set_light(LightState *light) { this->light_ = light; }
+  void set_fps_sensor(sensor::Sensor *sensor) { this->fps_sensor_ = sensor; }
+  void set_load_sensor(sensor::Sensor *sensor) { this->load_sensor_ = sensor; }
+  void set_skipped_frames_sensor(sensor::Sensor *sensor) { this->skipped_frames_sensor_ = sensor; }
+  void set_overruns_sensor(sensor::Sensor *sensor) { this->overruns_sensor_ = sensor; }
+
+  void update() override;
+  void dump_config() override;
+
+ protected:
+  LightState *light_{nullptr};
+  sensor::Sensor *fps_sensor_{nullptr};
+  sensor::Sensor *load_sensor_{nullptr};
+  sensor::Sensor *skipped_frames_sensor_{nullptr};
+  sensor::Sensor *overruns_sensor_{nullptr};
+};
+
+}  // namespace esphome::light
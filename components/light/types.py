@@ -86,3 +86,14 @@ AddressableFireworksEffect = light_ns.class_(
 AddressableFlickerEffect = light_ns.class_(
     "AddressableFlickerEffect", AddressableLightEffect
 )
+AddressableLayersEffect = light_ns.class_(
+    "AddressableLayersEffect", AddressableLightEffect
+)
+AddressableLayerConfig = light_ns.struct("AddressableLayerConfig")
+AddressableBlendMode = light_ns.enum("AddressableBlendMode")
+BLEND_MODES = {
+    "ALPHA": AddressableBlendMode.BLEND_ALPHA,
+    "ADD": AddressableBlendMode.BLEND_ADD,
+    "MAX": AddressableBlendMode.BLEND_MAX,
+    "MASK": AddressableBlendMode.BLEND_MASK,
+}
@@ -1,6 +1,8 @@
 from __future__ import annotations
 
 import gzip
+import hashlib
+from pathlib import Path
 
 import esphome.codegen as cg
 from esphome.components import web_server_base
@@ -87,6 +89,20 @@ def validate_local(config: ConfigType) -> ConfigType:
     return config
 
 
+# KAUF: the WebSocket transport uses ESPAsyncWebServer's AsyncWebSocket, which the ESP-IDF server does not have
+def validate_websocket(config: ConfigType) -> ConfigType:
+    if config.get("websocket") and CORE.is_esp32:
+        raise cv.Invalid("'websocket' is only supported on Arduino platforms (not ESP32)")
+    return config
+
+
+# KAUF: delta state events are implemented in the Arduino event source list; web_server_idf sends full events only
+def validate_delta_state_events(config: ConfigType) -> ConfigType:
+    if config.get("delta_state_events") and CORE.is_esp32:
+        raise cv.Invalid("'delta_state_events' is only supported on Arduino platforms (not ESP32)")
+    return config
+
+
 def validate_ota(config: ConfigType) -> ConfigType:
     # The OTA option only accepts False to explicitly disable OTA for web_server
     # IMPORTANT: Setting ota: false ONLY affects the web_server component
@@ -247,6 +263,10 @@ CONFIG_SCHEMA = cv.All(
             cv.Optional(CONF_PRODUCT): cv.one_of(*PRODUCT_DEFINE_MAP, lower=True),
             cv.Optional(CONF_FACTORY, default=False): cv.boolean,
             cv.Optional(CONF_FEATURED_ENTITY): cv.string,
+            cv.Optional("delta_state_events", default=False): cv.boolean,
+            cv.Optional("websocket", default=False): cv.boolean,
+            cv.Optional("metrics", default=False): cv.boolean,
+            cv.Optional("diagnostics", default=False): cv.boolean,
 
             cv.Optional(CONF_LOCAL): cv.boolean,
             cv.Optional(CONF_COMPRESSION, default="gzip"): cv.one_of("gzip", "br"),
@@ -265,6 +285,8 @@ CONFIG_SCHEMA = cv.All(
     ),
     default_url,
     validate_local,
+    validate_websocket,
+    validate_delta_state_events,
     validate_sorting_groups,
     validate_ota,
     _consume_web_server_sockets,
@@ -297,17 +319,28 @@ async def add_entity_config(entity, config):
     )
 
 
+# KAUF: content hash used as ETag and as cache-busting query for the included assets
+def content_hash(content: bytes) -> str:
+    return hashlib.sha256(content).hexdigest()[:16]
+
+
+def _include_hash(path: str) -> str:
+    with open(file=CORE.relative_config_path(path), encoding="utf-8") as file:
+        return content_hash(file.read().encode("utf-8"))
+
+
 def build_index_html(config) -> str:
     html = "<!DOCTYPE html><html><head><meta charset=UTF-8><link rel=icon href=data:>"
     css_include = config.get(CONF_CSS_INCLUDE)
     js_include = config.get(CONF_JS_INCLUDE)
+    # KAUF: hashed include URLs so the browser may cache them forever
     if css_include:
-        html += "<link rel=stylesheet href=/0.css>"
+        html += f"<link rel=stylesheet href=/0.css?v={_include_hash(css_include)}>"
     if config[CONF_CSS_URL]:
         html += f'<link rel=stylesheet href="{config[CONF_CSS_URL]}">'
     html += "</head><body>"
     if js_include:
-        html += "<script type=module src=/0.js></script>"
+        html += f"<script type=module src=/0.js?v={_include_hash(js_include)}></script>"
     html += "<esp-app></esp-app>"
     if config[CONF_JS_URL]:
         html += f'<script src="{config[CONF_JS_URL]}"></script>'
@@ -328,6 +361,17 @@ def add_resource_as_progmem(
     size_t = f"constexpr size_t ESPHOME_WEBSERVER_{resource_name}_SIZE = {content_encoded_size}"
     cg.add_global(cg.RawExpression(uint8_t))
     cg.add_global(cg.RawExpression(size_t))
+    # KAUF: hash of the uncompressed content, so it matches the ?v= query built by build_index_html()
+    add_etag(resource_name, content_hash(content.encode("utf-8")))
+
+
+def add_etag(resource_name: str, etag: str) -> None:
+    """Add a quoted ETag string for a resource."""
+    cg.add_global(
+        cg.RawExpression(
+            f'constexpr char ESPHOME_WEBSERVER_{resource_name}_ETAG[] = "\\"{etag}\\""'
+        )
+    )
 
 
 @coroutine_with_priority(CoroPriority.WEB)
@@ -380,6 +424,13 @@ async def to_code(config):
     cg.add(var.set_include_internal(config[CONF_INCLUDE_INTERNAL]))
     if CONF_LOCAL in config and config[CONF_LOCAL]:
         cg.add_define("USE_WEBSERVER_LOCAL")
+        # KAUF: the bundled frontend only changes with the header it is compiled from
+        if version >= 2:
+            bundle = Path(__file__).parent / f"server_index_v{version}.h"
+            add_etag(
+                "LOCAL_INDEX",
+                content_hash(bundle.read_bytes() + config[CONF_COMPRESSION].encode()),
+            )
     if config[CONF_COMPRESSION] == "gzip":
         cg.add_define("USE_WEBSERVER_GZIP")
 
@@ -396,6 +447,14 @@ async def to_code(config):
         cg.add_define("KAUF_FACTORY_FIRMWARE")
     if (featured := config.get(CONF_FEATURED_ENTITY)) is not None:
         cg.add(var.set_featured_name(featured))
+    if config["delta_state_events"]:
+        cg.add(var.set_delta_events(True))
+    if config["websocket"]:
+        cg.add_define("USE_WEBSERVER_WEBSOCKET")
+    if config["metrics"]:
+        cg.add_define("USE_WEBSERVER_METRICS")
+    if config["diagnostics"]:
+        cg.add_define("USE_WEBSERVER_DIAGNOSTICS")
 
 
 def FILTER_SOURCE_FILES() -> list[str]:
@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""KAUF: host benchmark for the deferred SSE queue.
+
+Builds deferred_event_source.cpp with g++ against the stand-ins from
+test_deferred_events.py. A client with a full send queue gets state events for
+100 sensors, each published --updates times, then its queue frees up and
+DeferredUpdateEventSource::loop() drains the 100 queued updates. Timed two ways:
+
+  vector  the previous queue: a std::vector popped from the front, dedup by a
+          linear search for the (source, generator) pair
+  ring    the current ring buffer with dedup by entity index slot
+
+The vector queue is a copy of the previous code built into the driver, both use
+the same generator and send stand-ins. Times are per round of publishes plus
+drain, averaged over --rounds rounds.
+
+    python3 bench_deferred_events.py [--sensors 100] [--updates 1,3] [--rounds 2000] [--cxx g++] [--keep]
+"""
+
+import argparse
+import json
+import os
+from pathlib import Path
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE))
+
+from test_deferred_events import LOCAL_STUBS, STUBS  # noqa: E402
+
+# Times publishing and draining with both queues and reports us per round as JSON
+DRIVER = r"""
+#include "web_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::web_server;
+
+static std::vector<float> values;
+
+static json::SerializationBuffer<> generator(WebServer *ws, void *source) {
+  const int32_t id = ws->get_entity_index().id_of(source);
+  char buf[96];
+  snprintf(buf, sizeof(buf), "{\"id\":\"sensor-sensor_%d\",\"value\":%.1f,\"state\":\"%.1f C\"}", id, values[id],
+           values[id]);
+  return json::SerializationBuffer<>(buf);
+}
+
+// The queue before the ring buffer, for one client
+class VectorQueue : public AsyncEventSource {
+ public:
+  struct DeferredEvent {
+    void *source_;
+    message_generator_t *message_generator_;
+    bool operator==(const DeferredEvent &test) const {
+      return source_ == test.source_ && message_generator_ == test.message_generator_;
+    }
+  };
+  VectorQueue(WebServer *ws) : AsyncEventSource("/events"), web_server_(ws) {}
+
+  void deq_push_back_with_dedup_(void *source, message_generator_t *message_generator) {
+    DeferredEvent item{source, message_generator};
+    if (std::find(this->deferred_queue_.begin(), this->deferred_queue_.end(), item) != this->deferred_queue_.end())
+      return;
+    this->deferred_queue_.push_back(item);
+  }
+  void process_deferred_queue_() {
+    while (!this->deferred_queue_.empty()) {
+      DeferredEvent &de = this->deferred_queue_.front();
+      auto message = de.message_generator_(this->web_server_, de.source_);
+      if (this->send(message.c_str(), "state") == DISCARDED)
+        break;
+      this->deferred_queue_.erase(this->deferred_queue_.begin());
+    }
+  }
+  void deferrable_send_state(void *source, message_generator_t *message_generator) {
+    if (!this->deferred_queue_.empty())
+      this->process_deferred_queue_();
+    if (!this->deferred_queue_.empty()) {
+      this->deq_push_back_with_dedup_(source, message_generator);
+      return;
+    }
+    auto message = message_generator(this->web_server_, source);
+    if (this->send(message.c_str(), "state") == DISCARDED)
+      this->deq_push_back_with_dedup_(source, message_generator);
+  }
+  void loop() { this->process_deferred_queue_(); }
+
+ protected:
+  WebServer *web_server_;
+  std::vector<DeferredEvent> deferred_queue_;
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Times {
+  double publish_us{0};
+  double drain_us{0};
+};
+
+template<typename Client, typename Publish, typename Drain>
+static Times run(Client *client, int sensors, int updates, int rounds, std::vector<std::unique_ptr<EntityBase>> &ents,
+                 Publish &&publish, Drain &&drain) {
+  Times times;
+  for (int r = 0; r < rounds; r++) {
+    client->full = true;
+    const auto start = Clock::now();
+    for (int u = 0; u < updates; u++) {
+      for (int i = 0; i < sensors; i++) {
+        values[i] += 0.1f;
+        publish(ents[i].get());
+      }
+    }
+    const auto queued = Clock::now();
+    client->full = false;
+    drain();
+    const auto drained = Clock::now();
+    times.publish_us += std::chrono::duration<double, std::micro>(queued - start).count();
+    times.drain_us += std::chrono::duration<double, std::micro>(drained - queued).count();
+    client->states.clear();
+    client->discarded = 0;
+  }
+  times.publish_us /= rounds;
+  times.drain_us /= rounds;
+  return times;
+}
+
+int main(int argc, char **argv) {
+  const int sensors = atoi(argv[1]);
+  const int updates = atoi(argv[2]);
+  const int rounds = atoi(argv[3]);
+
+  WebServer ws;
+  std::vector<std::unique_ptr<EntityBase>> entities;
+  for (int i = 0; i < sensors; i++) {
+    entities.emplace_back(new EntityBase("Sensor " + std::to_string(i)));
+    ws.entity_index_.add(ENTITY_DOMAIN_SENSOR, entities.back().get());
+  }
+  ws.entity_index_.build();
+  values.assign(sensors, 20.0f);
+
+  VectorQueue vector(&ws);
+  const Times before = run(
+      &vector, sensors, updates, rounds, entities, [&](EntityBase *obj) { vector.deferrable_send_state(obj, generator); },
+      [&]() { vector.loop(); });
+  const size_t vector_sent = vector.states.size();
+
+  DeferredUpdateEventSourceList list;
+  AsyncWebServerRequest request("");
+  list.add_new_client(&ws, &request);
+  ws.run_deferred();
+  list.loop();
+  AsyncEventSource *client = list.front();
+  size_t ring_sent = 0;
+  const Times after = run(
+      client, sensors, updates, rounds, entities,
+      [&](EntityBase *obj) { list.deferrable_send_state(obj, "state", generator); },
+      [&]() {
+        list.loop();
+        ring_sent = client->states.size();
+      });
+
+  client->disconnect();
+  ws.run_deferred();
+  printf("{\"vector\": {\"publish_us\": %.2f, \"drain_us\": %.2f}, \"ring\": {\"publish_us\": %.2f, \"drain_us\": %.2f}, "
+         "\"ring_sent\": %zu, \"vector_sent\": %zu}\n",
+         before.publish_us, before.drain_us, after.publish_us, after.drain_us, ring_sent, vector_sent);
+  return 0;
+}
+"""
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--sensors", type=int, default=100, help="sensors queued per round")
+    parser.add_argument("--updates", default="1,3", help="comma separated publishes per sensor and round")
+    parser.add_argument("--rounds", type=int, default=2000, help="timed rounds per row")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--keep", action="store_true", help="keep the build directory")
+    args = parser.parse_args()
+
+    tmp = Path(tempfile.mkdtemp(prefix="deferred_events_bench_"))
+    try:
+        for name, text in STUBS.items():
+            path = tmp / "include" / name
+            path.parent.mkdir(parents=True, exist_ok=True)
+            path.write_text(text)
+        src = tmp / "src"
+        src.mkdir()
+        for name in ("deferred_event_source.h", "deferred_event_source.cpp", "entity_index.h", "entity_index.cpp"):
+            shutil.copy(HERE / name, src / name)
+        for name, text in LOCAL_STUBS.items():
+            (src / name).write_text(text)
+        (src / "driver.cpp").write_text(DRIVER)
+        binary = tmp / "bench"
+        subprocess.run(
+            [args.cxx, "-std=gnu++17", "-O2", "-Wall", "-Werror", "-I", str(tmp / "include")]
+            + [str(src / "deferred_event_source.cpp"), str(src / "entity_index.cpp"), str(src / "driver.cpp")]
+            + ["-o", str(binary)],
+            check=True,
+        )
+
+        failed = False
+        print(f"{'sensors':>7} {'updates':>7} {'queue':<7} {'publish us':>11} {'drain us':>9}")
+        for updates in (int(u) for u in args.updates.split(",")):
+            out = subprocess.run(
+                [str(binary), str(args.sensors), str(updates), str(args.rounds)],
+                check=True,
+                capture_output=True,
+                text=True,
+            )
+            row = json.loads(out.stdout)
+            # Every round ends with one message per sensor drained from the queue
+            if row["ring_sent"] != args.sensors:
+                print(f"ring queue drained {row['ring_sent']} updates, expected {args.sensors}")
+                failed = True
+            for queue in ("vector", "ring"):
+                publish_us, drain_us = row[queue]["publish_us"], row[queue]["drain_us"]
+                print(f"{args.sensors:>7} {updates:>7} {queue:<7} {publish_us:>11.2f} {drain_us:>9.2f}")
+    finally:
+        if args.keep:
+            print(f"build files kept in {tmp}")
+        else:
+            shutil.rmtree(tmp)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
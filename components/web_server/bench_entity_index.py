@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""KAUF: host benchmark for the REST entity lookup.
+
+Builds entity_index.cpp with g++ against minimal stand-ins for the ESPHome
+headers and times finding an entity for a parsed URL at 10, 100 and 500
+entities in one domain, two ways:
+
+  scan   the previous dispatch: walk the domain's entities and call
+         UrlMatch::match_entity() on each until one matches
+  index  EntityIndex::find()
+
+Both use the real UrlMatch::match_entity(), and every lookup is checked to
+return the same entity both ways. Lookups are by entity name, by the
+deprecated object_id and for names that do not exist (a 404).
+
+    python3 bench_entity_index.py [--sizes 10,100,500] [--lookups 200000] [--cxx g++] [--keep]
+"""
+
+import argparse
+import json
+import os
+from pathlib import Path
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = Path(__file__).resolve().parent
+
+STUBS = {
+    "esphome/core/defines.h": """
+#pragma once
+#define USE_WEBSERVER
+""",
+    "esphome/core/log.h": """
+#pragma once
+#define ESP_LOGW(tag, ...) ((void) 0)
+""",
+    "esphome/core/string_ref.h": """
+#pragma once
+#include <cstring>
+#include <string>
+namespace esphome {
+class StringRef {
+ public:
+  StringRef() = default;
+  StringRef(const char *str) : base_(str), len_(strlen(str)) {}
+  StringRef(const char *str, size_t len) : base_(str), len_(len) {}
+  StringRef(const std::string &str) : base_(str.c_str()), len_(str.size()) {}
+  const char *c_str() const { return this->base_; }
+  size_t size() const { return this->len_; }
+  bool empty() const { return this->len_ == 0; }
+  bool operator==(const StringRef &o) const { return len_ == o.len_ && memcmp(base_, o.base_, len_) == 0; }
+  bool operator!=(const StringRef &o) const { return !(*this == o); }
+  bool operator==(const char *s) const { return *this == StringRef(s); }
+
+ protected:
+  const char *base_{""};
+  size_t len_{0};
+};
+}  // namespace esphome
+""",
+    "esphome/core/entity_base.h": """
+#pragma once
+#include <cctype>
+#include <string>
+#include "esphome/core/string_ref.h"
+namespace esphome {
+static constexpr size_t OBJECT_ID_MAX_LEN = 128;
+class EntityBase {
+ public:
+  explicit EntityBase(std::string name) : name_(std::move(name)), name_ref_(this->name_) {}
+  const StringRef &get_name() const { return this->name_ref_; }
+  /// Snake case of the name with everything but [a-z0-9_-] dropped, like the real object_id.
+  StringRef get_object_id_to(char *buf) const {
+    size_t len = 0;
+    for (char c : this->name_) {
+      if (len + 1 >= OBJECT_ID_MAX_LEN)
+        break;
+      c = c == ' ' ? '_' : static_cast<char>(tolower(static_cast<unsigned char>(c)));
+      if (isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-')
+        buf[len++] = c;
+    }
+    buf[len] = 0;
+    return StringRef(buf, len);
+  }
+  bool is_internal() const { return false; }
+
+ protected:
+  std::string name_;
+  StringRef name_ref_;
+};
+}  // namespace esphome
+""",
+}
+
+# Times both lookups for one entity count and reports ns per lookup as JSON
+DRIVER = r"""
+#include "entity_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::web_server;
+
+struct Key {
+  std::string id;
+};
+
+static UrlMatch url(const std::string &id) {
+  UrlMatch match{};
+  match.domain = StringRef("sensor");
+  match.id = StringRef(id);
+  match.valid = true;
+  return match;
+}
+
+// The dispatch before the index: first entity of the domain whose name or object_id matches
+static EntityBase *scan(const std::vector<EntityBase *> &entities, const UrlMatch &match) {
+  for (auto *obj : entities) {
+    if (match.match_entity(obj).matched)
+      return obj;
+  }
+  return nullptr;
+}
+
+template<typename F> static double time_ns(const std::vector<Key> &keys, uint32_t lookups, F &&lookup) {
+  uintptr_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < lookups; i++)
+    sink += reinterpret_cast<uintptr_t>(lookup(url(keys[i % keys.size()].id)));
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  if (sink == 1)
+    printf("\n");
+  return ns / lookups;
+}
+
+int main(int argc, char **argv) {
+  const int count = atoi(argv[1]);
+  const uint32_t lookups = strtoul(argv[2], nullptr, 10);
+
+  // Other domains are indexed too, they share the hash table
+  std::vector<std::unique_ptr<EntityBase>> owned;
+  std::vector<EntityBase *> sensors;
+  EntityIndex index;
+  for (int i = 0; i < count; i++) {
+    owned.emplace_back(new EntityBase("Living Room Sensor " + std::to_string(i)));
+    sensors.push_back(owned.back().get());
+    index.add(ENTITY_DOMAIN_SENSOR, sensors.back());
+    owned.emplace_back(new EntityBase("Living Room Sensor " + std::to_string(i)));
+    index.add(ENTITY_DOMAIN_SWITCH, owned.back().get());
+  }
+  index.build();
+
+  std::mt19937 rng(count);
+  std::vector<Key> by_name, by_object_id, missing;
+  char buf[OBJECT_ID_MAX_LEN];
+  for (auto *obj : sensors) {
+    by_name.push_back({obj->get_name().c_str()});
+    by_object_id.push_back({obj->get_object_id_to(buf).c_str()});
+    missing.push_back({std::string("Kitchen Sensor ") + std::to_string(by_name.size())});
+  }
+  for (auto *keys : {&by_name, &by_object_id, &missing})
+    std::shuffle(keys->begin(), keys->end(), rng);
+
+  // Both ways must find the same entity
+  int mismatches = 0;
+  for (auto *keys : {&by_name, &by_object_id, &missing}) {
+    for (const auto &key : *keys) {
+      if (scan(sensors, url(key.id)) != index.find(ENTITY_DOMAIN_SENSOR, url(key.id)))
+        mismatches++;
+    }
+  }
+
+  printf("{\"entities\": %d, \"mismatches\": %d, \"slots\": %zu", count, mismatches, index.capacity());
+  const char *names[] = {"name", "object_id", "missing"};
+  const std::vector<Key> *sets[] = {&by_name, &by_object_id, &missing};
+  for (int s = 0; s < 3; s++) {
+    const double scan_ns = time_ns(*sets[s], lookups, [&](const UrlMatch &m) { return scan(sensors, m); });
+    const double index_ns =
+        time_ns(*sets[s], lookups, [&](const UrlMatch &m) { return index.find(ENTITY_DOMAIN_SENSOR, m); });
+    printf(", \"%s\": {\"scan_ns\": %.1f, \"index_ns\": %.1f}", names[s], scan_ns, index_ns);
+  }
+  printf("}\n");
+  return 0;
+}
+"""
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--sizes", default="10,100,500", help="comma separated entity counts")
+    parser.add_argument("--lookups", type=int, default=200000, help="timed lookups per row")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--keep", action="store_true", help="keep the build directory")
+    args = parser.parse_args()
+
+    tmp = Path(tempfile.mkdtemp(prefix="entity_index_bench_"))
+    try:
+        for name, text in STUBS.items():
+            path = tmp / "include" / name
+            path.parent.mkdir(parents=True, exist_ok=True)
+            path.write_text(text)
+        (tmp / "driver.cpp").write_text(DRIVER)
+        binary = tmp / "bench"
+        subprocess.run(
+            [args.cxx, "-std=gnu++17", "-O2", "-Wall", "-Werror", "-I", str(tmp / "include"), "-I", str(HERE)]
+            + [str(HERE / "entity_index.cpp"), str(tmp / "driver.cpp"), "-o", str(binary)],
+            check=True,
+        )
+
+        failed = False
+        print(f"{'entities':>8} {'lookup':<10} {'scan ns':>9} {'index ns':>9} {'speedup':>8}")
+        for size in (int(s) for s in args.sizes.split(",")):
+            out = subprocess.run(
+                [str(binary), str(size), str(args.lookups)], check=True, capture_output=True, text=True
+            )
+            row = json.loads(out.stdout)
+            if row["mismatches"]:
+                print(f"{size} entities: index and scan disagree on {row['mismatches']} lookups")
+                failed = True
+            for kind in ("name", "object_id", "missing"):
+                scan_ns, index_ns = row[kind]["scan_ns"], row[kind]["index_ns"]
+                print(f"{size:>8} {kind:<10} {scan_ns:>9.1f} {index_ns:>9.1f} {scan_ns / index_ns:>7.1f}x")
+    finally:
+        if args.keep:
+            print(f"build files kept in {tmp}")
+        else:
+            shutil.rmtree(tmp)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,319 @@
+#include "deferred_event_source.h"
+#ifdef USE_WEBSERVER
+#if !defined(USE_ESP32) && defined(USE_ARDUINO)
+#include "web_server.h"
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/core/progmem.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <new>
+
+namespace esphome::web_server {
+
+static const char *const TAG = "web_server";
+
+// helper for allowing only unique entries in the queue
+void __attribute__((flatten))
+DeferredUpdateEventSource::deq_push_back_with_dedup_(void *source, message_generator_t *message_generator,
+                                                     bool detail_all) {
+  // KAUF: dedup by dense entity id; every entity the web server publishes is indexed at setup
+  const int32_t id = this->web_server_->get_entity_index().id_of(source);
+  if (id >= 0) {
+    if (this->deferred_slots_ == nullptr) {
+      this->deferred_slots_.reset(  // NOLINT
+          new (std::nothrow) message_generator_t *[this->web_server_->get_entity_index().entity_count()]());
+    }
+    if (this->deferred_slots_ != nullptr && this->deferred_slots_[id] != nullptr) {
+      // Already queued; the entry is generated when it is sent so it carries the latest state anyway
+      if (detail_all)
+        this->deferred_slots_[id] = message_generator;
+      return;
+    }
+  }
+
+  this->deferred_idle_loops_ = 0;
+  if (this->deferred_count_ == this->deferred_capacity_ && !this->grow_deferred_queue_()) {
+    ESP_LOGW(TAG, "Deferred event queue full, dropping event");
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+    this->web_server_->get_diagnostics().record_sse_dropped();
+#endif
+    return;
+  }
+  this->deferred_queue_[(this->deferred_head_ + this->deferred_count_) & (this->deferred_capacity_ - 1)] =
+      DeferredEvent(source, message_generator);
+  this->deferred_count_++;
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  this->web_server_->get_diagnostics().record_sse_queue_depth(this->deferred_count_);
+#endif
+  if (id >= 0 && this->deferred_slots_ != nullptr)
+    this->deferred_slots_[id] = message_generator;
+}
+
+bool DeferredUpdateEventSource::grow_deferred_queue_() {
+  if (this->deferred_capacity_ >= DEFERRED_QUEUE_MAX_CAPACITY)
+    return false;
+  const uint16_t capacity =
+      this->deferred_capacity_ == 0 ? DEFERRED_QUEUE_INITIAL_CAPACITY : this->deferred_capacity_ * 2;
+  std::unique_ptr<DeferredEvent[]> queue(new (std::nothrow) DeferredEvent[capacity]);  // NOLINT
+  if (queue == nullptr)
+    return false;
+  // Unwrap into the new buffer so the head starts at 0 again
+  for (uint16_t i = 0; i < this->deferred_count_; i++)
+    queue[i] = this->deferred_queue_[(this->deferred_head_ + i) & (this->deferred_capacity_ - 1)];
+  this->deferred_queue_ = std::move(queue);
+  this->deferred_capacity_ = capacity;
+  this->deferred_head_ = 0;
+  return true;
+}
+
+void DeferredUpdateEventSource::clear_deferred_queue_() {
+  this->deferred_head_ = 0;
+  this->deferred_count_ = 0;
+  this->release_deferred_queue_();
+}
+
+void DeferredUpdateEventSource::release_deferred_queue_() {
+  // KAUF: the next event allocates the initial capacity again
+  this->deferred_queue_.reset();
+  this->deferred_slots_.reset();
+  this->deferred_capacity_ = 0;
+  this->deferred_head_ = 0;
+  this->deferred_idle_loops_ = 0;
+}
+
+void DeferredUpdateEventSource::process_deferred_queue_() {
+  while (!this->deferred_queue_empty_()) {
+    DeferredEvent &de = this->deferred_queue_[this->deferred_head_];
+    // KAUF: an indexed entity's slot holds the generator to use, it may have been upgraded to state_detail_all
+    const int32_t id = this->web_server_->get_entity_index().id_of(de.source_);
+    message_generator_t **slot = id >= 0 && this->deferred_slots_ != nullptr ? &this->deferred_slots_[id] : nullptr;
+    auto message = (slot != nullptr ? *slot : de.message_generator_)(web_server_, de.source_);
+    if (this->send(message.c_str(), "state") != DISCARDED) {
+      // KAUF: O(1) pop from the ring buffer
+      if (slot != nullptr)
+        *slot = nullptr;
+      this->deferred_head_ = (this->deferred_head_ + 1) & (this->deferred_capacity_ - 1);
+      this->deferred_count_--;
+      this->consecutive_send_failures_ = 0;  // Reset failure count on successful send
+    } else {
+      // NOTE: Similar logic exists in web_server_idf/web_server_idf.cpp in AsyncEventSourceResponse::process_buffer_()
+      // The implementations differ due to platform-specific APIs (DISCARDED vs HTTPD_SOCK_ERR_TIMEOUT, close() vs
+      // fd_.store(0)), but the failure counting and timeout logic should be kept in sync. If you change this logic,
+      // also update the ESP-IDF implementation.
+      this->consecutive_send_failures_++;
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+      this->web_server_->get_diagnostics().record_sse_discarded();
+#endif
+      if (this->consecutive_send_failures_ >= MAX_CONSECUTIVE_SEND_FAILURES) {
+        // Too many failures, connection is likely dead
+        ESP_LOGW(TAG, "Closing stuck EventSource connection after %" PRIu16 " failed sends",
+                 this->consecutive_send_failures_);
+        this->close();
+        this->clear_deferred_queue_();
+      }
+      break;
+    }
+  }
+}
+
+void DeferredUpdateEventSource::loop() {
+  process_deferred_queue_();
+  // KAUF: keep a grown buffer through a burst, release it once the queue has stayed empty for a while
+  if (this->deferred_queue_empty_() && this->deferred_capacity_ > DEFERRED_QUEUE_INITIAL_CAPACITY &&
+      ++this->deferred_idle_loops_ >= DEFERRED_QUEUE_IDLE_LOOPS)
+    this->release_deferred_queue_();
+  if (!this->entities_iterator_.completed())
+    this->entities_iterator_.advance();
+}
+
+void DeferredUpdateEventSource::deferrable_send_state(void *source, const char *event_type,
+                                                      message_generator_t *message_generator) {
+  if (this->prepare_send_state_(source, event_type, message_generator)) {
+    auto message = message_generator(web_server_, source);
+    this->send_prepared_state_(message.c_str(), source, message_generator,
+                               0 == strcmp(event_type, "state_detail_all"));
+  }
+}
+
+bool DeferredUpdateEventSource::prepare_send_state_(void *source, const char *event_type,
+                                                    message_generator_t *message_generator) {
+  // Skip if no connected clients to avoid unnecessary deferred queue processing
+  if (this->count() == 0)
+    return false;
+
+  // allow all json "details_all" to go through before publishing bare state events, this avoids unnamed entries showing
+  // up in the web GUI and reduces event load during initial connect
+  if (!entities_iterator_.completed() && 0 != strcmp(event_type, "state_detail_all"))
+    return false;
+
+  if (source == nullptr)
+    return false;
+  if (event_type == nullptr)
+    return false;
+  if (message_generator == nullptr)
+    return false;
+
+  if (0 != strcmp(event_type, "state_detail_all") && 0 != strcmp(event_type, "state")) {
+    ESP_LOGE(TAG, "Can't defer non-state event");
+  }
+
+  if (!this->deferred_queue_empty_())
+    process_deferred_queue_();
+  if (!this->deferred_queue_empty_()) {
+    // deferred queue still not empty which means downstream event queue full, no point trying to send first
+    deq_push_back_with_dedup_(source, message_generator, 0 == strcmp(event_type, "state_detail_all"));
+    return false;
+  }
+  return true;
+}
+
+bool DeferredUpdateEventSource::send_prepared_state_(const char *message, void *source,
+                                                     message_generator_t *message_generator, bool detail_all) {
+  if (this->send(message, "state") == DISCARDED) {
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+    this->web_server_->get_diagnostics().record_sse_discarded();
+#endif
+    deq_push_back_with_dedup_(source, message_generator, detail_all);
+    return false;
+  }
+  this->consecutive_send_failures_ = 0;  // Reset failure count on successful send
+  return true;
+}
+
+// used for logs plus the initial ping/config
+void DeferredUpdateEventSource::try_send_nodefer(const char *message, const char *event, uint32_t id,
+                                                 uint32_t reconnect) {
+  this->send(message, event, id, reconnect);
+}
+
+bool DeferredUpdateEventSourceList::loop() {
+  for (DeferredUpdateEventSource *dues : *this) {
+    dues->loop();
+  }
+  return !this->empty();
+}
+
+void DeferredUpdateEventSourceList::deferrable_send_state(void *source, const char *event_type,
+                                                          message_generator_t *message_generator) {
+  // Skip if no event sources (no connected clients) to avoid unnecessary iteration
+  if (this->empty())
+    return;
+
+  // KAUF: serialize the event once and hand the same buffer to every client that can take it now. Clients with a
+  // backed up queue only queue (source, generator) and regenerate later, so they still get the latest state.
+  bool any_ready = false;
+  bool all_delta = true;
+  for (DeferredUpdateEventSource *dues : *this) {
+    dues->send_ready_ = dues->prepare_send_state_(source, event_type, message_generator);
+    any_ready |= dues->send_ready_;
+    all_delta &= dues->send_ready_ && dues->delta_capable_;
+  }
+
+  // KAUF: a delta is only correct if every client got every event since the last snapshot, so send one only when all
+  // clients understand deltas and take this event now. Otherwise the next event for this source goes out in full.
+  WebServer *ws = this->front()->web_server_;
+  if (!all_delta || 0 != strcmp(event_type, "state"))
+    ws->invalidate_delta_(source);
+  if (!any_ready)
+    return;
+
+  const bool detail_all = 0 == strcmp(event_type, "state_detail_all");
+  if (all_delta && ws->delta_events_)
+    ws->delta_source_ = source;
+  auto message = message_generator(ws, source);
+  ws->delta_source_ = nullptr;
+  bool all_sent = true;
+  for (DeferredUpdateEventSource *dues : *this) {
+    if (dues->send_ready_) {
+      dues->send_ready_ = false;
+      all_sent &= dues->send_prepared_state_(message.c_str(), source, message_generator, detail_all);
+    }
+  }
+  // KAUF: a client that had to defer this event gets it regenerated in full later, the others still got the delta.
+  // Either way the snapshot no longer matches what every client has seen.
+  if (!all_sent)
+    ws->invalidate_delta_(source);
+}
+
+void DeferredUpdateEventSourceList::try_send_nodefer(const char *message, const char *event, uint32_t id,
+                                                     uint32_t reconnect) {
+  for (DeferredUpdateEventSource *dues : *this) {
+    dues->try_send_nodefer(message, event, id, reconnect);
+  }
+}
+
+void DeferredUpdateEventSourceList::add_new_client(WebServer *ws, AsyncWebServerRequest *request) {
+  DeferredUpdateEventSource *es = new DeferredUpdateEventSource(ws, "/events");
+  // KAUF: only clients that advertise the delta protocol version (/events?delta=N) get delta state events
+  es->delta_capable_ = request->arg(ESPHOME_F("delta")).toInt() == WebServer::DELTA_PROTOCOL_VERSION;
+  this->push_back(es);
+
+  es->onConnect([this, es](AsyncEventSourceClient *client) { this->on_client_connect_(es); });
+
+  es->onDisconnect([this, es](AsyncEventSourceClient *client) { this->on_client_disconnect_(es); });
+
+  es->handleRequest(request);
+  ws->enable_loop_soon_any_context();
+}
+
+void DeferredUpdateEventSourceList::on_client_connect_(DeferredUpdateEventSource *source) {
+  WebServer *ws = source->web_server_;
+  ws->defer([ws, source]() {
+    // Configure reconnect timeout and send config
+    // this should always go through since the AsyncEventSourceClient event queue is empty on connect
+    auto message = ws->get_config_json();
+    source->try_send_nodefer(message.c_str(), "ping", millis(), 30000);
+
+    // KAUF: snapshots for delta state events, freed again in WebServer::loop() once the last client is gone. The new
+    // client has not seen the short ids yet, so every entity's next state event goes out in full.
+    if (ws->delta_events_ && ws->delta_snapshots_ == nullptr) {
+      ws->delta_snapshots_.reset(  // NOLINT
+          new (std::nothrow) WebServer::DeltaSnapshot[ws->entity_index_.entity_count()]());
+    } else if (ws->delta_snapshots_ != nullptr) {
+      for (size_t i = 0; i < ws->entity_index_.entity_count(); i++)
+        ws->delta_snapshots_[i].count = 0;
+    }
+
+#ifdef USE_WEBSERVER_SORTING
+    for (auto &group : ws->sorting_groups_) {
+      json::JsonBuilder builder;
+      JsonObject root = builder.root();
+      root[ESPHOME_F("name")] = group.second.name;
+      root[ESPHOME_F("sorting_weight")] = group.second.weight;
+      auto group_msg = builder.serialize();
+
+      // up to 31 groups should be able to be queued initially without defer
+      source->try_send_nodefer(group_msg.c_str(), "sorting_group");
+    }
+#endif
+
+// KAUF: show all entities if factory routine is running so button to stop it is visible.
+    source->entities_iterator_.begin(ws->include_internal_
+#ifdef KAUF_FACTORY
+        || (ws->factory_condition_ != nullptr && *ws->factory_condition_)
+#endif
+    );
+
+    // just dump them all up-front and take advantage of the deferred queue
+    //     on second thought that takes too long, but leaving the commented code here for debug purposes
+    // while(!source->entities_iterator_.completed()) {
+    //  source->entities_iterator_.advance();
+    //}
+  });
+}
+
+void DeferredUpdateEventSourceList::on_client_disconnect_(DeferredUpdateEventSource *source) {
+  source->web_server_->defer([this, source]() {
+    // This method was called via WebServer->defer() and is no longer executing in the
+    // context of the network callback. The object is now dead and can be safely deleted.
+    this->remove(source);
+    delete source;  // NOLINT
+  });
+}
+
+}  // namespace esphome::web_server
+#endif
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#ifdef USE_WEBSERVER
+#include "list_entities.h"
+
+#include "esphome/components/json/json_util.h"
+#include "esphome/components/web_server_base/web_server_base.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+namespace esphome::web_server {
+
+class WebServer;
+
+/*
+  In order to defer updates in arduino mode, we need to create one AsyncEventSource per incoming request to /events.
+  This is because only minimal changes were made to the ESPAsyncWebServer lib_dep, it was undesirable to put deferred
+  update logic into that library. We need one deferred queue per connection so instead of one AsyncEventSource with
+  multiple clients, we have multiple event sources with one client each. This is slightly awkward which is why it's
+  implemented in a more straightforward way for ESP-IDF. Arduino platform will eventually go away and this workaround
+  can be forgotten.
+*/
+#if !defined(USE_ESP32) && defined(USE_ARDUINO)
+using message_generator_t = json::SerializationBuffer<>(WebServer *, void *);
+
+class DeferredUpdateEventSourceList;
+class DeferredUpdateEventSource final : public AsyncEventSource {
+  friend class DeferredUpdateEventSourceList;
+
+  /*
+    This class holds a pointer to the source component that wants to publish a state event, and a pointer to a function
+    that will lazily generate that event.  The two pointers allow dedup in the deferred queue if multiple publishes for
+    the same component are backed up, and take up only two pointers of memory.  The entry in the deferred queue (a
+    std::vector) is the DeferredEvent instance itself (not a pointer to one elsewhere in heap) so still only two
+    pointers per entry (and no heap fragmentation).  Even 100 backed up events (you'd have to have at least 100 sensors
+    publishing because of dedup) would take up only 0.8 kB.
+
+    KAUF: the queue is a ring buffer (grown by doubling) instead of a vector popped from the front, so enqueue and
+    dequeue are O(1). Dedup is keyed by the entity's dense EntityIndex id: a slot per entity holds the generator of its
+    queued entry, so a repeated publish is dropped without looking at the queue. A queued state event is upgraded in
+    place to a state_detail_all one, which carries the state too. A buffer grown by a burst is released once the queue
+    has stayed empty for a while.
+  */
+  struct DeferredEvent {
+    friend class DeferredUpdateEventSource;
+
+   protected:
+    void *source_{nullptr};
+    message_generator_t *message_generator_{nullptr};
+
+   public:
+    DeferredEvent() = default;
+    DeferredEvent(void *source, message_generator_t *message_generator)
+        : source_(source), message_generator_(message_generator) {}
+    bool operator==(const DeferredEvent &test) const {
+      return (source_ == test.source_ && message_generator_ == test.message_generator_);
+    }
+  };
+  static_assert(sizeof(DeferredEvent) == sizeof(void *) + sizeof(message_generator_t *),
+                "DeferredEvent should have no padding");
+
+ protected:
+  // surface a couple methods from the base class
+  using AsyncEventSource::handleRequest;
+  using AsyncEventSource::send;
+
+  ListEntitiesIterator entities_iterator_;
+  // KAUF: ring buffer, allocated on first use; capacity is a power of two
+  std::unique_ptr<DeferredEvent[]> deferred_queue_;
+  // KAUF: generator of the queued entry per indexed entity, nullptr if it has none queued
+  std::unique_ptr<message_generator_t *[]> deferred_slots_;
+  WebServer *web_server_;
+  uint16_t deferred_head_{0};
+  uint16_t deferred_count_{0};
+  uint16_t deferred_capacity_{0};
+  static constexpr uint16_t DEFERRED_QUEUE_INITIAL_CAPACITY = 8;
+  static constexpr uint16_t DEFERRED_QUEUE_MAX_CAPACITY = 4096;
+  // KAUF: loops with an empty queue before a grown buffer is released
+  uint16_t deferred_idle_loops_{0};
+  static constexpr uint16_t DEFERRED_QUEUE_IDLE_LOOPS = 1000;  // ~8 seconds at 125Hz loop rate
+  uint16_t consecutive_send_failures_{0};
+  static constexpr uint16_t MAX_CONSECUTIVE_SEND_FAILURES = 2500;  // ~20 seconds at 125Hz loop rate
+  // KAUF: set by prepare_send_state_() when this source wants the message now, see DeferredUpdateEventSourceList
+  bool send_ready_{false};
+  // KAUF: the client asked for delta state events in a protocol version we speak
+  bool delta_capable_{false};
+
+  // helper for allowing only unique entries in the queue
+  void deq_push_back_with_dedup_(void *source, message_generator_t *message_generator, bool detail_all);
+
+  void process_deferred_queue_();
+  // KAUF: ring buffer helpers
+  bool deferred_queue_empty_() const { return this->deferred_count_ == 0; }
+  bool grow_deferred_queue_();
+  void clear_deferred_queue_();
+  void release_deferred_queue_();
+
+  // KAUF: deferrable_send_state() split in two so the list can serialize a state event once for all clients.
+  /// Returns true if the event should be sent right away, otherwise it was dropped or deferred.
+  bool prepare_send_state_(void *source, const char *event_type, message_generator_t *message_generator);
+  /// Send an already serialized event, deferring it if the client queue is full. Returns false if it was deferred.
+  bool send_prepared_state_(const char *message, void *source, message_generator_t *message_generator,
+                            bool detail_all);
+
+ public:
+  DeferredUpdateEventSource(WebServer *ws, const String &url)
+      : AsyncEventSource(url), entities_iterator_(ListEntitiesIterator(ws, this)), web_server_(ws) {}
+
+  void loop();
+
+  void deferrable_send_state(void *source, const char *event_type, message_generator_t *message_generator);
+  void try_send_nodefer(const char *message, const char *event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
+};
+
+class DeferredUpdateEventSourceList final : public std::list<DeferredUpdateEventSource *> {
+ protected:
+  void on_client_connect_(DeferredUpdateEventSource *source);
+  void on_client_disconnect_(DeferredUpdateEventSource *source);
+
+ public:
+  /// Returns true if there are event sources remaining (including pending cleanup).
+  bool loop();
+
+  void deferrable_send_state(void *source, const char *event_type, message_generator_t *message_generator);
+  void try_send_nodefer(const char *message, const char *event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
+
+  void add_new_client(WebServer *ws, AsyncWebServerRequest *request);
+};
+#endif
+
+}  // namespace esphome::web_server
+#endif
@@ -0,0 +1,177 @@
+#include "entity_index.h"
+#ifdef USE_WEBSERVER
+#include "esphome/core/log.h"
+
+#include <cstring>
+
+namespace esphome::web_server {
+
+static const char *const TAG = "web_server";
+
+EntityMatchResult UrlMatch::match_entity(EntityBase *entity) const {
+  EntityMatchResult result{false, this->method.empty()};
+
+#ifdef USE_DEVICES
+  Device *entity_device = entity->get_device();
+  bool url_has_device = !this->device_name.empty();
+  bool entity_has_device = (entity_device != nullptr);
+
+  // Device matching: URL device segment must match entity's device
+  if (url_has_device != entity_has_device) {
+    return result;  // Mismatch: one has device, other doesn't
+  }
+  if (url_has_device && this->device_name != entity_device->get_name()) {
+    return result;  // Device name doesn't match
+  }
+#endif
+
+  // Try matching by entity name (new format)
+  if (this->id == entity->get_name()) {
+    result.matched = true;
+    return result;
+  }
+
+  // Fall back to object_id (deprecated format)
+  char object_id_buf[OBJECT_ID_MAX_LEN];
+  StringRef object_id = entity->get_object_id_to(object_id_buf);
+  if (this->id == object_id) {
+    result.matched = true;
+    // Log deprecation warning
+#ifdef USE_DEVICES
+    Device *device = entity->get_device();
+    if (device != nullptr) {
+      ESP_LOGW(TAG,
+               "Deprecated URL format: /%.*s/%.*s/%.*s - use entity name '/%.*s/%s/%s' instead. "
+               "Object ID URLs will be removed in 2026.7.0.",
+               (int) this->domain.size(), this->domain.c_str(), (int) this->device_name.size(),
+               this->device_name.c_str(), (int) this->id.size(), this->id.c_str(), (int) this->domain.size(),
+               this->domain.c_str(), device->get_name(), entity->get_name().c_str());
+    } else
+#endif
+    {
+      ESP_LOGW(TAG,
+               "Deprecated URL format: /%.*s/%.*s - use entity name '/%.*s/%s' instead. "
+               "Object ID URLs will be removed in 2026.7.0.",
+               (int) this->domain.size(), this->domain.c_str(), (int) this->id.size(), this->id.c_str(),
+               (int) this->domain.size(), this->domain.c_str(), entity->get_name().c_str());
+    }
+  }
+
+  return result;
+}
+
+// KAUF: FNV-1a over the domain, the device name (if any) and the entity name or object_id
+uint32_t EntityIndex::hash_(EntityDomain domain, const char *device, size_t device_len, const char *id,
+                            size_t id_len) {
+  uint32_t hash = 2166136261UL;
+  auto feed = [&hash](uint8_t c) { hash = (hash ^ c) * 16777619UL; };
+  feed(domain);
+  for (size_t i = 0; i < device_len; i++)
+    feed(device[i]);
+  feed('/');
+  for (size_t i = 0; i < id_len; i++)
+    feed(id[i]);
+  return hash;
+}
+
+uint32_t EntityIndex::pointer_hash_(const void *ptr) {
+  // Fibonacci hashing; the low bits of heap pointers are mostly alignment zeros
+  const uint32_t hash = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)) * 2654435769UL;
+  return hash ^ (hash >> 16);
+}
+
+void EntityIndex::add(EntityDomain domain, EntityBase *entity) {
+  const char *device = "";
+  size_t device_len = 0;
+#ifdef USE_DEVICES
+  if (entity->get_device() != nullptr) {
+    device = entity->get_device()->get_name();
+    device_len = strlen(device);
+  }
+#endif
+  this->entity_count_++;
+  const StringRef &name = entity->get_name();
+  const uint32_t name_hash = hash_(domain, device, device_len, name.c_str(), name.size());
+  this->pending_.push_back({name_hash, entity, domain});
+
+  // Deprecated object_id URLs are still served, so index those too unless they equal the name
+  char object_id_buf[OBJECT_ID_MAX_LEN];
+  StringRef object_id = entity->get_object_id_to(object_id_buf);
+  if (object_id != name)
+    this->pending_.push_back({hash_(domain, device, device_len, object_id.c_str(), object_id.size()), entity, domain});
+}
+
+void EntityIndex::build() {
+  this->count_ = this->pending_.size();
+  // Power of two capacity with load factor <= 2/3 keeps probe chains short and leaves at least one empty slot
+  size_t capacity = 8;
+  while (capacity < this->count_ + this->count_ / 2 + 1)
+    capacity <<= 1;
+  this->mask_ = capacity - 1;
+  this->slots_.reset(new Slot[capacity]());  // NOLINT
+  for (const auto &key : this->pending_)
+    this->insert_(key);
+
+  // Pointer table for id_of(); the name and object_id keys of an entity are queued back to back
+  capacity = 8;
+  while (capacity < size_t(this->entity_count_) + this->entity_count_ / 2 + 1)
+    capacity <<= 1;
+  this->id_mask_ = capacity - 1;
+  this->id_slots_.reset(new IdSlot[capacity]());           // NOLINT
+  this->entries_.reset(new Entry[this->entity_count_]());  // NOLINT
+  const void *last = nullptr;
+  uint16_t id = 0;
+  for (const auto &key : this->pending_) {
+    if (key.entity == last)
+      continue;
+    last = key.entity;
+    size_t i = pointer_hash_(key.entity) & this->id_mask_;
+    while (this->id_slots_[i].entity != nullptr)
+      i = (i + 1) & this->id_mask_;
+    this->entries_[id] = {key.entity, key.domain};
+    this->id_slots_[i] = {key.entity, id++};
+  }
+  std::vector<PendingKey>().swap(this->pending_);
+}
+
+int32_t EntityIndex::id_of(const void *entity) const {
+  if (this->id_slots_ == nullptr || entity == nullptr)
+    return -1;
+  for (size_t i = pointer_hash_(entity) & this->id_mask_; this->id_slots_[i].entity != nullptr;
+       i = (i + 1) & this->id_mask_) {
+    if (this->id_slots_[i].entity == entity)
+      return this->id_slots_[i].id;
+  }
+  return -1;
+}
+
+void EntityIndex::insert_(const PendingKey &key) {
+  size_t i = key.hash & this->mask_;
+  while (this->slots_[i].entity != nullptr)
+    i = (i + 1) & this->mask_;
+  this->slots_[i] = {key.entity, static_cast<uint16_t>(key.hash >> 16), key.domain};
+}
+
+EntityBase *EntityIndex::find(EntityDomain domain, const UrlMatch &match) const {
+  if (this->slots_ == nullptr || match.id.empty())
+    return nullptr;
+  const char *device = "";
+  size_t device_len = 0;
+#ifdef USE_DEVICES
+  device = match.device_name.c_str();
+  device_len = match.device_name.size();
+#endif
+  const uint32_t hash = hash_(domain, device, device_len, match.id.c_str(), match.id.size());
+  const auto tag = static_cast<uint16_t>(hash >> 16);
+  // Entities are inserted in registration order, so among equal keys the first registered one is found first,
+  // the same entity the previous linear scan returned.
+  for (size_t i = hash & this->mask_; this->slots_[i].entity != nullptr; i = (i + 1) & this->mask_) {
+    const Slot &slot = this->slots_[i];
+    if (slot.tag == tag && slot.domain == domain && match.match_entity(slot.entity).matched)
+      return slot.entity;
+  }
+  return nullptr;
+}
+
+}  // namespace esphome::web_server
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#ifdef USE_WEBSERVER
+#include "esphome/core/entity_base.h"
+#include "esphome/core/string_ref.h"
+
+#ifdef USE_ESP8266
+#include <WString.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace esphome::web_server {
+
+/// Result of matching a URL against an entity
+struct EntityMatchResult {
+  bool matched;          ///< True if entity matched the URL
+  bool action_is_empty;  ///< True if no action/method segment in URL
+};
+
+/// Internal helper struct that is used to parse incoming URLs
+struct UrlMatch {
+  StringRef domain;  ///< Domain within URL, for example "sensor"
+  StringRef id;      ///< Entity name/id within URL, for example "Temperature"
+  StringRef method;  ///< Method within URL, for example "turn_on"
+#ifdef USE_DEVICES
+  StringRef device_name;  ///< Device name within URL, empty for main device
+#endif
+  bool valid{false};  ///< Whether this match is valid
+
+  // Helper methods for string comparisons
+  bool domain_equals(const char *str) const { return this->domain == str; }
+  bool method_equals(const char *str) const { return this->method == str; }
+
+#ifdef USE_ESP8266
+  // Overloads for flash strings on ESP8266
+  bool domain_equals(const __FlashStringHelper *str) const { return this->domain == str; }
+  bool method_equals(const __FlashStringHelper *str) const { return this->method == str; }
+#endif
+
+  /// Match entity by name first, then fall back to object_id with deprecation warning
+  /// Returns EntityMatchResult with match status and whether action segment is empty
+  EntityMatchResult match_entity(EntityBase *entity) const;
+};
+
+/// KAUF: entity domains served by the REST API, used as part of the entity index key
+enum EntityDomain : uint8_t {
+  ENTITY_DOMAIN_SENSOR,
+  ENTITY_DOMAIN_SWITCH,
+  ENTITY_DOMAIN_BUTTON,
+  ENTITY_DOMAIN_BINARY_SENSOR,
+  ENTITY_DOMAIN_FAN,
+  ENTITY_DOMAIN_LIGHT,
+  ENTITY_DOMAIN_TEXT_SENSOR,
+  ENTITY_DOMAIN_COVER,
+  ENTITY_DOMAIN_NUMBER,
+  ENTITY_DOMAIN_DATE,
+  ENTITY_DOMAIN_TIME,
+  ENTITY_DOMAIN_DATETIME,
+  ENTITY_DOMAIN_TEXT,
+  ENTITY_DOMAIN_SELECT,
+  ENTITY_DOMAIN_CLIMATE,
+  ENTITY_DOMAIN_LOCK,
+  ENTITY_DOMAIN_VALVE,
+  ENTITY_DOMAIN_ALARM_CONTROL_PANEL,
+  ENTITY_DOMAIN_WATER_HEATER,
+  ENTITY_DOMAIN_INFRARED,
+  ENTITY_DOMAIN_RADIO_FREQUENCY,
+  ENTITY_DOMAIN_EVENT,
+  ENTITY_DOMAIN_UPDATE,
+};
+
+/** KAUF: hash index from (domain, device, name or object_id) to entity.
+ *
+ * Built once in WebServer::setup() so REST requests don't walk every entity of a domain and format an object_id for
+ * each one. Open addressing with linear probing; a slot stores the upper 16 bits of the key hash so most collisions
+ * are rejected without touching the entity, and every candidate is confirmed with UrlMatch::match_entity() so a hash
+ * collision can never dispatch to the wrong entity.
+ */
+class EntityIndex {
+ public:
+  /// Queue an entity for indexing under its name and object_id. Call build() once all entities are added.
+  void add(EntityDomain domain, EntityBase *entity);
+  /// Build the hash table from the queued entities and release the queue.
+  void build();
+
+  EntityBase *find(EntityDomain domain, const UrlMatch &match) const;
+  template<typename T> T *find(EntityDomain domain, const UrlMatch &match) const {
+    return static_cast<T *>(this->find(domain, match));
+  }
+
+  size_t size() const { return this->count_; }
+  size_t capacity() const { return this->mask_ + 1; }
+
+  /// Dense id (0 to entity_count() - 1) of an indexed entity, or -1 if it is not indexed.
+  int32_t id_of(const void *entity) const;
+  size_t entity_count() const { return this->entity_count_; }
+
+  struct Entry {
+    EntityBase *entity;
+    EntityDomain domain;
+  };
+  /// Entity with the given dense id, id must be below entity_count().
+  const Entry &entry(uint16_t id) const { return this->entries_[id]; }
+
+ protected:
+  struct Slot {
+    EntityBase *entity;
+    uint16_t tag;
+    EntityDomain domain;
+  };
+  struct PendingKey {
+    uint32_t hash;
+    EntityBase *entity;
+    EntityDomain domain;
+  };
+  struct IdSlot {
+    const void *entity;
+    uint16_t id;
+  };
+
+  static uint32_t hash_(EntityDomain domain, const char *device, size_t device_len, const char *id, size_t id_len);
+  static uint32_t pointer_hash_(const void *ptr);
+  void insert_(const PendingKey &key);
+
+  std::vector<PendingKey> pending_;
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_{0};
+  size_t count_{0};
+  // entity pointer -> dense id, used for per-client "already queued" bits in the SSE deferred queue
+  std::unique_ptr<IdSlot[]> id_slots_;
+  std::unique_ptr<Entry[]> entries_;  // dense id -> entity, for the WebSocket short ids
+  size_t id_mask_{0};
+  uint16_t entity_count_{0};
+};
+
+}  // namespace esphome::web_server
+#endif
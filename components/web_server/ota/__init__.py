@@ -66,14 +66,33 @@ def _web_server_ota_final_validate(config: ConfigType) -> None:
     fv.full_config.set(full_conf)
 
 
-CONFIG_SCHEMA = (
+# KAUF: delta patches are rebuilt from the running image in flash, which is only implemented for ESP8266
+CONF_DELTA = "delta"
+# KAUF: lowest ESP8266 boot loader version (ESP.getBootVersion()) this firmware runs on, 0 = any
+CONF_MIN_BOOT_VERSION = "min_boot_version"
+
+
+def _validate_esp8266_only(config: ConfigType) -> ConfigType:
+    if config[CONF_DELTA] and not CORE.is_esp8266:
+        raise cv.Invalid(f"'{CONF_DELTA}' is only supported on ESP8266")
+    if config[CONF_MIN_BOOT_VERSION] and not CORE.is_esp8266:
+        raise cv.Invalid(f"'{CONF_MIN_BOOT_VERSION}' is only supported on ESP8266")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(WebServerOTAComponent),
+            cv.Optional(CONF_DELTA, default=False): cv.boolean,
+            cv.Optional(CONF_MIN_BOOT_VERSION, default=0): cv.int_range(
+                min=0, max=255
+            ),
         }
     )
     .extend(BASE_OTA_SCHEMA)
-    .extend(cv.COMPONENT_SCHEMA)
+    .extend(cv.COMPONENT_SCHEMA),
+    _validate_esp8266_only,
 )
 
 FINAL_VALIDATE_SCHEMA = _web_server_ota_final_validate
@@ -85,5 +104,18 @@ async def to_code(config):
     await ota_to_code(var, config)
     await cg.register_component(var, config)
     cg.add_define("USE_WEBSERVER_OTA")
+    # KAUF: image info block checked by the device this firmware is uploaded to (ota_image_info.h)
+    config_hash = getattr(CORE, "config_hash", 0) or 0
+    cg.add_global(
+        cg.RawStatement(
+            "const web_server::KaufImageInfo web_server::KAUF_IMAGE_INFO KAUF_IMAGE_INFO_ATTRIBUTES = {"
+            "{'K', 'A', 'U', 'F', 'I', 'N', 'F', 'O'}, web_server::KAUF_IMAGE_INFO_VERSION, "
+            f"{config[CONF_MIN_BOOT_VERSION]}, "
+            "sizeof(web_server::KaufImageInfo), KAUF_IMAGE_PRODUCT, KAUF_IMAGE_FLASH_SIZE, "
+            f"0x{config_hash:08X}}};"
+        )
+    )
+    if config[CONF_DELTA]:
+        cg.add_define("USE_WEBSERVER_OTA_DELTA")
     if CORE.is_esp32:
         add_idf_component(name="zorxx/multipart-parser", ref="1.0.1")
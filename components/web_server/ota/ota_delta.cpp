@@ -0,0 +1,279 @@
+#include "ota_delta.h"
+#if defined(USE_WEBSERVER_OTA) && defined(USE_WEBSERVER_OTA_DELTA)
+
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef USE_ESP8266
+#include <Esp.h>
+#endif
+
+namespace esphome::web_server {
+
+static const char *const TAG = "web_server.ota_delta";
+
+static constexpr uint8_t DELTA_MAGIC[4] = {'K', 'D', 'L', 'T'};
+static constexpr uint8_t DELTA_VERSION = 1;
+
+enum DeltaOp : uint8_t {
+  DELTA_OP_END = 0x00,
+  DELTA_OP_COPY = 0x01,
+  DELTA_OP_INSERT = 0x02,
+};
+
+static uint32_t read_u32(const uint8_t *p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+bool OTADeltaDecoder::is_delta(const uint8_t *data, size_t len) {
+  return len >= sizeof(DELTA_MAGIC) && memcmp(data, DELTA_MAGIC, sizeof(DELTA_MAGIC)) == 0;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::fail_(Result result) {
+  this->state_ = STATE_FAILED;
+  return result;
+}
+
+bool OTADeltaDecoder::read_varint_(uint8_t byte, bool &overflow) {
+  if (this->varint_shift_ >= 32 || (this->varint_shift_ == 28 && (byte & 0x70) != 0)) {
+    overflow = true;
+    return false;
+  }
+  this->varint_ |= uint32_t(byte & 0x7F) << this->varint_shift_;
+  this->varint_shift_ += 7;
+  if (byte & 0x80)
+    return false;
+  this->varint_shift_ = 0;
+  return true;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::begin_() {
+  const uint8_t *h = this->header_;
+  if (h[4] != DELTA_VERSION) {
+    ESP_LOGE(TAG, "Unsupported delta patch version %u", h[4]);
+    return DELTA_BAD_PATCH;
+  }
+  this->base_size_ = read_u32(h + 8);
+  this->target_size_ = read_u32(h + 28);
+
+  // The patch only rebuilds the image it was made against
+#ifdef USE_ESP8266
+  const std::string base_md5 = format_hex(h + 12, 16);
+  const uint32_t running_size = ESP.getSketchSize();
+  if (running_size != this->base_size_ || strcasecmp(ESP.getSketchMD5().c_str(), base_md5.c_str()) != 0) {
+    ESP_LOGE(TAG, "Delta patch base %s (%" PRIu32 " bytes) does not match the running firmware (%" PRIu32 " bytes)",
+             base_md5.c_str(), this->base_size_, running_size);
+    return DELTA_WRONG_BASE;
+  }
+#endif
+
+  ESP_LOGI(TAG, "Applying delta patch, new image is %" PRIu32 " bytes", this->target_size_);
+  ota::OTAResponseTypes error = this->backend_->begin(this->target_size_);
+  if (error == ota::OTA_RESPONSE_OK) {
+    const std::string target_md5 = format_hex(h + 32, 16);
+    this->backend_->set_update_md5(target_md5.c_str());
+    return DELTA_OK;
+  }
+  this->backend_error_ = error;
+  return DELTA_BACKEND_ERROR;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::emit_(const uint8_t *data, size_t len) {
+  if (len > this->target_size_ - this->written_) {
+    ESP_LOGE(TAG, "Delta patch writes past the announced image size");
+    return DELTA_BAD_PATCH;
+  }
+  ota::OTAResponseTypes error = this->writer_(data, len);
+  if (error != ota::OTA_RESPONSE_OK) {
+    this->backend_error_ = error;
+    return DELTA_BACKEND_ERROR;
+  }
+  this->written_ += len;
+  return DELTA_OK;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::copy_(uint32_t offset, uint32_t length) {
+#ifdef USE_ESP8266
+  uint8_t buf[COPY_BUFFER_SIZE];
+  while (length > 0) {
+    const size_t chunk = std::min<uint32_t>(length, sizeof(buf));
+    // The running sketch starts at flash offset 0; the update is staged behind it, so this never reads new data.
+    if (!ESP.flashRead(offset, buf, chunk)) {
+      ESP_LOGE(TAG, "Reading running image at 0x%06" PRIX32 " failed", offset);
+      this->backend_error_ = ota::OTA_RESPONSE_ERROR_WRITING_FLASH;
+      return DELTA_BACKEND_ERROR;
+    }
+    Result result = this->emit_(buf, chunk);
+    if (result != DELTA_OK)
+      return result;
+    offset += chunk;
+    length -= chunk;
+    // finish() and a full stash rebuild the rest of a run in one call
+    App.feed_wdt();
+  }
+  return DELTA_OK;
+#else
+  return DELTA_BAD_PATCH;
+#endif
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::process_(const uint8_t *data, size_t len, size_t &pos, size_t &budget) {
+  // A COPY run continues even without input, until it is done or the budget is used up
+  while (pos < len || (this->state_ == STATE_COPY_DATA && budget > 0)) {
+    switch (this->state_) {
+      case STATE_HEADER: {
+        const size_t take = std::min(len - pos, HEADER_SIZE - this->header_len_);
+        memcpy(this->header_ + this->header_len_, data + pos, take);
+        this->header_len_ += take;
+        pos += take;
+        if (this->header_len_ == HEADER_SIZE) {
+          Result result = this->begin_();
+          if (result != DELTA_OK)
+            return result;
+          this->state_ = STATE_OP;
+        }
+        break;
+      }
+      case STATE_OP: {
+        const uint8_t op = data[pos++];
+        this->varint_ = 0;
+        if (op == DELTA_OP_COPY) {
+          this->state_ = STATE_COPY_OFFSET;
+        } else if (op == DELTA_OP_INSERT) {
+          this->state_ = STATE_INSERT_LENGTH;
+        } else if (op == DELTA_OP_END) {
+          this->state_ = STATE_DONE;
+        } else {
+          ESP_LOGE(TAG, "Unknown delta op 0x%02X", op);
+          return DELTA_BAD_PATCH;
+        }
+        break;
+      }
+      case STATE_COPY_OFFSET:
+      case STATE_COPY_LENGTH:
+      case STATE_INSERT_LENGTH: {
+        bool overflow = false;
+        if (!this->read_varint_(data[pos++], overflow)) {
+          if (overflow)
+            return DELTA_BAD_PATCH;
+          break;
+        }
+        const uint32_t value = this->varint_;
+        this->varint_ = 0;
+        if (this->state_ == STATE_COPY_OFFSET) {
+          this->copy_offset_ = value;
+          this->state_ = STATE_COPY_LENGTH;
+        } else if (this->state_ == STATE_COPY_LENGTH) {
+          if (this->copy_offset_ > this->base_size_ || value > this->base_size_ - this->copy_offset_) {
+            ESP_LOGE(TAG, "Delta copy 0x%06" PRIX32 "+%" PRIu32 " is outside the running image", this->copy_offset_,
+                     value);
+            return DELTA_BAD_PATCH;
+          }
+          this->remaining_ = value;
+          this->state_ = value == 0 ? STATE_OP : STATE_COPY_DATA;
+        } else {
+          this->remaining_ = value;
+          this->state_ = value == 0 ? STATE_OP : STATE_INSERT_DATA;
+        }
+        break;
+      }
+      case STATE_COPY_DATA: {
+        if (budget == 0)
+          return DELTA_OK;
+        const uint32_t step = std::min<size_t>(this->remaining_, budget);
+        Result result = this->copy_(this->copy_offset_, step);
+        if (result != DELTA_OK)
+          return result;
+        this->copy_offset_ += step;
+        this->remaining_ -= step;
+        budget -= step;
+        if (this->remaining_ == 0)
+          this->state_ = STATE_OP;
+        break;
+      }
+      case STATE_INSERT_DATA: {
+        const size_t take = std::min<size_t>(len - pos, this->remaining_);
+        Result result = this->emit_(data + pos, take);
+        if (result != DELTA_OK)
+          return result;
+        pos += take;
+        this->remaining_ -= take;
+        if (this->remaining_ == 0)
+          this->state_ = STATE_OP;
+        break;
+      }
+      case STATE_DONE:
+        // Anything after END is not part of the image
+        pos = len;
+        return DELTA_OK;
+      case STATE_FAILED:
+      default:
+        return DELTA_BAD_PATCH;
+    }
+  }
+  return DELTA_OK;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::drain_stash_(size_t &budget) {
+  size_t pos = 0;
+  Result result = this->process_(this->stash_.get(), this->stash_len_, pos, budget);
+  if (result != DELTA_OK)
+    return result;
+  if (pos > 0) {
+    memmove(this->stash_.get(), this->stash_.get() + pos, this->stash_len_ - pos);
+    this->stash_len_ -= pos;
+  }
+  return DELTA_OK;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::write(const uint8_t *data, size_t len) {
+  if (this->state_ == STATE_FAILED)
+    return DELTA_BAD_PATCH;
+  // Input held back earlier goes first, this chunk only once it is all processed
+  size_t budget = COPY_STEP_SIZE;
+  size_t pos = 0;
+  Result result = this->drain_stash_(budget);
+  if (result == DELTA_OK && this->stash_len_ == 0)
+    result = this->process_(data, len, pos, budget);
+  if (result == DELTA_OK && len - pos > STASH_SIZE - this->stash_len_) {
+    // No room to hold the rest back, finish the COPY run here
+    budget = SIZE_MAX;
+    result = this->drain_stash_(budget);
+    if (result == DELTA_OK)
+      result = this->process_(data, len, pos, budget);
+  }
+  if (result != DELTA_OK)
+    return this->fail_(result);
+
+  if (pos < len) {
+    if (!this->stash_)
+      this->stash_ = make_unique<uint8_t[]>(STASH_SIZE);
+    memcpy(this->stash_.get() + this->stash_len_, data + pos, len - pos);
+    this->stash_len_ += len - pos;
+  }
+  return DELTA_OK;
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::resume() {
+  if (this->state_ == STATE_FAILED)
+    return DELTA_BAD_PATCH;
+  size_t budget = COPY_STEP_SIZE;
+  Result result = this->drain_stash_(budget);
+  return result == DELTA_OK ? DELTA_OK : this->fail_(result);
+}
+
+OTADeltaDecoder::Result OTADeltaDecoder::finish() {
+  if (this->state_ == STATE_FAILED)
+    return DELTA_BAD_PATCH;
+  size_t budget = SIZE_MAX;
+  Result result = this->drain_stash_(budget);
+  return result == DELTA_OK ? DELTA_OK : this->fail_(result);
+}
+
+}  // namespace esphome::web_server
+
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#if defined(USE_WEBSERVER_OTA) && defined(USE_WEBSERVER_OTA_DELTA)
+
+#include "esphome/components/ota/ota_backend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace esphome::web_server {
+
+/** KAUF: Streaming decoder for delta OTA uploads.
+ *
+ * A delta patch rebuilds the new firmware from the running one, so only the changed bytes have to be uploaded.
+ * It is produced on the host by ota_delta.py. Layout (all integers little endian):
+ *
+ *   header   "KDLT", version, 3 reserved bytes, base size (u32), base MD5 (16), target size (u32), target MD5 (16)
+ *   ops      COPY   0x01 <offset varint> <length varint>  bytes copied from the running image
+ *            INSERT 0x02 <length varint> <length bytes>   literal bytes
+ *            END    0x00
+ *
+ * Varints are unsigned LEB128. The patch is applied as it arrives and the rebuilt image is handed to a writer (the
+ * upload's flash write pipeline); literals are passed through and copies are read from flash through a small buffer,
+ * so RAM use does not depend on the image size. The backend is started with the target size and MD5 from the header,
+ * so the rebuilt image is verified before end() accepts it.
+ *
+ * A COPY run can span most of the image, so it is rebuilt COPY_STEP_SIZE bytes per write() or resume() call. Input
+ * that arrives behind an unfinished run is held back (up to STASH_SIZE bytes) and resume(), called from the main loop,
+ * continues the run. Only when the held back input would not fit, or on finish(), is the rest done in one call.
+ *
+ * test_ota_delta.py builds this decoder on the host and checks it against patches made by ota_delta.py.
+ */
+class OTADeltaDecoder {
+ public:
+  enum Result : uint8_t {
+    DELTA_OK,
+    DELTA_BAD_PATCH,
+    DELTA_WRONG_BASE,
+    DELTA_BACKEND_ERROR,
+  };
+
+  static constexpr size_t HEADER_SIZE = 48;
+  static constexpr size_t COPY_BUFFER_SIZE = 256;
+  static constexpr size_t COPY_STEP_SIZE = 4096;
+  static constexpr size_t STASH_SIZE = 2048;
+
+  /// Receives the rebuilt image in order.
+  using Writer = std::function<ota::OTAResponseTypes(const uint8_t *data, size_t len)>;
+
+  OTADeltaDecoder(ota::OTABackend *backend, Writer writer) : backend_(backend), writer_(std::move(writer)) {}
+
+  /// Whether an upload starting with these bytes is a delta patch.
+  static bool is_delta(const uint8_t *data, size_t len);
+
+  /// Feed the next chunk of the patch.
+  Result write(const uint8_t *data, size_t len);
+  /// Continue an unfinished COPY run and the input held back behind it by one step.
+  Result resume();
+  /// Apply everything still pending, after the last chunk.
+  Result finish();
+  /// Whether resume() has work to do.
+  bool is_busy() const { return this->state_ == STATE_COPY_DATA || this->stash_len_ > 0; }
+  /// Whether the whole patch was applied and the image has the size announced in the header.
+  bool is_complete() const {
+    return this->state_ == STATE_DONE && !this->is_busy() && this->written_ == this->target_size_;
+  }
+
+  /// Backend error of the last DELTA_BACKEND_ERROR.
+  ota::OTAResponseTypes get_backend_error() const { return this->backend_error_; }
+  uint32_t get_written() const { return this->written_; }
+
+ protected:
+  enum State : uint8_t {
+    STATE_HEADER,
+    STATE_OP,
+    STATE_COPY_OFFSET,
+    STATE_COPY_LENGTH,
+    STATE_COPY_DATA,
+    STATE_INSERT_LENGTH,
+    STATE_INSERT_DATA,
+    STATE_DONE,
+    STATE_FAILED,
+  };
+
+  Result begin_();
+  /// Run the patch in data through the state machine, rebuilding at most budget bytes of COPY runs. Stops early, with
+  /// pos short of len, only when a COPY run is left unfinished.
+  Result process_(const uint8_t *data, size_t len, size_t &pos, size_t &budget);
+  /// Process the held back input, continuing the COPY run in front of it first.
+  Result drain_stash_(size_t &budget);
+  Result copy_(uint32_t offset, uint32_t length);
+  Result emit_(const uint8_t *data, size_t len);
+  /// Accumulate one LEB128 byte, true once the value is complete.
+  bool read_varint_(uint8_t byte, bool &overflow);
+  Result fail_(Result result);
+
+  ota::OTABackend *backend_;
+  Writer writer_;
+  ota::OTAResponseTypes backend_error_{ota::OTA_RESPONSE_OK};
+  std::unique_ptr<uint8_t[]> stash_;  // input behind an unfinished COPY run, allocated on first use
+  size_t stash_len_{0};
+  uint8_t header_[HEADER_SIZE];
+  uint8_t header_len_{0};
+  State state_{STATE_HEADER};
+  uint8_t varint_shift_{0};
+  uint32_t varint_{0};
+  uint32_t copy_offset_{0};
+  uint32_t remaining_{0};  // bytes left in the current COPY run or INSERT literal
+  uint32_t base_size_{0};
+  uint32_t target_size_{0};
+  uint32_t written_{0};
+};
+
+}  // namespace esphome::web_server
+
+#endif
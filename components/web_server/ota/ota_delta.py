@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""KAUF: create delta OTA patches for the web_server OTA platform (``delta: true``).
+
+A patch rebuilds a new firmware image from the image running on the device, so
+only the bytes that changed have to be uploaded. Upload the patch file on the
+update page like a normal firmware file; the device checks that it was made for
+the running image and verifies the MD5 of the rebuilt image before accepting it.
+
+    python3 ota_delta.py running.bin new.bin update.delta
+
+The base must be the exact .bin file that is installed on the device. Every
+patch written is applied again here and compared to the new image byte for byte.
+The format is documented in ota_delta.h.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"KDLT"
+VERSION = 1
+HEADER = struct.Struct("<4sB3xI16sI16s")
+
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+# Shortest run copied from the base, shorter matches cost more to encode than they save
+BLOCK = 16
+
+
+def _varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _read_varint(data: bytes, pos: int) -> tuple[int, int]:
+    value = shift = 0
+    while True:
+        if pos >= len(data) or shift > 28:
+            raise ValueError("truncated or oversized varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def _match_length(base: bytes, base_pos: int, target: bytes, target_pos: int) -> int:
+    length = 0
+    limit = min(len(base) - base_pos, len(target) - target_pos)
+    # Compare in large steps first, then byte by byte
+    step = 256
+    while step:
+        while (
+            length + step <= limit
+            and base[base_pos + length : base_pos + length + step]
+            == target[target_pos + length : target_pos + length + step]
+        ):
+            length += step
+        step //= 4
+    while length < limit and base[base_pos + length] == target[target_pos + length]:
+        length += 1
+    return length
+
+
+def create_patch(base: bytes, target: bytes) -> bytes:
+    index: dict[bytes, int] = {}
+    for i in range(len(base) - BLOCK + 1):
+        index.setdefault(base[i : i + BLOCK], i)
+
+    ops = bytearray()
+    literal_start = 0
+    expected = None  # base offset that continues the last copy
+    pos = 0
+
+    def flush_literal(end: int) -> None:
+        if end > literal_start:
+            ops.append(OP_INSERT)
+            ops.extend(_varint(end - literal_start))
+            ops.extend(target[literal_start:end])
+
+    while pos + BLOCK <= len(target):
+        block = target[pos : pos + BLOCK]
+        # Unchanged code usually continues where the last copy left off, shifted by the inserted bytes
+        if expected is not None and base[expected : expected + BLOCK] == block:
+            base_pos = expected
+        else:
+            base_pos = index.get(block)
+        if base_pos is None:
+            pos += 1
+            if expected is not None:
+                expected += 1
+            continue
+
+        # Grow the match backwards into the pending literal
+        back = 0
+        while (
+            pos - back > literal_start
+            and base_pos - back > 0
+            and base[base_pos - back - 1] == target[pos - back - 1]
+        ):
+            back += 1
+        start, base_start = pos - back, base_pos - back
+        length = back + _match_length(base, base_pos, target, pos)
+
+        flush_literal(start)
+        ops.append(OP_COPY)
+        ops.extend(_varint(base_start))
+        ops.extend(_varint(length))
+        pos = literal_start = start + length
+        expected = base_start + length
+
+    flush_literal(len(target))
+    ops.append(OP_END)
+
+    header = HEADER.pack(
+        MAGIC,
+        VERSION,
+        len(base),
+        hashlib.md5(base).digest(),
+        len(target),
+        hashlib.md5(target).digest(),
+    )
+    return header + bytes(ops)
+
+
+def apply_patch(base: bytes, patch: bytes) -> bytes:
+    """Reference implementation of the decoder in ota_delta.cpp."""
+    magic, version, base_size, base_md5, target_size, target_md5 = HEADER.unpack_from(
+        patch
+    )
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a delta patch")
+    if base_size != len(base) or base_md5 != hashlib.md5(base).digest():
+        raise ValueError("patch was made for a different base image")
+
+    out = bytearray()
+    pos = HEADER.size
+    while True:
+        if pos >= len(patch):
+            raise ValueError("patch ends without END op")
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            offset, pos = _read_varint(patch, pos)
+            length, pos = _read_varint(patch, pos)
+            if offset + length > len(base):
+                raise ValueError("copy outside the base image")
+            out += base[offset : offset + length]
+        elif op == OP_INSERT:
+            length, pos = _read_varint(patch, pos)
+            if pos + length > len(patch):
+                raise ValueError("truncated insert")
+            out += patch[pos : pos + length]
+            pos += length
+        else:
+            raise ValueError(f"unknown op 0x{op:02x}")
+        if len(out) > target_size:
+            raise ValueError("patch writes past the target size")
+
+    if len(out) != target_size or hashlib.md5(out).digest() != target_md5:
+        raise ValueError("rebuilt image does not match the target")
+    return bytes(out)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("base", help="firmware .bin running on the device")
+    parser.add_argument("target", help="new firmware .bin")
+    parser.add_argument("patch", help="delta patch to write")
+    args = parser.parse_args()
+
+    with open(args.base, "rb") as f:
+        base = f.read()
+    with open(args.target, "rb") as f:
+        target = f.read()
+
+    patch = create_patch(base, target)
+    if apply_patch(base, patch) != target:
+        print("error: patch does not reproduce the target image", file=sys.stderr)
+        return 1
+
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+    print(
+        f"{args.patch}: {len(patch)} bytes for a {len(target)} byte image "
+        f"({100 * len(patch) / max(len(target), 1):.1f}%), base md5 {hashlib.md5(base).hexdigest()}"
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
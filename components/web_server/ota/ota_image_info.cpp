@@ -0,0 +1,71 @@
+#include "ota_image_info.h"
+#ifdef USE_WEBSERVER_OTA
+
+#include "esphome/core/log.h"
+
+#include <cstring>
+
+#ifdef USE_ESP8266
+#include <Esp.h>
+#include <pgmspace.h>
+#endif
+
+namespace esphome::web_server {
+
+static const char *const TAG = "web_server.ota";
+
+KaufImageInfo get_running_image_info() {
+  KaufImageInfo info;
+#ifdef USE_ESP8266
+  memcpy_P(&info, &KAUF_IMAGE_INFO, sizeof(info));
+#else
+  memcpy(&info, &KAUF_IMAGE_INFO, sizeof(info));
+#endif
+  return info;
+}
+
+bool find_image_info(const uint8_t *data, size_t len, KaufImageInfo &info) {
+  if (len < sizeof(KaufImageInfo))
+    return false;
+  const KaufImageInfo own = get_running_image_info();
+  // Sections are word aligned in the image
+  for (size_t pos = 0; pos + sizeof(KaufImageInfo) <= len; pos += 4) {
+    if (memcmp(data + pos, own.magic, sizeof(own.magic)) != 0)
+      continue;
+    memcpy(&info, data + pos, sizeof(info));
+    if (info.version == KAUF_IMAGE_INFO_VERSION && info.size == sizeof(KaufImageInfo))
+      return true;
+  }
+  return false;
+}
+
+uint16_t check_image_info(const KaufImageInfo &info) {
+  const KaufImageInfo own = get_running_image_info();
+  char product[sizeof(info.product) + 1]{};
+  memcpy(product, info.product, sizeof(info.product));
+  ESP_LOGD(TAG, "Image info: product '%s', flash %" PRIu32 " bytes, boot loader >= %u, config hash %08" PRIx32,
+           product, info.flash_size, info.min_boot_version, info.config_hash);
+
+  if (info.product[0] != '\0' && own.product[0] != '\0' &&
+      strncmp(info.product, own.product, sizeof(info.product)) != 0) {
+    ESP_LOGD(TAG, "***** Wrong product: image is for '%s' *****", product);
+    return 4;
+  }
+  if (info.flash_size != 0 && own.flash_size != 0 && info.flash_size != own.flash_size) {
+    ESP_LOGD(TAG, "***** Image is built for %" PRIu32 " bytes of flash, this firmware for %" PRIu32 " *****",
+             info.flash_size, own.flash_size);
+    return 3;
+  }
+#ifdef USE_ESP8266
+  if (info.min_boot_version != 0 && ESP.getBootVersion() < info.min_boot_version) {
+    ESP_LOGD(TAG, "***** Image needs boot loader %u, this device has %u *****", info.min_boot_version,
+             ESP.getBootVersion());
+    return 6;
+  }
+#endif
+  return 0;
+}
+
+}  // namespace esphome::web_server
+
+#endif  // USE_WEBSERVER_OTA
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#ifdef USE_WEBSERVER_OTA
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome::web_server {
+
+/** KAUF: Metadata block embedded in every firmware built with the web_server OTA platform.
+ *
+ * The instance is generated into main.cpp. On ESP8266 it is placed in the .ver_number section, which the core's linker
+ * script puts first in .irom0.text, so it lands within the first few KB of the .bin and can be checked before the
+ * upload writes anything to flash. Zero / empty fields mean "not checked".
+ */
+struct KaufImageInfo {
+  char magic[8];
+  uint8_t version;
+  /// Lowest ESP8266 boot loader version the image runs on.
+  uint8_t min_boot_version;
+  uint16_t size;
+  /// KAUF product id, e.g. "plf12".
+  char product[8];
+  /// Flash size the image was built for, in bytes. Compared with the running firmware's, like the -1m / -4m check.
+  uint32_t flash_size;
+  uint32_t config_hash;
+};
+
+static constexpr uint8_t KAUF_IMAGE_INFO_VERSION = 1;
+/// Uploaded bytes that are searched for the block before falling back to the filename checks.
+static constexpr size_t KAUF_IMAGE_INFO_SCAN_SIZE = 4096 + 512;
+
+#if defined(KAUF_PRODUCT_PLF12)
+#define KAUF_IMAGE_PRODUCT "plf12"
+#elif defined(KAUF_PRODUCT_PLF10)
+#define KAUF_IMAGE_PRODUCT "plf10"
+#elif defined(KAUF_PRODUCT_BULB)
+#define KAUF_IMAGE_PRODUCT "bulb"
+#elif defined(KAUF_PRODUCT_SRF10)
+#define KAUF_IMAGE_PRODUCT "srf10"
+#else
+#define KAUF_IMAGE_PRODUCT ""
+#endif
+
+// Same rule as the -1m / -4m filename check
+#if defined(SENSOR_4M)
+#define KAUF_IMAGE_FLASH_SIZE (SENSOR_4M ? 4194304UL : 1048576UL)
+#else
+#define KAUF_IMAGE_FLASH_SIZE 0
+#endif
+
+#ifdef USE_ESP8266
+#define KAUF_IMAGE_INFO_ATTRIBUTES __attribute__((section(".ver_number"), used, aligned(4)))
+#else
+#define KAUF_IMAGE_INFO_ATTRIBUTES __attribute__((used, aligned(4)))
+#endif
+
+/// This firmware's own block.
+extern const KaufImageInfo KAUF_IMAGE_INFO;
+
+/// Copy of this firmware's block (it lives in flash on ESP8266).
+KaufImageInfo get_running_image_info();
+/// Look for a block in the start of an uploaded image.
+bool find_image_info(const uint8_t *data, size_t len, KaufImageInfo &info);
+/** Check an uploaded image's block against this device.
+ *
+ * @return 0 if the image may be flashed, otherwise the error code reported by the OTA handler: 3 flash size,
+ *         4 product, 6 boot loader.
+ */
+uint16_t check_image_info(const KaufImageInfo &info);
+
+}  // namespace esphome::web_server
+
+#endif  // USE_WEBSERVER_OTA
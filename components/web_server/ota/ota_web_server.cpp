@@ -1,6 +1,11 @@
 #include "ota_web_server.h"
 #ifdef USE_WEBSERVER_OTA
 
+#ifdef USE_WEBSERVER_OTA_DELTA
+#include "ota_delta.h"
+#endif
+
+#include "ota_image_info.h"
 #include "esphome/components/ota/ota_backend_factory.h"
 #include "esphome/core/application.h"
 #include "esphome/core/log.h"
@@ -13,6 +18,8 @@
 // KAUF: added to compare strings in filename
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <memory>
 #ifdef USE_ESP8266
 #include <StreamString.h>
 #endif
@@ -68,18 +75,46 @@ class OTARequestHandler : public AsyncWebHandler {
   // NOLINTNEXTLINE(readability-identifier-naming)
   bool isRequestHandlerTrivial() const override { return false; }
 
+  /// KAUF: write one queued upload buffer to flash, called from loop(). Returns whether more are queued.
+  bool pump();
+
  protected:
   void report_ota_progress_(AsyncWebServerRequest *request);
   void schedule_ota_reboot_();
   void ota_init_(const char *filename);
+  void ota_abort_(ota::OTAResponseTypes error_code);
+  ota::OTAResponseTypes write_image_(const uint8_t *data, size_t len);
+  ota::OTAResponseTypes flush_image_();
+#ifdef USE_WEBSERVER_OTA_DELTA
+  ota::OTAResponseTypes delta_error_(OTADeltaDecoder::Result result);
+#endif
 
   uint32_t last_ota_progress_{0};
+  uint32_t last_ota_progress_length_{0};
   uint32_t ota_read_length_{0};
   WebServerOTAComponent *parent_;
   bool ota_success_{false};
 
  private:
   ota::OTABackendPtr ota_backend_{nullptr};
+#ifdef USE_WEBSERVER_OTA_DELTA
+  // KAUF: set while the current upload is a delta patch
+  std::unique_ptr<OTADeltaDecoder> ota_delta_;
+#endif
+#ifdef USE_ESP8266
+  // KAUF: start of a plain image, held back until its image info block was checked
+  std::unique_ptr<uint8_t[]> image_head_;
+  size_t image_head_len_{0};
+#endif
+#ifdef KAUF_OTA_PIPELINE
+  // KAUF: two upload buffers; the callback fills one while loop() writes the other to flash
+  static constexpr size_t PIPELINE_BUFFER_SIZE = 2048;
+  ota::OTAResponseTypes write_oldest_();
+  std::unique_ptr<uint8_t[]> pipeline_;
+  size_t pipeline_len_[2]{};
+  uint8_t pipeline_fill_{0};
+  uint8_t pipeline_queued_{0};
+#endif
 
   // KAUF: error code set during upload to report descriptive failure in handleRequest
   uint16_t kauf_ota_error_code = 0;
@@ -88,6 +123,13 @@ class OTARequestHandler : public AsyncWebHandler {
 void OTARequestHandler::report_ota_progress_(AsyncWebServerRequest *request) {
   const uint32_t now = millis();
   if (now - this->last_ota_progress_ > 1000) {
+    // KAUF: upload rate over the last report interval, smoothed, and the time left at that rate
+    const float rate = (this->ota_read_length_ - this->last_ota_progress_length_) * 1000.0f /
+                       (now - this->last_ota_progress_);
+    float &bytes_per_second = this->parent_->bytes_per_second_;
+    bytes_per_second = bytes_per_second == 0.0f ? rate : (bytes_per_second + rate) / 2.0f;
+    this->last_ota_progress_length_ = this->ota_read_length_;
+
     float percentage = 0.0f;
     if (request->contentLength() != 0) {
       // Note: Using contentLength() for progress calculation is technically wrong as it includes
@@ -95,9 +137,13 @@ void OTARequestHandler::report_ota_progress_(AsyncWebServerRequest *request) {
       // access to the actual firmware size until the upload is complete. This is intentional
       // as it still gives the user a reasonable progress indication.
       percentage = (this->ota_read_length_ * 100.0f) / request->contentLength();
-      ESP_LOGD(TAG, "OTA in progress: %0.1f%%", percentage);
+      if (bytes_per_second > 0.0f && request->contentLength() > this->ota_read_length_)
+        this->parent_->eta_seconds_ = (request->contentLength() - this->ota_read_length_) / bytes_per_second;
+      ESP_LOGD(TAG, "OTA in progress: %0.1f%%, %.1f KB/s, %" PRIu32 " s left", percentage, bytes_per_second / 1024.0f,
+               this->parent_->eta_seconds_);
     } else {
-      ESP_LOGD(TAG, "OTA in progress: %" PRIu32 " bytes read", this->ota_read_length_);
+      ESP_LOGD(TAG, "OTA in progress: %" PRIu32 " bytes read, %.1f KB/s", this->ota_read_length_,
+               bytes_per_second / 1024.0f);
     }
 #ifdef USE_OTA_STATE_LISTENER
     // Report progress - use notify_state_deferred_ since we're in web server task
@@ -118,76 +164,225 @@ void OTARequestHandler::schedule_ota_reboot_() {
 void OTARequestHandler::ota_init_(const char *filename) {
   ESP_LOGI(TAG, "OTA Update Start: %s", filename);
   this->ota_read_length_ = 0;
+  this->last_ota_progress_ = millis();
+  this->last_ota_progress_length_ = 0;
+  this->parent_->bytes_per_second_ = 0.0f;
+  this->parent_->eta_seconds_ = 0;
   this->ota_success_ = false;
 }
 
-void OTARequestHandler::handleUpload(AsyncWebServerRequest *request, const PlatformString &filename, size_t index,
-                                     uint8_t *data, size_t len, bool final) {
+void OTARequestHandler::ota_abort_(ota::OTAResponseTypes error_code) {
+  this->ota_backend_->abort();
+  this->ota_backend_.reset();
+#ifdef USE_ESP8266
+  this->image_head_.reset();
+#endif
+#ifdef KAUF_OTA_PIPELINE
+  this->pipeline_.reset();
+#endif
+#ifdef USE_WEBSERVER_OTA_DELTA
+  this->ota_delta_.reset();
+#endif
+#ifdef USE_OTA_STATE_LISTENER
+  this->parent_->notify_state_deferred_(ota::OTA_ERROR, 0.0f, static_cast<uint8_t>(error_code));
+#endif
+}
+
+#ifdef KAUF_OTA_PIPELINE
+ota::OTAResponseTypes OTARequestHandler::write_oldest_() {
+  // With both buffers queued the fill index has wrapped around to the older one
+  const uint8_t i = this->pipeline_queued_ == 2 ? this->pipeline_fill_ : this->pipeline_fill_ ^ 1;
+  const ota::OTAResponseTypes error_code =
+      this->ota_backend_->write(this->pipeline_.get() + i * PIPELINE_BUFFER_SIZE, this->pipeline_len_[i]);
+  this->pipeline_len_[i] = 0;
+  this->pipeline_queued_--;
+  return error_code;
+}
+#endif
+
+// KAUF: copy the upload into the pipeline buffers, loop() writes them to flash. Only when loop() has not caught up
+// does the callback write a buffer itself.
+ota::OTAResponseTypes OTARequestHandler::write_image_(const uint8_t *data, size_t len) {
+#ifdef KAUF_OTA_PIPELINE
+  if (!this->pipeline_) {
+    this->pipeline_ = make_unique<uint8_t[]>(2 * PIPELINE_BUFFER_SIZE);
+    this->pipeline_len_[0] = this->pipeline_len_[1] = 0;
+    this->pipeline_fill_ = 0;
+    this->pipeline_queued_ = 0;
+  }
+  while (len > 0) {
+    if (this->pipeline_queued_ == 2) {
+      const ota::OTAResponseTypes error_code = this->write_oldest_();
+      if (error_code != ota::OTA_RESPONSE_OK)
+        return error_code;
+    }
+    const uint8_t i = this->pipeline_fill_;
+    const size_t take = std::min(len, PIPELINE_BUFFER_SIZE - this->pipeline_len_[i]);
+    memcpy(this->pipeline_.get() + i * PIPELINE_BUFFER_SIZE + this->pipeline_len_[i], data, take);
+    this->pipeline_len_[i] += take;
+    data += take;
+    len -= take;
+    if (this->pipeline_len_[i] == PIPELINE_BUFFER_SIZE) {
+      this->pipeline_queued_++;
+      this->pipeline_fill_ ^= 1;
+      this->parent_->enable_loop_soon_any_context();
+    }
+  }
+  return ota::OTA_RESPONSE_OK;
+#else
+  // The backend takes a non-const pointer but does not modify the data
+  return this->ota_backend_->write(const_cast<uint8_t *>(data), len);
+#endif
+}
+
+// KAUF: write everything still buffered, before end()
+ota::OTAResponseTypes OTARequestHandler::flush_image_() {
+#ifdef KAUF_OTA_PIPELINE
+  if (!this->pipeline_)
+    return ota::OTA_RESPONSE_OK;
+  while (this->pipeline_queued_ > 0) {
+    const ota::OTAResponseTypes error_code = this->write_oldest_();
+    if (error_code != ota::OTA_RESPONSE_OK)
+      return error_code;
+  }
+  const uint8_t i = this->pipeline_fill_;
   ota::OTAResponseTypes error_code = ota::OTA_RESPONSE_OK;
+  if (this->pipeline_len_[i] > 0)
+    error_code = this->ota_backend_->write(this->pipeline_.get() + i * PIPELINE_BUFFER_SIZE, this->pipeline_len_[i]);
+  this->pipeline_.reset();
+  return error_code;
+#else
+  return ota::OTA_RESPONSE_OK;
+#endif
+}
 
-  // KAUF: analyze filename and don't update in some cases.
-  std::string str = filename.c_str();
-  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+bool OTARequestHandler::pump() {
+  if (!this->ota_backend_)
+    return false;
+  bool more = false;
+#ifdef USE_WEBSERVER_OTA_DELTA
+  // KAUF: continue the COPY run the upload callback left unfinished
+  if (this->ota_delta_ && this->ota_delta_->is_busy()) {
+    const auto result = this->ota_delta_->resume();
+    if (result != OTADeltaDecoder::DELTA_OK) {
+      const ota::OTAResponseTypes error_code = this->delta_error_(result);
+      ESP_LOGE(TAG, "Delta OTA failed: %d", error_code);
+      this->ota_abort_(error_code);
+      return false;
+    }
+    more = this->ota_delta_->is_busy();
+  }
+#endif
+#ifdef KAUF_OTA_PIPELINE
+  if (this->pipeline_ && this->pipeline_queued_ > 0) {
+    const ota::OTAResponseTypes error_code = this->write_oldest_();
+    if (error_code != ota::OTA_RESPONSE_OK) {
+      ESP_LOGE(TAG, "OTA write failed: %d", error_code);
+      this->ota_abort_(error_code);
+      return false;
+    }
+  }
+  more |= this->pipeline_ && this->pipeline_queued_ > 0;
+#endif
+  return more;
+}
 
-  // kill process if already errored out
-  if (this->kauf_ota_error_code != 0) {
-    ESP_LOGD(TAG, "Last OTA try errored out; reboot firmware to try again.");
-    return;
+#ifdef USE_WEBSERVER_OTA_DELTA
+// KAUF: OTA error for a failed delta patch, wrong base patches also get their own message in handleRequest()
+ota::OTAResponseTypes OTARequestHandler::delta_error_(OTADeltaDecoder::Result result) {
+  if (result == OTADeltaDecoder::DELTA_WRONG_BASE) {
+    this->kauf_ota_error_code = 5;
+    return ota::OTA_RESPONSE_ERROR_MD5_MISMATCH;
   }
+  if (result == OTADeltaDecoder::DELTA_BACKEND_ERROR)
+    return this->ota_delta_->get_backend_error();
+  return ota::OTA_RESPONSE_ERROR_MAGIC;
+}
+#endif
+
+// KAUF: filename heuristics, only used for uploads without an image info block. Returns the error code or 0.
+static uint16_t check_filename(const char *filename) {
+  std::string str = filename;
+  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
 
   // kill process if "minimal" is found in string
   if (str.find("minimal") != std::string::npos) {
-    this->kauf_ota_error_code = 1;
     ESP_LOGD(TAG, "***** DO NOT TRY TO FLASH TASMOTA-MINIMAL *****");
-    return;
+    return 1;
   }
 
   // kill process if "wled" is found in string
   if (str.find("wled") != std::string::npos) {
-    this->kauf_ota_error_code = 2;
     ESP_LOGD(TAG, "***** DO NOT TRY TO FLASH WLED *****");
-    return;
+    return 2;
   }
 
   // if used, confirm filename does not conflict with sensor value
 #ifdef SENSOR_4M
   if (SENSOR_4M && str.find("-1m") != std::string::npos) {
     ESP_LOGD(TAG, "***** Apparently trying to flash 1M firmware over 4M version *****");
-    this->kauf_ota_error_code = 3;
-    return;
+    return 3;
   }
 
   if (!SENSOR_4M && str.find("-4m") != std::string::npos) {
     ESP_LOGD(TAG, "***** Apparently trying to flash 4M firmware over 1M version *****");
-    this->kauf_ota_error_code = 3;
-    return;
+    return 3;
   }
 #endif // SENSOR_4M
 
   // check filename does not contain a different product's string
   static const char *const all_products[] = {"plf10", "plf12", "srf10", "rgbsw", "bulb", "plug"};
-#if defined(KAUF_PRODUCT_PLF12)
-  static const char *const my_product = "plf12";
-#elif defined(KAUF_PRODUCT_PLF10)
-  static const char *const my_product = "plf10";
-#elif defined(KAUF_PRODUCT_BULB)
-  static const char *const my_product = "bulb";
-#elif defined(KAUF_PRODUCT_SRF10)
-  static const char *const my_product = "srf10";
-#else
-  static const char *const my_product = nullptr;
-#endif
-  if (my_product != nullptr) {
+  const char *const my_product = KAUF_IMAGE_PRODUCT;
+  if (my_product[0] != '\0') {
     for (size_t i = 0; i < sizeof(all_products) / sizeof(all_products[0]); i++) {
       if (strcmp(all_products[i], my_product) == 0)
         continue;
       if (str.find(all_products[i]) != std::string::npos) {
         ESP_LOGD(TAG, "***** Wrong product: filename contains '%s', this is a %s device *****", all_products[i], my_product);
-        this->kauf_ota_error_code = 4;
-        return;
+        return 4;
       }
     }
   }
+  return 0;
+}
+
+#ifdef USE_ESP8266
+// KAUF: a raw firmware image, as opposed to a .bin.gz or a delta patch. Only esp8266 images are scanned for the image
+// info block: it is linked first in .irom0.text there, inside the first KAUF_IMAGE_INFO_SCAN_SIZE bytes. An ESP32 image
+// has it further in, so those are checked by filename.
+static bool is_plain_image(const uint8_t *data, size_t len) {
+  if (len >= 2 && data[0] == 0x1F && data[1] == 0x8B)
+    return false;
+#ifdef USE_WEBSERVER_OTA_DELTA
+  if (OTADeltaDecoder::is_delta(data, len))
+    return false;
+#endif
+  return true;
+}
+#endif
+
+void OTARequestHandler::handleUpload(AsyncWebServerRequest *request, const PlatformString &filename, size_t index,
+                                     uint8_t *data, size_t len, bool final) {
+  ota::OTAResponseTypes error_code = ota::OTA_RESPONSE_OK;
+
+  // kill process if already errored out
+  if (this->kauf_ota_error_code != 0) {
+    ESP_LOGD(TAG, "Last OTA try errored out; reboot firmware to try again.");
+    return;
+  }
+
+  // KAUF: uploads that cannot carry the image info block (delta patches, .bin.gz, non-esp8266 images) are checked by
+  // filename right away, before anything is started
+#ifdef USE_ESP8266
+  const bool scan_image_info = index == 0 && len > 0 && is_plain_image(data, len);
+#else
+  const bool scan_image_info = false;
+#endif
+  if (index == 0 && len > 0 && !scan_image_info) {
+    this->kauf_ota_error_code = check_filename(filename.c_str());
+    if (this->kauf_ota_error_code != 0)
+      return;
+  }
 
   // First byte of a new upload: index==0 with actual data. (web_server_idf
   // fires a separate start-marker call with data==nullptr/len==0 before the
@@ -206,6 +401,15 @@ void OTARequestHandler::handleUpload(AsyncWebServerRequest *request, const Platf
       this->parent_->notify_state_deferred_(ota::OTA_ABORT, 0.0f, 0);
 #endif
       this->ota_backend_.reset();
+#ifdef USE_ESP8266
+      this->image_head_.reset();
+#endif
+#ifdef KAUF_OTA_PIPELINE
+      this->pipeline_.reset();
+#endif
+#ifdef USE_WEBSERVER_OTA_DELTA
+      this->ota_delta_.reset();
+#endif
     }
 
     // Initialize OTA on first call
@@ -238,7 +442,20 @@ void OTARequestHandler::handleUpload(AsyncWebServerRequest *request, const Platf
     // Web server OTA uses multipart uploads where the actual firmware size
     // is unknown (contentLength includes multipart overhead)
     // Pass 0 to indicate unknown size
+#ifdef USE_WEBSERVER_OTA_DELTA
+    // KAUF: a delta patch starts the backend itself once its header is in, with the size and MD5 of the new image
+    if (OTADeltaDecoder::is_delta(data, len)) {
+      ESP_LOGI(TAG, "Upload is a delta patch");
+      // The rebuilt image goes through the same flash write pipeline as a plain upload
+      this->ota_delta_ = make_unique<OTADeltaDecoder>(this->ota_backend_.get(), [this](const uint8_t *buf, size_t n) {
+        return this->write_image_(buf, n);
+      });
+    } else {
+      error_code = this->ota_backend_->begin(0);
+    }
+#else
     error_code = this->ota_backend_->begin(0);
+#endif
     if (error_code != ota::OTA_RESPONSE_OK) {
       ESP_LOGE(TAG, "OTA begin failed: %d", error_code);
       this->ota_backend_.reset();
@@ -247,22 +464,75 @@ void OTARequestHandler::handleUpload(AsyncWebServerRequest *request, const Platf
 #endif
       return;
     }
+
+#ifdef USE_ESP8266
+    if (scan_image_info) {
+      this->image_head_ = make_unique<uint8_t[]>(KAUF_IMAGE_INFO_SCAN_SIZE);
+      this->image_head_len_ = 0;
+    }
+#endif
   }
 
   if (!this->ota_backend_) {
     return;
   }
 
+#ifdef USE_ESP8266
+  // KAUF: validate the image info block once, before the first flash write. Images without one fall back to the
+  // filename checks.
+  if (this->image_head_ && (len > 0 || final)) {
+    const size_t take = std::min(len, KAUF_IMAGE_INFO_SCAN_SIZE - this->image_head_len_);
+    memcpy(this->image_head_.get() + this->image_head_len_, data, take);
+    this->image_head_len_ += take;
+    this->ota_read_length_ += take;
+    data += take;
+    len -= take;
+
+    KaufImageInfo info;
+    const bool found = find_image_info(this->image_head_.get(), this->image_head_len_, info);
+    if (!found && this->image_head_len_ < KAUF_IMAGE_INFO_SCAN_SIZE && !final)
+      return;
+
+    if (!found)
+      ESP_LOGD(TAG, "No image info block, checking filename");
+    this->kauf_ota_error_code = found ? check_image_info(info) : check_filename(filename.c_str());
+    if (this->kauf_ota_error_code != 0) {
+      this->ota_abort_(ota::OTA_RESPONSE_ERROR_MAGIC);
+      return;
+    }
+
+    error_code = this->ota_backend_->write(this->image_head_.get(), this->image_head_len_);
+    this->image_head_.reset();
+    if (error_code != ota::OTA_RESPONSE_OK) {
+      ESP_LOGE(TAG, "OTA write failed: %d", error_code);
+      this->ota_abort_(error_code);
+      return;
+    }
+  }
+#endif
+
+#ifdef USE_WEBSERVER_OTA_DELTA
+  if (this->ota_delta_ && len > 0) {
+    const auto result = this->ota_delta_->write(data, len);
+    if (result != OTADeltaDecoder::DELTA_OK) {
+      error_code = this->delta_error_(result);
+      ESP_LOGE(TAG, "Delta OTA failed: %d", error_code);
+      this->ota_abort_(error_code);
+      return;
+    }
+    // KAUF: loop() continues an unfinished COPY run
+    if (this->ota_delta_->is_busy())
+      this->parent_->enable_loop_soon_any_context();
+    this->ota_read_length_ += len;
+    this->report_ota_progress_(request);
+  } else
+#endif
   // Process data
   if (len > 0) {
-    error_code = this->ota_backend_->write(data, len);
+    error_code = this->write_image_(data, len);
     if (error_code != ota::OTA_RESPONSE_OK) {
       ESP_LOGE(TAG, "OTA write failed: %d", error_code);
-      this->ota_backend_->abort();
-      this->ota_backend_.reset();
-#ifdef USE_OTA_STATE_LISTENER
-      this->parent_->notify_state_deferred_(ota::OTA_ERROR, 0.0f, static_cast<uint8_t>(error_code));
-#endif
+      this->ota_abort_(error_code);
       return;
     }
     this->ota_read_length_ += len;
@@ -277,6 +547,29 @@ void OTARequestHandler::handleUpload(AsyncWebServerRequest *request, const Platf
     // For Arduino framework, the Update library tracks expected size from firmware header
     // If we haven't received enough data, calling end() will fail
     // This can happen if the upload is interrupted or the client disconnects
+#ifdef USE_WEBSERVER_OTA_DELTA
+    if (this->ota_delta_) {
+      const auto result = this->ota_delta_->finish();
+      if (result != OTADeltaDecoder::DELTA_OK) {
+        error_code = this->delta_error_(result);
+        ESP_LOGE(TAG, "Delta OTA failed: %d", error_code);
+        this->ota_abort_(error_code);
+        return;
+      }
+      if (!this->ota_delta_->is_complete()) {
+        ESP_LOGE(TAG, "Delta patch incomplete, rebuilt %" PRIu32 " bytes", this->ota_delta_->get_written());
+        this->ota_abort_(ota::OTA_RESPONSE_ERROR_UPDATE_END);
+        return;
+      }
+      this->ota_delta_.reset();
+    }
+#endif
+    error_code = this->flush_image_();
+    if (error_code != ota::OTA_RESPONSE_OK) {
+      ESP_LOGE(TAG, "OTA write failed: %d", error_code);
+      this->ota_abort_(error_code);
+      return;
+    }
     error_code = this->ota_backend_->end();
     if (error_code == ota::OTA_RESPONSE_OK) {
       this->ota_success_ = true;
@@ -314,10 +607,16 @@ void OTARequestHandler::handleRequest(AsyncWebServerRequest *request) {
       stream->print(ESPHOME_F("You appear to be trying to flash a WLED bin file, which could brick the device. Rename firmware file to not include the word <b>wled</b> or <b>WLED</b> to override."));
     }
     if ( this->kauf_ota_error_code == 3) {
-      stream->print(ESPHOME_F("You appear to be trying to flash a mismatched update file, either -1m over -4m or -4m over -1m. Download the proper update file or remove <b>-1m</b> or <b>-4m</b> from filename to override."));
+      stream->print(ESPHOME_F("You appear to be trying to flash a mismatched update file, either -1m over -4m or -4m over -1m. Download the proper update file. For files without KAUF image info, remove <b>-1m</b> or <b>-4m</b> from filename to override."));
     }
     if ( this->kauf_ota_error_code == 4) {
-      stream->print(ESPHOME_F("You appear to be trying to flash firmware for a different product. Download the correct firmware or remove the product name from the filename to override."));
+      stream->print(ESPHOME_F("You appear to be trying to flash firmware for a different product. Download the correct firmware. For files without KAUF image info, remove the product name from the filename to override."));
+    }
+    if ( this->kauf_ota_error_code == 5) {
+      stream->print(ESPHOME_F("This delta update was made for a different firmware than the one running on the device. Generate the patch from the firmware file currently installed, or upload the full firmware file."));
+    }
+    if ( this->kauf_ota_error_code == 6) {
+      stream->print(ESPHOME_F("This firmware needs a newer boot loader than the one on this device. Flash it over serial instead."));
     }
 
     stream->print(ESPHOME_F("</body></html>"));
@@ -376,10 +675,24 @@ void WebServerOTAComponent::setup() {
   }
 
   // AsyncWebServer takes ownership of the handler and will delete it when the server is destroyed
-  base->add_handler(new OTARequestHandler(this));  // NOLINT
+  this->handler_ = new OTARequestHandler(this);  // NOLINT
+  base->add_handler(this->handler_);
+  // KAUF: loop() only runs while upload buffers wait for their flash write or a delta COPY run is unfinished
+  this->disable_loop();
+}
+
+void WebServerOTAComponent::loop() {
+  if (!this->handler_->pump())
+    this->disable_loop();
 }
 
-void WebServerOTAComponent::dump_config() { ESP_LOGCONFIG(TAG, "Web Server OTA"); }
+void WebServerOTAComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "Web Server OTA");
+  // KAUF: image info block of this firmware
+  const KaufImageInfo info = get_running_image_info();
+  ESP_LOGCONFIG(TAG, "  Image product: '%.*s', flash size: %" PRIu32, static_cast<int>(sizeof(info.product)),
+                info.product, info.flash_size);
+}
 
 }  // namespace esphome::web_server
 
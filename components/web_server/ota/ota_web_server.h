@@ -7,16 +7,34 @@
 #include "esphome/components/web_server_base/web_server_base.h"
 #include "esphome/core/component.h"
 
+// KAUF: on ESP8266 the upload callback and loop() never run at the same time, so uploads hand full buffers to loop()
+// for the flash writes without locking
+#ifdef USE_ESP8266
+#define KAUF_OTA_PIPELINE
+#endif
+
 namespace esphome::web_server {
 
+class OTARequestHandler;
+
 class WebServerOTAComponent final : public ota::OTAComponent {
  public:
   void setup() override;
+  void loop() override;
   void dump_config() override;
   float get_setup_priority() const override { return setup_priority::AFTER_WIFI; }
 
+  /// KAUF: upload rate of the running update, for OTA state listeners. 0 when unknown.
+  float get_bytes_per_second() const { return this->bytes_per_second_; }
+  /// KAUF: estimated seconds until the running upload is received. 0 when unknown.
+  uint32_t get_eta_seconds() const { return this->eta_seconds_; }
+
  protected:
   friend class OTARequestHandler;
+
+  OTARequestHandler *handler_{nullptr};
+  float bytes_per_second_{0.0f};
+  uint32_t eta_seconds_{0};
 };
 
 }  // namespace esphome::web_server
@@ -0,0 +1,372 @@
+#!/usr/bin/env python3
+"""KAUF: host test for the delta OTA decoder.
+
+Builds ota_delta.cpp with g++ against minimal stand-ins for the ESPHome and
+ESP8266 headers, makes patches with ota_delta.py for a set of sample images and
+checks that the decoder rebuilds every target byte for byte. The patch is fed in
+random chunk sizes with random main loop passes (resume()) in between, like an
+upload on the device.
+
+    python3 test_ota_delta.py [--cxx g++] [--keep]
+"""
+
+import argparse
+import hashlib
+import json
+import os
+from pathlib import Path
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE))
+
+import ota_delta  # noqa: E402
+
+STUBS = {
+    "esphome/core/defines.h": """
+#pragma once
+#define USE_WEBSERVER_OTA
+#define USE_WEBSERVER_OTA_DELTA
+#define USE_ESP8266
+""",
+    "esphome/components/ota/ota_backend.h": """
+#pragma once
+#include <cstddef>
+#include <cstdint>
+namespace esphome::ota {
+enum OTAResponseTypes { OTA_RESPONSE_OK = 0x00, OTA_RESPONSE_ERROR_WRITING_FLASH = 0x82 };
+class OTABackend {
+ public:
+  virtual ~OTABackend() = default;
+  virtual OTAResponseTypes begin(size_t image_size) = 0;
+  virtual void set_update_md5(const char *md5) = 0;
+};
+}  // namespace esphome::ota
+""",
+    "esphome/core/application.h": """
+#pragma once
+namespace esphome {
+struct Application {
+  void feed_wdt() {}
+};
+extern Application App;
+}  // namespace esphome
+""",
+    "esphome/core/helpers.h": """
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+namespace esphome {
+using std::make_unique;
+inline std::string format_hex(const uint8_t *data, size_t length) {
+  std::string out;
+  char buf[3];
+  for (size_t i = 0; i < length; i++) {
+    snprintf(buf, sizeof(buf), "%02x", data[i]);
+    out += buf;
+  }
+  return out;
+}
+}  // namespace esphome
+""",
+    "esphome/core/log.h": """
+#pragma once
+#include <cinttypes>
+#include <cstdio>
+#define ESP_LOGE(tag, ...) (fprintf(stderr, "E [%s] ", tag), fprintf(stderr, __VA_ARGS__), fputc('\\n', stderr))
+#define ESP_LOGI(tag, ...) ((void) 0)
+""",
+    "Esp.h": """
+#pragma once
+#include <strings.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+class EspClass {
+ public:
+  bool flashRead(uint32_t address, uint8_t *data, size_t size);
+  uint32_t getSketchSize();
+  std::string getSketchMD5();
+};
+extern EspClass ESP;
+""",
+}
+
+# Feeds a patch to OTADeltaDecoder the way the upload handler does and reports the result as JSON
+DRIVER = r"""
+#include "ota_delta.h"
+#include "esphome/core/application.h"
+
+#include <Esp.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace esphome {
+Application App;
+}
+
+static std::vector<uint8_t> g_base;
+static std::string g_base_md5;
+
+EspClass ESP;
+bool EspClass::flashRead(uint32_t address, uint8_t *data, size_t size) {
+  if (address > g_base.size() || size > g_base.size() - address)
+    return false;
+  memcpy(data, g_base.data() + address, size);
+  return true;
+}
+uint32_t EspClass::getSketchSize() { return g_base.size(); }
+std::string EspClass::getSketchMD5() { return g_base_md5; }
+
+class Backend : public esphome::ota::OTABackend {
+ public:
+  esphome::ota::OTAResponseTypes begin(size_t image_size) override {
+    this->size = image_size;
+    return esphome::ota::OTA_RESPONSE_OK;
+  }
+  void set_update_md5(const char *md5) override { this->md5 = md5; }
+  size_t size{0};
+  std::string md5;
+};
+
+static std::vector<uint8_t> read_file(const char *path) {
+  std::ifstream f(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), {});
+}
+
+int main(int argc, char **argv) {
+  if (argc != 6)
+    return 2;
+  g_base = read_file(argv[1]);
+  g_base_md5 = argv[2];
+  const std::vector<uint8_t> patch = read_file(argv[3]);
+  std::mt19937 rng(std::stoul(argv[5]));
+
+  using esphome::web_server::OTADeltaDecoder;
+  Backend backend;
+  std::vector<uint8_t> out;
+  size_t emitted = 0;
+  OTADeltaDecoder decoder(&backend, [&](const uint8_t *data, size_t len) {
+    out.insert(out.end(), data, data + len);
+    emitted += len;
+    return esphome::ota::OTA_RESPONSE_OK;
+  });
+
+  int result = OTADeltaDecoder::DELTA_OK;
+  size_t max_write = 0, max_resume = 0, resumes = 0, pos = 0;
+  while (pos < patch.size() && result == OTADeltaDecoder::DELTA_OK) {
+    const size_t len = std::min<size_t>(patch.size() - pos, 1 + rng() % 1460);
+    emitted = 0;
+    result = decoder.write(patch.data() + pos, len);
+    max_write = std::max(max_write, emitted);
+    pos += len;
+    // Sometimes the main loop gets a few passes before the next chunk arrives, sometimes none
+    for (unsigned passes = rng() % 4; passes > 0 && result == OTADeltaDecoder::DELTA_OK && decoder.is_busy();
+         passes--) {
+      emitted = 0;
+      result = decoder.resume();
+      max_resume = std::max(max_resume, emitted);
+      resumes++;
+    }
+  }
+  if (result == OTADeltaDecoder::DELTA_OK)
+    result = decoder.finish();
+
+  std::ofstream(argv[4], std::ios::binary).write(reinterpret_cast<const char *>(out.data()), out.size());
+  printf("{\"result\": %d, \"complete\": %s, \"size\": %zu, \"md5\": \"%s\", \"max_write\": %zu, "
+         "\"max_resume\": %zu, \"resumes\": %zu}\n",
+         result, decoder.is_complete() ? "true" : "false", backend.size, backend.md5.c_str(), max_write, max_resume,
+         resumes);
+  return 0;
+}
+"""
+
+DELTA_OK = 0
+DELTA_BAD_PATCH = 1
+DELTA_WRONG_BASE = 2
+COPY_STEP_SIZE = 4096
+STASH_SIZE = 2048
+
+
+def _sample_base(rng: random.Random, size: int) -> bytes:
+    """Something shaped like firmware: code-like random runs, zero padding and repeated tables."""
+    out = bytearray()
+    table = bytes(rng.randrange(256) for _ in range(512))
+    while len(out) < size:
+        kind = rng.randrange(10)
+        if kind < 7:
+            out += rng.randbytes(rng.randrange(64, 4096))
+        elif kind < 9:
+            out += table
+        else:
+            out += bytes(rng.randrange(16, 1024))
+    return bytes(out[:size])
+
+
+def _edit(rng: random.Random, base: bytes, edits: int) -> bytes:
+    """A new build: bytes changed, inserted and removed at a few places, the rest shifted."""
+    out = bytearray(base)
+    for _ in range(edits):
+        pos = rng.randrange(len(out))
+        kind = rng.randrange(3)
+        if kind == 0:
+            out[pos : pos + 4] = rng.randbytes(4)
+        elif kind == 1:
+            out[pos:pos] = rng.randbytes(rng.randrange(1, 300))
+        else:
+            del out[pos : pos + rng.randrange(1, 300)]
+    return bytes(out)
+
+
+def _samples() -> list[tuple[str, bytes, bytes]]:
+    rng = random.Random(0x4B41_5546)
+    base = _sample_base(rng, 300_000)
+    moved = base[150_000:] + base[:150_000]
+    return [
+        ("identical", base, base),
+        ("few_edits", base, _edit(rng, base, 5)),
+        ("many_edits", base, _edit(rng, base, 200)),
+        ("moved_halves", base, moved),
+        ("appended", base, base + rng.randbytes(20_000)),
+        ("truncated", base, base[:123_457]),
+        ("unrelated", base, rng.randbytes(40_000)),
+        ("small", base[:100], base[50:100] + b"new" + base[:50]),
+    ]
+
+
+class DeltaDecoderTest(unittest.TestCase):
+    cxx = "g++"
+    keep = False
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.tmp = Path(tempfile.mkdtemp(prefix="ota_delta_test_"))
+        # Class cleanups also run when the build below fails
+        cls.addClassCleanup(cls._remove_tmp)
+        for name, text in STUBS.items():
+            path = cls.tmp / "include" / name
+            path.parent.mkdir(parents=True, exist_ok=True)
+            path.write_text(text)
+        (cls.tmp / "driver.cpp").write_text(DRIVER)
+        cls.driver = cls.tmp / "driver"
+        subprocess.run(
+            [
+                cls.cxx,
+                "-std=gnu++17",
+                "-O1",
+                "-Wall",
+                "-Werror",
+                "-fsanitize=address,undefined",
+                "-I",
+                str(cls.tmp / "include"),
+                "-I",
+                str(HERE),
+                str(HERE / "ota_delta.cpp"),
+                str(cls.tmp / "driver.cpp"),
+                "-o",
+                str(cls.driver),
+            ],
+            check=True,
+        )
+
+    @classmethod
+    def _remove_tmp(cls) -> None:
+        if cls.keep:
+            print(f"test files kept in {cls.tmp}")
+        else:
+            shutil.rmtree(cls.tmp)
+
+    def _run(self, base: bytes, patch: bytes, seed: int, base_md5: str | None = None) -> tuple[dict, bytes]:
+        (self.tmp / "base.bin").write_bytes(base)
+        (self.tmp / "patch.delta").write_bytes(patch)
+        proc = subprocess.run(
+            [
+                str(self.driver),
+                str(self.tmp / "base.bin"),
+                base_md5 or hashlib.md5(base).hexdigest(),
+                str(self.tmp / "patch.delta"),
+                str(self.tmp / "out.bin"),
+                str(seed),
+            ],
+            check=True,
+            capture_output=True,
+            text=True,
+        )
+        return json.loads(proc.stdout), (self.tmp / "out.bin").read_bytes()
+
+    def test_rebuilds_samples(self) -> None:
+        for name, base, target in _samples():
+            patch = ota_delta.create_patch(base, target)
+            self.assertEqual(ota_delta.apply_patch(base, patch), target, name)
+            for seed in range(3):
+                with self.subTest(sample=name, seed=seed):
+                    report, out = self._run(base, patch, seed)
+                    self.assertEqual(report["result"], DELTA_OK)
+                    self.assertTrue(report["complete"])
+                    self.assertEqual(out, target)
+                    self.assertEqual(report["size"], len(target))
+                    self.assertEqual(report["md5"], hashlib.md5(target).hexdigest())
+                    # A loop pass rebuilds at most one COPY step plus the literals held back behind it
+                    self.assertLessEqual(report["max_resume"], COPY_STEP_SIZE + STASH_SIZE)
+
+    def test_long_copy_spans_calls(self) -> None:
+        _, base, target = _samples()[0]
+        report, out = self._run(base, ota_delta.create_patch(base, target), 1)
+        self.assertEqual(out, target)
+        self.assertGreater(report["resumes"], 0)
+        self.assertLess(report["max_write"], len(target))
+
+    def test_wrong_base(self) -> None:
+        _, base, target = _samples()[1]
+        patch = ota_delta.create_patch(base, target)
+        report, out = self._run(base, patch, 0, base_md5="0" * 32)
+        self.assertEqual(report["result"], DELTA_WRONG_BASE)
+        self.assertEqual(out, b"")
+
+    def test_copy_outside_base(self) -> None:
+        base = bytes(range(256)) * 4
+        header = ota_delta.HEADER.pack(
+            ota_delta.MAGIC,
+            ota_delta.VERSION,
+            len(base),
+            hashlib.md5(base).digest(),
+            16,
+            bytes(16),
+        )
+        ops = bytes([ota_delta.OP_COPY]) + ota_delta._varint(len(base) - 8) + ota_delta._varint(16)
+        report, _ = self._run(base, header + ops + bytes([ota_delta.OP_END]), 0)
+        self.assertEqual(report["result"], DELTA_BAD_PATCH)
+
+    def test_truncated_patch(self) -> None:
+        _, base, target = _samples()[2]
+        patch = ota_delta.create_patch(base, target)
+        report, out = self._run(base, patch[: len(patch) // 2], 0)
+        self.assertEqual(report["result"], DELTA_OK)
+        self.assertFalse(report["complete"])
+        self.assertEqual(out, target[: len(out)])
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--keep", action="store_true", help="keep the build directory")
+    args, rest = parser.parse_known_args()
+    DeltaDecoderTest.cxx = args.cxx
+    DeltaDecoderTest.keep = args.keep
+    program = unittest.main(argv=[sys.argv[0], *rest], exit=False)
+    return 0 if program.result.wasSuccessful() else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
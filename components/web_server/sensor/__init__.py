@@ -0,0 +1,79 @@
+import esphome.codegen as cg
+from esphome.components import sensor
+import esphome.config_validation as cv
+from esphome.const import (
+    CONF_ID,
+    CONF_WEB_SERVER_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_MILLISECOND,
+)
+
+from .. import WebServer, web_server_ns
+
+DEPENDENCIES = ["web_server"]
+
+# KAUF: request path instrumentation of the web server
+WebServerSensor = web_server_ns.class_("WebServerSensor", cg.PollingComponent)
+
+CONF_REQUEST_TIME_MAX = "request_time_max"
+CONF_MIN_FREE_HEAP = "min_free_heap"
+CONF_SSE_QUEUE_DEPTH = "sse_queue_depth"
+CONF_SSE_SEND_FAILURES = "sse_send_failures"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(WebServerSensor),
+        cv.GenerateID(CONF_WEB_SERVER_ID): cv.use_id(WebServer),
+        cv.Optional(CONF_REQUEST_TIME_MAX): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            icon="mdi:timer-outline",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_MIN_FREE_HEAP): sensor.sensor_schema(
+            unit_of_measurement=UNIT_BYTES,
+            icon="mdi:memory",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_SSE_QUEUE_DEPTH): sensor.sensor_schema(
+            icon="mdi:tray-full",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_SSE_SEND_FAILURES): sensor.sensor_schema(
+            icon="mdi:alert-circle-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+).extend(cv.polling_component_schema("60s"))
+
+
+async def to_code(config):
+    cg.add_define("USE_WEBSERVER_DIAGNOSTICS")
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    server = await cg.get_variable(config[CONF_WEB_SERVER_ID])
+    cg.add(var.set_web_server(server))
+
+    if request_time_config := config.get(CONF_REQUEST_TIME_MAX):
+        sens = await sensor.new_sensor(request_time_config)
+        cg.add(var.set_request_time_max_sensor(sens))
+    if heap_config := config.get(CONF_MIN_FREE_HEAP):
+        sens = await sensor.new_sensor(heap_config)
+        cg.add(var.set_min_free_heap_sensor(sens))
+    if queue_config := config.get(CONF_SSE_QUEUE_DEPTH):
+        sens = await sensor.new_sensor(queue_config)
+        cg.add(var.set_sse_queue_depth_sensor(sens))
+    if failures_config := config.get(CONF_SSE_SEND_FAILURES):
+        sens = await sensor.new_sensor(failures_config)
+        cg.add(var.set_sse_send_failures_sensor(sens))
@@ -0,0 +1,38 @@
+#include "web_server_sensor.h"
+#include "esphome/core/log.h"
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+
+namespace esphome::web_server {
+
+static const char *const TAG = "web_server.sensor";
+
+void WebServerSensor::update() {
+  auto &diagnostics = this->web_server_->get_diagnostics();
+
+  // Request time and queue depth are maxima over the update interval; the take_*() calls restart them.
+  if (this->request_time_max_sensor_ != nullptr)
+    this->request_time_max_sensor_->publish_state(diagnostics.take_recent_max_us() / 1000.0f);
+  if (this->min_free_heap_sensor_ != nullptr) {
+    const uint32_t heap = diagnostics.get_heap_min_free();
+    // No request served yet
+    if (heap != UINT32_MAX)
+      this->min_free_heap_sensor_->publish_state(heap);
+  }
+  if (this->sse_queue_depth_sensor_ != nullptr)
+    this->sse_queue_depth_sensor_->publish_state(diagnostics.take_sse_queue_max());
+  if (this->sse_send_failures_sensor_ != nullptr)
+    this->sse_send_failures_sensor_->publish_state(diagnostics.get_sse_discarded());
+}
+
+void WebServerSensor::dump_config() {
+  ESP_LOGCONFIG(TAG, "Web Server Sensor");
+  LOG_SENSOR("  ", "Request Time Max", this->request_time_max_sensor_);
+  LOG_SENSOR("  ", "Min Free Heap", this->min_free_heap_sensor_);
+  LOG_SENSOR("  ", "SSE Queue Depth", this->sse_queue_depth_sensor_);
+  LOG_SENSOR("  ", "SSE Send Failures", this->sse_send_failures_sensor_);
+}
+
+}  // namespace esphome::web_server
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "../web_server.h"
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+
+namespace esphome::web_server {
+
+/// KAUF: publishes the request path instrumentation of the web server.
+class WebServerSensor : public PollingComponent {
+ public:
+  void set_web_server(WebServer *web_server) { this->web_server_ = web_server; }
+  void set_request_time_max_sensor(sensor::Sensor *sensor) { this->request_time_max_sensor_ = sensor; }
+  void set_min_free_heap_sensor(sensor::Sensor *sensor) { this->min_free_heap_sensor_ = sensor; }
+  void set_sse_queue_depth_sensor(sensor::Sensor *sensor) { this->sse_queue_depth_sensor_ = sensor; }
+  void set_sse_send_failures_sensor(sensor::Sensor *sensor) { this->sse_send_failures_sensor_ = sensor; }
+
+  void update() override;
+  void dump_config() override;
+
+ protected:
+  WebServer *web_server_{nullptr};
+  sensor::Sensor *request_time_max_sensor_{nullptr};
+  sensor::Sensor *min_free_heap_sensor_{nullptr};
+  sensor::Sensor *sse_queue_depth_sensor_{nullptr};
+  sensor::Sensor *sse_send_failures_sensor_{nullptr};
+};
+
+}  // namespace esphome::web_server
+
+#endif
@@ -0,0 +1,434 @@
+#!/usr/bin/env python3
+"""KAUF: host test for the Arduino event source list.
+
+Builds deferred_event_source.cpp and entity_index.cpp with g++ against minimal
+stand-ins for WebServer, ListEntitiesIterator and the ESPHome and
+ESPAsyncWebServer headers, connects 1, 4 and 8 clients to /events and
+publishes state events for a set of sensors. Checks that each event is
+serialized once no matter how many clients are connected, that every client
+ends up with the latest state of every sensor, and that a client with a full
+send queue does not cost the others extra serializations.
+
+    python3 test_deferred_events.py [--cxx g++] [--keep]
+"""
+
+import argparse
+import json
+import os
+from pathlib import Path
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE))
+
+from bench_entity_index import STUBS as INDEX_STUBS  # noqa: E402
+
+STUBS = {
+    "esphome/core/defines.h": """
+#pragma once
+#define USE_WEBSERVER
+#define USE_ARDUINO
+""",
+    "esphome/core/log.h": """
+#pragma once
+#define ESP_LOGW(tag, ...) ((void) 0)
+#define ESP_LOGE(tag, ...) ((void) 0)
+""",
+    "esphome/core/hal.h": """
+#pragma once
+#include <cstdint>
+namespace esphome {
+inline uint32_t millis() { return 0; }
+}  // namespace esphome
+""",
+    "esphome/core/progmem.h": """
+#pragma once
+#define ESPHOME_F(s) s
+""",
+    "esphome/core/string_ref.h": INDEX_STUBS["esphome/core/string_ref.h"],
+    "esphome/core/entity_base.h": INDEX_STUBS["esphome/core/entity_base.h"],
+    "esphome/components/json/json_util.h": """
+#pragma once
+#include <cstddef>
+#include <string>
+namespace esphome::json {
+template<size_t STACK_SIZE = 512> class SerializationBuffer {
+ public:
+  explicit SerializationBuffer(std::string str) : str_(std::move(str)) {}
+  const char *c_str() const { return this->str_.c_str(); }
+
+ protected:
+  std::string str_;
+};
+}  // namespace esphome::json
+""",
+    # One client per event source, like DeferredUpdateEventSource uses it. A full client discards every send.
+    "esphome/components/web_server_base/web_server_base.h": """
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+class String : public std::string {
+ public:
+  using std::string::string;
+  long toInt() const { return atol(this->c_str()); }
+};
+class AsyncWebServerRequest {
+ public:
+  explicit AsyncWebServerRequest(const char *delta) : delta_(delta) {}
+  String arg(const char *name) const { return String(strcmp(name, "delta") == 0 ? this->delta_ : ""); }
+
+ protected:
+  const char *delta_;
+};
+class AsyncEventSourceClient {};
+enum SendStatus { DISCARDED = 0, ENQUEUED = 1, PARTIALLY_ENQUEUED = 2 };
+class AsyncEventSource {
+ public:
+  using ArEventHandlerFunction = std::function<void(AsyncEventSourceClient *)>;
+  explicit AsyncEventSource(const String &url) {}
+  void onConnect(ArEventHandlerFunction cb) { this->connect_cb_ = std::move(cb); }
+  void onDisconnect(ArEventHandlerFunction cb) { this->disconnect_cb_ = std::move(cb); }
+  void handleRequest(AsyncWebServerRequest *request) { this->connect_cb_(&this->client_); }
+  void disconnect() { this->disconnect_cb_(&this->client_); }
+  size_t count() const { return 1; }
+  void close() { this->closed = true; }
+  SendStatus send(const char *message, const char *event = nullptr, uint32_t id = 0, uint32_t reconnect = 0) {
+    if (this->full) {
+      this->discarded++;
+      return DISCARDED;
+    }
+    if (event != nullptr && strcmp(event, "state") == 0)
+      this->states.emplace_back(message);
+    return ENQUEUED;
+  }
+
+  bool full{false};
+  bool closed{false};
+  int discarded{0};
+  std::vector<std::string> states;
+
+ protected:
+  ArEventHandlerFunction connect_cb_;
+  ArEventHandlerFunction disconnect_cb_;
+  AsyncEventSourceClient client_;
+};
+""",
+}
+
+# Stand-ins that sit next to the copied sources so they win over the real headers of the same name
+LOCAL_STUBS = {
+    "list_entities.h": """
+#pragma once
+namespace esphome::web_server {
+class WebServer;
+class DeferredUpdateEventSource;
+/// Lists one entity per advance() after begin(), like the real iterator it is completed before begin()
+class ListEntitiesIterator {
+ public:
+  ListEntitiesIterator(const WebServer *ws, DeferredUpdateEventSource *es) {}
+  void begin(bool include_internal = false) { this->remaining_ = 1; }
+  bool completed() const { return this->remaining_ == 0; }
+  void advance() { this->remaining_--; }
+
+ protected:
+  int remaining_{0};
+};
+}  // namespace esphome::web_server
+""",
+    "web_server.h": """
+#pragma once
+#include "deferred_event_source.h"
+#include "entity_index.h"
+#include <functional>
+#include <memory>
+#include <vector>
+namespace esphome::web_server {
+class WebServer {
+ public:
+  static constexpr uint8_t DELTA_PROTOCOL_VERSION = 1;
+  struct DeltaSnapshot {
+    uint32_t fields[16];
+    uint8_t count;
+  };
+  const EntityIndex &get_entity_index() const { return this->entity_index_; }
+  json::SerializationBuffer<> get_config_json() { return json::SerializationBuffer<>("{}"); }
+  void defer(std::function<void()> &&f) { this->deferred_.push_back(std::move(f)); }
+  void enable_loop_soon_any_context() {}
+  void invalidate_delta_(const void *source) { this->invalidations++; }
+  void run_deferred() {
+    auto deferred = std::move(this->deferred_);
+    this->deferred_.clear();
+    for (auto &f : deferred)
+      f();
+  }
+
+  EntityIndex entity_index_;
+  std::unique_ptr<DeltaSnapshot[]> delta_snapshots_;
+  const void *delta_source_{nullptr};
+  bool delta_events_{false};
+  bool include_internal_{false};
+  int invalidations{0};
+
+ protected:
+  std::vector<std::function<void()>> deferred_;
+};
+}  // namespace esphome::web_server
+""",
+}
+
+# Connects the clients, publishes every sensor `updates` times with client `blocked` full, then lets the full
+# client drain and reports the generator calls and what each client received as JSON
+DRIVER = r"""
+#include "web_server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::web_server;
+
+static int serializations = 0;
+static int delta_serializations = 0;
+static std::vector<int> versions;
+
+static json::SerializationBuffer<> generator(WebServer *ws, void *source) {
+  serializations++;
+  if (ws->delta_source_ == source)
+    delta_serializations++;
+  const int32_t id = ws->get_entity_index().id_of(source);
+  return json::SerializationBuffer<>(std::to_string(id) + ":" + std::to_string(versions[id]));
+}
+
+static json::SerializationBuffer<> all_generator(WebServer *ws, void *source) {
+  serializations++;
+  const int32_t id = ws->get_entity_index().id_of(source);
+  return json::SerializationBuffer<>(std::to_string(id) + ":" + std::to_string(versions[id]) + ":all");
+}
+
+int main(int argc, char **argv) {
+  const int clients = atoi(argv[1]);
+  const int sensors = atoi(argv[2]);
+  const int updates = atoi(argv[3]);
+  const int blocked = atoi(argv[4]);
+  const bool delta = atoi(argv[5]) != 0;
+  // Sensor 0 publishes a state_detail_all event after the others
+  const bool detail_all = argc > 6 && atoi(argv[6]) != 0;
+
+  WebServer ws;
+  ws.delta_events_ = delta;
+  std::vector<std::unique_ptr<EntityBase>> entities;
+  for (int i = 0; i < sensors; i++) {
+    entities.emplace_back(new EntityBase("Sensor " + std::to_string(i)));
+    ws.entity_index_.add(ENTITY_DOMAIN_SENSOR, entities.back().get());
+  }
+  ws.entity_index_.build();
+  versions.assign(sensors, 0);
+
+  DeferredUpdateEventSourceList list;
+  for (int i = 0; i < clients; i++) {
+    AsyncWebServerRequest request(delta ? "1" : "");
+    list.add_new_client(&ws, &request);
+  }
+  ws.run_deferred();
+  list.loop();
+
+  std::vector<AsyncEventSource *> sources(list.begin(), list.end());
+  if (blocked >= 0)
+    sources[blocked]->full = true;
+
+  for (int u = 0; u < updates; u++) {
+    for (int i = 0; i < sensors; i++) {
+      versions[i]++;
+      list.deferrable_send_state(entities[i].get(), "state", generator);
+    }
+  }
+  if (detail_all)
+    list.deferrable_send_state(entities[0].get(), "state_detail_all", all_generator);
+  const int publish_serializations = serializations;
+
+  if (blocked >= 0) {
+    sources[blocked]->full = false;
+    for (int i = 0; i < 4; i++)
+      list.loop();
+  }
+
+  printf("{\"publish_serializations\": %d, \"serializations\": %d, \"delta_serializations\": %d, "
+         "\"invalidations\": %d, \"clients\": [",
+         publish_serializations, serializations, delta_serializations, ws.invalidations);
+  for (size_t c = 0; c < sources.size(); c++) {
+    // The last message for every sensor must carry its latest version
+    std::vector<int> latest(sensors, -1);
+    bool all_last = false;
+    for (const auto &message : sources[c]->states) {
+      int id, version;
+      if (sscanf(message.c_str(), "%d:%d", &id, &version) == 2 && id >= 0 && id < sensors) {
+        latest[id] = version;
+        if (id == 0)
+          all_last = message.find(":all") != std::string::npos;
+      }
+    }
+    bool up_to_date = true;
+    for (int i = 0; i < sensors; i++)
+      up_to_date &= latest[i] == versions[i];
+    printf("%s{\"received\": %zu, \"discarded\": %d, \"up_to_date\": %s, \"detail_all_last\": %s}",
+           c == 0 ? "" : ", ", sources[c]->states.size(), sources[c]->discarded, up_to_date ? "true" : "false",
+           all_last ? "true" : "false");
+  }
+  printf("]}\n");
+
+  for (auto *source : sources)
+    source->disconnect();
+  ws.run_deferred();
+  return list.empty() ? 0 : 1;
+}
+"""
+
+SENSORS = 10
+UPDATES = 3
+
+
+class DeferredEventsTest(unittest.TestCase):
+    cxx = "g++"
+    keep = False
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.tmp = Path(tempfile.mkdtemp(prefix="deferred_events_test_"))
+        # Class cleanups also run when the build below fails
+        cls.addClassCleanup(cls._remove_tmp)
+        for name, text in STUBS.items():
+            path = cls.tmp / "include" / name
+            path.parent.mkdir(parents=True, exist_ok=True)
+            path.write_text(text)
+        src = cls.tmp / "src"
+        src.mkdir()
+        for name in ("deferred_event_source.h", "deferred_event_source.cpp", "entity_index.h", "entity_index.cpp"):
+            shutil.copy(HERE / name, src / name)
+        for name, text in LOCAL_STUBS.items():
+            (src / name).write_text(text)
+        (src / "driver.cpp").write_text(DRIVER)
+        cls.driver = cls.tmp / "driver"
+        subprocess.run(
+            [
+                cls.cxx,
+                "-std=gnu++17",
+                "-O1",
+                "-Wall",
+                "-Werror",
+                "-fsanitize=address,undefined",
+                "-I",
+                str(cls.tmp / "include"),
+                str(src / "deferred_event_source.cpp"),
+                str(src / "entity_index.cpp"),
+                str(src / "driver.cpp"),
+                "-o",
+                str(cls.driver),
+            ],
+            check=True,
+        )
+
+    @classmethod
+    def _remove_tmp(cls) -> None:
+        if cls.keep:
+            print(f"test files kept in {cls.tmp}")
+        else:
+            shutil.rmtree(cls.tmp)
+
+    def _run(self, clients: int, blocked: int = -1, delta: bool = False, detail_all: bool = False) -> dict:
+        proc = subprocess.run(
+            [
+                str(self.driver),
+                str(clients),
+                str(SENSORS),
+                str(UPDATES),
+                str(blocked),
+                str(int(delta)),
+                str(int(detail_all)),
+            ],
+            check=True,
+            capture_output=True,
+            text=True,
+        )
+        return json.loads(proc.stdout)
+
+    def test_one_serialization_per_event(self) -> None:
+        for clients in (1, 4, 8):
+            with self.subTest(clients=clients):
+                report = self._run(clients)
+                self.assertEqual(report["serializations"], SENSORS * UPDATES)
+                for client in report["clients"]:
+                    self.assertEqual(client["received"], SENSORS * UPDATES)
+                    self.assertTrue(client["up_to_date"])
+
+    def test_delta_serialized_once(self) -> None:
+        for clients in (1, 4, 8):
+            with self.subTest(clients=clients):
+                report = self._run(clients, delta=True)
+                self.assertEqual(report["serializations"], SENSORS * UPDATES)
+                self.assertEqual(report["delta_serializations"], SENSORS * UPDATES)
+                self.assertEqual(report["invalidations"], 0)
+
+    def test_full_client(self) -> None:
+        publish = []
+        for clients in (1, 4, 8):
+            with self.subTest(clients=clients):
+                report = self._run(clients, blocked=0)
+                full, others = report["clients"][0], report["clients"][1:]
+                # One retry of the full client's queue head per event after the first, plus the shared message for
+                # every event some client takes right away
+                shared = SENSORS * UPDATES if others else 1
+                self.assertEqual(report["publish_serializations"], shared + full["discarded"] - 1)
+                if others:
+                    publish.append(report["publish_serializations"])
+                # Once it drains it gets each sensor's latest state once, the queue keeps one entry per sensor
+                self.assertEqual(full["received"], SENSORS)
+                self.assertEqual(report["serializations"], report["publish_serializations"] + SENSORS)
+                self.assertTrue(full["up_to_date"])
+                for client in others:
+                    self.assertEqual(client["received"], SENSORS * UPDATES)
+                    self.assertTrue(client["up_to_date"])
+        # More clients don't add serializations
+        self.assertEqual(len(set(publish)), 1)
+
+    def test_queued_state_upgraded_to_detail_all(self) -> None:
+        report = self._run(2, blocked=0, detail_all=True)
+        full, other = report["clients"]
+        # The queued state event of sensor 0 goes out as the detail_all one instead of both being queued
+        self.assertEqual(full["received"], SENSORS)
+        self.assertTrue(full["detail_all_last"])
+        self.assertEqual(other["received"], SENSORS * UPDATES + 1)
+        self.assertTrue(other["detail_all_last"])
+
+    def test_full_client_disables_delta(self) -> None:
+        report = self._run(4, blocked=0, delta=True)
+        # Only the first event goes out as a delta, the full client didn't take it and every later event finds its
+        # queue backed up
+        self.assertEqual(report["delta_serializations"], 1)
+        self.assertGreaterEqual(report["invalidations"], SENSORS * UPDATES)
+        self.assertTrue(all(client["up_to_date"] for client in report["clients"]))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--keep", action="store_true", help="keep the build directory")
+    args, rest = parser.parse_known_args()
+    DeferredEventsTest.cxx = args.cxx
+    DeferredEventsTest.keep = args.keep
+    program = unittest.main(argv=[sys.argv[0], *rest], exit=False)
+    return 0 if program.result.wasSuccessful() else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
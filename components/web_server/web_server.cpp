@@ -20,6 +20,7 @@
 #include "esphome/core/helpers.h"
 #ifdef USE_ESP32
 #include <esp_ota_ops.h>
+#include <esp_system.h>  // KAUF: free heap for /metrics
 #endif
 
 #if !defined(USE_ESP32) && defined(USE_ARDUINO)
@@ -31,6 +32,8 @@
 #include <algorithm>
 
 #include <cstdlib>
+#include <cstring>
+#include <new>
 #include <cmath> // KAUF
 
 #ifdef USE_LIGHT
@@ -54,6 +57,10 @@
 #include "esphome/components/water_heater/water_heater.h"
 #endif
 
+#ifdef USE_DDP
+#include "esphome/components/ddp/ddp.h"  // KAUF: DDP packet counter for /metrics
+#endif
+
 #ifdef USE_INFRARED
 #include "esphome/components/infrared/infrared.h"
 #endif
@@ -131,6 +138,18 @@ static void parse_color_mode_param_(AsyncWebServerRequest *request, T &call) {
     ESP_LOGW(TAG, "Unsupported color_mode value: %s", value.c_str());
   }
 }
+
+// KAUF: for batch light commands, color_mode has to be one the light supports and effect one of its effects (or
+// "none"). Returns the error that rejects the command, or nullptr. REST requests keep ignoring invalid values.
+static const char *check_light_mode_effect_(light::LightState *obj, const char *color_mode, const char *effect) {
+  light::ColorMode mode = light::ColorMode::UNKNOWN;
+  if (color_mode != nullptr &&
+      (!parse_color_mode_string_(color_mode, mode) || !obj->get_traits().supports_color_mode(mode)))
+    return "unsupported color_mode";
+  if (effect != nullptr && strcasecmp(effect, "none") != 0 && obj->get_effect_index(effect, strlen(effect)) == 0)
+    return "unknown effect";
+  return nullptr;
+}
 #endif
 
 // Longest: UPDATE AVAILABLE (16 chars + null terminator, rounded up)
@@ -302,230 +321,6 @@ static UrlMatch match_url(const char *url_ptr, size_t url_len, bool only_domain,
   return match;
 }
 
-EntityMatchResult UrlMatch::match_entity(EntityBase *entity) const {
-  EntityMatchResult result{false, this->method.empty()};
-
-#ifdef USE_DEVICES
-  Device *entity_device = entity->get_device();
-  bool url_has_device = !this->device_name.empty();
-  bool entity_has_device = (entity_device != nullptr);
-
-  // Device matching: URL device segment must match entity's device
-  if (url_has_device != entity_has_device) {
-    return result;  // Mismatch: one has device, other doesn't
-  }
-  if (url_has_device && this->device_name != entity_device->get_name()) {
-    return result;  // Device name doesn't match
-  }
-#endif
-
-  // Try matching by entity name (new format)
-  if (this->id == entity->get_name()) {
-    result.matched = true;
-    return result;
-  }
-
-  // Fall back to object_id (deprecated format)
-  char object_id_buf[OBJECT_ID_MAX_LEN];
-  StringRef object_id = entity->get_object_id_to(object_id_buf);
-  if (this->id == object_id) {
-    result.matched = true;
-    // Log deprecation warning
-#ifdef USE_DEVICES
-    Device *device = entity->get_device();
-    if (device != nullptr) {
-      ESP_LOGW(TAG,
-               "Deprecated URL format: /%.*s/%.*s/%.*s - use entity name '/%.*s/%s/%s' instead. "
-               "Object ID URLs will be removed in 2026.7.0.",
-               (int) this->domain.size(), this->domain.c_str(), (int) this->device_name.size(),
-               this->device_name.c_str(), (int) this->id.size(), this->id.c_str(), (int) this->domain.size(),
-               this->domain.c_str(), device->get_name(), entity->get_name().c_str());
-    } else
-#endif
-    {
-      ESP_LOGW(TAG,
-               "Deprecated URL format: /%.*s/%.*s - use entity name '/%.*s/%s' instead. "
-               "Object ID URLs will be removed in 2026.7.0.",
-               (int) this->domain.size(), this->domain.c_str(), (int) this->id.size(), this->id.c_str(),
-               (int) this->domain.size(), this->domain.c_str(), entity->get_name().c_str());
-    }
-  }
-
-  return result;
-}
-
-#if !defined(USE_ESP32) && defined(USE_ARDUINO)
-// helper for allowing only unique entries in the queue
-void __attribute__((flatten))
-DeferredUpdateEventSource::deq_push_back_with_dedup_(void *source, message_generator_t *message_generator) {
-  DeferredEvent item(source, message_generator);
-
-  // Use range-based for loop instead of std::find_if to reduce template instantiation overhead and binary size
-  for (auto &event : this->deferred_queue_) {
-    if (event == item) {
-      return;  // Already in queue, no need to update since items are equal
-    }
-  }
-  this->deferred_queue_.push_back(item);
-}
-
-void DeferredUpdateEventSource::process_deferred_queue_() {
-  while (!deferred_queue_.empty()) {
-    DeferredEvent &de = deferred_queue_.front();
-    auto message = de.message_generator_(web_server_, de.source_);
-    if (this->send(message.c_str(), "state") != DISCARDED) {
-      // O(n) but memory efficiency is more important than speed here which is why std::vector was chosen
-      deferred_queue_.erase(deferred_queue_.begin());
-      this->consecutive_send_failures_ = 0;  // Reset failure count on successful send
-    } else {
-      // NOTE: Similar logic exists in web_server_idf/web_server_idf.cpp in AsyncEventSourceResponse::process_buffer_()
-      // The implementations differ due to platform-specific APIs (DISCARDED vs HTTPD_SOCK_ERR_TIMEOUT, close() vs
-      // fd_.store(0)), but the failure counting and timeout logic should be kept in sync. If you change this logic,
-      // also update the ESP-IDF implementation.
-      this->consecutive_send_failures_++;
-      if (this->consecutive_send_failures_ >= MAX_CONSECUTIVE_SEND_FAILURES) {
-        // Too many failures, connection is likely dead
-        ESP_LOGW(TAG, "Closing stuck EventSource connection after %" PRIu16 " failed sends",
-                 this->consecutive_send_failures_);
-        this->close();
-        this->deferred_queue_.clear();
-      }
-      break;
-    }
-  }
-}
-
-void DeferredUpdateEventSource::loop() {
-  process_deferred_queue_();
-  if (!this->entities_iterator_.completed())
-    this->entities_iterator_.advance();
-}
-
-void DeferredUpdateEventSource::deferrable_send_state(void *source, const char *event_type,
-                                                      message_generator_t *message_generator) {
-  // Skip if no connected clients to avoid unnecessary deferred queue processing
-  if (this->count() == 0)
-    return;
-
-  // allow all json "details_all" to go through before publishing bare state events, this avoids unnamed entries showing
-  // up in the web GUI and reduces event load during initial connect
-  if (!entities_iterator_.completed() && 0 != strcmp(event_type, "state_detail_all"))
-    return;
-
-  if (source == nullptr)
-    return;
-  if (event_type == nullptr)
-    return;
-  if (message_generator == nullptr)
-    return;
-
-  if (0 != strcmp(event_type, "state_detail_all") && 0 != strcmp(event_type, "state")) {
-    ESP_LOGE(TAG, "Can't defer non-state event");
-  }
-
-  if (!deferred_queue_.empty())
-    process_deferred_queue_();
-  if (!deferred_queue_.empty()) {
-    // deferred queue still not empty which means downstream event queue full, no point trying to send first
-    deq_push_back_with_dedup_(source, message_generator);
-  } else {
-    auto message = message_generator(web_server_, source);
-    if (this->send(message.c_str(), "state") == DISCARDED) {
-      deq_push_back_with_dedup_(source, message_generator);
-    } else {
-      this->consecutive_send_failures_ = 0;  // Reset failure count on successful send
-    }
-  }
-}
-
-// used for logs plus the initial ping/config
-void DeferredUpdateEventSource::try_send_nodefer(const char *message, const char *event, uint32_t id,
-                                                 uint32_t reconnect) {
-  this->send(message, event, id, reconnect);
-}
-
-bool DeferredUpdateEventSourceList::loop() {
-  for (DeferredUpdateEventSource *dues : *this) {
-    dues->loop();
-  }
-  return !this->empty();
-}
-
-void DeferredUpdateEventSourceList::deferrable_send_state(void *source, const char *event_type,
-                                                          message_generator_t *message_generator) {
-  // Skip if no event sources (no connected clients) to avoid unnecessary iteration
-  if (this->empty())
-    return;
-  for (DeferredUpdateEventSource *dues : *this) {
-    dues->deferrable_send_state(source, event_type, message_generator);
-  }
-}
-
-void DeferredUpdateEventSourceList::try_send_nodefer(const char *message, const char *event, uint32_t id,
-                                                     uint32_t reconnect) {
-  for (DeferredUpdateEventSource *dues : *this) {
-    dues->try_send_nodefer(message, event, id, reconnect);
-  }
-}
-
-void DeferredUpdateEventSourceList::add_new_client(WebServer *ws, AsyncWebServerRequest *request) {
-  DeferredUpdateEventSource *es = new DeferredUpdateEventSource(ws, "/events");
-  this->push_back(es);
-
-  es->onConnect([this, es](AsyncEventSourceClient *client) { this->on_client_connect_(es); });
-
-  es->onDisconnect([this, es](AsyncEventSourceClient *client) { this->on_client_disconnect_(es); });
-
-  es->handleRequest(request);
-  ws->enable_loop_soon_any_context();
-}
-
-void DeferredUpdateEventSourceList::on_client_connect_(DeferredUpdateEventSource *source) {
-  WebServer *ws = source->web_server_;
-  ws->defer([ws, source]() {
-    // Configure reconnect timeout and send config
-    // this should always go through since the AsyncEventSourceClient event queue is empty on connect
-    auto message = ws->get_config_json();
-    source->try_send_nodefer(message.c_str(), "ping", millis(), 30000);
-
-#ifdef USE_WEBSERVER_SORTING
-    for (auto &group : ws->sorting_groups_) {
-      json::JsonBuilder builder;
-      JsonObject root = builder.root();
-      root[ESPHOME_F("name")] = group.second.name;
-      root[ESPHOME_F("sorting_weight")] = group.second.weight;
-      auto group_msg = builder.serialize();
-
-      // up to 31 groups should be able to be queued initially without defer
-      source->try_send_nodefer(group_msg.c_str(), "sorting_group");
-    }
-#endif
-
-// KAUF: show all entities if factory routine is running so button to stop it is visible.
-    source->entities_iterator_.begin(ws->include_internal_
-#ifdef KAUF_FACTORY
-        || (ws->factory_condition_ != nullptr && *ws->factory_condition_)
-#endif
-    );
-
-    // just dump them all up-front and take advantage of the deferred queue
-    //     on second thought that takes too long, but leaving the commented code here for debug purposes
-    // while(!source->entities_iterator_.completed()) {
-    //  source->entities_iterator_.advance();
-    //}
-  });
-}
-
-void DeferredUpdateEventSourceList::on_client_disconnect_(DeferredUpdateEventSource *source) {
-  source->web_server_->defer([this, source]() {
-    // This method was called via WebServer->defer() and is no longer executing in the
-    // context of the network callback. The object is now dead and can be safely deleted.
-    this->remove(source);
-    delete source;  // NOLINT
-  });
-}
-#endif
-
 WebServer::WebServer(web_server_base::WebServerBase *base) : base_(base) {}
 
 #ifdef USE_WEBSERVER_CSS_INCLUDE
@@ -601,6 +396,10 @@ json::SerializationBuffer<> WebServer::get_config_json() {
   App.get_build_time_string(build_time_buffer);
   root[ESPHOME_F("build_ts")]  = build_time_buffer;
   root[ESPHOME_F("cfg_hash")]  = App.get_config_hash();
+#ifdef USE_WEBSERVER_OTA_DELTA
+  // KAUF: identifies the running image a delta OTA patch has to be made against
+  root[ESPHOME_F("sketch_md5")] = ESP.getSketchMD5();
+#endif
 
   JsonObject kauf_ui = root[ESPHOME_F("kauf_ui")].to<JsonObject>();
   kauf_ui[ESPHOME_F("display_name")] = product_ui.display_name;
@@ -630,6 +429,13 @@ void WebServer::setup() {
   this->base_->add_handler(&this->events_);
 #endif
   this->base_->add_handler(this);
+  this->build_entity_index_();
+#ifdef USE_WEBSERVER_WEBSOCKET
+  // KAUF: WebSocket transport on /ws, see on_ws_event_()
+  this->ws_.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg,
+                           uint8_t *data, size_t len) { this->on_ws_event_(client, type, arg, data, len); });
+  this->base_->add_handler(&this->ws_);
+#endif
 
   // OTA is now handled by the web_server OTA platform
 
@@ -644,17 +450,176 @@ void WebServer::setup() {
     this->events_.try_send_nodefer(buf, "ping", millis(), 30000);
   });
 }
+
+// KAUF: index every entity once so REST requests don't scan the entity lists
+void WebServer::build_entity_index_() {
+  const std::string featured_name = this->featured_name_.empty()
+                                        ? (App.get_friendly_name().empty() ? App.get_name() : App.get_friendly_name())
+                                        : this->featured_name_;
+#ifdef USE_SENSOR
+  for (auto *obj : App.get_sensors())
+    this->index_entity_(ENTITY_DOMAIN_SENSOR, obj, featured_name);
+#endif
+#ifdef USE_SWITCH
+  for (auto *obj : App.get_switches())
+    this->index_entity_(ENTITY_DOMAIN_SWITCH, obj, featured_name);
+#endif
+#ifdef USE_BUTTON
+  for (auto *obj : App.get_buttons())
+    this->index_entity_(ENTITY_DOMAIN_BUTTON, obj, featured_name);
+#endif
+#ifdef USE_BINARY_SENSOR
+  for (auto *obj : App.get_binary_sensors())
+    this->index_entity_(ENTITY_DOMAIN_BINARY_SENSOR, obj, featured_name);
+#endif
+#ifdef USE_FAN
+  for (auto *obj : App.get_fans())
+    this->index_entity_(ENTITY_DOMAIN_FAN, obj, featured_name);
+#endif
+#ifdef USE_LIGHT
+  for (auto *obj : App.get_lights())
+    this->index_entity_(ENTITY_DOMAIN_LIGHT, obj, featured_name);
+#endif
+#ifdef USE_TEXT_SENSOR
+  for (auto *obj : App.get_text_sensors())
+    this->index_entity_(ENTITY_DOMAIN_TEXT_SENSOR, obj, featured_name);
+#endif
+#ifdef USE_COVER
+  for (auto *obj : App.get_covers())
+    this->index_entity_(ENTITY_DOMAIN_COVER, obj, featured_name);
+#endif
+#ifdef USE_NUMBER
+  for (auto *obj : App.get_numbers())
+    this->index_entity_(ENTITY_DOMAIN_NUMBER, obj, featured_name);
+#endif
+#ifdef USE_DATETIME_DATE
+  for (auto *obj : App.get_dates())
+    this->index_entity_(ENTITY_DOMAIN_DATE, obj, featured_name);
+#endif
+#ifdef USE_DATETIME_TIME
+  for (auto *obj : App.get_times())
+    this->index_entity_(ENTITY_DOMAIN_TIME, obj, featured_name);
+#endif
+#ifdef USE_DATETIME_DATETIME
+  for (auto *obj : App.get_datetimes())
+    this->index_entity_(ENTITY_DOMAIN_DATETIME, obj, featured_name);
+#endif
+#ifdef USE_TEXT
+  for (auto *obj : App.get_texts())
+    this->index_entity_(ENTITY_DOMAIN_TEXT, obj, featured_name);
+#endif
+#ifdef USE_SELECT
+  for (auto *obj : App.get_selects())
+    this->index_entity_(ENTITY_DOMAIN_SELECT, obj, featured_name);
+#endif
+#ifdef USE_CLIMATE
+  for (auto *obj : App.get_climates())
+    this->index_entity_(ENTITY_DOMAIN_CLIMATE, obj, featured_name);
+#endif
+#ifdef USE_LOCK
+  for (auto *obj : App.get_locks())
+    this->index_entity_(ENTITY_DOMAIN_LOCK, obj, featured_name);
+#endif
+#ifdef USE_VALVE
+  for (auto *obj : App.get_valves())
+    this->index_entity_(ENTITY_DOMAIN_VALVE, obj, featured_name);
+#endif
+#ifdef USE_ALARM_CONTROL_PANEL
+  for (auto *obj : App.get_alarm_control_panels())
+    this->index_entity_(ENTITY_DOMAIN_ALARM_CONTROL_PANEL, obj, featured_name);
+#endif
+#ifdef USE_WATER_HEATER
+  for (auto *obj : App.get_water_heaters())
+    this->index_entity_(ENTITY_DOMAIN_WATER_HEATER, obj, featured_name);
+#endif
+#ifdef USE_INFRARED
+  for (auto *obj : App.get_infrareds())
+    this->index_entity_(ENTITY_DOMAIN_INFRARED, obj, featured_name);
+#endif
+#ifdef USE_RADIO_FREQUENCY
+  for (auto *obj : App.get_radio_frequencies())
+    this->index_entity_(ENTITY_DOMAIN_RADIO_FREQUENCY, obj, featured_name);
+#endif
+#ifdef USE_EVENT
+  for (auto *obj : App.get_events())
+    this->index_entity_(ENTITY_DOMAIN_EVENT, obj, featured_name);
+#endif
+#ifdef USE_UPDATE
+  for (auto *obj : App.get_updates())
+    this->index_entity_(ENTITY_DOMAIN_UPDATE, obj, featured_name);
+#endif
+  this->entity_index_.build();
+}
+
+void WebServer::index_entity_(EntityDomain domain, EntityBase *entity, const std::string &featured_name) {
+  this->entity_index_.add(domain, entity);
+  // KAUF: the first visible entity named like the featured name leads /state; radio frequency isn't part of /state
+  if (this->featured_entity_ == nullptr && domain != ENTITY_DOMAIN_RADIO_FREQUENCY && !featured_name.empty() &&
+      entity->get_name() == featured_name && (this->include_internal_ || !entity->is_internal())) {
+    this->featured_entity_ = entity;
+    this->featured_domain_ = domain;
+  }
+}
+
 void WebServer::loop() {
+#ifdef USE_WEBSERVER_METRICS
+  this->record_loop_time_();  // KAUF
+#endif
   // No SSE clients connected; stop looping until a new client connects via
   // enable_loop_soon_any_context(). This is safe because:
   // - set_interval/set_timeout/defer run via the Scheduler, independent of loop()
   // - deferrable_send_state early-outs when no clients are connected
   // - try_send_nodefer (log, ping) iterates sessions which are empty
   // - REST API handlers use defer() which runs via the Scheduler
-  if (!this->events_.loop())
-    this->disable_loop();
+#ifdef USE_WEBSERVER_WEBSOCKET
+  // KAUF: closes clients beyond the library limit; loop() keeps running while WebSocket clients are connected
+  this->ws_.cleanupClients();
+  this->ws_sync_clients_();
+#endif
+  if (!this->events_.loop()) {
+    this->delta_snapshots_.reset();  // KAUF
+    if (!this->keep_looping_()) {    // KAUF
+#ifdef USE_WEBSERVER_METRICS
+      this->metrics_last_loop_us_ = 0;  // the next gap would span the time the loop was disabled
+#endif
+      this->disable_loop();
+    }
+  }
+}
+
+#ifdef USE_WEBSERVER_METRICS
+// KAUF: the gap between two loop() calls is one main loop iteration. The application sleeps away whatever is left
+// of its loop interval, so a gap within the interval is mostly sleep and only a longer one is time spent working.
+void WebServer::record_loop_time_() {
+  const uint32_t now = micros();
+  if (this->metrics_last_loop_us_ != 0) {
+    const uint32_t gap = now - this->metrics_last_loop_us_;
+    this->rotate_loop_window_(App.get_loop_component_start_time());
+    if (gap > App.get_loop_interval() * 1000)
+      this->metrics_loop_max_us_ = std::max(this->metrics_loop_max_us_, gap);
+  }
+  this->metrics_last_loop_us_ = now;
+}
+
+void WebServer::rotate_loop_window_(uint32_t now_ms) {
+  const uint32_t elapsed = now_ms - this->metrics_window_start_ms_;
+  if (elapsed < METRICS_LOOP_WINDOW_MS)
+    return;
+  // Windows without any loop() call (loop disabled) had no samples
+  this->metrics_loop_max_prev_us_ = elapsed < 2 * METRICS_LOOP_WINDOW_MS ? this->metrics_loop_max_us_ : 0;
+  this->metrics_loop_max_us_ = 0;
+  this->metrics_window_start_ms_ = now_ms;
 }
 
+// Same result as rotating the windows first, without writing (scrapes don't run in the main loop)
+uint32_t WebServer::loop_time_max_us_(uint32_t now_ms) const {
+  const uint32_t elapsed = now_ms - this->metrics_window_start_ms_;
+  if (elapsed < METRICS_LOOP_WINDOW_MS)
+    return std::max(this->metrics_loop_max_us_, this->metrics_loop_max_prev_us_);
+  return elapsed < 2 * METRICS_LOOP_WINDOW_MS ? this->metrics_loop_max_us_ : 0;
+}
+#endif
+
 #ifdef USE_LOGGER
 void WebServer::on_log(uint8_t level, const char *tag, const char *message, size_t message_len) {
   (void) level;
@@ -669,11 +634,42 @@ void WebServer::dump_config() {
                 "Web Server:\n"
                 "  Address: %s:%u",
                 network::get_use_address(), this->base_->get_port());
+  ESP_LOGCONFIG(TAG, "  Entity index: %u keys, %u slots", (unsigned) this->entity_index_.size(),
+                (unsigned) this->entity_index_.capacity());
 }
 float WebServer::get_setup_priority() const { return setup_priority::WIFI - 1.0f; }
 
+// KAUF: conditional GET for the embedded assets. Their ETags are content hashes generated at build time, so a
+// matching If-None-Match is answered with 304 without reading the asset from flash.
+[[maybe_unused]] static bool send_not_modified(AsyncWebServerRequest *request, const char *etag) {
+#ifdef USE_ESP32
+  auto if_none_match = request->get_header("If-None-Match");
+  if (!if_none_match.has_value() || if_none_match->find(etag) == std::string::npos)
+    return false;
+#else
+  if (!request->hasHeader(ESPHOME_F("If-None-Match")) || request->header(ESPHOME_F("If-None-Match")).indexOf(etag) < 0)
+    return false;
+#endif
+  AsyncWebServerResponse *response = request->beginResponse(304, ESPHOME_F(""));
+  response->addHeader(ESPHOME_F("ETag"), etag);
+  request->send(response);
+  return true;
+}
+
+// KAUF: the index is revalidated on every load (cheap with ETags); included assets have hashed URLs and never change
+[[maybe_unused]] static void add_cache_headers(AsyncWebServerResponse *response, const char *etag, bool immutable) {
+  response->addHeader(ESPHOME_F("ETag"), etag);
+  if (immutable) {
+    response->addHeader(ESPHOME_F("Cache-Control"), ESPHOME_F("public, max-age=31536000, immutable"));
+  } else {
+    response->addHeader(ESPHOME_F("Cache-Control"), ESPHOME_F("no-cache"));
+  }
+}
+
 #ifdef USE_WEBSERVER_LOCAL
 void WebServer::handle_index_request(AsyncWebServerRequest *request) {
+  if (send_not_modified(request, ESPHOME_WEBSERVER_LOCAL_INDEX_ETAG))
+    return;
 #ifndef USE_ESP8266
   AsyncWebServerResponse *response = request->beginResponse(200, "text/html", INDEX_GZ, sizeof(INDEX_GZ));
 #else
@@ -684,10 +680,13 @@ void WebServer::handle_index_request(AsyncWebServerRequest *request) {
 #else
   response->addHeader(ESPHOME_F("Content-Encoding"), ESPHOME_F("br"));
 #endif
+  add_cache_headers(response, ESPHOME_WEBSERVER_LOCAL_INDEX_ETAG, false);
   request->send(response);
 }
 #elif USE_WEBSERVER_VERSION >= 2
 void WebServer::handle_index_request(AsyncWebServerRequest *request) {
+  if (send_not_modified(request, ESPHOME_WEBSERVER_INDEX_HTML_ETAG))
+    return;
 #ifndef USE_ESP8266
   AsyncWebServerResponse *response =
       request->beginResponse(200, "text/html", ESPHOME_WEBSERVER_INDEX_HTML, ESPHOME_WEBSERVER_INDEX_HTML_SIZE);
@@ -696,6 +695,7 @@ void WebServer::handle_index_request(AsyncWebServerRequest *request) {
       request->beginResponse_P(200, "text/html", ESPHOME_WEBSERVER_INDEX_HTML, ESPHOME_WEBSERVER_INDEX_HTML_SIZE);
 #endif
   // No gzip header here because the HTML file is so small
+  add_cache_headers(response, ESPHOME_WEBSERVER_INDEX_HTML_ETAG, false);
   request->send(response);
 }
 #endif
@@ -713,6 +713,8 @@ void WebServer::handle_pna_cors_request(AsyncWebServerRequest *request) {
 
 #ifdef USE_WEBSERVER_CSS_INCLUDE
 void WebServer::handle_css_request(AsyncWebServerRequest *request) {
+  if (send_not_modified(request, ESPHOME_WEBSERVER_CSS_INCLUDE_ETAG))
+    return;
 #ifndef USE_ESP8266
   AsyncWebServerResponse *response =
       request->beginResponse(200, "text/css", ESPHOME_WEBSERVER_CSS_INCLUDE, ESPHOME_WEBSERVER_CSS_INCLUDE_SIZE);
@@ -721,12 +723,15 @@ void WebServer::handle_css_request(AsyncWebServerRequest *request) {
       request->beginResponse_P(200, "text/css", ESPHOME_WEBSERVER_CSS_INCLUDE, ESPHOME_WEBSERVER_CSS_INCLUDE_SIZE);
 #endif
   response->addHeader(ESPHOME_F("Content-Encoding"), ESPHOME_F("gzip"));
+  add_cache_headers(response, ESPHOME_WEBSERVER_CSS_INCLUDE_ETAG, true);
   request->send(response);
 }
 #endif
 
 #ifdef USE_WEBSERVER_JS_INCLUDE
 void WebServer::handle_js_request(AsyncWebServerRequest *request) {
+  if (send_not_modified(request, ESPHOME_WEBSERVER_JS_INCLUDE_ETAG))
+    return;
 #ifndef USE_ESP8266
   AsyncWebServerResponse *response =
       request->beginResponse(200, "text/javascript", ESPHOME_WEBSERVER_JS_INCLUDE, ESPHOME_WEBSERVER_JS_INCLUDE_SIZE);
@@ -735,6 +740,7 @@ void WebServer::handle_js_request(AsyncWebServerRequest *request) {
       request->beginResponse_P(200, "text/javascript", ESPHOME_WEBSERVER_JS_INCLUDE, ESPHOME_WEBSERVER_JS_INCLUDE_SIZE);
 #endif
   response->addHeader(ESPHOME_F("Content-Encoding"), ESPHOME_F("gzip"));
+  add_cache_headers(response, ESPHOME_WEBSERVER_JS_INCLUDE_ETAG, true);
   request->send(response);
 }
 #endif
@@ -828,6 +834,88 @@ static void set_json_icon_state_value(JsonObject &root, EntityBase *obj, const c
   root[ESPHOME_F("state")] = state;
 }
 
+// KAUF: ArduinoJson writer that only hashes its input, used to fingerprint state fields for delta events
+struct FieldHashWriter {
+  uint32_t hash{2166136261UL};
+  size_t write(uint8_t c) {
+    this->hash = (this->hash ^ c) * 16777619UL;
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++)
+      this->write(data[i]);
+    return length;
+  }
+};
+
+// KAUF: serialize a state object, dropping the fields that are unchanged since the last delta for this entity.
+// Only applies while DeferredUpdateEventSourceList fans a state event out as a delta; REST responses, the initial
+// entity listing and regenerated deferred events are always complete. Delta protocol version 1: such events carry
+// the entity index id as "i", deltas drop id/name_id (the longest fields of most events) and only full events keep
+// them so the client can map "i" back to the entity.
+json::SerializationBuffer<> WebServer::serialize_state_(json::JsonBuilder &builder, JsonObject &root, EntityBase *obj,
+                                                        JsonDetail start_config) {
+  if (start_config != DETAIL_STATE || obj != this->delta_source_ || this->delta_snapshots_ == nullptr)
+    return this->serialize_builder_(builder);
+  const int32_t id = this->entity_index_.id_of(obj);
+  if (id < 0)
+    return this->serialize_builder_(builder);
+
+  DeltaSnapshot &snapshot = this->delta_snapshots_[id];
+  // A full event (no snapshot to diff against) also carries id/name_id so the client can learn the short id
+  const bool full = snapshot.count == 0;
+  DeltaSnapshot current{};
+  JsonString unchanged[DELTA_MAX_FIELDS];
+  uint8_t unchanged_count = 0;
+  for (JsonPair kv : root) {
+    const char *key = kv.key().c_str();
+    // The ids are not state, they are replaced by the short id below
+    if (strcmp(key, "id") == 0 || strcmp(key, "name_id") == 0)
+      continue;
+    FieldHashWriter writer;
+    writer.write(reinterpret_cast<const uint8_t *>(key), strlen(key));
+    writer.write(':');
+    serializeJson(kv.value(), writer);
+    // Fields beyond DELTA_MAX_FIELDS are not remembered and therefore always sent
+    if (current.count < DELTA_MAX_FIELDS)
+      current.fields[current.count++] = writer.hash;
+    for (uint8_t i = 0; i < snapshot.count; i++) {
+      if (snapshot.fields[i] == writer.hash) {
+        unchanged[unchanged_count++] = kv.key();
+        break;
+      }
+    }
+  }
+  for (uint8_t i = 0; i < unchanged_count; i++)
+    root.remove(unchanged[i]);
+  if (!full) {
+    root.remove("id");
+    root.remove("name_id");
+  }
+  root[ESPHOME_F("i")] = id;
+  snapshot = current;
+  return this->serialize_builder_(builder);
+}
+
+// KAUF: serialize a finished state object, recording its size for /diagnostics
+json::SerializationBuffer<> WebServer::serialize_builder_(json::JsonBuilder &builder) {
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  auto result = builder.serialize();
+  this->diagnostics_.record_serialization(result.size());
+  return result;
+#else
+  return builder.serialize();
+#endif
+}
+
+void WebServer::invalidate_delta_(const void *source) {
+  if (this->delta_snapshots_ == nullptr)
+    return;
+  const int32_t id = this->entity_index_.id_of(source);
+  if (id >= 0)
+    this->delta_snapshots_[id].count = 0;
+}
+
 // Helper to get request detail parameter
 [[maybe_unused]] static JsonDetail get_request_detail(AsyncWebServerRequest *request) {
   return request->arg(ESPHOME_F("detail")) == "all" ? DETAIL_ALL : DETAIL_STATE;
@@ -837,15 +925,13 @@ static void set_json_icon_state_value(JsonObject &root, EntityBase *obj, const c
 void WebServer::on_sensor_update(sensor::Sensor *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", sensor_state_json_generator);
+  this->send_state_event_(obj, sensor_state_json_generator);
 }
 void WebServer::handle_sensor_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (sensor::Sensor *obj : App.get_sensors()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
+  auto *obj = this->entity_index_.find<sensor::Sensor>(ENTITY_DOMAIN_SENSOR, match);
+  if (obj != nullptr) {
     // Note: request->method() is always HTTP_GET here (canHandle ensures this)
-    if (entity_match.action_is_empty) {
+    if (match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->sensor_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -876,7 +962,7 @@ json::SerializationBuffer<> WebServer::sensor_json_(sensor::Sensor *obj, float v
       root[ESPHOME_F("uom")] = uom_ref.c_str();
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -884,15 +970,13 @@ json::SerializationBuffer<> WebServer::sensor_json_(sensor::Sensor *obj, float v
 void WebServer::on_text_sensor_update(text_sensor::TextSensor *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", text_sensor_state_json_generator);
+  this->send_state_event_(obj, text_sensor_state_json_generator);
 }
 void WebServer::handle_text_sensor_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (text_sensor::TextSensor *obj : App.get_text_sensors()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
+  auto *obj = this->entity_index_.find<text_sensor::TextSensor>(ENTITY_DOMAIN_TEXT_SENSOR, match);
+  if (obj != nullptr) {
     // Note: request->method() is always HTTP_GET here (canHandle ensures this)
-    if (entity_match.action_is_empty) {
+    if (match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->text_sensor_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -919,7 +1003,7 @@ json::SerializationBuffer<> WebServer::text_sensor_json_(text_sensor::TextSensor
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -945,15 +1029,12 @@ static void execute_switch_action(switch_::Switch *obj, SwitchAction action) {
 void WebServer::on_switch_update(switch_::Switch *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", switch_state_json_generator);
+  this->send_state_event_(obj, switch_state_json_generator);
 }
 void WebServer::handle_switch_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (switch_::Switch *obj : App.get_switches()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<switch_::Switch>(ENTITY_DOMAIN_SWITCH, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->switch_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -996,17 +1077,15 @@ json::SerializationBuffer<> WebServer::switch_json_(switch_::Switch *obj, bool v
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
 #ifdef USE_BUTTON
 void WebServer::handle_button_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (button::Button *obj : App.get_buttons()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<button::Button>(ENTITY_DOMAIN_BUTTON, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->button_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1041,15 +1120,13 @@ json::SerializationBuffer<> WebServer::button_json_(button::Button *obj, JsonDet
 void WebServer::on_binary_sensor_update(binary_sensor::BinarySensor *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", binary_sensor_state_json_generator);
+  this->send_state_event_(obj, binary_sensor_state_json_generator);
 }
 void WebServer::handle_binary_sensor_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (binary_sensor::BinarySensor *obj : App.get_binary_sensors()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
+  auto *obj = this->entity_index_.find<binary_sensor::BinarySensor>(ENTITY_DOMAIN_BINARY_SENSOR, match);
+  if (obj != nullptr) {
     // Note: request->method() is always HTTP_GET here (canHandle ensures this)
-    if (entity_match.action_is_empty) {
+    if (match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->binary_sensor_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -1076,7 +1153,7 @@ json::SerializationBuffer<> WebServer::binary_sensor_json_(binary_sensor::Binary
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1084,15 +1161,12 @@ json::SerializationBuffer<> WebServer::binary_sensor_json_(binary_sensor::Binary
 void WebServer::on_fan_update(fan::Fan *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", fan_state_json_generator);
+  this->send_state_event_(obj, fan_state_json_generator);
 }
 void WebServer::handle_fan_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (fan::Fan *obj : App.get_fans()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<fan::Fan>(ENTITY_DOMAIN_FAN, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->fan_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1157,7 +1231,7 @@ json::SerializationBuffer<> WebServer::fan_json_(fan::Fan *obj, JsonDetail start
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1165,15 +1239,12 @@ json::SerializationBuffer<> WebServer::fan_json_(fan::Fan *obj, JsonDetail start
 void WebServer::on_light_update(light::LightState *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", light_state_json_generator);
+  this->send_state_event_(obj, light_state_json_generator);
 }
 void WebServer::handle_light_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (light::LightState *obj : App.get_lights()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<light::LightState>(ENTITY_DOMAIN_LIGHT, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->light_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1254,7 +1325,7 @@ json::SerializationBuffer<> WebServer::light_json_(light::LightState *obj, JsonD
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1262,15 +1333,12 @@ json::SerializationBuffer<> WebServer::light_json_(light::LightState *obj, JsonD
 void WebServer::on_cover_update(cover::Cover *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", cover_state_json_generator);
+  this->send_state_event_(obj, cover_state_json_generator);
 }
 void WebServer::handle_cover_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (cover::Cover *obj : App.get_covers()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<cover::Cover>(ENTITY_DOMAIN_COVER, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->cover_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1343,7 +1411,7 @@ json::SerializationBuffer<> WebServer::cover_json_(cover::Cover *obj, JsonDetail
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1351,15 +1419,12 @@ json::SerializationBuffer<> WebServer::cover_json_(cover::Cover *obj, JsonDetail
 void WebServer::on_number_update(number::Number *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", number_state_json_generator);
+  this->send_state_event_(obj, number_state_json_generator);
 }
 void WebServer::handle_number_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_numbers()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<number::Number>(ENTITY_DOMAIN_NUMBER, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->number_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -1411,7 +1476,7 @@ json::SerializationBuffer<> WebServer::number_json_(number::Number *obj, float v
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1419,14 +1484,12 @@ json::SerializationBuffer<> WebServer::number_json_(number::Number *obj, float v
 void WebServer::on_date_update(datetime::DateEntity *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", date_state_json_generator);
+  this->send_state_event_(obj, date_state_json_generator);
 }
 void WebServer::handle_date_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_dates()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<datetime::DateEntity>(ENTITY_DOMAIN_DATE, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->date_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1472,7 +1535,7 @@ json::SerializationBuffer<> WebServer::date_json_(datetime::DateEntity *obj, Jso
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif  // USE_DATETIME_DATE
 
@@ -1480,14 +1543,12 @@ json::SerializationBuffer<> WebServer::date_json_(datetime::DateEntity *obj, Jso
 void WebServer::on_time_update(datetime::TimeEntity *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", time_state_json_generator);
+  this->send_state_event_(obj, time_state_json_generator);
 }
 void WebServer::handle_time_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_times()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<datetime::TimeEntity>(ENTITY_DOMAIN_TIME, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->time_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1532,7 +1593,7 @@ json::SerializationBuffer<> WebServer::time_json_(datetime::TimeEntity *obj, Jso
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif  // USE_DATETIME_TIME
 
@@ -1540,14 +1601,12 @@ json::SerializationBuffer<> WebServer::time_json_(datetime::TimeEntity *obj, Jso
 void WebServer::on_datetime_update(datetime::DateTimeEntity *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", datetime_state_json_generator);
+  this->send_state_event_(obj, datetime_state_json_generator);
 }
 void WebServer::handle_datetime_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_datetimes()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<datetime::DateTimeEntity>(ENTITY_DOMAIN_DATETIME, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->datetime_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1593,7 +1652,7 @@ json::SerializationBuffer<> WebServer::datetime_json_(datetime::DateTimeEntity *
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif  // USE_DATETIME_DATETIME
 
@@ -1601,15 +1660,12 @@ json::SerializationBuffer<> WebServer::datetime_json_(datetime::DateTimeEntity *
 void WebServer::on_text_update(text::Text *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", text_state_json_generator);
+  this->send_state_event_(obj, text_state_json_generator);
 }
 void WebServer::handle_text_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_texts()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<text::Text>(ENTITY_DOMAIN_TEXT, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->text_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -1652,7 +1708,7 @@ json::SerializationBuffer<> WebServer::text_json_(text::Text *obj, const std::st
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1660,15 +1716,12 @@ json::SerializationBuffer<> WebServer::text_json_(text::Text *obj, const std::st
 void WebServer::on_select_update(select::Select *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", select_state_json_generator);
+  this->send_state_event_(obj, select_state_json_generator);
 }
 void WebServer::handle_select_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_selects()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<select::Select>(ENTITY_DOMAIN_SELECT, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->select_json_(obj, obj->has_state() ? obj->current_option() : StringRef(), detail);
       request->send(200, "application/json", data.c_str());
@@ -1713,7 +1766,7 @@ json::SerializationBuffer<> WebServer::select_json_(select::Select *obj, StringR
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1721,15 +1774,12 @@ json::SerializationBuffer<> WebServer::select_json_(select::Select *obj, StringR
 void WebServer::on_climate_update(climate::Climate *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", climate_state_json_generator);
+  this->send_state_event_(obj, climate_state_json_generator);
 }
 void WebServer::handle_climate_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (auto *obj : App.get_climates()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<climate::Climate>(ENTITY_DOMAIN_CLIMATE, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->climate_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -1882,7 +1932,7 @@ json::SerializationBuffer<> WebServer::climate_json_(climate::Climate *obj, Json
       root[ESPHOME_F("state")] = root[ESPHOME_F("target_temperature")];
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
   // NOLINTEND(clang-analyzer-cplusplus.NewDeleteLeaks)
 }
 #endif
@@ -1909,15 +1959,12 @@ static void execute_lock_action(lock::Lock *obj, LockAction action) {
 void WebServer::on_lock_update(lock::Lock *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", lock_state_json_generator);
+  this->send_state_event_(obj, lock_state_json_generator);
 }
 void WebServer::handle_lock_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (lock::Lock *obj : App.get_locks()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<lock::Lock>(ENTITY_DOMAIN_LOCK, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->lock_json_(obj, obj->state, detail);
       request->send(200, "application/json", data.c_str());
@@ -1960,7 +2007,7 @@ json::SerializationBuffer<> WebServer::lock_json_(lock::Lock *obj, lock::LockSta
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -1968,15 +2015,12 @@ json::SerializationBuffer<> WebServer::lock_json_(lock::Lock *obj, lock::LockSta
 void WebServer::on_valve_update(valve::Valve *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", valve_state_json_generator);
+  this->send_state_event_(obj, valve_state_json_generator);
 }
 void WebServer::handle_valve_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (valve::Valve *obj : App.get_valves()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<valve::Valve>(ENTITY_DOMAIN_VALVE, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->valve_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -2045,7 +2089,7 @@ json::SerializationBuffer<> WebServer::valve_json_(valve::Valve *obj, JsonDetail
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -2053,15 +2097,12 @@ json::SerializationBuffer<> WebServer::valve_json_(valve::Valve *obj, JsonDetail
 void WebServer::on_alarm_control_panel_update(alarm_control_panel::AlarmControlPanel *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", alarm_control_panel_state_json_generator);
+  this->send_state_event_(obj, alarm_control_panel_state_json_generator);
 }
 void WebServer::handle_alarm_control_panel_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (alarm_control_panel::AlarmControlPanel *obj : App.get_alarm_control_panels()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<alarm_control_panel::AlarmControlPanel>(ENTITY_DOMAIN_ALARM_CONTROL_PANEL, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->alarm_control_panel_json_(obj, obj->get_state(), detail);
       request->send(200, "application/json", data.c_str());
@@ -2129,7 +2170,7 @@ json::SerializationBuffer<> WebServer::alarm_control_panel_json_(alarm_control_p
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
@@ -2137,15 +2178,12 @@ json::SerializationBuffer<> WebServer::alarm_control_panel_json_(alarm_control_p
 void WebServer::on_water_heater_update(water_heater::WaterHeater *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", water_heater_state_json_generator);
+  this->send_state_event_(obj, water_heater_state_json_generator);
 }
 void WebServer::handle_water_heater_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (water_heater::WaterHeater *obj : App.get_water_heaters()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<water_heater::WaterHeater>(ENTITY_DOMAIN_WATER_HEATER, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->water_heater_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -2242,21 +2280,18 @@ json::SerializationBuffer<> WebServer::water_heater_json_(water_heater::WaterHea
     root[ESPHOME_F("is_on")] = obj->is_on();
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
 }
 #endif
 
 #ifdef USE_INFRARED
 void WebServer::handle_infrared_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (infrared::Infrared *obj : App.get_infrareds()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<infrared::Infrared>(ENTITY_DOMAIN_INFRARED, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->infrared_json_(obj, detail);
-      request->send(200, ESPHOME_F("application/json"), data.c_str());
+      request->send(200, "application/json", data.c_str());
       return;
     }
     if (!match.method_equals(ESPHOME_F("transmit"))) {
@@ -2341,15 +2376,12 @@ json::SerializationBuffer<> WebServer::infrared_json_(infrared::Infrared *obj, J
 
 #ifdef USE_RADIO_FREQUENCY
 void WebServer::handle_radio_frequency_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (radio_frequency::RadioFrequency *obj : App.get_radio_frequencies()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<radio_frequency::RadioFrequency>(ENTITY_DOMAIN_RADIO_FREQUENCY, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->radio_frequency_json_(obj, detail);
-      request->send(200, ESPHOME_F("application/json"), data.c_str());
+      request->send(200, "application/json", data.c_str());
       return;
     }
     if (!match.method_equals(ESPHOME_F("transmit"))) {
@@ -2441,17 +2473,14 @@ json::SerializationBuffer<> WebServer::radio_frequency_json_(radio_frequency::Ra
 void WebServer::on_event(event::Event *obj) {
   if (!this->include_internal_ && obj->is_internal())
     return;
-  this->events_.deferrable_send_state(obj, "state", event_state_json_generator);
+  this->send_state_event_(obj, event_state_json_generator);
 }
 
 void WebServer::handle_event_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (event::Event *obj : App.get_events()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
+  auto *obj = this->entity_index_.find<event::Event>(ENTITY_DOMAIN_EVENT, match);
+  if (obj != nullptr) {
     // Note: request->method() is always HTTP_GET here (canHandle ensures this)
-    if (entity_match.action_is_empty) {
+    if (match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->event_json_(obj, StringRef(), detail);
       request->send(200, "application/json", data.c_str());
@@ -2497,15 +2526,12 @@ json::SerializationBuffer<> WebServer::event_json_(event::Event *obj, StringRef
 
 #ifdef USE_UPDATE
 void WebServer::on_update(update::UpdateEntity *obj) {
-  this->events_.deferrable_send_state(obj, "state", update_state_json_generator);
+  this->send_state_event_(obj, update_state_json_generator);
 }
 void WebServer::handle_update_request(AsyncWebServerRequest *request, const UrlMatch &match) {
-  for (update::UpdateEntity *obj : App.get_updates()) {
-    auto entity_match = match.match_entity(obj);
-    if (!entity_match.matched)
-      continue;
-
-    if (request->method() == HTTP_GET && entity_match.action_is_empty) {
+  auto *obj = this->entity_index_.find<update::UpdateEntity>(ENTITY_DOMAIN_UPDATE, match);
+  if (obj != nullptr) {
+    if (request->method() == HTTP_GET && match.method.empty()) {
       auto detail = get_request_detail(request);
       auto data = this->update_json_(obj, detail);
       request->send(200, "application/json", data.c_str());
@@ -2552,11 +2578,115 @@ json::SerializationBuffer<> WebServer::update_json_(update::UpdateEntity *obj, J
     this->add_sorting_info_(root, obj);
   }
 
-  return builder.serialize();
+  return this->serialize_state_(builder, root, obj, start_config);
   // NOLINTEND(clang-analyzer-cplusplus.NewDeleteLeaks)
 }
 #endif
 
+#if defined(USE_WEBSERVER_METRICS) || defined(USE_WEBSERVER_DIAGNOSTICS)
+// KAUF: free heap in bytes, or 0 where the platform has no cheap way to ask
+static uint32_t free_heap_bytes() {
+#if defined(USE_ESP8266)
+  return ESP.getFreeHeap();
+#elif defined(USE_ESP32)
+  return esp_get_free_heap_size();
+#elif defined(USE_LIBRETINY)
+  return lt_heap_get_free();
+#elif defined(USE_RP2040)
+  return rp2040.getFreeHeap();
+#else
+  return 0;
+#endif
+}
+#endif
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+constexpr uint32_t WebServerDiagnostics::BUCKET_BOUNDS_US[];
+
+void WebServerDiagnostics::record_request(RouteClass route, uint32_t duration_us, uint32_t heap_before,
+                                          uint32_t heap_after) {
+  Route &r = this->routes_[route];
+  uint8_t bucket = 0;
+  while (bucket < BUCKET_COUNT - 1 && duration_us > BUCKET_BOUNDS_US[bucket])
+    bucket++;
+  r.buckets[bucket]++;
+  r.count++;
+  r.total_us += duration_us;
+  store_max(r.max_us, duration_us);
+  store_max(this->recent_max_us_, duration_us);
+
+  if (heap_after != 0) {
+    store_min(this->heap_min_free_, std::min(heap_before, heap_after));
+    if (heap_before > heap_after)
+      store_max(this->heap_max_drop_, heap_before - heap_after);
+  }
+}
+
+void WebServerDiagnostics::record_serialization(size_t bytes) {
+  this->serializations_++;
+  this->serialized_bytes_ += bytes;
+  store_max(this->serialized_max_, static_cast<uint32_t>(bytes));
+}
+
+void WebServerDiagnostics::write_json(JsonObject root) const {
+  static const char *const ROUTE_NAMES[ROUTE_COUNT] = {"index", "asset",     "events", "state",
+                                                       "get",   "post",      "batch",  "other"};
+  JsonArray bounds = root[ESPHOME_F("bucket_bounds_us")].to<JsonArray>();
+  for (uint32_t bound : BUCKET_BOUNDS_US)
+    bounds.add(bound);
+
+  JsonObject routes = root[ESPHOME_F("routes")].to<JsonObject>();
+  for (uint8_t i = 0; i < ROUTE_COUNT; i++) {
+    const Route &r = this->routes_[i];
+    const uint32_t count = r.count;
+    if (count == 0)
+      continue;
+    JsonObject route = routes[ROUTE_NAMES[i]].to<JsonObject>();
+    route[ESPHOME_F("count")] = count;
+    route[ESPHOME_F("avg_us")] = static_cast<uint32_t>(static_cast<uint64_t>(r.total_us) / count);
+    route[ESPHOME_F("max_us")] = static_cast<uint32_t>(r.max_us);
+    JsonArray buckets = route[ESPHOME_F("buckets")].to<JsonArray>();
+    for (uint32_t bucket : r.buckets)
+      buckets.add(bucket);
+  }
+
+  JsonObject serialization = root[ESPHOME_F("serialization")].to<JsonObject>();
+  serialization[ESPHOME_F("count")] = static_cast<uint32_t>(this->serializations_);
+  serialization[ESPHOME_F("bytes")] = static_cast<uint64_t>(this->serialized_bytes_);
+  serialization[ESPHOME_F("max_bytes")] = static_cast<uint32_t>(this->serialized_max_);
+
+  JsonObject heap = root[ESPHOME_F("heap")].to<JsonObject>();
+  heap[ESPHOME_F("free")] = free_heap_bytes();
+  const uint32_t heap_min_free = this->heap_min_free_;
+  if (heap_min_free != UINT32_MAX)
+    heap[ESPHOME_F("min_free_during_request")] = heap_min_free;
+  heap[ESPHOME_F("max_request_drop")] = static_cast<uint32_t>(this->heap_max_drop_);
+
+  JsonObject sse = root[ESPHOME_F("sse")].to<JsonObject>();
+  sse[ESPHOME_F("queue_max")] = static_cast<uint16_t>(this->sse_queue_max_);
+  sse[ESPHOME_F("discarded")] = static_cast<uint32_t>(this->sse_discarded_);
+  sse[ESPHOME_F("dropped")] = static_cast<uint32_t>(this->sse_dropped_);
+}
+
+// KAUF: route class of a request, mirrors the dispatch order in handle_request_()
+static WebServerDiagnostics::RouteClass classify_route(const char *url, size_t len, bool is_post) {
+  const StringRef path(url, len);
+  if (path == "/")
+    return WebServerDiagnostics::ROUTE_INDEX;
+  if (path == "/0.css" || path == "/0.js")
+    return WebServerDiagnostics::ROUTE_ASSET;
+  if (path == "/events")
+    return WebServerDiagnostics::ROUTE_EVENTS;
+  if (path == "/state" || path == "/states")
+    return WebServerDiagnostics::ROUTE_STATE;
+  if (path == "/batch")
+    return WebServerDiagnostics::ROUTE_BATCH;
+  if (match_url(url, len, true).valid)
+    return is_post ? WebServerDiagnostics::ROUTE_ENTITY_POST : WebServerDiagnostics::ROUTE_ENTITY_GET;
+  return WebServerDiagnostics::ROUTE_OTHER;
+}
+#endif
+
 bool WebServer::canHandle(AsyncWebServerRequest *request) const {
 #ifdef USE_ESP32
   char url_buf[AsyncWebServerRequest::URL_BUF_SIZE];
@@ -2585,6 +2715,16 @@ bool WebServer::canHandle(AsyncWebServerRequest *request) const {
     return true;
   if (url == ESPHOME_F("/wifisave"))
     return true;
+  if (url == ESPHOME_F("/batch") && method == HTTP_POST)
+    return true;
+#ifdef USE_WEBSERVER_METRICS
+  if (url == ESPHOME_F("/metrics") && method == HTTP_GET)
+    return true;
+#endif
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  if (url == ESPHOME_F("/diagnostics") && method == HTTP_GET)
+    return true;
+#endif
 
 #ifdef USE_WEBSERVER_CSS_INCLUDE
   if (url == ESPHOME_F("/0.css"))
@@ -2716,6 +2856,25 @@ bool WebServer::canHandle(AsyncWebServerRequest *request) const {
   return false;
 }
 void WebServer::handleRequest(AsyncWebServerRequest *request) {
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  // KAUF: time and heap around the whole route
+  const uint32_t start = micros();
+  const uint32_t heap_before = free_heap_bytes();
+#ifdef USE_ESP32
+  char url_buf[AsyncWebServerRequest::URL_BUF_SIZE];
+  StringRef url = request->url_to(url_buf);
+#else
+  const auto &url = request->url();
+#endif
+  const auto route = classify_route(url.c_str(), url.length(), request->method() == HTTP_POST);
+  this->handle_request_(request);
+  this->diagnostics_.record_request(route, micros() - start, heap_before, free_heap_bytes());
+#else
+  this->handle_request_(request);
+#endif
+}
+
+void WebServer::handle_request_(AsyncWebServerRequest *request) {
 #ifdef USE_ESP32
   char url_buf[AsyncWebServerRequest::URL_BUF_SIZE];
   StringRef url = request->url_to(url_buf);
@@ -2746,6 +2905,25 @@ void WebServer::handleRequest(AsyncWebServerRequest *request) {
     return;
   }
 
+  if (url == ESPHOME_F("/batch")) {
+    this->handle_batch_request(request);
+    return;
+  }
+
+#ifdef USE_WEBSERVER_METRICS
+  if (url == ESPHOME_F("/metrics")) {
+    this->handle_metrics_request(request);
+    return;
+  }
+#endif
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  if (url == ESPHOME_F("/diagnostics")) {
+    this->handle_diagnostics_request(request);
+    return;
+  }
+#endif
+
   if (url == "/reset") {
     this->reset_flash(request);
     return;
@@ -3011,396 +3189,1270 @@ void WebServer::save_wifi(AsyncWebServerRequest *request) {
 #endif
 }
 
-// KAUF: add function to dump out all JSON at /state
-void WebServer::handle_state_request(AsyncWebServerRequest *request) {
-  if (request->method() != HTTP_GET) {
+// KAUF: batch command parameters may be JSON numbers/bools or strings, like the REST query parameters
+static optional<float> batch_number(JsonObjectConst cmd, const char *key) {
+  JsonVariantConst value = cmd[key];
+  if (value.is<float>())
+    return value.as<float>();
+  if (value.is<const char *>())
+    return parse_number<float>(value.as<const char *>());
+  return {};
+}
+
+static ParseOnOffState batch_on_off(JsonObjectConst cmd, const char *key) {
+  JsonVariantConst value = cmd[key];
+  if (value.is<bool>())
+    return value.as<bool>() ? PARSE_ON : PARSE_OFF;
+  if (value.is<const char *>())
+    return parse_on_off(value.as<const char *>());
+  return PARSE_NONE;
+}
+
+// KAUF: apply several entity commands from one request, see handle_batch_request() in web_server.h
+void WebServer::handle_batch_request(AsyncWebServerRequest *request) {
+  if (request->method() != HTTP_POST) {
     request->send(405, ESPHOME_F("text/plain"), ESPHOME_F("Method Not Allowed"));
     return;
   }
 
-  bool wrap_entities = false;
-#ifdef USE_ESP32
-  char url_buf[AsyncWebServerRequest::URL_BUF_SIZE];
-  wrap_entities = request->url_to(url_buf) == "/state";
-#else
-  wrap_entities = request->url() == ESPHOME_F("/state");
-#endif
-  AsyncResponseStream *stream = request->beginResponseStream(ESPHOME_F("application/json"));
-  if (wrap_entities) {
-    stream->print(ESPHOME_F("{\"entities\":["));
-  } else {
-    stream->print('[');
+  const auto &commands = request->arg(ESPHOME_F("commands"));
+  std::vector<std::function<void()>> actions;
+  json::JsonBuilder builder;
+  JsonObject root = builder.root();
+  JsonArray results = root[ESPHOME_F("results")].to<JsonArray>();
+  const char *error = this->parse_batch_(commands.c_str(), commands.length(), results, actions);
+  if (error != nullptr) {
+    request->send(400, ESPHOME_F("text/plain"), error);
+    return;
   }
 
-  bool wrote_entity = false;
-  EntityBase *featured_entity = nullptr;
-  const std::string featured_name = this->featured_name_.empty()
-                                        ? (App.get_friendly_name().empty() ? App.get_name() : App.get_friendly_name())
-                                        : this->featured_name_;
+  if (!actions.empty()) {
+    this->defer([actions = std::move(actions)]() {
+      for (const auto &action : actions)
+        action();
+    });
+  }
 
-  auto write_json = [&](EntityBase *obj, const std::string &json) {
-    if (!this->include_internal_ && obj->is_internal())
-      return;
-    if (wrote_entity)
-      stream->print(',');
-    stream->print(json.c_str());
-    wrote_entity = true;
-  };
+  auto data = builder.serialize();
+  request->send(200, "application/json", data.c_str());
+}
 
-  auto try_write_featured = [&](EntityBase *obj, const std::string &json) -> bool {
-    if (featured_entity != nullptr || featured_name.empty() || obj->get_name() != featured_name)
-      return false;
-    if (!this->include_internal_ && obj->is_internal())
-      return false;
-    if (wrote_entity)
-      stream->print(',');
-    stream->print(json.c_str());
-    wrote_entity = true;
-    featured_entity = obj;
-    return true;
-  };
+const char *WebServer::parse_batch_(const char *data, size_t len, JsonArray results,
+                                    std::vector<std::function<void()>> &actions) {
+  JsonDocument doc;
+  if (deserializeJson(doc, data, len) != DeserializationError::Ok || !doc.is<JsonArrayConst>())
+    return "commands must be a JSON array";
+  JsonArrayConst items = doc.as<JsonArrayConst>();
+  if (items.size() > BATCH_MAX_COMMANDS)
+    return "too many commands";
 
-#ifdef USE_SENSOR
-  for (sensor::Sensor *obj : App.get_sensors()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->sensor_json_(obj, obj->state, DETAIL_ALL)))
-        break;
-    }
+  actions.reserve(items.size());
+  for (JsonVariantConst item : items) {
+    JsonObjectConst cmd = item.as<JsonObjectConst>();
+    const char *path = cmd["path"] | "";
+    JsonObject result = results.add<JsonObject>();
+    result[ESPHOME_F("path")] = path;
+
+    // Commands always carry an action, so parse the path like a POST url
+    const char *error = "invalid path";
+    UrlMatch match = match_url(path, strlen(path), false, true);
+    if (match.valid && !match.method.empty())
+      error = this->prepare_batch_command_(match, cmd, actions);
+
+    result[ESPHOME_F("ok")] = error == nullptr;
+    if (error != nullptr)
+      result[ESPHOME_F("error")] = error;
   }
-#endif
+
+  ESP_LOGD(TAG, "Batch: %zu of %zu commands valid", actions.size(), items.size());
+  return nullptr;
+}
+
+const char *WebServer::prepare_batch_command_(const UrlMatch &match, JsonObjectConst cmd,
+                                              std::vector<std::function<void()>> &actions) {
+  static const char *const NOT_FOUND = "entity not found";
+  static const char *const UNKNOWN_ACTION = "unknown action";
+  static const char *const UNSUPPORTED_PARAM = "unsupported parameter";
+
 #ifdef USE_SWITCH
-  for (switch_::Switch *obj : App.get_switches()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->switch_json_(obj, obj->state, DETAIL_ALL)))
-        break;
+  if (match.domain_equals(ESPHOME_F("switch"))) {
+    auto *obj = this->entity_index_.find<switch_::Switch>(ENTITY_DOMAIN_SWITCH, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    SwitchAction action = SWITCH_ACTION_NONE;
+    if (match.method_equals(ESPHOME_F("toggle"))) {
+      action = SWITCH_ACTION_TOGGLE;
+    } else if (match.method_equals(ESPHOME_F("turn_on"))) {
+      action = SWITCH_ACTION_TURN_ON;
+    } else if (match.method_equals(ESPHOME_F("turn_off"))) {
+      action = SWITCH_ACTION_TURN_OFF;
     }
+    if (action == SWITCH_ACTION_NONE)
+      return UNKNOWN_ACTION;
+    actions.emplace_back([obj, action]() { execute_switch_action(obj, action); });
+    return nullptr;
   }
 #endif
 #ifdef USE_BUTTON
-  for (button::Button *obj : App.get_buttons()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->button_json_(obj, DETAIL_ALL)))
-        break;
-    }
+  if (match.domain_equals(ESPHOME_F("button"))) {
+    auto *obj = this->entity_index_.find<button::Button>(ENTITY_DOMAIN_BUTTON, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    if (!match.method_equals(ESPHOME_F("press")))
+      return UNKNOWN_ACTION;
+    actions.emplace_back([obj]() { obj->press(); });
+    return nullptr;
   }
 #endif
-#ifdef USE_BINARY_SENSOR
-  for (binary_sensor::BinarySensor *obj : App.get_binary_sensors()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->binary_sensor_json_(obj, obj->state, DETAIL_ALL)))
-        break;
+#ifdef USE_LIGHT
+  if (match.domain_equals(ESPHOME_F("light"))) {
+    auto *obj = this->entity_index_.find<light::LightState>(ENTITY_DOMAIN_LIGHT, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    if (match.method_equals(ESPHOME_F("toggle"))) {
+      actions.emplace_back([obj]() { obj->toggle().perform(); });
+      return nullptr;
+    }
+    bool is_on = match.method_equals(ESPHOME_F("turn_on"));
+    bool is_off = match.method_equals(ESPHOME_F("turn_off"));
+    if (!is_on && !is_off)
+      return UNKNOWN_ACTION;
+    auto call = is_on ? obj->turn_on() : obj->turn_off();
+
+    // Same parameters and scaling as handle_light_request()
+    auto apply = [&cmd, &call](const char *key, light::LightCall &(light::LightCall::*setter)(float), float scale) {
+      auto value = batch_number(cmd, key);
+      if (value.has_value())
+        (call.*setter)(*value / scale);
+    };
+    auto apply_ms = [&cmd, &call](const char *key, light::LightCall &(light::LightCall::*setter)(uint32_t)) {
+      auto value = batch_number(cmd, key);
+      if (value.has_value())
+        (call.*setter)(static_cast<uint32_t>(*value * 1000.0f));
+    };
+    if (is_on) {
+      const char *color_mode = cmd["color_mode"];
+      const char *effect = cmd["effect"];
+      const char *error = check_light_mode_effect_(obj, color_mode, effect);
+      if (error != nullptr)
+        return error;
+      light::ColorMode mode = light::ColorMode::UNKNOWN;
+      if (color_mode != nullptr && parse_color_mode_string_(color_mode, mode))
+        call.set_color_mode_if_supported(mode);
+      apply("brightness", &light::LightCall::set_brightness, 255.0f);
+      apply("r", &light::LightCall::set_red, 255.0f);
+      apply("g", &light::LightCall::set_green, 255.0f);
+      apply("b", &light::LightCall::set_blue, 255.0f);
+      apply("white_value", &light::LightCall::set_white, 255.0f);
+      apply("color_temp", &light::LightCall::set_color_temperature, 1.0f);
+      apply_ms("flash", &light::LightCall::set_flash_length);
+      if (effect != nullptr)
+        call.set_effect(effect, strlen(effect));
     }
+    apply_ms("transition", &light::LightCall::set_transition_length);
+    actions.emplace_back([call]() mutable { call.perform(); });
+    return nullptr;
   }
 #endif
 #ifdef USE_FAN
-  for (fan::Fan *obj : App.get_fans()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->fan_json_(obj, DETAIL_ALL)))
-        break;
+  if (match.domain_equals(ESPHOME_F("fan"))) {
+    auto *obj = this->entity_index_.find<fan::Fan>(ENTITY_DOMAIN_FAN, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    if (match.method_equals(ESPHOME_F("toggle"))) {
+      actions.emplace_back([obj]() { obj->toggle().perform(); });
+      return nullptr;
+    }
+    bool is_on = match.method_equals(ESPHOME_F("turn_on"));
+    bool is_off = match.method_equals(ESPHOME_F("turn_off"));
+    if (!is_on && !is_off)
+      return UNKNOWN_ACTION;
+    auto call = is_on ? obj->turn_on() : obj->turn_off();
+    auto speed = batch_number(cmd, "speed_level");
+    if (speed.has_value())
+      call.set_speed(static_cast<int>(*speed));
+    if (!cmd["oscillation"].isNull()) {
+      switch (batch_on_off(cmd, "oscillation")) {
+        case PARSE_ON:
+          call.set_oscillating(true);
+          break;
+        case PARSE_OFF:
+          call.set_oscillating(false);
+          break;
+        case PARSE_TOGGLE:
+          call.set_oscillating(!obj->oscillating);
+          break;
+        case PARSE_NONE:
+          return UNSUPPORTED_PARAM;
+      }
     }
+    actions.emplace_back([call]() mutable { call.perform(); });
+    return nullptr;
   }
 #endif
-#ifdef USE_LIGHT
-  for (light::LightState *obj : App.get_lights()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->light_json_(obj, DETAIL_ALL)))
-        break;
+#ifdef USE_COVER
+  if (match.domain_equals(ESPHOME_F("cover"))) {
+    auto *obj = this->entity_index_.find<cover::Cover>(ENTITY_DOMAIN_COVER, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    auto call = obj->make_call();
+    if (match.method_equals(ESPHOME_F("open"))) {
+      call.set_command_open();
+    } else if (match.method_equals(ESPHOME_F("close"))) {
+      call.set_command_close();
+    } else if (match.method_equals(ESPHOME_F("stop"))) {
+      call.set_command_stop();
+    } else if (match.method_equals(ESPHOME_F("toggle"))) {
+      call.set_command_toggle();
+    } else if (!match.method_equals(ESPHOME_F("set"))) {
+      return UNKNOWN_ACTION;
     }
+    auto traits = obj->get_traits();
+    auto position = batch_number(cmd, "position");
+    auto tilt = batch_number(cmd, "tilt");
+    if ((position.has_value() && !traits.get_supports_position()) || (tilt.has_value() && !traits.get_supports_tilt()))
+      return UNSUPPORTED_PARAM;
+    if (position.has_value())
+      call.set_position(*position);
+    if (tilt.has_value())
+      call.set_tilt(*tilt);
+    actions.emplace_back([call]() mutable { call.perform(); });
+    return nullptr;
   }
 #endif
-#ifdef USE_TEXT_SENSOR
-  for (text_sensor::TextSensor *obj : App.get_text_sensors()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->text_sensor_json_(obj, obj->state, DETAIL_ALL)))
-        break;
-    }
+#ifdef USE_NUMBER
+  if (match.domain_equals(ESPHOME_F("number"))) {
+    auto *obj = this->entity_index_.find<number::Number>(ENTITY_DOMAIN_NUMBER, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    if (!match.method_equals(ESPHOME_F("set")))
+      return UNKNOWN_ACTION;
+    auto value = batch_number(cmd, "value");
+    if (!value.has_value())
+      return UNSUPPORTED_PARAM;
+    auto call = obj->make_call();
+    call.set_value(*value);
+    actions.emplace_back([call]() mutable { call.perform(); });
+    return nullptr;
   }
 #endif
-#ifdef USE_COVER
-  for (cover::Cover *obj : App.get_covers()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->cover_json_(obj, DETAIL_ALL)))
-        break;
-    }
+#ifdef USE_SELECT
+  if (match.domain_equals(ESPHOME_F("select"))) {
+    auto *obj = this->entity_index_.find<select::Select>(ENTITY_DOMAIN_SELECT, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    if (!match.method_equals(ESPHOME_F("set")))
+      return UNKNOWN_ACTION;
+    const char *option = cmd["option"];
+    if (option == nullptr)
+      return UNSUPPORTED_PARAM;
+    auto call = obj->make_call();
+    call.set_option(option, strlen(option));
+    actions.emplace_back([call]() mutable { call.perform(); });
+    return nullptr;
   }
 #endif
-#ifdef USE_NUMBER
-  for (number::Number *obj : App.get_numbers()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->number_json_(obj, obj->state, DETAIL_ALL)))
-        break;
+#ifdef USE_LOCK
+  if (match.domain_equals(ESPHOME_F("lock"))) {
+    auto *obj = this->entity_index_.find<lock::Lock>(ENTITY_DOMAIN_LOCK, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    LockAction action = LOCK_ACTION_NONE;
+    if (match.method_equals(ESPHOME_F("lock"))) {
+      action = LOCK_ACTION_LOCK;
+    } else if (match.method_equals(ESPHOME_F("unlock"))) {
+      action = LOCK_ACTION_UNLOCK;
+    } else if (match.method_equals(ESPHOME_F("open"))) {
+      action = LOCK_ACTION_OPEN;
     }
+    if (action == LOCK_ACTION_NONE)
+      return UNKNOWN_ACTION;
+    actions.emplace_back([obj, action]() { execute_lock_action(obj, action); });
+    return nullptr;
   }
 #endif
-#ifdef USE_DATETIME_DATE
-  for (datetime::DateEntity *obj : App.get_dates()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->date_json_(obj, DETAIL_ALL)))
-        break;
+#ifdef USE_VALVE
+  if (match.domain_equals(ESPHOME_F("valve"))) {
+    auto *obj = this->entity_index_.find<valve::Valve>(ENTITY_DOMAIN_VALVE, match);
+    if (obj == nullptr)
+      return NOT_FOUND;
+    auto call = obj->make_call();
+    if (match.method_equals(ESPHOME_F("open"))) {
+      call.set_command_open();
+    } else if (match.method_equals(ESPHOME_F("close"))) {
+      call.set_command_close();
+    } else if (match.method_equals(ESPHOME_F("stop"))) {
+      call.set_command_stop();
+    } else if (match.method_equals(ESPHOME_F("toggle"))) {
+      call.set_command_toggle();
+    } else if (!match.method_equals(ESPHOME_F("set"))) {
+      return UNKNOWN_ACTION;
     }
+    auto position = batch_number(cmd, "position");
+    if (position.has_value() && !obj->get_traits().get_supports_position())
+      return UNSUPPORTED_PARAM;
+    if (position.has_value())
+      call.set_position(*position);
+    actions.emplace_back([call]() mutable { call.perform(); });
+    return nullptr;
   }
 #endif
-#ifdef USE_DATETIME_TIME
-  for (datetime::TimeEntity *obj : App.get_times()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->time_json_(obj, DETAIL_ALL)))
-        break;
+  return "unsupported domain";
+}
+
+void WebServer::send_state_event_(EntityBase *obj, state_generator_t *generator) {
+  this->events_.deferrable_send_state(obj, "state", generator);
+#ifdef USE_WEBSERVER_WEBSOCKET
+  this->ws_send_state_(obj, generator);
+#endif
+}
+
+#ifdef USE_WEBSERVER_WEBSOCKET
+// KAUF: URL domain of each EntityDomain, in enum order
+static const char *const ENTITY_DOMAIN_NAMES[] = {
+    "sensor",  "switch", "button", "binary_sensor",       "fan",          "light",    "text_sensor",
+    "cover",   "number", "date",   "time",                "datetime",     "text",     "select",
+    "climate", "lock",   "valve",  "alarm_control_panel", "water_heater", "infrared", "radio_frequency",
+    "event",   "update",
+};
+static_assert(sizeof(ENTITY_DOMAIN_NAMES) / sizeof(ENTITY_DOMAIN_NAMES[0]) == ENTITY_DOMAIN_UPDATE + 1,
+              "ENTITY_DOMAIN_NAMES must list every EntityDomain");
+
+void WebServer::on_ws_event_(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data,
+                             size_t len) {
+  // Runs in the async server context; everything that touches entities or ws_clients_ is deferred to the main loop
+  const uint32_t id = client->id();
+  switch (type) {
+    case WS_EVT_CONNECT:
+      this->defer([this, id]() { this->ws_clients_.push_back({id, false, false, 0}); });
+      this->enable_loop_soon_any_context();
+      break;
+    case WS_EVT_DISCONNECT:
+      this->defer([this, id]() {
+        auto it = std::find_if(this->ws_clients_.begin(), this->ws_clients_.end(),
+                               [id](const WsClient &c) { return c.id == id; });
+        if (it != this->ws_clients_.end())
+          this->ws_clients_.erase(it);
+      });
+      break;
+    case WS_EVT_DATA: {
+      // Commands are small, fragmented messages are not supported
+      auto *info = static_cast<AwsFrameInfo *>(arg);
+      if (!info->final || info->index != 0 || info->len != len || len == 0 || len > WS_MAX_MESSAGE)
+        return;
+      const bool binary = info->opcode == WS_BINARY;
+      std::string message(reinterpret_cast<const char *>(data), len);
+      this->defer([this, id, binary, message = std::move(message)]() { this->on_ws_message_(id, binary, message); });
+      break;
     }
+    default:
+      break;
   }
-#endif
-#ifdef USE_DATETIME_DATETIME
-  for (datetime::DateTimeEntity *obj : App.get_datetimes()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->datetime_json_(obj, DETAIL_ALL)))
-        break;
+}
+
+void WebServer::on_ws_message_(uint32_t client_id, bool binary, const std::string &message) {
+  AsyncWebSocketClient *client = this->ws_.client(client_id);
+  if (client == nullptr)
+    return;
+
+  if (binary) {
+    const auto *data = reinterpret_cast<const uint8_t *>(message.data());
+    if (data[0] == WS_OP_HELLO) {
+      this->ws_send_entity_map_(client);
+      // KAUF: the states follow the id map, in binary from the start
+      for (auto &entry : this->ws_clients_) {
+        if (entry.id == client_id) {
+          entry.binary = true;
+          entry.resync = false;
+          entry.sync_next = 0;
+        }
+      }
+      return;
+    }
+    uint8_t reply[4] = {WS_OP_RESULT, 0, 0, WS_STATUS_MALFORMED};
+    if (data[0] == WS_OP_COMMAND && message.size() >= 4) {
+      reply[1] = data[1];
+      reply[2] = data[2];
+      reply[3] = this->ws_binary_command_(data, message.size());
     }
+    client->binary(reply, sizeof(reply));
+    return;
   }
+
+  // Text frames are batch commands; this already runs in the main loop, so the actions run right away
+  std::vector<std::function<void()>> actions;
+  json::JsonBuilder builder;
+  JsonObject root = builder.root();
+  JsonArray results = root[ESPHOME_F("results")].to<JsonArray>();
+  const char *error = this->parse_batch_(message.c_str(), message.size(), results, actions);
+  if (error != nullptr)
+    root[ESPHOME_F("error")] = error;
+  for (const auto &action : actions)
+    action();
+  auto reply = builder.serialize();
+  client->text(reply.c_str());
+}
+
+void WebServer::ws_send_entity_map_(AsyncWebSocketClient *client) {
+  json::JsonBuilder builder;
+  JsonObject root = builder.root();
+  JsonArray entities = root[ESPHOME_F("entities")].to<JsonArray>();
+  std::string name_id;
+  for (uint16_t sid = 0; sid < this->entity_index_.entity_count(); sid++) {
+    const auto &entry = this->entity_index_.entry(sid);
+    if (!this->include_internal_ && entry.entity->is_internal())
+      continue;
+    // Same {domain}/{device?}/{name} as the name_id of the JSON state events
+    name_id = ENTITY_DOMAIN_NAMES[entry.domain];
+    name_id += '/';
+#ifdef USE_DEVICES
+    if (entry.entity->get_device() != nullptr) {
+      name_id += entry.entity->get_device()->get_name();
+      name_id += '/';
+    }
 #endif
-#ifdef USE_TEXT
-  for (text::Text *obj : App.get_texts()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->text_json_(obj, obj->state, DETAIL_ALL)))
-        break;
+    const StringRef &name = entry.entity->get_name();
+    name_id.append(name.c_str(), name.size());
+    JsonObject item = entities.add<JsonObject>();
+    item[ESPHOME_F("sid")] = sid;
+    item[ESPHOME_F("name_id")] = name_id;
+  }
+  auto message = builder.serialize();
+  client->text(message.c_str());
+}
+
+void WebServer::ws_send_state_(EntityBase *obj, state_generator_t *generator) {
+  if (this->ws_clients_.empty())
+    return;
+
+  // Like the SSE list, encode once per format for all clients. A client whose send queue is full misses this
+  // update and is brought up to date by a full snapshot from ws_sync_clients_().
+  const int32_t sid = this->entity_index_.id_of(obj);
+  bool want_json = false;
+  bool want_binary = false;
+  for (auto &entry : this->ws_clients_) {
+    AsyncWebSocketClient *client = this->ws_.client(entry.id);
+    if (client == nullptr)
+      continue;
+    if (client->canSend()) {
+      (entry.binary ? want_binary : want_json) = true;
+    } else if (entry.sync_next == WS_SYNC_DONE) {
+      entry.sync_next = 0;
+    } else if (sid < 0 || sid < entry.sync_next) {
+      entry.resync = true;  // the running snapshot already passed this entity
     }
   }
-#endif
-#ifdef USE_SELECT
-  for (select::Select *obj : App.get_selects()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      StringRef value = obj->has_state() ? obj->current_option() : StringRef();
-      if (try_write_featured(obj, this->select_json_(obj, value, DETAIL_ALL)))
-        break;
+
+  if (want_json) {
+    auto message = generator(this, obj);
+    for (const auto &entry : this->ws_clients_) {
+      AsyncWebSocketClient *client = this->ws_.client(entry.id);
+      if (!entry.binary && client != nullptr && client->canSend())
+        client->text(message.c_str());
     }
   }
-#endif
-#ifdef USE_CLIMATE
-  for (climate::Climate *obj : App.get_climates()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->climate_json_(obj, DETAIL_ALL)))
-        break;
+
+  if (want_binary && sid >= 0) {
+    uint8_t buf[WS_MAX_STATE_FRAME];
+    const size_t len = this->ws_encode_state_(sid, buf);
+    for (const auto &entry : this->ws_clients_) {
+      AsyncWebSocketClient *client = this->ws_.client(entry.id);
+      if (entry.binary && client != nullptr && client->canSend())
+        client->binary(buf, len);
     }
   }
-#endif
-#ifdef USE_LOCK
-  for (lock::Lock *obj : App.get_locks()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->lock_json_(obj, obj->state, DETAIL_ALL)))
-        break;
+}
+
+// KAUF: continue the state snapshots of clients that connected, sent HELLO or missed an update, as far as their send
+// queues take them. The library closes a client whose queue overflows, so nothing is sent past canSend().
+void WebServer::ws_sync_clients_() {
+  const uint16_t count = this->entity_index_.entity_count();
+  std::string json;
+  uint8_t buf[WS_MAX_STATE_FRAME];
+  for (auto &entry : this->ws_clients_) {
+    if (entry.sync_next == WS_SYNC_DONE)
+      continue;
+    AsyncWebSocketClient *client = this->ws_.client(entry.id);
+    if (client == nullptr)
+      continue;
+    while (entry.sync_next < count && client->canSend()) {
+      const uint16_t sid = entry.sync_next++;
+      const auto &item = this->entity_index_.entry(sid);
+      if (!this->include_internal_ && item.entity->is_internal())
+        continue;
+      if (entry.binary) {
+        client->binary(buf, this->ws_encode_state_(sid, buf));
+      } else {
+        // JSON clients get the DETAIL_ALL state, like /state
+        json.clear();
+        if (this->entity_state_json_(item.entity, item.domain, json))
+          client->text(json.c_str());
+      }
+    }
+    if (entry.sync_next >= count) {
+      entry.sync_next = entry.resync ? 0 : WS_SYNC_DONE;
+      entry.resync = false;
     }
   }
+}
+
+size_t WebServer::ws_encode_state_(uint16_t sid, uint8_t *buf) {
+  buf[0] = WS_OP_STATE;
+  buf[1] = sid & 0xFF;
+  buf[2] = sid >> 8;
+  auto put_bool = [buf](bool value) -> size_t {
+    buf[3] = WS_VALUE_BOOL;
+    buf[4] = value ? 1 : 0;
+    return 5;
+  };
+  auto put_float = [buf](float value) -> size_t {
+    buf[3] = WS_VALUE_FLOAT;
+    memcpy(buf + 4, &value, sizeof(value));
+    return 4 + sizeof(value);
+  };
+  auto put_string = [buf](const char *value, size_t len) -> size_t {
+    len = std::min<size_t>(len, 255);
+    buf[3] = WS_VALUE_STRING;
+    buf[4] = len;
+    memcpy(buf + 5, value, len);
+    return 5 + len;
+  };
+
+  // The primary value of the entity only; clients that need attributes use the JSON events or the REST API
+  const auto &entry = this->entity_index_.entry(sid);
+  switch (entry.domain) {
+#ifdef USE_SENSOR
+    case ENTITY_DOMAIN_SENSOR:
+      return put_float(static_cast<sensor::Sensor *>(entry.entity)->state);
+#endif
+#ifdef USE_BINARY_SENSOR
+    case ENTITY_DOMAIN_BINARY_SENSOR:
+      return put_bool(static_cast<binary_sensor::BinarySensor *>(entry.entity)->state);
+#endif
+#ifdef USE_SWITCH
+    case ENTITY_DOMAIN_SWITCH:
+      return put_bool(static_cast<switch_::Switch *>(entry.entity)->state);
+#endif
+#ifdef USE_FAN
+    case ENTITY_DOMAIN_FAN:
+      return put_bool(static_cast<fan::Fan *>(entry.entity)->state);
+#endif
+#ifdef USE_LIGHT
+    case ENTITY_DOMAIN_LIGHT:
+      return put_bool(static_cast<light::LightState *>(entry.entity)->remote_values.is_on());
+#endif
+#ifdef USE_COVER
+    case ENTITY_DOMAIN_COVER:
+      return put_float(static_cast<cover::Cover *>(entry.entity)->position);
 #endif
 #ifdef USE_VALVE
-  for (valve::Valve *obj : App.get_valves()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->valve_json_(obj, DETAIL_ALL)))
-        break;
+    case ENTITY_DOMAIN_VALVE:
+      return put_float(static_cast<valve::Valve *>(entry.entity)->position);
+#endif
+#ifdef USE_NUMBER
+    case ENTITY_DOMAIN_NUMBER:
+      return put_float(static_cast<number::Number *>(entry.entity)->state);
+#endif
+#ifdef USE_CLIMATE
+    case ENTITY_DOMAIN_CLIMATE:
+      return put_float(static_cast<climate::Climate *>(entry.entity)->current_temperature);
+#endif
+#ifdef USE_LOCK
+    case ENTITY_DOMAIN_LOCK:
+      return put_bool(static_cast<lock::Lock *>(entry.entity)->state == lock::LOCK_STATE_LOCKED);
+#endif
+#ifdef USE_TEXT_SENSOR
+    case ENTITY_DOMAIN_TEXT_SENSOR: {
+      const auto &value = static_cast<text_sensor::TextSensor *>(entry.entity)->state;
+      return put_string(value.c_str(), value.size());
     }
-  }
 #endif
-#ifdef USE_ALARM_CONTROL_PANEL
-  for (alarm_control_panel::AlarmControlPanel *obj : App.get_alarm_control_panels()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->alarm_control_panel_json_(obj, obj->get_state(), DETAIL_ALL)))
-        break;
+#ifdef USE_TEXT
+    case ENTITY_DOMAIN_TEXT: {
+      const auto &value = static_cast<text::Text *>(entry.entity)->state;
+      return put_string(value.c_str(), value.size());
     }
-  }
 #endif
-#ifdef USE_WATER_HEATER
-  for (water_heater::WaterHeater *obj : App.get_water_heaters()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->water_heater_json_(obj, DETAIL_ALL)))
+#ifdef USE_SELECT
+    case ENTITY_DOMAIN_SELECT: {
+      auto *obj = static_cast<select::Select *>(entry.entity);
+      if (!obj->has_state())
         break;
+      StringRef value = obj->current_option();
+      return put_string(value.c_str(), value.size());
     }
+#endif
+    default:
+      break;
   }
+  buf[3] = WS_VALUE_NONE;
+  return 4;
+}
+
+uint8_t WebServer::ws_binary_command_(const uint8_t *data, size_t len) {
+  const uint16_t sid = data[1] | (data[2] << 8);
+  if (sid >= this->entity_index_.entity_count())
+    return WS_STATUS_NOT_FOUND;
+  const auto &entry = this->entity_index_.entry(sid);
+
+  const uint8_t type = data[3];
+  const uint8_t *value = data + 4;
+  const size_t value_len = len - 4;
+  bool on = false;
+  float number = NAN;
+  const char *text = nullptr;
+  size_t text_len = 0;
+  switch (type) {
+    case WS_VALUE_NONE:
+      break;
+    case WS_VALUE_BOOL:
+      if (value_len < 1)
+        return WS_STATUS_MALFORMED;
+      on = value[0] != 0;
+      break;
+    case WS_VALUE_FLOAT:
+      if (value_len < sizeof(number))
+        return WS_STATUS_MALFORMED;
+      memcpy(&number, value, sizeof(number));
+      // KAUF: every float operand is a level, position or value; NaN is never valid (and casting it is UB)
+      if (std::isnan(number))
+        return WS_STATUS_MALFORMED;
+      break;
+    case WS_VALUE_STRING:
+      if (value_len < 1 || value_len < 1u + value[0])
+        return WS_STATUS_MALFORMED;
+      text = reinterpret_cast<const char *>(value + 1);
+      text_len = value[0];
+      break;
+    default:
+      return WS_STATUS_MALFORMED;
+  }
+
+  // none toggles (or presses), a bool turns on/off, a float sets the entity's main number, a string its option/value
+  switch (entry.domain) {
+#ifdef USE_SWITCH
+    case ENTITY_DOMAIN_SWITCH: {
+      auto *obj = static_cast<switch_::Switch *>(entry.entity);
+      if (type == WS_VALUE_NONE) {
+        execute_switch_action(obj, SWITCH_ACTION_TOGGLE);
+      } else if (type == WS_VALUE_BOOL) {
+        execute_switch_action(obj, on ? SWITCH_ACTION_TURN_ON : SWITCH_ACTION_TURN_OFF);
+      } else {
+        return WS_STATUS_UNSUPPORTED;
+      }
+      return WS_STATUS_OK;
+    }
 #endif
-#ifdef USE_INFRARED
-  for (infrared::Infrared *obj : App.get_infrareds()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->infrared_json_(obj, DETAIL_ALL)))
-        break;
+#ifdef USE_BUTTON
+    case ENTITY_DOMAIN_BUTTON:
+      if (type != WS_VALUE_NONE)
+        return WS_STATUS_UNSUPPORTED;
+      static_cast<button::Button *>(entry.entity)->press();
+      return WS_STATUS_OK;
+#endif
+#ifdef USE_LIGHT
+    case ENTITY_DOMAIN_LIGHT: {
+      auto *obj = static_cast<light::LightState *>(entry.entity);
+      if (type == WS_VALUE_NONE) {
+        obj->toggle().perform();
+      } else if (type == WS_VALUE_BOOL) {
+        (on ? obj->turn_on() : obj->turn_off()).perform();
+      } else if (type == WS_VALUE_FLOAT) {
+        if (number < 0.0f || number > 1.0f)
+          return WS_STATUS_MALFORMED;
+        obj->turn_on().set_brightness(number).perform();
+      } else {
+        return WS_STATUS_UNSUPPORTED;
+      }
+      return WS_STATUS_OK;
     }
-  }
 #endif
-#ifdef USE_EVENT
-  for (event::Event *obj : App.get_events()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->event_json_(obj, StringRef(), DETAIL_ALL)))
-        break;
+#ifdef USE_FAN
+    case ENTITY_DOMAIN_FAN: {
+      auto *obj = static_cast<fan::Fan *>(entry.entity);
+      if (type == WS_VALUE_NONE) {
+        obj->toggle().perform();
+      } else if (type == WS_VALUE_BOOL) {
+        (on ? obj->turn_on() : obj->turn_off()).perform();
+      } else if (type == WS_VALUE_FLOAT) {
+        const auto traits = obj->get_traits();
+        if (!traits.supports_speed())
+          return WS_STATUS_UNSUPPORTED;
+        // Range check before the cast, an out of range float to int conversion is UB
+        if (number < 1.0f || number > static_cast<float>(traits.supported_speed_count()))
+          return WS_STATUS_MALFORMED;
+        obj->turn_on().set_speed(static_cast<int>(number)).perform();
+      } else {
+        return WS_STATUS_UNSUPPORTED;
+      }
+      return WS_STATUS_OK;
     }
-  }
 #endif
-#ifdef USE_UPDATE
-  for (update::UpdateEntity *obj : App.get_updates()) {
-    if (featured_entity == nullptr && !featured_name.empty() && obj->get_name() == featured_name) {
-      if (try_write_featured(obj, this->update_json_(obj, DETAIL_ALL)))
-        break;
+#ifdef USE_COVER
+    case ENTITY_DOMAIN_COVER: {
+      auto call = static_cast<cover::Cover *>(entry.entity)->make_call();
+      if (type == WS_VALUE_NONE) {
+        call.set_command_toggle();
+      } else if (type == WS_VALUE_BOOL) {
+        on ? call.set_command_open() : call.set_command_close();
+      } else if (type == WS_VALUE_FLOAT) {
+        if (number < 0.0f || number > 1.0f)
+          return WS_STATUS_MALFORMED;
+        call.set_position(number);
+      } else {
+        return WS_STATUS_UNSUPPORTED;
+      }
+      call.perform();
+      return WS_STATUS_OK;
     }
+#endif
+#ifdef USE_VALVE
+    case ENTITY_DOMAIN_VALVE: {
+      auto call = static_cast<valve::Valve *>(entry.entity)->make_call();
+      if (type == WS_VALUE_NONE) {
+        call.set_command_toggle();
+      } else if (type == WS_VALUE_BOOL) {
+        on ? call.set_command_open() : call.set_command_close();
+      } else if (type == WS_VALUE_FLOAT) {
+        if (number < 0.0f || number > 1.0f)
+          return WS_STATUS_MALFORMED;
+        call.set_position(number);
+      } else {
+        return WS_STATUS_UNSUPPORTED;
+      }
+      call.perform();
+      return WS_STATUS_OK;
+    }
+#endif
+#ifdef USE_NUMBER
+    case ENTITY_DOMAIN_NUMBER:
+      if (type != WS_VALUE_FLOAT)
+        return WS_STATUS_UNSUPPORTED;
+      static_cast<number::Number *>(entry.entity)->make_call().set_value(number).perform();
+      return WS_STATUS_OK;
+#endif
+#ifdef USE_SELECT
+    case ENTITY_DOMAIN_SELECT:
+      if (type != WS_VALUE_STRING)
+        return WS_STATUS_UNSUPPORTED;
+      static_cast<select::Select *>(entry.entity)->make_call().set_option(text, text_len).perform();
+      return WS_STATUS_OK;
+#endif
+#ifdef USE_TEXT
+    case ENTITY_DOMAIN_TEXT:
+      if (type != WS_VALUE_STRING)
+        return WS_STATUS_UNSUPPORTED;
+      static_cast<text::Text *>(entry.entity)->make_call().set_value(std::string(text, text_len)).perform();
+      return WS_STATUS_OK;
+#endif
+#ifdef USE_LOCK
+    case ENTITY_DOMAIN_LOCK: {
+      auto *obj = static_cast<lock::Lock *>(entry.entity);
+      // KAUF: no toggle for locks, and opening takes the explicit "open"
+      LockAction action = LOCK_ACTION_NONE;
+      if (type == WS_VALUE_BOOL) {
+        action = on ? LOCK_ACTION_LOCK : LOCK_ACTION_UNLOCK;
+      } else if (type == WS_VALUE_STRING) {
+        const StringRef command(text, text_len);
+        if (command == "lock") {
+          action = LOCK_ACTION_LOCK;
+        } else if (command == "unlock") {
+          action = LOCK_ACTION_UNLOCK;
+        } else if (command == "open") {
+          action = LOCK_ACTION_OPEN;
+        } else {
+          return WS_STATUS_MALFORMED;
+        }
+      } else {
+        return WS_STATUS_UNSUPPORTED;
+      }
+      execute_lock_action(obj, action);
+      return WS_STATUS_OK;
+    }
+#endif
+    default:
+      break;
   }
+  return WS_STATUS_UNSUPPORTED;
+}
 #endif
 
+// KAUF: append the DETAIL_ALL JSON of an entity for /state to `out`, false for domains /state leaves out
+bool WebServer::entity_state_json_(EntityBase *entity, EntityDomain domain, std::string &out) {
+  switch (domain) {
 #ifdef USE_SENSOR
-  for (sensor::Sensor *obj : App.get_sensors()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->sensor_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_SENSOR: {
+      auto *obj = static_cast<sensor::Sensor *>(entity);
+      out += this->sensor_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_SWITCH
-  for (switch_::Switch *obj : App.get_switches()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->switch_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_SWITCH: {
+      auto *obj = static_cast<switch_::Switch *>(entity);
+      out += this->switch_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_BUTTON
-  for (button::Button *obj : App.get_buttons()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->button_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_BUTTON: {
+      auto *obj = static_cast<button::Button *>(entity);
+      out += this->button_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_BINARY_SENSOR
-  for (binary_sensor::BinarySensor *obj : App.get_binary_sensors()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->binary_sensor_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_BINARY_SENSOR: {
+      auto *obj = static_cast<binary_sensor::BinarySensor *>(entity);
+      out += this->binary_sensor_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_FAN
-  for (fan::Fan *obj : App.get_fans()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->fan_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_FAN: {
+      auto *obj = static_cast<fan::Fan *>(entity);
+      out += this->fan_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_LIGHT
-  for (light::LightState *obj : App.get_lights()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->light_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_LIGHT: {
+      auto *obj = static_cast<light::LightState *>(entity);
+      out += this->light_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_TEXT_SENSOR
-  for (text_sensor::TextSensor *obj : App.get_text_sensors()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->text_sensor_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_TEXT_SENSOR: {
+      auto *obj = static_cast<text_sensor::TextSensor *>(entity);
+      out += this->text_sensor_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_COVER
-  for (cover::Cover *obj : App.get_covers()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->cover_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_COVER: {
+      auto *obj = static_cast<cover::Cover *>(entity);
+      out += this->cover_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_NUMBER
-  for (number::Number *obj : App.get_numbers()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->number_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_NUMBER: {
+      auto *obj = static_cast<number::Number *>(entity);
+      out += this->number_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_DATETIME_DATE
-  for (datetime::DateEntity *obj : App.get_dates()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->date_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_DATE: {
+      auto *obj = static_cast<datetime::DateEntity *>(entity);
+      out += this->date_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_DATETIME_TIME
-  for (datetime::TimeEntity *obj : App.get_times()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->time_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_TIME: {
+      auto *obj = static_cast<datetime::TimeEntity *>(entity);
+      out += this->time_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_DATETIME_DATETIME
-  for (datetime::DateTimeEntity *obj : App.get_datetimes()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->datetime_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_DATETIME: {
+      auto *obj = static_cast<datetime::DateTimeEntity *>(entity);
+      out += this->datetime_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_TEXT
-  for (text::Text *obj : App.get_texts()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->text_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_TEXT: {
+      auto *obj = static_cast<text::Text *>(entity);
+      out += this->text_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_SELECT
-  for (select::Select *obj : App.get_selects()) {
-    if (obj == featured_entity)
-      continue;
-    StringRef value = obj->has_state() ? obj->current_option() : StringRef();
-    write_json(obj, this->select_json_(obj, value, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_SELECT: {
+      auto *obj = static_cast<select::Select *>(entity);
+      StringRef value = obj->has_state() ? obj->current_option() : StringRef();
+      out += this->select_json_(obj, value, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_CLIMATE
-  for (climate::Climate *obj : App.get_climates()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->climate_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_CLIMATE: {
+      auto *obj = static_cast<climate::Climate *>(entity);
+      out += this->climate_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_LOCK
-  for (lock::Lock *obj : App.get_locks()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->lock_json_(obj, obj->state, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_LOCK: {
+      auto *obj = static_cast<lock::Lock *>(entity);
+      out += this->lock_json_(obj, obj->state, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_VALVE
-  for (valve::Valve *obj : App.get_valves()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->valve_json_(obj, DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_VALVE: {
+      auto *obj = static_cast<valve::Valve *>(entity);
+      out += this->valve_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_ALARM_CONTROL_PANEL
-  for (alarm_control_panel::AlarmControlPanel *obj : App.get_alarm_control_panels()) {
-    if (obj == featured_entity)
-      continue;
-    write_json(obj, this->alarm_control_panel_json_(obj, obj->get_state(), DETAIL_ALL));
-  }
+    case ENTITY_DOMAIN_ALARM_CONTROL_PANEL: {
+      auto *obj = static_cast<alarm_control_panel::AlarmControlPanel *>(entity);
+      out += this->alarm_control_panel_json_(obj, obj->get_state(), DETAIL_ALL).c_str();
+      return true;
+    }
 #endif
 #ifdef USE_WATER_HEATER
-  for (water_heater::WaterHeater *obj : App.get_water_heaters()) {
-    if (obj == featured_entity)
+    case ENTITY_DOMAIN_WATER_HEATER: {
+      auto *obj = static_cast<water_heater::WaterHeater *>(entity);
+      out += this->water_heater_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
+#endif
+#ifdef USE_INFRARED
+    case ENTITY_DOMAIN_INFRARED: {
+      auto *obj = static_cast<infrared::Infrared *>(entity);
+      out += this->infrared_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
+#endif
+#ifdef USE_EVENT
+    case ENTITY_DOMAIN_EVENT: {
+      auto *obj = static_cast<event::Event *>(entity);
+      out += this->event_json_(obj, StringRef(), DETAIL_ALL).c_str();
+      return true;
+    }
+#endif
+#ifdef USE_UPDATE
+    case ENTITY_DOMAIN_UPDATE: {
+      auto *obj = static_cast<update::UpdateEntity *>(entity);
+      out += this->update_json_(obj, DETAIL_ALL).c_str();
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+
+/** KAUF: produces the /state response piece by piece, one entity's JSON at a time.
+ *
+ * Entities are walked by their EntityIndex id, which follows the domain order of the entity lists, so the response
+ * can be resumed between chunks and never holds more than one entity's JSON.
+ */
+class WebServer::StateCursor {
+ public:
+  StateCursor(WebServer *web_server, bool wrap_entities) : web_server_(web_server), wrap_entities_(wrap_entities) {}
+
+  /// Fill up to `len` bytes of the response into `buf`; returns 0 once the whole response was written.
+  size_t fill(uint8_t *buf, size_t len) {
+    size_t written = 0;
+    while (written < len) {
+      if (this->pending_pos_ == this->pending_.size() && !this->next_())
+        break;
+      const size_t n = std::min(len - written, this->pending_.size() - this->pending_pos_);
+      memcpy(buf + written, this->pending_.data() + this->pending_pos_, n);
+      this->pending_pos_ += n;
+      written += n;
+    }
+    return written;
+  }
+
+ protected:
+  enum Step : uint8_t { STEP_OPEN, STEP_FEATURED, STEP_ENTITIES, STEP_DONE };
+
+  /// Load the next piece of the response into pending_, false once there is none left.
+  bool next_() {
+    WebServer *ws = this->web_server_;
+    this->pending_.clear();
+    this->pending_pos_ = 0;
+    switch (this->step_) {
+      case STEP_OPEN:
+        this->pending_ = this->wrap_entities_ ? "{\"entities\":[" : "[";
+        this->step_ = STEP_FEATURED;
+        return true;
+      case STEP_FEATURED:
+        // the featured entity is resolved once in setup(), see index_entity_()
+        this->step_ = STEP_ENTITIES;
+        if (ws->featured_entity_ != nullptr && this->append_entity_(ws->featured_entity_, ws->featured_domain_))
+          return true;
+        // fall through
+      case STEP_ENTITIES:
+        while (this->next_id_ < ws->entity_index_.entity_count()) {
+          const EntityIndex::Entry &entry = ws->entity_index_.entry(this->next_id_++);
+          if (entry.entity == ws->featured_entity_ || (!ws->include_internal_ && entry.entity->is_internal()))
+            continue;
+          if (this->append_entity_(entry.entity, entry.domain))
+            return true;
+        }
+        this->pending_ = this->wrap_entities_ ? "]}" : "]";
+        this->step_ = STEP_DONE;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  bool append_entity_(EntityBase *entity, EntityDomain domain) {
+    if (this->wrote_entity_)
+      this->pending_ += ',';
+    if (!this->web_server_->entity_state_json_(entity, domain, this->pending_)) {
+      this->pending_.clear();
+      return false;
+    }
+    this->wrote_entity_ = true;
+    return true;
+  }
+
+  WebServer *web_server_;
+  // one entity's JSON, reused so its capacity settles at the largest entity
+  std::string pending_;
+  size_t pending_pos_{0};
+  uint16_t next_id_{0};
+  Step step_{STEP_OPEN};
+  bool wrap_entities_;
+  bool wrote_entity_{false};
+};
+
+// KAUF: add function to dump out all JSON at /state
+void WebServer::handle_state_request(AsyncWebServerRequest *request) {
+  if (request->method() != HTTP_GET) {
+    request->send(405, ESPHOME_F("text/plain"), ESPHOME_F("Method Not Allowed"));
+    return;
+  }
+
+  bool wrap_entities = false;
+#ifdef USE_ESP32
+  char url_buf[AsyncWebServerRequest::URL_BUF_SIZE];
+  wrap_entities = request->url_to(url_buf) == "/state";
+
+  // The ESP-IDF server has no chunked response with a fill callback; the handler runs in the httpd task, so the
+  // stream is written in one go from the same cursor
+  AsyncResponseStream *stream = request->beginResponseStream(ESPHOME_F("application/json"));
+  StateCursor cursor(this, wrap_entities);
+  char buf[256];
+  while (size_t len = cursor.fill(reinterpret_cast<uint8_t *>(buf), sizeof(buf) - 1)) {
+    buf[len] = '\0';
+    stream->print(buf);
+  }
+  request->send(stream);
+#else
+  wrap_entities = request->url() == ESPHOME_F("/state");
+
+  // KAUF: chunked, each chunk is filled from the cursor when the connection can take it, so peak heap stays at one
+  // entity's JSON however many entities there are
+  auto cursor = std::make_shared<StateCursor>(this, wrap_entities);
+  request->send(request->beginChunkedResponse(
+      ESPHOME_F("application/json"),
+      [cursor](uint8_t *buffer, size_t max_len, size_t index) -> size_t { return cursor->fill(buffer, max_len); }));
+#endif
+}
+
+#ifdef USE_WEBSERVER_METRICS
+// KAUF: OpenMetrics label values escape backslash, double quote and newline
+static void print_label_value(AsyncResponseStream *stream, const char *value, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    const char c = value[i];
+    if (c == '\\' || c == '"') {
+      stream->print('\\');
+      stream->print(c);
+    } else if (c == '\n') {
+      stream->print(ESPHOME_F("\\n"));
+    } else {
+      stream->print(c);
+    }
+  }
+}
+
+static void print_sample_value(AsyncResponseStream *stream, float value) {
+  if (std::isnan(value)) {
+    stream->print(ESPHOME_F("NaN"));
+  } else if (std::isinf(value)) {
+    stream->print(value > 0 ? ESPHOME_F("+Inf") : ESPHOME_F("-Inf"));
+  } else {
+    char buf[24];
+    buf_append_printf(buf, sizeof(buf), 0, "%.7g", value);
+    stream->print(buf);
+  }
+}
+
+// {metric}{id="{domain}/{device?}/{name}",name="{name}"[,unit="{unit}"]} {value}
+static void print_entity_sample(AsyncResponseStream *stream, const char *metric, const char *domain, EntityBase *obj,
+                                float value, const StringRef &unit = StringRef()) {
+  const StringRef &name = obj->get_name();
+  stream->print(metric);
+  stream->print(ESPHOME_F("{id=\""));
+  stream->print(domain);
+  stream->print('/');
+#ifdef USE_DEVICES
+  if (obj->get_device() != nullptr) {
+    const char *device = obj->get_device()->get_name();
+    print_label_value(stream, device, strlen(device));
+    stream->print('/');
+  }
+#endif
+  print_label_value(stream, name.c_str(), name.size());
+  stream->print(ESPHOME_F("\",name=\""));
+  print_label_value(stream, name.c_str(), name.size());
+  if (!unit.empty()) {
+    stream->print(ESPHOME_F("\",unit=\""));
+    print_label_value(stream, unit.c_str(), unit.size());
+  }
+  stream->print(ESPHOME_F("\"} "));
+  print_sample_value(stream, value);
+  stream->print('\n');
+}
+
+static void print_stat_sample(AsyncResponseStream *stream, const char *metric, float value) {
+  stream->print(metric);
+  stream->print(' ');
+  print_sample_value(stream, value);
+  stream->print('\n');
+}
+
+// Integer samples are printed exactly, a float would round counters past 2^24
+static void print_stat_count(AsyncResponseStream *stream, const char *metric, uint64_t value) {
+  char buf[24];
+  buf_append_printf(buf, sizeof(buf), 0, " %" PRIu64 "\n", value);
+  stream->print(metric);
+  stream->print(buf);
+}
+
+// KAUF: /metrics walks the same entity lists as handle_state_request() and prints samples straight from the entity
+// state into the response stream, no JSON documents are built.
+void WebServer::handle_metrics_request(AsyncWebServerRequest *request) {
+  // KAUF: sample the loop time from now on, see keep_looping_()
+  this->metrics_scrape_ms_ = millis();
+  this->metrics_scraped_ = true;
+  this->enable_loop_soon_any_context();
+
+  AsyncResponseStream *stream =
+      request->beginResponseStream(ESPHOME_F("application/openmetrics-text; version=1.0.0; charset=utf-8"));
+
+#ifdef USE_SENSOR
+  stream->print(ESPHOME_F("# TYPE esphome_sensor_value gauge\n"));
+  for (sensor::Sensor *obj : App.get_sensors()) {
+    if (!this->include_internal_ && obj->is_internal())
       continue;
-    write_json(obj, this->water_heater_json_(obj, DETAIL_ALL));
+    print_entity_sample(stream, "esphome_sensor_value", "sensor", obj, obj->state, obj->get_unit_of_measurement_ref());
   }
 #endif
-#ifdef USE_INFRARED
-  for (infrared::Infrared *obj : App.get_infrareds()) {
-    if (obj == featured_entity)
+#ifdef USE_BINARY_SENSOR
+  stream->print(ESPHOME_F("# TYPE esphome_binary_sensor_value gauge\n"));
+  for (binary_sensor::BinarySensor *obj : App.get_binary_sensors()) {
+    if (!this->include_internal_ && obj->is_internal())
       continue;
-    write_json(obj, this->infrared_json_(obj, DETAIL_ALL));
+    print_entity_sample(stream, "esphome_binary_sensor_value", "binary_sensor", obj,
+                        obj->has_state() ? (obj->state ? 1.0f : 0.0f) : NAN);
   }
 #endif
-#ifdef USE_EVENT
-  for (event::Event *obj : App.get_events()) {
-    if (obj == featured_entity)
+#ifdef USE_SWITCH
+  stream->print(ESPHOME_F("# TYPE esphome_switch_value gauge\n"));
+  for (switch_::Switch *obj : App.get_switches()) {
+    if (!this->include_internal_ && obj->is_internal())
       continue;
-    write_json(obj, this->event_json_(obj, StringRef(), DETAIL_ALL));
+    print_entity_sample(stream, "esphome_switch_value", "switch", obj, obj->state ? 1.0f : 0.0f);
   }
 #endif
-#ifdef USE_UPDATE
-  for (update::UpdateEntity *obj : App.get_updates()) {
-    if (obj == featured_entity)
+#ifdef USE_LIGHT
+  stream->print(ESPHOME_F("# TYPE esphome_light_state gauge\n"));
+  for (light::LightState *obj : App.get_lights()) {
+    if (!this->include_internal_ && obj->is_internal())
+      continue;
+    print_entity_sample(stream, "esphome_light_state", "light", obj, obj->remote_values.is_on() ? 1.0f : 0.0f);
+  }
+  stream->print(ESPHOME_F("# TYPE esphome_light_brightness gauge\n"));
+  for (light::LightState *obj : App.get_lights()) {
+    if (!this->include_internal_ && obj->is_internal())
       continue;
-    write_json(obj, this->update_json_(obj, DETAIL_ALL));
+    print_entity_sample(stream, "esphome_light_brightness", "light", obj, obj->remote_values.get_brightness());
   }
 #endif
 
-  if (wrap_entities) {
-    stream->print(ESPHOME_F("]}"));
-  } else {
-    stream->print(']');
+  stream->print(ESPHOME_F("# TYPE esphome_uptime_seconds gauge\n"));
+  print_stat_count(stream, "esphome_uptime_seconds", millis_64() / 1000);
+  stream->print(ESPHOME_F("# TYPE esphome_free_heap_bytes gauge\n"));
+  print_stat_count(stream, "esphome_free_heap_bytes", free_heap_bytes());
+  // Longest main loop iteration that overran the application's loop interval, over the current and the previous
+  // METRICS_LOOP_WINDOW_MS window (0 if none did). Reading it does not reset it, so concurrent scrapers agree.
+  stream->print(ESPHOME_F("# TYPE esphome_loop_time_max_seconds gauge\n"));
+  print_stat_sample(stream, "esphome_loop_time_max_seconds", this->loop_time_max_us_(millis()) / 1e6f);
+#ifdef USE_WIFI
+  if (wifi::global_wifi_component != nullptr) {
+    const int8_t rssi = wifi::global_wifi_component->wifi_rssi();
+    stream->print(ESPHOME_F("# TYPE esphome_wifi_rssi_dbm gauge\n"));
+    print_stat_sample(stream, "esphome_wifi_rssi_dbm", rssi == wifi::WIFI_RSSI_DISCONNECTED ? NAN : rssi);
   }
+#endif
+  stream->print(ESPHOME_F("# TYPE esphome_sse_clients gauge\n"));
+#ifdef USE_ESP32
+  print_stat_count(stream, "esphome_sse_clients", this->events_.count());
+#else
+  print_stat_count(stream, "esphome_sse_clients", this->events_.size());
+#endif
+#ifdef USE_DDP
+  if (ddp::global_ddp_component != nullptr) {
+    stream->print(ESPHOME_F("# TYPE esphome_ddp_packets counter\n"));
+    print_stat_count(stream, "esphome_ddp_packets_total", ddp::global_ddp_component->get_packets_total());
+  }
+#endif
+
+  stream->print(ESPHOME_F("# EOF\n"));
   request->send(stream);
 }
+#endif
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+void WebServer::handle_diagnostics_request(AsyncWebServerRequest *request) {
+  json::JsonBuilder builder;
+  JsonObject root = builder.root();
+  this->diagnostics_.write_json(root);
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  if (wifi::global_wifi_component != nullptr) {
+    const wifi::WiFiComponent *wifi = wifi::global_wifi_component;
+    JsonObject wifi_obj = root[ESPHOME_F("wifi")].to<JsonObject>();
+    wifi_obj[ESPHOME_F("boot_to_connected_ms")] = wifi->get_boot_to_connected_ms();
+    wifi_obj[ESPHOME_F("cycles")] = wifi->get_connect_cycles();
+    JsonArray timeline = wifi_obj[ESPHOME_F("timeline")].to<JsonArray>();
+    for (uint8_t i = 0; i < wifi->get_connect_record_count(); i++) {
+      const wifi::WiFiConnectRecord &rec = wifi->get_connect_record(i);
+      JsonObject obj = timeline.add<JsonObject>();
+      obj[ESPHOME_F("started_ms")] = rec.started;
+      obj[ESPHOME_F("total_ms")] = rec.total_ms;
+      obj[ESPHOME_F("scan_ms")] = rec.scan_ms;
+      obj[ESPHOME_F("scans")] = rec.scans;
+      obj[ESPHOME_F("link_ms")] = rec.link_ms;
+      obj[ESPHOME_F("dhcp_ms")] = rec.dhcp_ms;
+      obj[ESPHOME_F("ready_ms")] = rec.ready_ms;
+      obj[ESPHOME_F("attempts")] = rec.attempts;
+      obj[ESPHOME_F("phase_changes")] = rec.transitions;
+      obj[ESPHOME_F("phase")] = static_cast<uint8_t>(rec.phase);
+    }
+  }
+#endif
+  auto data = builder.serialize();
+  request->send(200, "application/json", data.c_str());
+}
+#endif
+
+// KAUF: reasons to keep loop() running while no SSE client is connected
+bool WebServer::keep_looping_() const {
+#ifdef USE_WEBSERVER_METRICS
+  // loop time for /metrics, sampled for two windows after each scrape so a periodic scraper always finds samples
+  if (this->metrics_scraped_ && millis() - this->metrics_scrape_ms_ < 2 * METRICS_LOOP_WINDOW_MS)
+    return true;
+#endif
+#ifdef USE_WEBSERVER_WEBSOCKET
+  if (!this->ws_clients_.empty())
+    return true;  // cleanupClients()
+#endif
+  return false;
+}
 
 }  // namespace esphome::web_server
 #endif
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "deferred_event_source.h"
+#include "entity_index.h"
 #include "list_entities.h"
 
 #include "esphome/components/json/json_util.h"
@@ -12,9 +14,16 @@
 #include "esphome/components/logger/logger.h"
 #endif
 
+#ifdef USE_WEBSERVER_WEBSOCKET
+#include <AsyncWebSocket.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -22,16 +31,22 @@
 #if USE_WEBSERVER_VERSION >= 2
 extern const uint8_t ESPHOME_WEBSERVER_INDEX_HTML[] PROGMEM;
 extern const size_t ESPHOME_WEBSERVER_INDEX_HTML_SIZE;
+extern const char ESPHOME_WEBSERVER_INDEX_HTML_ETAG[];  // KAUF
+#ifdef USE_WEBSERVER_LOCAL
+extern const char ESPHOME_WEBSERVER_LOCAL_INDEX_ETAG[];  // KAUF
+#endif
 #endif
 
 #ifdef USE_WEBSERVER_CSS_INCLUDE
 extern const uint8_t ESPHOME_WEBSERVER_CSS_INCLUDE[] PROGMEM;
 extern const size_t ESPHOME_WEBSERVER_CSS_INCLUDE_SIZE;
+extern const char ESPHOME_WEBSERVER_CSS_INCLUDE_ETAG[];  // KAUF
 #endif
 
 #ifdef USE_WEBSERVER_JS_INCLUDE
 extern const uint8_t ESPHOME_WEBSERVER_JS_INCLUDE[] PROGMEM;
 extern const size_t ESPHOME_WEBSERVER_JS_INCLUDE_SIZE;
+extern const char ESPHOME_WEBSERVER_JS_INCLUDE_ETAG[];  // KAUF
 #endif
 
 namespace esphome::web_server {
@@ -50,36 +65,91 @@ using ParamNameType = const char *;
 // yield() from sys context causes a panic in the Arduino core.
 #define DEFER_ACTION(capture, action) this->defer([capture]() mutable { action; })
 
-/// Result of matching a URL against an entity
-struct EntityMatchResult {
-  bool matched;          ///< True if entity matched the URL
-  bool action_is_empty;  ///< True if no action/method segment in URL
-};
-
-/// Internal helper struct that is used to parse incoming URLs
-struct UrlMatch {
-  StringRef domain;  ///< Domain within URL, for example "sensor"
-  StringRef id;      ///< Entity name/id within URL, for example "Temperature"
-  StringRef method;  ///< Method within URL, for example "turn_on"
-#ifdef USE_DEVICES
-  StringRef device_name;  ///< Device name within URL, empty for main device
+/// KAUF: a value request handlers write and the main loop reads. On ESP32 the handlers run in the server task, so it
+/// is atomic there; ESP8266 runs both in one context and keeps a plain value.
+#ifdef USE_ESP32
+template<typename T> using Counter = std::atomic<T>;
+#else
+template<typename T> using Counter = T;
 #endif
-  bool valid{false};  ///< Whether this match is valid
 
-  // Helper methods for string comparisons
-  bool domain_equals(const char *str) const { return this->domain == str; }
-  bool method_equals(const char *str) const { return this->method == str; }
-
-#ifdef USE_ESP8266
-  // Overloads for flash strings on ESP8266
-  bool domain_equals(const __FlashStringHelper *str) const { return this->domain == str; }
-  bool method_equals(const __FlashStringHelper *str) const { return this->method == str; }
-#endif
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+/** KAUF: Request path instrumentation, served as JSON under '/diagnostics' and optionally published by the
+ * web_server sensor platform.
+ *
+ * Latencies are kept per route class as a histogram (BUCKET_BOUNDS_US, the last bucket is unbounded). Heap is
+ * sampled before and after each request, which catches the response buffers a handler leaves for the async server.
+ *
+ * On ESP32 the request handlers run in the server task while the sensors and /diagnostics read in the main loop, so
+ * the counters are atomic there. ESP8266 runs both in one context and keeps plain integers.
+ */
+class WebServerDiagnostics {
+ public:
+  enum RouteClass : uint8_t {
+    ROUTE_INDEX,
+    ROUTE_ASSET,
+    ROUTE_EVENTS,
+    ROUTE_STATE,
+    ROUTE_ENTITY_GET,
+    ROUTE_ENTITY_POST,
+    ROUTE_BATCH,
+    ROUTE_OTHER,
+    ROUTE_COUNT,
+  };
+  static constexpr uint8_t BUCKET_COUNT = 8;
+  static constexpr uint32_t BUCKET_BOUNDS_US[BUCKET_COUNT - 1] = {1000, 5000, 10000, 25000, 50000, 100000, 250000};
+
+  void record_request(RouteClass route, uint32_t duration_us, uint32_t heap_before, uint32_t heap_after);
+  void record_serialization(size_t bytes);
+  void record_sse_queue_depth(uint16_t depth) { store_max(this->sse_queue_max_, depth); }
+  /// A send the event source discarded because the client's queue was full.
+  void record_sse_discarded() { this->sse_discarded_++; }
+  /// An event dropped for good because the deferred queue could not grow.
+  void record_sse_dropped() { this->sse_dropped_++; }
+
+  void write_json(JsonObject root) const;
+
+  /// Longest request since the last call, for periodic sensors.
+  uint32_t take_recent_max_us() { return take(this->recent_max_us_); }
+  /// Deepest SSE deferred queue since the last call, for periodic sensors.
+  uint16_t take_sse_queue_max() { return take(this->sse_queue_max_); }
+  uint32_t get_heap_min_free() const { return this->heap_min_free_; }
+  uint32_t get_sse_discarded() const { return this->sse_discarded_; }
 
-  /// Match entity by name first, then fall back to object_id with deprecation warning
-  /// Returns EntityMatchResult with match status and whether action segment is empty
-  EntityMatchResult match_entity(EntityBase *entity) const;
+ protected:
+  template<typename T> static void store_max(std::atomic<T> &target, T value) {
+    T current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+  template<typename T> static void store_max(T &target, T value) { target = std::max(target, value); }
+  template<typename T> static void store_min(std::atomic<T> &target, T value) {
+    T current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+  template<typename T> static void store_min(T &target, T value) { target = std::min(target, value); }
+  template<typename T> static T take(std::atomic<T> &target) { return target.exchange(0, std::memory_order_relaxed); }
+  template<typename T> static T take(T &target) { return std::exchange(target, 0); }
+
+  struct Route {
+    Counter<uint32_t> count;
+    Counter<uint32_t> buckets[BUCKET_COUNT];
+    Counter<uint64_t> total_us;
+    Counter<uint32_t> max_us;
+  };
+  Route routes_[ROUTE_COUNT]{};
+  Counter<uint64_t> serialized_bytes_{0};
+  Counter<uint32_t> serializations_{0};
+  Counter<uint32_t> serialized_max_{0};
+  Counter<uint32_t> heap_min_free_{UINT32_MAX};
+  Counter<uint32_t> heap_max_drop_{0};
+  Counter<uint32_t> recent_max_us_{0};
+  Counter<uint32_t> sse_discarded_{0};
+  Counter<uint32_t> sse_dropped_{0};
+  Counter<uint16_t> sse_queue_max_{0};
 };
+#endif
 
 #ifdef USE_WEBSERVER_SORTING
 struct SortingComponents {
@@ -95,90 +165,6 @@ struct SortingGroup {
 
 enum JsonDetail { DETAIL_ALL, DETAIL_STATE };
 
-/*
-  In order to defer updates in arduino mode, we need to create one AsyncEventSource per incoming request to /events.
-  This is because only minimal changes were made to the ESPAsyncWebServer lib_dep, it was undesirable to put deferred
-  update logic into that library. We need one deferred queue per connection so instead of one AsyncEventSource with
-  multiple clients, we have multiple event sources with one client each. This is slightly awkward which is why it's
-  implemented in a more straightforward way for ESP-IDF. Arduino platform will eventually go away and this workaround
-  can be forgotten.
-*/
-#if !defined(USE_ESP32) && defined(USE_ARDUINO)
-using message_generator_t = json::SerializationBuffer<>(WebServer *, void *);
-
-class DeferredUpdateEventSourceList;
-class DeferredUpdateEventSource final : public AsyncEventSource {
-  friend class DeferredUpdateEventSourceList;
-
-  /*
-    This class holds a pointer to the source component that wants to publish a state event, and a pointer to a function
-    that will lazily generate that event.  The two pointers allow dedup in the deferred queue if multiple publishes for
-    the same component are backed up, and take up only two pointers of memory.  The entry in the deferred queue (a
-    std::vector) is the DeferredEvent instance itself (not a pointer to one elsewhere in heap) so still only two
-    pointers per entry (and no heap fragmentation).  Even 100 backed up events (you'd have to have at least 100 sensors
-    publishing because of dedup) would take up only 0.8 kB.
-  */
-  struct DeferredEvent {
-    friend class DeferredUpdateEventSource;
-
-   protected:
-    void *source_;
-    message_generator_t *message_generator_;
-
-   public:
-    DeferredEvent(void *source, message_generator_t *message_generator)
-        : source_(source), message_generator_(message_generator) {}
-    bool operator==(const DeferredEvent &test) const {
-      return (source_ == test.source_ && message_generator_ == test.message_generator_);
-    }
-  };
-  static_assert(sizeof(DeferredEvent) == sizeof(void *) + sizeof(message_generator_t *),
-                "DeferredEvent should have no padding");
-
- protected:
-  // surface a couple methods from the base class
-  using AsyncEventSource::handleRequest;
-  using AsyncEventSource::send;
-
-  ListEntitiesIterator entities_iterator_;
-  // vector is used very specifically for its zero memory overhead even though items are popped from the front (memory
-  // footprint is more important than speed here)
-  std::vector<DeferredEvent> deferred_queue_;
-  WebServer *web_server_;
-  uint16_t consecutive_send_failures_{0};
-  static constexpr uint16_t MAX_CONSECUTIVE_SEND_FAILURES = 2500;  // ~20 seconds at 125Hz loop rate
-
-  // helper for allowing only unique entries in the queue
-  void deq_push_back_with_dedup_(void *source, message_generator_t *message_generator);
-
-  void process_deferred_queue_();
-
- public:
-  DeferredUpdateEventSource(WebServer *ws, const String &url)
-      : AsyncEventSource(url), entities_iterator_(ListEntitiesIterator(ws, this)), web_server_(ws) {}
-
-  void loop();
-
-  void deferrable_send_state(void *source, const char *event_type, message_generator_t *message_generator);
-  void try_send_nodefer(const char *message, const char *event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
-};
-
-class DeferredUpdateEventSourceList final : public std::list<DeferredUpdateEventSource *> {
- protected:
-  void on_client_connect_(DeferredUpdateEventSource *source);
-  void on_client_disconnect_(DeferredUpdateEventSource *source);
-
- public:
-  /// Returns true if there are event sources remaining (including pending cleanup).
-  bool loop();
-
-  void deferrable_send_state(void *source, const char *event_type, message_generator_t *message_generator);
-  void try_send_nodefer(const char *message, const char *event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
-
-  void add_new_client(WebServer *ws, AsyncWebServerRequest *request);
-};
-#endif
-
 /** This class allows users to create a web server with their ESP nodes.
  *
  * Behind the scenes it's using AsyncWebServer to set up the server. It exposes 3 things:
@@ -240,6 +226,12 @@ class WebServer final : public Controller, public Component, public AsyncWebHand
    */
   void set_expose_log(bool expose_log) { this->expose_log_ = expose_log; }
 
+  /** KAUF: Send SSE state events as deltas that only carry the fields that changed since the last event.
+   *  Only clients that open /events?delta=DELTA_PROTOCOL_VERSION get them (the v2 frontend source does, once
+   *  server_index_v2.h is rebuilt from it).
+   *  Arduino (ESPAsyncWebServer) only, the ESP-IDF event source does not implement it. */
+  void set_delta_events(bool delta_events) { this->delta_events_ = delta_events; }
+
   /** KAUF: Set the name of the featured entity (optional). */
   void set_featured_name(const std::string &name) { this->featured_name_ = name; }
 
@@ -268,9 +260,33 @@ class WebServer final : public Controller, public Component, public AsyncWebHand
   /// Handle an index request under '/'.
   void handle_index_request(AsyncWebServerRequest *request);
 
-  /// KAUF: Handle a streamed state dump request under '/state'.
+  /// KAUF: Index used for REST lookups and SSE deferred queue dedup.
+  const EntityIndex &get_entity_index() const { return this->entity_index_; }
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  /// KAUF: Request path instrumentation.
+  WebServerDiagnostics &get_diagnostics() { return this->diagnostics_; }
+  /// KAUF: Handle a diagnostics request under '/diagnostics'.
+  void handle_diagnostics_request(AsyncWebServerRequest *request);
+#endif
+
+  /// KAUF: Handle a chunked state dump request under '/state'.
   void handle_state_request(AsyncWebServerRequest *request);
 
+  /** KAUF: Handle a batch of entity commands under '/batch' (POST).
+   *
+   * The `commands` parameter holds a JSON array like `[{"path":"/switch/Relay/turn_on"},
+   * {"path":"/light/Bulb/turn_on","brightness":128}]`, where each path and parameter means the same as the matching
+   * REST request. All commands are validated first; the valid ones run in order in a single deferred callback and the
+   * response lists a result per command.
+   */
+  void handle_batch_request(AsyncWebServerRequest *request);
+
+#ifdef USE_WEBSERVER_METRICS
+  /// KAUF: Handle a Prometheus/OpenMetrics text scrape under '/metrics'.
+  void handle_metrics_request(AsyncWebServerRequest *request);
+#endif
+
   /// Return the webserver configuration as JSON.
   json::SerializationBuffer<> get_config_json();
 
@@ -526,6 +542,76 @@ class WebServer final : public Controller, public Component, public AsyncWebHand
 
  protected:
   void add_sorting_info_(JsonObject &root, EntityBase *entity);
+  void build_entity_index_();
+  // KAUF: delta state events
+  json::SerializationBuffer<> serialize_state_(json::JsonBuilder &builder, JsonObject &root, EntityBase *obj,
+                                               JsonDetail start_config);
+  json::SerializationBuffer<> serialize_builder_(json::JsonBuilder &builder);
+  void invalidate_delta_(const void *source);
+  // KAUF: batch commands. parse_batch_() returns nullptr and adds one result per command, or the error if the
+  // commands are not a JSON array. prepare_batch_command_() returns nullptr and appends the action, or the error.
+  static constexpr uint8_t BATCH_MAX_COMMANDS = 32;
+  const char *parse_batch_(const char *data, size_t len, JsonArray results,
+                           std::vector<std::function<void()>> &actions);
+  const char *prepare_batch_command_(const UrlMatch &match, JsonObjectConst cmd,
+                                     std::vector<std::function<void()>> &actions);
+
+  bool keep_looping_() const;  // KAUF
+  void handle_request_(AsyncWebServerRequest *request);
+
+  // KAUF: push a state event to the SSE clients and, if enabled, the WebSocket clients
+  using state_generator_t = json::SerializationBuffer<>(WebServer *, void *);
+  void send_state_event_(EntityBase *obj, state_generator_t *generator);
+
+#ifdef USE_WEBSERVER_WEBSOCKET
+  /* KAUF: WebSocket transport on '/ws' (Arduino only).
+   *
+   * Text frames from the client are JSON arrays of batch commands (see handle_batch_request()) and are answered
+   * with {"results":[...]}. State changes are pushed as the same JSON as the SSE "state" events.
+   *
+   * A client that sends the binary HELLO frame gets the short id map as {"entities":[{"sid":0,"name_id":...}]} and
+   * from then on binary state frames instead of JSON. Binary frames are little endian:
+   *   STATE   (to client):   0x01, sid (u16), value
+   *   COMMAND (from client): 0x02, sid (u16), value
+   *   RESULT  (to client):   0x03, sid (u16), status (WsStatus)
+   * where value is a WsValueType byte followed by nothing, a u8 bool, a float32 or a u8 length and that many bytes.
+   * A float command is MALFORMED if it is NaN or out of range: 0..1 for light brightness and cover/valve position,
+   * 1..speed_count for fan speed. A lock takes a bool (lock/unlock) or the string "lock", "unlock" or "open"; it is
+   * only opened by an explicit "open".
+   *
+   * After connecting, and again after HELLO (following the id map), a client gets the state of every entity, paced
+   * by its send queue from loop(). A client that misses a state push because its queue is full gets another full
+   * snapshot once the current one is through.
+   */
+  enum WsOpcode : uint8_t { WS_OP_HELLO = 0x00, WS_OP_STATE = 0x01, WS_OP_COMMAND = 0x02, WS_OP_RESULT = 0x03 };
+  enum WsValueType : uint8_t { WS_VALUE_NONE = 0, WS_VALUE_BOOL = 1, WS_VALUE_FLOAT = 2, WS_VALUE_STRING = 3 };
+  enum WsStatus : uint8_t {
+    WS_STATUS_OK = 0,
+    WS_STATUS_NOT_FOUND = 1,
+    WS_STATUS_UNSUPPORTED = 2,
+    WS_STATUS_MALFORMED = 3,
+  };
+  static constexpr size_t WS_MAX_MESSAGE = 2048;
+  static constexpr size_t WS_MAX_STATE_FRAME = 4 + 1 + 255;
+  static constexpr uint16_t WS_SYNC_DONE = UINT16_MAX;
+  struct WsClient {
+    uint32_t id;
+    bool binary;
+    bool resync;         // missed an update during the running snapshot, start another one after it
+    uint16_t sync_next;  // next EntityIndex id of the running snapshot, WS_SYNC_DONE if none
+  };
+  void on_ws_event_(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+  void on_ws_message_(uint32_t client_id, bool binary, const std::string &message);
+  void ws_send_entity_map_(AsyncWebSocketClient *client);
+  void ws_send_state_(EntityBase *obj, state_generator_t *generator);
+  void ws_sync_clients_();
+  size_t ws_encode_state_(uint16_t sid, uint8_t *buf);
+  uint8_t ws_binary_command_(const uint8_t *data, size_t len);
+#endif
+  void index_entity_(EntityDomain domain, EntityBase *entity, const std::string &featured_name);
+  // KAUF: /state response cursor and the per-entity JSON it writes
+  class StateCursor;
+  bool entity_state_json_(EntityBase *entity, EntityDomain domain, std::string &out);
 
 #ifdef USE_LIGHT
   // Helper to parse and apply a float parameter with optional scaling
@@ -610,6 +696,45 @@ class WebServer final : public Controller, public Component, public AsyncWebHand
 #endif
   bool expose_log_{true};
   std::string featured_name_{}; // KAUF: variable to store featured name
+  EntityIndex entity_index_;    // KAUF: REST URL -> entity lookup, built in setup()
+  EntityBase *featured_entity_{nullptr};  // KAUF: entity written first by /state, resolved in setup()
+  EntityDomain featured_domain_{ENTITY_DOMAIN_SENSOR};
+
+  // KAUF: last sent state per entity (indexed by EntityIndex id), as hashes of its key/value pairs. Only allocated
+  // while SSE clients are connected and delta events are enabled.
+  static constexpr uint8_t DELTA_MAX_FIELDS = 16;
+  static constexpr uint8_t DELTA_PROTOCOL_VERSION = 1;  // advertised by the client as /events?delta=N
+  struct DeltaSnapshot {
+    uint32_t fields[DELTA_MAX_FIELDS];
+    uint8_t count;
+  };
+  std::unique_ptr<DeltaSnapshot[]> delta_snapshots_;
+  const void *delta_source_{nullptr};  // entity whose state event is serialized as a delta right now
+  bool delta_events_{false};
+
+#ifdef USE_WEBSERVER_DIAGNOSTICS
+  WebServerDiagnostics diagnostics_;
+#endif
+
+#ifdef USE_WEBSERVER_METRICS
+  // KAUF: longest main loop iteration beyond the loop interval, kept per fixed window
+  static constexpr uint32_t METRICS_LOOP_WINDOW_MS = 60000;
+  void record_loop_time_();
+  void rotate_loop_window_(uint32_t now_ms);
+  uint32_t loop_time_max_us_(uint32_t now_ms) const;
+  uint32_t metrics_last_loop_us_{0};
+  uint32_t metrics_loop_max_us_{0};       // current window
+  uint32_t metrics_loop_max_prev_us_{0};  // previous window
+  uint32_t metrics_window_start_ms_{0};
+  // written by handle_metrics_request(), which runs in the server task on ESP32
+  Counter<uint32_t> metrics_scrape_ms_{0};
+  Counter<bool> metrics_scraped_{false};
+#endif
+
+#ifdef USE_WEBSERVER_WEBSOCKET
+  AsyncWebSocket ws_{"/ws"};
+  std::vector<WsClient> ws_clients_;  // connected clients, maintained in the main loop
+#endif
 
  private:
 #ifdef USE_SENSOR
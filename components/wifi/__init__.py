@@ -440,6 +440,16 @@ def _validate(config):
 
         config[CONF_USE_ADDRESS] = use_address
 
+    # KAUF: cached_ip reuses the lease of the network fast_connect reconnects to
+    if config["cached_ip"]:
+        if not CORE.is_esp8266:
+            raise cv.Invalid("cached_ip is only supported on esp8266")
+        if not config[CONF_FAST_CONNECT]:
+            raise cv.Invalid("cached_ip requires fast_connect")
+    # KAUF: the esp8266 SDK can scan a single channel, which targeted_scan relies on
+    if config["targeted_scan"] and not CORE.is_esp8266:
+        raise cv.Invalid("targeted_scan is only supported on esp8266")
+
     return config
 
 
@@ -510,6 +520,13 @@ CONFIG_SCHEMA = cv.All(
             cv.Optional("forced_addr"): cv.int_,
             cv.Optional("disable_scanning", default=False): cv.boolean,
             cv.Optional("only_networks", default=False): cv.boolean,
+            cv.Optional("connect_timeline", default=False): cv.boolean,
+            cv.Optional("cached_ip", default=False): cv.boolean,
+            cv.Optional("targeted_scan", default=False): cv.boolean,
+            cv.Optional("roaming_trend", default=False): cv.boolean,
+            cv.Optional("scan_results_limit"): cv.All(
+                cv.only_on_esp8266, cv.int_range(min=1, max=32)
+            ),
         }
     ),
     _apply_min_auth_mode_default,
@@ -627,7 +644,8 @@ async def to_code(config):
         add_idf_sdkconfig_option("CONFIG_ESP_WIFI_ENTERPRISE_SUPPORT", has_eap)
 
     # Only define USE_WIFI_MANUAL_IP if any AP uses manual IP
-    if has_manual_ip:
+    # KAUF: cached_ip connects with the cached lease as a manual IP
+    if has_manual_ip or config["cached_ip"]:
         cg.add_define("USE_WIFI_MANUAL_IP")
 
     cg.add(var.set_reboot_timeout(config[CONF_REBOOT_TIMEOUT]))
@@ -759,6 +777,17 @@ async def to_code(config):
 
     # KAUF: configure other options
     cg.add(var.set_disable_scanning(config["disable_scanning"]))
+    if config["connect_timeline"]:
+        cg.add_define("USE_WIFI_CONNECT_TIMELINE")
+    if config["cached_ip"]:
+        cg.add_define("USE_WIFI_CACHED_IP")
+    if config["targeted_scan"]:
+        cg.add_define("USE_WIFI_TARGETED_SCAN")
+    if config["roaming_trend"]:
+        cg.add_define("USE_WIFI_ROAMING_TREND")
+    # KAUF: bounded scan results, configured networks first then the strongest others
+    if "scan_results_limit" in config:
+        cg.add_define("USE_WIFI_SCAN_RESULTS_LIMIT", config["scan_results_limit"])
 
     CORE.add_job(final_step)
 
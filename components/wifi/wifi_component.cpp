@@ -491,6 +491,7 @@ bool WiFiComponent::matches_configured_network_(const char *ssid, const uint8_t
   if (ssid[0] == '\0') {
     return false;
   }
+  const uint32_t ssid_hash = wifi_ssid_hash(ssid, strlen(ssid));
   for (const auto &sta : this->sta_) {
     // Skip hidden network configs (they don't appear in normal scans)
     if (sta.get_hidden()) {
@@ -503,8 +504,8 @@ bool WiFiComponent::matches_configured_network_(const char *ssid, const uint8_t
       }
       continue;
     }
-    // Match by SSID
-    if (sta.ssid_ == ssid) {
+    // Match by SSID (KAUF: hash first)
+    if (sta.ssid_hash_ == ssid_hash && sta.ssid_ == ssid) {
       return true;
     }
   }
@@ -672,6 +673,9 @@ void WiFiComponent::start() {
 #ifdef USE_WIFI_FAST_CONNECT
   this->fast_connect_pref_ = global_preferences->make_preference<wifi::SavedWifiFastConnectSettings>(hash + 1, false);
 #endif
+#ifdef USE_WIFI_CACHED_IP
+  this->cached_ip_pref_ = global_preferences->make_preference<wifi::SavedWifiCachedIPSettings>(hash + 2, false);
+#endif
 
   SavedWifiSettings save{};
   if (this->pref_.load(&save)) {
@@ -721,6 +725,9 @@ void WiFiComponent::start() {
       ESP_LOGV(TAG, "Setting Power Save Option failed");
     }
 
+#ifdef USE_WIFI_CONNECT_TIMELINE
+    this->timeline_begin_();
+#endif
     this->transition_to_phase_(WiFiRetryPhase::INITIAL_CONNECT);
 #ifdef USE_WIFI_FAST_CONNECT
     if (this->fast_connect_enabled_) {  // KAUF: allow disabling of fast connect
@@ -729,6 +736,14 @@ void WiFiComponent::start() {
       // Fast connect optimization: only use when we have saved BSSID+channel data
       // Without saved data, try first configured network or use normal flow
       if (loaded_fast_connect) {
+#ifdef USE_WIFI_TARGETED_SCAN
+        this->preferred_channel_ = params.get_channel();
+        this->remember_channel_(this->preferred_channel_);
+#endif
+#ifdef USE_WIFI_CACHED_IP
+        // KAUF: skip DHCP by bringing the interface up with the last lease, checked once connected
+        this->using_cached_ip_ = this->load_cached_ip_(params);
+#endif
         ESP_LOGI(TAG, "Starting fast_connect (saved) " LOG_SECRET("'%s'"), params.ssid_.c_str());
         this->start_connecting(params);
       } else if (!this->sta_.empty() && !this->sta_[0].get_hidden()) {
@@ -848,12 +863,21 @@ void WiFiComponent::loop() {
         // Use cached connected_ set unconditionally at the top of loop()
         if (!this->connected_) {
           ESP_LOGW(TAG, "Connection lost; reconnecting");
+#ifdef USE_WIFI_CONNECT_TIMELINE
+          this->timeline_begin_();
+#endif
           this->state_ = WIFI_COMPONENT_STATE_STA_CONNECTING;
           this->retry_connect();
         } else {
           this->status_clear_warning();
           this->last_connected_ = now;
 
+#ifdef USE_WIFI_CACHED_IP
+          if (this->cached_ip_checking_ && this->cached_ip_check_due_(now)) {
+            this->finish_cached_ip_check_();
+          }
+#endif
+
           // Post-connect roaming: check for better AP
           if (this->post_connect_roaming_) {
             if (this->roaming_state_ == RoamingState::SCANNING) {
@@ -861,10 +885,18 @@ void WiFiComponent::loop() {
                 this->process_roaming_scan_();
               }
               // else: scan in progress, wait
+#ifdef USE_WIFI_ROAMING_TREND
+            } else if (this->roaming_state_ == RoamingState::IDLE &&
+                       now - this->roaming_trend_last_sample_ >= ROAMING_TREND_SAMPLE_INTERVAL) {
+              // KAUF: roam checks follow the RSSI trend instead of ROAMING_CHECK_INTERVAL
+              this->update_roaming_trend_(now);
+            }
+#else
             } else if (this->roaming_state_ == RoamingState::IDLE && this->roaming_attempts_ < ROAMING_MAX_ATTEMPTS &&
                        now - this->roaming_last_check_ >= ROAMING_CHECK_INTERVAL) {
               this->check_roaming_(now);
             }
+#endif
           }
         }
         break;
@@ -964,6 +996,10 @@ network::IPAddress WiFiComponent::get_dns_address(int num) {
 
 #ifdef USE_WIFI_AP
 void WiFiComponent::setup_ap_config_() {
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: a connection attempt, the AP fallback or disabling ends a running chain of single channel scans
+  this->reset_targeted_scan_();
+#endif
   this->wifi_mode_({}, true);
 
   if (this->ap_setup_)
@@ -1180,6 +1216,10 @@ void WiFiComponent::connect_soon_() {
 }
 
 void WiFiComponent::start_connecting(const WiFiAP &ap) {
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: a connection attempt, the AP fallback or disabling ends a running chain of single channel scans
+  this->reset_targeted_scan_();
+#endif
   // Log connection attempt at INFO level with priority
   char bssid_s[18];
   int8_t priority = 0;
@@ -1267,6 +1307,18 @@ void WiFiComponent::start_connecting(const WiFiAP &ap) {
   // restart_adapter() which enters COOLDOWN without calling start_connecting().
   this->error_from_callback_ = false;
 
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  if (!this->timeline_active_)
+    this->timeline_begin_();
+  // KAUF: a cycle counts with its first connect attempt, so roaming scans that don't lead to one are not counted
+  if (this->timeline_current_.attempts == 0)
+    this->timeline_cycles_++;
+  this->timeline_current_.attempts++;
+  this->timeline_associated_ = 0;
+  this->timeline_got_ip_ = 0;
+  this->timeline_attempt_started_ = millis();
+#endif
+
   if (!this->wifi_sta_connect_(ap)) {
     ESP_LOGE(TAG, "wifi_sta_connect_ failed");
     // Enter cooldown to allow WiFi hardware to stabilize
@@ -1381,6 +1433,10 @@ void WiFiComponent::disable() {
     return;
 
   ESP_LOGD(TAG, "Disabling");
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: a connection attempt, the AP fallback or disabling ends a running chain of single channel scans
+  this->reset_targeted_scan_();
+#endif
   this->state_ = WIFI_COMPONENT_STATE_DISABLED;
   this->wifi_disconnect_();
   this->wifi_mode_(false, false);
@@ -1392,11 +1448,50 @@ void WiFiComponent::start_scanning() {
   // KAUF: allow a configuration to short circuit out of scanning process.
   if (this->disable_scanning) return;
   this->action_started_ = millis();
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  if (!this->timeline_active_)
+    this->timeline_begin_();
+  this->timeline_current_.scans++;
+#endif
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: try the channels configured networks were last seen on before a full scan, unless every network is wanted
+  this->scan_channels_left_ = this->needs_full_scan_results_() ? 0 : this->known_channels_;
+  // The channels of one chain add up their results (scan callback), a new chain starts without any
+  this->scan_result_.clear();
+  if (this->start_next_targeted_scan_()) {
+    this->state_ = WIFI_COMPONENT_STATE_STA_SCANNING;
+    return;
+  }
+#endif
   ESP_LOGD(TAG, "Starting scan");
   this->wifi_scan_start_(this->passive_scan_);
   this->state_ = WIFI_COMPONENT_STATE_STA_SCANNING;
 }
 
+#ifdef USE_WIFI_TARGETED_SCAN
+bool WiFiComponent::start_next_targeted_scan_() {
+  this->scan_channel_ = 0;
+  if (this->scan_channels_left_ == 0)
+    return false;
+  uint8_t channel = this->preferred_channel_;
+  if (channel > MAX_TARGETED_SCAN_CHANNEL || (this->scan_channels_left_ & (1 << channel)) == 0) {
+    channel = 1;
+    while ((this->scan_channels_left_ & (1 << channel)) == 0)
+      channel++;
+  }
+  this->scan_channels_left_ &= ~(1 << channel);
+  this->scan_channel_ = channel;
+  ESP_LOGD(TAG, "Starting scan on channel %u", channel);
+  this->action_started_ = millis();
+  if (!this->wifi_scan_start_(this->passive_scan_)) {
+    // Let the full scan handle the failure
+    this->reset_targeted_scan_();
+    return false;
+  }
+  return true;
+}
+#endif
+
 /// Comparator for WiFi scan result sorting - determines which network should be tried first
 /// Returns true if 'a' should be placed before 'b' in the sorted order (a is "better" than b)
 ///
@@ -1483,7 +1578,13 @@ template<typename VectorType> static void insertion_sort_scan_results(VectorType
   static_assert(std::is_standard_layout<WiFiScanResult>::value, "WiFiScanResult must be standard layout");
   static_assert(std::is_standard_layout<CompactString>::value, "CompactString must be standard layout");
   // Size checks catch added/removed fields that may need safety review
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+  // KAUF: InternedSsid is a pointer and a length, trivially copyable
+  static_assert(std::is_trivially_copyable<InternedSsid>::value, "InternedSsid must be trivially copyable");
+  static_assert(sizeof(WiFiScanResult) <= 32, "WiFiScanResult size changed - verify memcpy sort is still safe");
+#else
   static_assert(sizeof(WiFiScanResult) == 32, "WiFiScanResult size changed - verify memcpy sort is still safe");
+#endif
   static_assert(sizeof(CompactString) == 20, "CompactString size changed - verify memcpy sort is still safe");
   // Alignment must match for reinterpret_cast of key_buf to be valid
   static_assert(alignof(WiFiScanResult) <= alignof(std::max_align_t), "WiFiScanResult alignment exceeds max_align_t");
@@ -1537,15 +1638,50 @@ void WiFiComponent::check_scanning_finished() {
   if (!this->scan_done_) {
     if (millis() - this->action_started_ > WIFI_SCAN_TIMEOUT_MS) {
       ESP_LOGE(TAG, "Scan timeout");
+#ifdef USE_WIFI_CONNECT_TIMELINE
+      this->timeline_current_.scan_ms += millis() - this->action_started_;
+#endif
       this->retry_connect();
     }
     return;
   }
   this->scan_done_ = false;
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  this->timeline_current_.scan_ms += millis() - this->action_started_;
+#endif
   this->has_completed_scan_after_captive_portal_start_ =
       true;  // Track that we've done a scan since captive portal started
   this->retry_hidden_mode_ = RetryHiddenMode::SCAN_BASED;
 
+#ifdef USE_WIFI_TARGETED_SCAN
+  if (this->scan_channel_ != 0) {
+    // Results only hold configured SSIDs here (filtered in the scan callback), collected over the channels scanned
+    // so far; only this channel's can be strong, the chain would have ended on an earlier one
+    bool seen = false;
+    bool strong = false;
+    for (const auto &res : this->scan_result_) {
+      if (res.get_channel() != this->scan_channel_)
+        continue;
+      seen = true;
+      strong |= res.get_rssi() >= TARGETED_SCAN_GOOD_RSSI;
+    }
+    if (!seen) {
+      // Nothing configured lives on this channel anymore
+      this->known_channels_ &= ~(1 << this->scan_channel_);
+    }
+    if (!strong) {
+      if (!this->start_next_targeted_scan_()) {
+        ESP_LOGD(TAG, "No strong network on known channels, starting full scan");
+        this->action_started_ = millis();
+        this->wifi_scan_start_(this->passive_scan_);
+      }
+      return;
+    }
+    // Early exit: connect from the results so far, skip the remaining channels
+    this->reset_targeted_scan_();
+  }
+#endif
+
   if (this->scan_result_.empty()) {
     ESP_LOGW(TAG, "No networks found");
     this->retry_connect();
@@ -1554,7 +1690,11 @@ void WiFiComponent::check_scanning_finished() {
 
   ESP_LOGD(TAG, "Found networks:");
   for (auto &res : this->scan_result_) {
+    // KAUF: SSID hash once per result; matches() only runs for configs whose SSID can match
+    const uint32_t ssid_hash = wifi_ssid_hash(res.ssid_.data(), res.ssid_.size());
     for (auto &ap : this->sta_) {
+      if (!ap.get_hidden() && !ap.ssid_.empty() && ap.ssid_hash_ != ssid_hash)
+        continue;
       if (res.matches(ap)) {
         res.set_matches(true);
         // Cache priority lookup - do single search instead of 2 separate searches
@@ -1563,6 +1703,9 @@ void WiFiComponent::check_scanning_finished() {
           this->set_sta_priority(bssid, ap.get_priority());
         }
         res.set_priority(this->get_sta_priority(bssid));
+#ifdef USE_WIFI_TARGETED_SCAN
+        this->remember_channel_(res.get_channel());
+#endif
         break;
       }
     }
@@ -1647,6 +1790,14 @@ void WiFiComponent::dump_config() {
 #endif
 #ifdef USE_WIFI_PHY_MODE
   ESP_LOGCONFIG(TAG, "  PHY Mode: %s", LOG_STR_ARG(phy_mode_to_log_string(this->phy_mode_)));
+#endif
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  if (this->boot_connected_ms_ != 0) {
+    ESP_LOGCONFIG(TAG,
+                  "  Boot to connected: %" PRIu32 " ms\n"
+                  "  Connect cycles: %" PRIu32,
+                  this->boot_connected_ms_, this->timeline_cycles_);
+  }
 #endif
   if (this->is_connected()) {
     this->print_connect_params_();
@@ -1672,6 +1823,9 @@ void WiFiComponent::check_connecting_finished(uint32_t now) {
                                                           this->scan_result_.empty()) {
       ESP_LOGW(TAG, LOG_SECRET("'%s'") " should be marked hidden", config->ssid_.c_str());
     }
+#ifdef USE_WIFI_CONNECT_TIMELINE
+    this->timeline_connected_();
+#endif
     // Reset to initial phase on successful connection (don't log transition, just reset state)
     this->retry_phase_ = WiFiRetryPhase::INITIAL_CONNECT;
     this->num_retried_ = 0;
@@ -1728,6 +1882,15 @@ void WiFiComponent::check_connecting_finished(uint32_t now) {
     this->roaming_state_ = RoamingState::IDLE;
     this->roaming_target_bssid_ = {};
     this->roaming_scan_end_ = 0;
+#ifdef USE_WIFI_ROAMING_TREND
+    // KAUF: new link, new trend; the per-BSSID history is kept
+    this->rssi_samples_ = 0;
+    this->degraded_samples_ = 0;
+    this->roaming_trend_last_sample_ = now;
+    WiFiBssidQuality *quality = this->find_bssid_quality_(this->wifi_bssid(), false);
+    if (quality != nullptr)
+      quality->roam_failures = 0;
+#endif
 
     // Clear all priority penalties - the next reconnect will happen when an AP disconnects,
     // which means the landscape has likely changed and previous tracked failures are stale
@@ -1736,6 +1899,15 @@ void WiFiComponent::check_connecting_finished(uint32_t now) {
 #ifdef USE_WIFI_FAST_CONNECT
     this->save_fast_connect_settings_();
 #endif
+#ifdef USE_WIFI_TARGETED_SCAN
+    this->preferred_channel_ = this->get_wifi_channel();
+    this->remember_channel_(this->preferred_channel_);
+#endif
+#ifdef USE_WIFI_CACHED_IP
+    if (this->using_cached_ip_) {
+      this->start_cached_ip_check_();
+    }
+#endif
 
     this->release_scan_results_();
 
@@ -1952,6 +2124,10 @@ bool WiFiComponent::transition_to_phase_(WiFiRetryPhase new_phase) {
 
   this->retry_phase_ = new_phase;
   this->num_retried_ = 0;  // Reset retry counter on phase change
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  if (this->timeline_active_)
+    this->timeline_current_.transitions++;
+#endif
 
   // Phase-specific setup
   switch (new_phase) {
@@ -2203,12 +2379,22 @@ void WiFiComponent::advance_to_next_target_or_increment_retry_() {
 }
 
 void WiFiComponent::retry_connect() {
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: the next scan starts a new chain
+  this->reset_targeted_scan_();
+#endif
   // Handle roaming state transitions - preserve attempts counter to prevent ping-pong
   // to unreachable APs after ROAMING_MAX_ATTEMPTS failures
   if (this->roaming_state_ == RoamingState::CONNECTING) {
     // Roam connection failed - transition to reconnecting
     ESP_LOGD(TAG, "Roam failed, reconnecting (attempt %u/%u)", this->roaming_attempts_, ROAMING_MAX_ATTEMPTS);
     this->roaming_state_ = RoamingState::RECONNECTING;
+#ifdef USE_WIFI_ROAMING_TREND
+    // KAUF: remembered across roams, makes this AP a worse candidate next time
+    WiFiBssidQuality *quality = this->find_bssid_quality_(this->roaming_target_bssid_, true);
+    if (quality != nullptr && quality->roam_failures < ROAMING_MAX_FAILURES)
+      quality->roam_failures++;
+#endif
   } else if (this->roaming_state_ == RoamingState::SCANNING) {
     // Disconnected during roam scan - transition to RECONNECTING so the attempts
     // counter is preserved when reconnection succeeds (IDLE would reset it)
@@ -2228,6 +2414,12 @@ void WiFiComponent::retry_connect() {
   }
   // RECONNECTING: keep state and counter, still trying to reconnect
 
+#ifdef USE_WIFI_CACHED_IP
+  // KAUF: only the first fast_connect attempt uses the cached lease, retries go through DHCP
+  this->using_cached_ip_ = false;
+  this->stop_cached_ip_check_();
+#endif
+
   this->log_and_adjust_priority_for_failed_connect_();
 
   // Determine next retry phase based on current state
@@ -2403,8 +2595,17 @@ bool WiFiComponent::get_initial_ap() {
   return false;
 }
 
-void WiFiAP::set_ssid(const std::string &ssid) { this->ssid_ = CompactString(ssid.c_str(), ssid.size()); }
-void WiFiAP::set_ssid(const char *ssid) { this->ssid_ = CompactString(ssid, strlen(ssid)); }
+uint32_t wifi_ssid_hash(const char *ssid, size_t len) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= static_cast<uint8_t>(ssid[i]);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+void WiFiAP::set_ssid(const std::string &ssid) { this->set_ssid(StringRef(ssid.c_str(), ssid.size())); }
+void WiFiAP::set_ssid(const char *ssid) { this->set_ssid(StringRef(ssid, strlen(ssid))); }
 void WiFiAP::set_bssid(const bssid_t &bssid) { this->bssid_ = bssid; }
 void WiFiAP::clear_bssid() { this->bssid_ = {}; }
 void WiFiAP::set_password(const std::string &password) {
@@ -2505,6 +2706,52 @@ void WiFiComponent::release_scan_results_() {
   }
 }
 
+#ifdef USE_WIFI_CONNECT_TIMELINE
+// KAUF: a cycle starts at boot, when the connection is lost, or with the first scan / attempt after that (roaming)
+void WiFiComponent::timeline_begin_() {
+  this->timeline_current_ = {};
+  this->timeline_current_.started = millis();
+  this->timeline_associated_ = 0;
+  this->timeline_got_ip_ = 0;
+  this->timeline_active_ = true;
+}
+
+void WiFiComponent::timeline_connected_() {
+  if (!this->timeline_active_)
+    return;
+  const uint32_t now = millis();
+  const uint32_t associated = this->timeline_associated_;
+  const uint32_t got_ip = this->timeline_got_ip_;
+  WiFiConnectRecord &rec = this->timeline_current_;
+  rec.total_ms = now - rec.started;
+  rec.phase = this->retry_phase_;
+  uint32_t last_event = this->timeline_attempt_started_;
+  if (associated != 0) {
+    rec.link_ms = associated - this->timeline_attempt_started_;
+    last_event = associated;
+  }
+  if (got_ip != 0 && associated != 0) {
+    rec.dhcp_ms = got_ip - associated;
+    last_event = got_ip;
+  }
+  rec.ready_ms = now - last_event;
+
+  this->timeline_[this->timeline_head_] = rec;
+  this->timeline_head_ = (this->timeline_head_ + 1) % CONNECT_TIMELINE_SIZE;
+  if (this->timeline_count_ < CONNECT_TIMELINE_SIZE)
+    this->timeline_count_++;
+  if (this->boot_connected_ms_ == 0)
+    this->boot_connected_ms_ = now;
+  this->timeline_active_ = false;
+
+  ESP_LOGD(TAG,
+           "Connected after %" PRIu32 " ms: scan %" PRIu32 " ms (%u), link %" PRIu32 " ms, DHCP %" PRIu32
+           " ms, ready %" PRIu32 " ms, %u attempts, %u phase changes",
+           rec.total_ms, rec.scan_ms, rec.scans, rec.link_ms, rec.dhcp_ms, rec.ready_ms, rec.attempts,
+           rec.transitions);
+}
+#endif
+
 #ifdef USE_WIFI_CONNECT_STATE_LISTENERS
 void WiFiComponent::notify_connect_state_listeners_() {
   if (!this->pending_.connect_state)
@@ -2564,9 +2811,97 @@ void WiFiComponent::check_roaming_(uint32_t now) {
 
   ESP_LOGD(TAG, "Roam scan (%d dBm, attempt %u/%u)", rssi, this->roaming_attempts_, ROAMING_MAX_ATTEMPTS);
   this->roaming_state_ = RoamingState::SCANNING;
+#ifdef USE_WIFI_TARGETED_SCAN
+  this->reset_targeted_scan_();  // KAUF: roam scans cover all channels
+#endif
   this->wifi_scan_start_(this->passive_scan_);
 }
 
+#ifdef USE_WIFI_ROAMING_TREND
+void WiFiComponent::update_roaming_trend_(uint32_t now) {
+  this->roaming_trend_last_sample_ = now;
+  int8_t rssi = this->wifi_rssi();
+  if (rssi == WIFI_RSSI_DISCONNECTED)
+    return;
+
+  // EWMA (alpha 1/4) of the RSSI and of its change per sample, in 1/16 dB
+  const int16_t sample = rssi * 16;
+  if (this->rssi_samples_ == 0) {
+    this->rssi_avg_x16_ = sample;
+    this->rssi_slope_x16_ = 0;
+  } else {
+    const int16_t previous = this->rssi_avg_x16_;
+    this->rssi_avg_x16_ += (sample - this->rssi_avg_x16_) / 4;
+    this->rssi_slope_x16_ += ((this->rssi_avg_x16_ - previous) - this->rssi_slope_x16_) / 4;
+  }
+  if (this->rssi_samples_ < 255)
+    this->rssi_samples_++;
+
+  // Slower EWMA (alpha 1/8) per BSSID, kept across roams
+  for (auto &entry : this->roaming_history_) {
+    if (entry.age < 255)
+      entry.age++;
+  }
+  WiFiBssidQuality *quality = this->find_bssid_quality_(this->wifi_bssid(), true);
+  if (quality != nullptr) {
+    quality->rssi_x16 = quality->rssi_x16 == 0 ? sample : quality->rssi_x16 + (sample - quality->rssi_x16) / 8;
+    quality->age = 0;
+  }
+
+  if (this->rssi_samples_ < ROAMING_TREND_MIN_SAMPLES)
+    return;
+  const bool weak = this->rssi_avg_x16_ < ROAMING_TREND_WEAK_RSSI * 16;
+  const bool falling =
+      this->rssi_avg_x16_ < ROAMING_GOOD_RSSI * 16 && this->rssi_slope_x16_ <= ROAMING_TREND_FALLING_SLOPE;
+  if (!weak && !falling) {
+    // Recovered, a later degradation gets a fresh set of attempts
+    this->degraded_samples_ = 0;
+    this->roaming_attempts_ = 0;
+    return;
+  }
+  if (this->degraded_samples_ < ROAMING_TREND_SUSTAIN)
+    this->degraded_samples_++;
+  if (this->degraded_samples_ < ROAMING_TREND_SUSTAIN || this->roaming_attempts_ >= ROAMING_MAX_ATTEMPTS)
+    return;
+  // Scans of one degradation are 1, 2 and 4 minutes apart
+  if (now - this->roaming_last_check_ < (ROAMING_TREND_BACKOFF << this->roaming_attempts_))
+    return;
+
+  ESP_LOGD(TAG, "Signal degrading (avg %.1f dBm, %+.2f dB/sample)", this->rssi_avg_x16_ / 16.0f,
+           this->rssi_slope_x16_ / 16.0f);
+  this->check_roaming_(now);
+}
+
+WiFiBssidQuality *WiFiComponent::find_bssid_quality_(const bssid_t &bssid, bool create) {
+  if (bssid == bssid_t{})
+    return nullptr;
+  WiFiBssidQuality *slot = nullptr;
+  for (auto &entry : this->roaming_history_) {
+    if (entry.bssid == bssid)
+      return &entry;
+    // An unused entry, otherwise the one not updated for the longest time
+    if (slot == nullptr || entry.bssid == bssid_t{} || (slot->bssid != bssid_t{} && entry.age > slot->age))
+      slot = &entry;
+  }
+  if (!create)
+    return nullptr;
+  *slot = WiFiBssidQuality{bssid, 0, 0, 0};
+  return slot;
+}
+
+int8_t WiFiComponent::roaming_candidate_rssi_(const WiFiScanResult &result) {
+  int16_t rssi = result.get_rssi();
+  const WiFiBssidQuality *quality = this->find_bssid_quality_(result.get_bssid(), false);
+  if (quality != nullptr) {
+    // An AP that did worse while connected than it looks in this scan counts halfway between the two
+    if (quality->rssi_x16 != 0 && quality->rssi_x16 / 16 < rssi)
+      rssi = (rssi + quality->rssi_x16 / 16) / 2;
+    rssi -= quality->roam_failures * ROAMING_FAILURE_PENALTY;
+  }
+  return rssi < -127 ? -127 : rssi;
+}
+#endif
+
 void WiFiComponent::process_roaming_scan_() {
   this->scan_done_ = false;
   // Default to IDLE - will be set to CONNECTING if we find a better AP
@@ -2587,6 +2922,13 @@ void WiFiComponent::process_roaming_scan_() {
   StringRef current_ssid(this->wifi_ssid_to(ssid_buf));
   bssid_t current_bssid = this->wifi_bssid();
 
+#ifdef USE_WIFI_ROAMING_TREND
+  // KAUF: compare against the smoothed signal rather than one sample
+  if (this->rssi_samples_ != 0)
+    current_rssi = this->rssi_avg_x16_ / 16;
+  int8_t best_rssi = 0;
+#endif
+
   // Find best candidate: same SSID, different BSSID
   const WiFiScanResult *best = nullptr;
   char bssid_buf[MAC_ADDRESS_PRETTY_BUFFER_SIZE];
@@ -2602,14 +2944,26 @@ void WiFiComponent::process_roaming_scan_() {
 #endif
 
     // Track the best candidate
+#ifdef USE_WIFI_ROAMING_TREND
+    const int8_t rssi = this->roaming_candidate_rssi_(result);
+    if (best == nullptr || rssi > best_rssi) {
+      best = &result;
+      best_rssi = rssi;
+    }
+#else
     if (best == nullptr || result.get_rssi() > best->get_rssi()) {
       best = &result;
     }
+#endif
   }
 
   // Check if best candidate meets minimum improvement threshold
   const WiFiAP *selected = this->get_selected_sta_();
+#ifdef USE_WIFI_ROAMING_TREND
+  int8_t improvement = (best == nullptr) ? 0 : best_rssi - current_rssi;
+#else
   int8_t improvement = (best == nullptr) ? 0 : best->get_rssi() - current_rssi;
+#endif
   if (selected == nullptr || improvement < ROAMING_MIN_IMPROVEMENT) {
     ESP_LOGV(TAG, "Roam best %+d dB (need +%d), attempt %u/%u", improvement, ROAMING_MIN_IMPROVEMENT,
              this->roaming_attempts_, ROAMING_MAX_ATTEMPTS);
@@ -82,6 +82,19 @@ struct SavedWifiFastConnectSettings {
   int8_t ap_index;
 } PACKED;  // NOLINT
 
+#ifdef USE_WIFI_CACHED_IP
+// KAUF: last DHCP lease of the fast_connect network, addresses in lwIP byte order
+struct SavedWifiCachedIPSettings {
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns1;
+  uint32_t dns2;
+  uint32_t lease_s;
+  int8_t ap_index;
+} PACKED;  // NOLINT
+#endif
+
 enum WiFiComponentState : uint8_t {
   /** Nothing has been initialized yet. Internal AP, if configured, is disabled at this point. */
   WIFI_COMPONENT_STATE_OFF = 0,
@@ -147,6 +160,27 @@ enum class RetryHiddenMode : uint8_t {
   BLIND_RETRY,
 };
 
+#ifdef USE_WIFI_CONNECT_TIMELINE
+/** KAUF: Timing of one connection cycle, from the first scan or connect attempt after boot (or after the connection
+ * was lost) until the state machine reaches STA_CONNECTED.
+ *
+ * link_ms, dhcp_ms and ready_ms describe the attempt that succeeded. The SDKs report association and authentication
+ * as a single event, so link_ms covers both. Phases whose event never arrived (e.g. no DHCP with a static IP) are 0.
+ */
+struct WiFiConnectRecord {
+  uint32_t started;      ///< millis() when the cycle began
+  uint32_t total_ms;     ///< whole cycle, including every failed attempt
+  uint32_t scan_ms;      ///< all scans of the cycle
+  uint32_t link_ms;      ///< connect request to associated and authenticated
+  uint32_t dhcp_ms;      ///< associated to IP address
+  uint32_t ready_ms;     ///< IP address to the connection being handed to other components
+  uint8_t scans;
+  uint8_t attempts;      ///< connect attempts, 1 if the first one succeeded
+  uint8_t transitions;   ///< retry phase changes
+  WiFiRetryPhase phase;  ///< phase of the successful attempt
+};
+#endif
+
 /// Struct for setting static IPs in WiFiComponent.
 struct ManualIP {
   network::IPAddress static_ip;
@@ -241,6 +275,36 @@ static_assert(sizeof(CompactString) == 20, "CompactString must be exactly 20 byt
 static_assert(std::is_standard_layout<CompactString>::value, "CompactString must be standard layout");
 static_assert(!std::is_polymorphic<CompactString>::value, "CompactString must not have vtable");
 
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+/// KAUF: non-owning SSID of a scan result. Points into WiFiComponent's scan SSID arena once the scan callback has
+/// picked the results to keep (before that, into the SDK's scan list), so scan results never allocate.
+class InternedSsid {
+ public:
+  InternedSsid() = default;
+  InternedSsid(const char *str, size_t len) : data_(str), length_(len) {}
+
+  const char *data() const { return this->data_; }
+  const char *c_str() const { return this->data_; }  // Null-terminated once interned
+  size_t size() const { return this->length_; }
+  bool empty() const { return this->length_ == 0; }
+  StringRef ref() const { return StringRef(this->data_, this->length_); }
+
+  bool operator==(const StringRef &other) const {
+    return this->length_ == other.size() && std::memcmp(this->data_, other.c_str(), this->length_) == 0;
+  }
+  bool operator!=(const StringRef &other) const { return !(*this == other); }
+  bool operator==(const CompactString &other) const { return *this == other.ref(); }
+  bool operator!=(const CompactString &other) const { return !(*this == other); }
+
+ protected:
+  const char *data_{""};
+  uint8_t length_{0};
+};
+#endif
+
+/// KAUF: FNV-1a hash of an SSID, compared before the SSID itself when matching scan results
+uint32_t wifi_ssid_hash(const char *ssid, size_t len);
+
 class WiFiAP {
   friend class WiFiComponent;
   friend class WiFiScanResult;
@@ -248,7 +312,10 @@ class WiFiAP {
  public:
   void set_ssid(const std::string &ssid);
   void set_ssid(const char *ssid);
-  void set_ssid(StringRef ssid) { this->ssid_ = CompactString(ssid.c_str(), ssid.size()); }
+  void set_ssid(StringRef ssid) {
+    this->ssid_ = CompactString(ssid.c_str(), ssid.size());
+    this->ssid_hash_ = wifi_ssid_hash(ssid.c_str(), ssid.size());
+  }
   void set_bssid(const bssid_t &bssid);
   void clear_bssid();
   void set_password(const std::string &password);
@@ -288,6 +355,7 @@ class WiFiAP {
 #ifdef USE_WIFI_MANUAL_IP
   optional<ManualIP> manual_ip_;
 #endif
+  uint32_t ssid_hash_{0};  // KAUF: wifi_ssid_hash() of ssid_
   // Group small types together to minimize padding
   bssid_t bssid_{};     // 6 bytes, all zeros = any/not set
   uint8_t channel_{0};  // 1 byte, 0 = auto/not set
@@ -321,7 +389,11 @@ class WiFiScanResult {
   bssid_t bssid_;
   uint8_t channel_;
   int8_t rssi_;
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+  InternedSsid ssid_;  // KAUF: see WiFiComponent::intern_scan_ssid_()
+#else
   CompactString ssid_;
+#endif
   int8_t priority_{0};
   bool matches_{false};
   bool with_auth_;
@@ -333,6 +405,16 @@ struct WiFiSTAPriority {
   int8_t priority;
 };
 
+#ifdef USE_WIFI_ROAMING_TREND
+/// KAUF: how one BSSID did while connected and how often roaming to it failed. Kept across roams.
+struct WiFiBssidQuality {
+  bssid_t bssid;
+  int16_t rssi_x16;       // EWMA of the connected RSSI in 1/16 dB, 0 = never connected
+  uint8_t roam_failures;  // cleared by connecting to it
+  uint8_t age;            // samples since the last update, the oldest entry is replaced
+};
+#endif
+
 enum WiFiPowerSaveMode : uint8_t {
   WIFI_POWER_SAVE_NONE = 0,
   WIFI_POWER_SAVE_LIGHT,
@@ -574,6 +656,21 @@ class WiFiComponent final : public Component {
   // KAUF: function to find out if default credentials are being used
   bool get_initial_ap();
 
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  // KAUF: connection timeline, the last CONNECT_TIMELINE_SIZE completed cycles
+  static constexpr uint8_t CONNECT_TIMELINE_SIZE = 4;
+  uint8_t get_connect_record_count() const { return this->timeline_count_; }
+  /// Completed cycle, 0 is the oldest kept one.
+  const WiFiConnectRecord &get_connect_record(uint8_t index) const {
+    return this->timeline_[(this->timeline_head_ + CONNECT_TIMELINE_SIZE - this->timeline_count_ + index) %
+                           CONNECT_TIMELINE_SIZE];
+  }
+  /// Cycles with at least one connect attempt since boot, including the one in progress.
+  uint32_t get_connect_cycles() const { return this->timeline_cycles_; }
+  /// Milliseconds from boot to the first connection, 0 until then.
+  uint32_t get_boot_to_connected_ms() const { return this->boot_connected_ms_; }
+#endif
+
   int32_t get_wifi_channel();
 
 #ifdef USE_WIFI_IP_STATE_LISTENERS
@@ -666,6 +763,12 @@ class WiFiComponent final : public Component {
   bool matches_configured_network_(const char *ssid, const uint8_t *bssid) const;
   /// Log a discarded scan result at VERBOSE level (skipped during roaming scans to avoid log overflow)
   void log_discarded_scan_result_(const char *ssid, const uint8_t *bssid, int8_t rssi, uint8_t channel);
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+  /// KAUF: copy an SSID into scan_ssid_arena_ (once per distinct SSID) and return the null-terminated copy
+  const char *intern_scan_ssid_(const char *ssid, size_t len);
+  /// KAUF: drop arena SSIDs no scan result points at anymore (results carried over by a targeted scan chain)
+  void compact_scan_ssid_arena_();
+#endif
   /// Find next SSID that wasn't in scan results (might be hidden)
   /// Returns index of next potentially hidden SSID, or -1 if none found
   /// @param start_index Start searching from index after this (-1 to start from beginning)
@@ -681,6 +784,19 @@ class WiFiComponent final : public Component {
   void advance_to_next_target_or_increment_retry_();
   /// Start initial connection - either scan or connect directly to hidden networks
   void start_initial_connection_();
+#ifdef USE_WIFI_TARGETED_SCAN
+  /// KAUF: scan the next channel of scan_channels_left_, preferred_channel_ first. Returns false when none are left.
+  bool start_next_targeted_scan_();
+  /// KAUF: drop an unfinished chain of single channel scans, so the next scan covers all channels again.
+  void reset_targeted_scan_() {
+    this->scan_channels_left_ = 0;
+    this->scan_channel_ = 0;
+  }
+  void remember_channel_(uint8_t channel) {
+    if (channel >= 1 && channel <= MAX_TARGETED_SCAN_CHANNEL)
+      this->known_channels_ |= 1 << channel;
+  }
+#endif
   const WiFiAP *get_selected_sta_() const {
     if (this->selected_sta_index_ >= 0 && static_cast<size_t>(this->selected_sta_index_) < this->sta_.size()) {
       return &this->sta_[this->selected_sta_index_];
@@ -750,15 +866,44 @@ class WiFiComponent final : public Component {
   bool load_fast_connect_settings_(WiFiAP &params);
   void save_fast_connect_settings_();
 #endif
+#ifdef USE_WIFI_CACHED_IP
+  // KAUF: cached lease (esp8266)
+  /// Use the cached lease of the fast_connect network as params' manual IP. Returns false if there is none.
+  bool load_cached_ip_(WiFiAP &params);
+  /// Save the current lease if it came from DHCP.
+  void save_cached_ip_();
+  /// After connecting with the cached lease: send RFC 5227 ARP probes for the own address (conflict) and the gateway.
+  void start_cached_ip_check_();
+  /// True once the probes had their time or another device answered for the cached address.
+  bool cached_ip_check_due_(uint32_t now) const;
+  /// Stop watching for ARP answers.
+  void stop_cached_ip_check_();
+  /// Evaluate the ARP answers and hand the address back to the DHCP client.
+  void finish_cached_ip_check_();
+#endif
 
   // Post-connect roaming methods
   void check_roaming_(uint32_t now);
+#ifdef USE_WIFI_ROAMING_TREND
+  /// KAUF: sample the RSSI into the trend and history, and start a roam check on sustained degradation
+  void update_roaming_trend_(uint32_t now);
+  /// KAUF: history entry of a BSSID; with create, replaces the oldest entry if it has none. nullptr for no BSSID.
+  WiFiBssidQuality *find_bssid_quality_(const bssid_t &bssid, bool create);
+  /// KAUF: scan RSSI of a roam candidate, lowered by a weaker connected history and failed roams to it
+  int8_t roaming_candidate_rssi_(const WiFiScanResult &result);
+#endif
   void process_roaming_scan_();
   void clear_roaming_state_();
 
   /// Free scan results memory unless a component needs them
   void release_scan_results_();
 
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  // KAUF: connection timeline
+  void timeline_begin_();
+  void timeline_connected_();
+#endif
+
 #ifdef USE_WIFI_CONNECT_STATE_LISTENERS
   /// Notify connect state listeners (called after state machine reaches STA_CONNECTED)
   void notify_connect_state_listeners_();
@@ -820,6 +965,9 @@ class WiFiComponent final : public Component {
   ESPPreferenceObject fast_connect_pref_;
   bool fast_connect_enabled_{true};
 #endif
+#ifdef USE_WIFI_CACHED_IP
+  ESPPreferenceObject cached_ip_pref_;
+#endif
 #ifdef USE_WIFI_CONNECT_TRIGGER
   Trigger<> connect_trigger_;
 #endif
@@ -841,6 +989,35 @@ class WiFiComponent final : public Component {
   // window (e.g., ESP8266 Beacon Timeout caused by going off-channel during scan),
   // the disconnect is treated as roaming-related and the attempts counter is preserved.
   static constexpr uint32_t ROAMING_SCAN_GRACE_PERIOD = 30 * 1000;  // 30 seconds
+#ifdef USE_WIFI_ROAMING_TREND
+  // KAUF: RSSI trend roaming, replaces the fixed ROAMING_CHECK_INTERVAL schedule
+  static constexpr uint32_t ROAMING_TREND_SAMPLE_INTERVAL = 10 * 1000;
+  static constexpr uint8_t ROAMING_TREND_MIN_SAMPLES = 3;     // before the average is trusted
+  static constexpr int8_t ROAMING_TREND_WEAK_RSSI = -70;      // average below this is degraded
+  static constexpr int16_t ROAMING_TREND_FALLING_SLOPE = -8;  // 1/16 dB per sample, below ROAMING_GOOD_RSSI
+  static constexpr uint8_t ROAMING_TREND_SUSTAIN = 3;         // degraded samples in a row before a scan
+  static constexpr uint32_t ROAMING_TREND_BACKOFF = 60 * 1000;  // doubled by each attempt
+  static constexpr int8_t ROAMING_FAILURE_PENALTY = 5;          // dB per failed roam to a BSSID
+  static constexpr uint8_t ROAMING_MAX_FAILURES = 4;
+  static constexpr uint8_t ROAMING_HISTORY_SIZE = 8;
+#endif
+
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: 2.4 GHz channels tracked for targeted scans
+  static constexpr uint8_t MAX_TARGETED_SCAN_CHANNEL = 14;
+  // KAUF: a configured network this strong on a known channel ends the scan early
+  static constexpr int8_t TARGETED_SCAN_GOOD_RSSI = -75;
+#endif
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+  // KAUF: arena entry is a length byte, up to 32 SSID bytes and a null terminator
+  static constexpr size_t SCAN_SSID_ENTRY_SIZE = 1 + 32 + 1;
+#endif
+#ifdef USE_WIFI_CACHED_IP
+  // KAUF: how long to wait for ARP answers after connecting with the cached lease
+  static constexpr uint32_t CACHED_IP_CHECK_MS = 1000;
+  // KAUF: shorter leases are not cached, the time the device was off would likely have used them up
+  static constexpr uint32_t CACHED_IP_MIN_LEASE_S = 60 * 60;
+#endif
 
   // 4-byte members
   float output_power_{NAN};
@@ -849,9 +1026,48 @@ class WiFiComponent final : public Component {
   uint32_t reboot_timeout_{};
   uint32_t roaming_last_check_{0};
   uint32_t roaming_scan_end_{0};  // Timestamp when last roaming scan completed
+#ifdef USE_WIFI_ROAMING_TREND
+  // KAUF: RSSI trend of the current link
+  uint32_t roaming_trend_last_sample_{0};
+  int16_t rssi_avg_x16_{0};
+  int16_t rssi_slope_x16_{0};
+  uint8_t rssi_samples_{0};
+  uint8_t degraded_samples_{0};
+  WiFiBssidQuality roaming_history_[ROAMING_HISTORY_SIZE]{};
+#endif
+#ifdef USE_WIFI_CACHED_IP
+  uint32_t cached_ip_check_started_{0};
+#endif
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: bit n set = a configured network was seen on / connected to channel n
+  uint16_t known_channels_{0};
+  uint16_t scan_channels_left_{0};
+  uint8_t preferred_channel_{0};
+  // Channel of the running targeted scan, 0 for a full scan
+  uint8_t scan_channel_{0};
+#endif
 #ifdef USE_WIFI_AP
   uint32_t ap_timeout_{};
 #endif
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+  // KAUF: SSIDs of scan_result_, reset by each scan
+  char scan_ssid_arena_[USE_WIFI_SCAN_RESULTS_LIMIT * SCAN_SSID_ENTRY_SIZE];
+  uint16_t scan_ssid_arena_used_{0};
+#endif
+#ifdef USE_WIFI_CONNECT_TIMELINE
+  // KAUF: connection timeline
+  WiFiConnectRecord timeline_[CONNECT_TIMELINE_SIZE]{};
+  WiFiConnectRecord timeline_current_{};
+  uint32_t timeline_attempt_started_{0};
+  // Set from SDK callbacks (system context on ESP8266), aligned 32-bit stores are atomic
+  volatile uint32_t timeline_associated_{0};
+  volatile uint32_t timeline_got_ip_{0};
+  uint32_t timeline_cycles_{0};
+  uint32_t boot_connected_ms_{0};
+  uint8_t timeline_head_{0};
+  uint8_t timeline_count_{0};
+  bool timeline_active_{false};
+#endif
 
   // 1-byte enums and integers
   WiFiComponentState state_{WIFI_COMPONENT_STATE_OFF};
@@ -904,6 +1120,10 @@ class WiFiComponent final : public Component {
 #endif
 #if defined(USE_ESP8266) && defined(USE_WIFI_SCAN_RESULTS_LISTENERS)
     bool scan_complete : 1;
+#endif
+#if defined(USE_ESP8266) && defined(USE_WIFI_CACHED_IP)
+    // KAUF: save the lease once DHCP has bound an address
+    bool save_lease : 1;
 #endif
   } pending_{};
   bool has_ap_{false};
@@ -927,6 +1147,10 @@ class WiFiComponent final : public Component {
   bool skip_cooldown_next_cycle_{false};
   bool connected_{false};
   bool post_connect_roaming_{true};  // Enabled by default
+#ifdef USE_WIFI_CACHED_IP
+  bool using_cached_ip_{false};
+  bool cached_ip_checking_{false};
+#endif
 #if defined(USE_ESP32) && defined(USE_WIFI_RUNTIME_POWER_SAVE)
   bool is_high_performance_mode_{false};
 #endif
@@ -20,6 +20,13 @@ extern "C" {
 #include "lwip/init.h"  // LWIP_VERSION_
 #include "lwip/apps/sntp.h"
 #include "lwip/netif.h"  // struct netif
+#ifdef USE_WIFI_CACHED_IP
+#include "lwip/etharp.h"  // KAUF: cached lease checks
+#if LWIP_VERSION_MAJOR != 1
+#include "lwip/prot/etharp.h"
+#include "lwip/prot/ethernet.h"
+#endif
+#endif
 #include <AddrList.h>
 #if USE_ARDUINO_VERSION_CODE >= VERSION_CODE(3, 0, 0)
 #include "LwipDhcpServer.h"
@@ -493,6 +500,9 @@ void WiFiComponent::wifi_event_callback(System_Event_t *event) {
                it.channel);
 #endif
       global_wifi_component->sta_state_ = static_cast<uint8_t>(ESP8266WiFiSTAState::ASSOCIATED);
+#ifdef USE_WIFI_CONNECT_TIMELINE
+      global_wifi_component->timeline_associated_ = millis();
+#endif
 #ifdef USE_WIFI_CONNECT_STATE_LISTENERS
       // Defer listener notification until state machine reaches STA_CONNECTED
       // This ensures wifi.connected condition returns true in listener automations
@@ -539,6 +549,12 @@ void WiFiComponent::wifi_event_callback(System_Event_t *event) {
       ESP_LOGV(TAG, "static_ip=%s gateway=%s netmask=%s", network::IPAddress(&it.ip).str_to(ip_buf),
                network::IPAddress(&it.gw).str_to(gw_buf), network::IPAddress(&it.mask).str_to(mask_buf));
       global_wifi_component->sta_state_ = static_cast<uint8_t>(ESP8266WiFiSTAState::CONNECTED);
+#ifdef USE_WIFI_CONNECT_TIMELINE
+      global_wifi_component->timeline_got_ip_ = millis();
+#endif
+#ifdef USE_WIFI_CACHED_IP
+      global_wifi_component->pending_.save_lease = true;
+#endif
 #ifdef USE_WIFI_IP_STATE_LISTENERS
       // Defer listener callbacks to main loop - system context has limited stack
       global_wifi_component->pending_.got_ip = true;
@@ -677,7 +693,11 @@ bool WiFiComponent::wifi_scan_start_(bool passive) {
   memset(&config, 0, sizeof(config));
   config.ssid = nullptr;
   config.bssid = nullptr;
+#ifdef USE_WIFI_TARGETED_SCAN
+  config.channel = this->scan_channel_;  // KAUF: 0 scans all channels
+#else
   config.channel = 0;
+#endif
   config.show_hidden = 1;
 #if USE_ARDUINO_VERSION_CODE >= VERSION_CODE(2, 4, 0)
   config.scan_type = passive ? WIFI_SCAN_TYPE_PASSIVE : WIFI_SCAN_TYPE_ACTIVE;
@@ -724,10 +744,21 @@ void WiFiComponent::s_wifi_scan_done_callback(void *arg, STATUS status) {
 }
 
 void WiFiComponent::wifi_scan_done_callback_(void *arg, STATUS status) {
+  size_t carried = 0;
+#ifdef USE_WIFI_TARGETED_SCAN
+  // KAUF: the single channel scans of one chain add up (start_scanning() starts a chain with no results)
+  wifi_scan_vector_t<WiFiScanResult> previous;
+  if (this->scan_channel_ != 0)
+    previous = std::move(this->scan_result_);
+  carried = previous.size();
+#endif
   this->scan_result_.clear();
 
   if (status != OK) {
     ESP_LOGV(TAG, "Scan failed: %d", status);
+#ifdef USE_WIFI_TARGETED_SCAN
+    this->scan_result_ = std::move(previous);
+#endif
     // Don't call retry_connect() here - this callback runs in SDK system context
     // where yield() cannot be called. Instead, just set scan_done_ and let
     // check_scanning_finished() handle the empty scan_result_ from loop context.
@@ -749,7 +780,68 @@ void WiFiComponent::wifi_scan_done_callback_(void *arg, STATUS status) {
     }
   }
 
-  this->scan_result_.init(count);  // Exact allocation
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+  // KAUF: keep at most USE_WIFI_SCAN_RESULTS_LIMIT results so a crowded scan cannot exhaust the heap.
+  // Configured networks win over others, then the stronger signal wins.
+  const size_t keep = std::min<size_t>(carried + count, USE_WIFI_SCAN_RESULTS_LIMIT);
+  bool configured[USE_WIFI_SCAN_RESULTS_LIMIT];
+  this->scan_result_.init(keep);
+#ifdef USE_WIFI_TARGETED_SCAN
+  // Carried results passed the configured network filter on their own channel
+  for (const auto &res : previous) {
+    configured[this->scan_result_.size()] = true;
+    this->scan_result_.push_back(res);
+  }
+#endif
+  if (carried == 0)
+    this->scan_ssid_arena_used_ = 0;
+
+  // Second pass: store the best networks, results still point at the SDK's SSIDs
+  for (bss_info *it = head; it != nullptr; it = STAILQ_NEXT(it, next)) {
+    const char *ssid_cstr = reinterpret_cast<const char *>(it->ssid);
+    const bool matches = this->matches_configured_network_(ssid_cstr, it->bssid);
+    if (!needs_full && !matches) {
+      this->log_discarded_scan_result_(ssid_cstr, it->bssid, it->rssi, it->channel);
+      continue;
+    }
+    size_t slot = this->scan_result_.size();
+    if (slot == keep) {
+      // Full: replace the worst kept result if this one is better
+      for (size_t i = 0; i < keep; i++) {
+        if (slot == keep || configured[i] < configured[slot] ||
+            (configured[i] == configured[slot] && this->scan_result_[i].rssi_ < this->scan_result_[slot].rssi_))
+          slot = i;
+      }
+      if (configured[slot] > matches || (configured[slot] == matches && this->scan_result_[slot].rssi_ >= it->rssi))
+        continue;
+    }
+    WiFiScanResult res(bssid_t{it->bssid[0], it->bssid[1], it->bssid[2], it->bssid[3], it->bssid[4], it->bssid[5]},
+                       ssid_cstr, it->ssid_len, it->channel, it->rssi, it->authmode != AUTH_OPEN, it->is_hidden != 0);
+    if (slot == this->scan_result_.size()) {
+      this->scan_result_.push_back(res);
+    } else {
+      this->scan_result_[slot] = res;
+    }
+    configured[slot] = matches;
+  }
+
+  if (carried + count > keep) {
+    ESP_LOGD(TAG, "Scan results limit %d reached, dropped %zu weaker results", USE_WIFI_SCAN_RESULTS_LIMIT,
+             carried + count - keep);
+  }
+  // Carried results keep their interned SSIDs, the ones they lost their slot to are dropped from the arena
+  if (carried != 0)
+    this->compact_scan_ssid_arena_();
+  // Copy the kept SSIDs out of the SDK's list before it is freed
+  for (auto &res : this->scan_result_) {
+    res.ssid_ = InternedSsid(this->intern_scan_ssid_(res.ssid_.data(), res.ssid_.size()), res.ssid_.size());
+  }
+#else
+  this->scan_result_.init(carried + count);  // Exact allocation
+#ifdef USE_WIFI_TARGETED_SCAN
+  for (auto &res : previous)
+    this->scan_result_.emplace_back(std::move(res));
+#endif
 
   // Second pass: store matching networks
   for (bss_info *it = head; it != nullptr; it = STAILQ_NEXT(it, next)) {
@@ -762,7 +854,8 @@ void WiFiComponent::wifi_scan_done_callback_(void *arg, STATUS status) {
       this->log_discarded_scan_result_(ssid_cstr, it->bssid, it->rssi, it->channel);
     }
   }
-  ESP_LOGV(TAG, "Scan complete: %zu found, %zu stored%s", total, this->scan_result_.size(),
+#endif
+  ESP_LOGV(TAG, "Scan complete: %zu found, %zu stored%s", total, this->scan_result_.size() - carried,
            needs_full ? LOG_STR_LITERAL("") : LOG_STR_LITERAL(" (filtered)"));
   this->scan_done_ = true;
 #ifdef USE_WIFI_SCAN_RESULTS_LISTENERS
@@ -770,6 +863,50 @@ void WiFiComponent::wifi_scan_done_callback_(void *arg, STATUS status) {
 #endif
 }
 
+#ifdef USE_WIFI_SCAN_RESULTS_LIMIT
+const char *WiFiComponent::intern_scan_ssid_(const char *ssid, size_t len) {
+  len = std::min<size_t>(len, 32);
+  // Mesh networks repeat one SSID across many BSSIDs, store it once
+  size_t pos = 0;
+  while (pos < this->scan_ssid_arena_used_) {
+    const uint8_t entry_len = this->scan_ssid_arena_[pos];
+    if (entry_len == len && memcmp(&this->scan_ssid_arena_[pos + 1], ssid, len) == 0)
+      return &this->scan_ssid_arena_[pos + 1];
+    pos += entry_len + 2;
+  }
+  // Fits: at most USE_WIFI_SCAN_RESULTS_LIMIT distinct SSIDs are interned per scan
+  char *entry = &this->scan_ssid_arena_[pos];
+  entry[0] = len;
+  memcpy(entry + 1, ssid, len);
+  entry[len + 1] = '\0';
+  this->scan_ssid_arena_used_ = pos + len + 2;
+  return entry + 1;
+}
+
+void WiFiComponent::compact_scan_ssid_arena_() {
+  // Entries only move towards the front, so a moved result never points at an entry that is still to be checked
+  size_t out = 0;
+  size_t pos = 0;
+  while (pos < this->scan_ssid_arena_used_) {
+    const uint8_t entry_len = this->scan_ssid_arena_[pos];
+    const char *entry = &this->scan_ssid_arena_[pos + 1];
+    bool used = false;
+    for (auto &res : this->scan_result_) {
+      if (res.ssid_.data() == entry) {
+        res.ssid_ = InternedSsid(&this->scan_ssid_arena_[out + 1], entry_len);
+        used = true;
+      }
+    }
+    if (used) {
+      memmove(&this->scan_ssid_arena_[out], &this->scan_ssid_arena_[pos], entry_len + 2);
+      out += entry_len + 2;
+    }
+    pos += entry_len + 2;
+  }
+  this->scan_ssid_arena_used_ = out;
+}
+#endif
+
 #ifdef USE_WIFI_AP
 bool WiFiComponent::wifi_ap_ip_config_(const optional<ManualIP> &manual_ip) {
   // enable AP
@@ -953,6 +1090,228 @@ network::IPAddress WiFiComponent::wifi_gateway_ip_() {
   return network::IPAddress(&ip.gw);
 }
 network::IPAddress WiFiComponent::wifi_dns_ip_(int num) { return network::IPAddress(dns_getserver(num)); }
+
+#ifdef USE_WIFI_CACHED_IP
+// KAUF: cached lease. Addresses are stored the way the SDK's ip_info holds them.
+static uint32_t ip_to_u32(const network::IPAddress &address) {
+  struct ip_addr ip {};
+  ip = address;
+  return ip.addr;
+}
+
+static network::IPAddress u32_to_ip(uint32_t value) {
+  struct ip_addr ip {};
+  ip.addr = value;
+  return network::IPAddress(&ip);
+}
+
+// Lease time of the address DHCP bound, 0 if the station address did not come from DHCP
+static uint32_t sta_dhcp_lease_s() {
+#if LWIP_VERSION_MAJOR != 1
+  for (netif *intf = netif_list; intf; intf = intf->next) {
+    const struct dhcp *dhcp = netif_dhcp_data(intf);
+    if (dhcp != nullptr && dhcp->state == DHCP_STATE_BOUND)
+      return dhcp->offered_t0_lease;
+  }
+#endif
+  return 0;
+}
+
+#if LWIP_VERSION_MAJOR != 1
+static netif *find_netif(uint32_t ip) {
+  for (netif *intf = netif_list; intf; intf = intf->next) {
+    if (ip4_addr_get_u32(netif_ip4_addr(intf)) == ip)
+      return intf;
+  }
+  return nullptr;
+}
+#endif
+
+bool WiFiComponent::load_cached_ip_(WiFiAP &params) {
+  SavedWifiCachedIPSettings save{};
+  if (!this->cached_ip_pref_.load(&save) || save.ip == 0 || save.ap_index != this->selected_sta_index_)
+    return false;
+  // A configured static IP wins
+  if (params.get_manual_ip().has_value())
+    return false;
+
+  ManualIP manual_ip{};
+  manual_ip.static_ip = u32_to_ip(save.ip);
+  manual_ip.gateway = u32_to_ip(save.gateway);
+  manual_ip.subnet = u32_to_ip(save.subnet);
+  manual_ip.dns1 = u32_to_ip(save.dns1);
+  manual_ip.dns2 = u32_to_ip(save.dns2);
+  params.set_manual_ip(manual_ip);
+
+  char ip_buf[network::IP_ADDRESS_BUFFER_SIZE];
+  ESP_LOGD(TAG, "Using cached IP %s (lease %" PRIu32 " s)", manual_ip.static_ip.str_to(ip_buf), save.lease_s);
+  return true;
+}
+
+void WiFiComponent::save_cached_ip_() {
+  const uint32_t lease_s = sta_dhcp_lease_s();
+  if (lease_s < CACHED_IP_MIN_LEASE_S)
+    return;
+
+  struct ip_info info {};
+  wifi_get_ip_info(STATION_IF, &info);
+  SavedWifiCachedIPSettings save{};
+  save.ip = info.ip.addr;
+  save.gateway = info.gw.addr;
+  save.subnet = info.netmask.addr;
+  save.dns1 = ip_to_u32(this->wifi_dns_ip_(0));
+  save.dns2 = ip_to_u32(this->wifi_dns_ip_(1));
+  save.lease_s = lease_s;
+  save.ap_index = this->selected_sta_index_ >= 0 ? this->selected_sta_index_ : 0;
+  if (save.ip == 0)
+    return;
+
+  // Skip save if the lease hasn't changed (reduces flash wear, renewals report the same lease)
+  SavedWifiCachedIPSettings previous_save{};
+  if (this->cached_ip_pref_.load(&previous_save) && memcmp(&previous_save, &save, sizeof(save)) == 0)
+    return;
+
+  this->cached_ip_pref_.save(&save);
+  ESP_LOGD(TAG, "Saved cached IP");
+}
+
+#if LWIP_VERSION_MAJOR != 1
+// KAUF: ARP frames seen while the cached lease is checked, recorded from the lwIP input path
+static struct {
+  netif *intf;
+  netif_input_fn input;
+  uint32_t ip;
+  uint32_t gateway;
+  volatile bool conflict;
+  volatile bool gateway_seen;
+} arp_watch{};
+
+static err_t arp_watch_input(pbuf *p, netif *intf) {
+  if (p->len >= SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR) {
+    const auto *eth = static_cast<const eth_hdr *>(p->payload);
+    const auto *hdr = reinterpret_cast<const etharp_hdr *>(static_cast<const uint8_t *>(p->payload) + SIZEOF_ETH_HDR);
+    if (eth->type == PP_HTONS(ETHTYPE_ARP) && memcmp(&hdr->shwaddr, intf->hwaddr, ETH_HWADDR_LEN) != 0) {
+      uint32_t sender_ip;
+      uint32_t target_ip;
+      memcpy(&sender_ip, &hdr->sipaddr, sizeof(sender_ip));
+      memcpy(&target_ip, &hdr->dipaddr, sizeof(target_ip));
+      // Another host uses the address, or probes for it at the same time (RFC 5227 2.1.1)
+      if (sender_ip == arp_watch.ip ||
+          (sender_ip == 0 && target_ip == arp_watch.ip && hdr->opcode == PP_HTONS(ARP_REQUEST))) {
+        arp_watch.conflict = true;
+      } else if (sender_ip == arp_watch.gateway && hdr->opcode == PP_HTONS(ARP_REPLY)) {
+        arp_watch.gateway_seen = true;
+      }
+    }
+  }
+  return arp_watch.input(p, intf);
+}
+
+static void arp_watch_stop() {
+  if (arp_watch.intf != nullptr && arp_watch.intf->input == arp_watch_input)
+    arp_watch.intf->input = arp_watch.input;
+  arp_watch.intf = nullptr;
+}
+
+// RFC 5227 ARP probe: a broadcast request with sender IP 0.0.0.0, so it does not claim any address. Built by hand,
+// etharp_raw() is only exported by lwIP builds with AUTOIP.
+static void send_arp_probe(netif *intf, uint32_t target_ip) {
+  pbuf *p = pbuf_alloc(PBUF_RAW, SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR, PBUF_RAM);
+  if (p == nullptr)
+    return;
+  auto *eth = static_cast<eth_hdr *>(p->payload);
+  auto *hdr = reinterpret_cast<etharp_hdr *>(static_cast<uint8_t *>(p->payload) + SIZEOF_ETH_HDR);
+  memset(p->payload, 0, p->len);
+  memset(&eth->dest, 0xFF, ETH_HWADDR_LEN);
+  memcpy(&eth->src, intf->hwaddr, ETH_HWADDR_LEN);
+  eth->type = PP_HTONS(ETHTYPE_ARP);
+  hdr->hwtype = PP_HTONS(1);  // Ethernet
+  hdr->proto = PP_HTONS(ETHTYPE_IP);
+  hdr->hwlen = ETH_HWADDR_LEN;
+  hdr->protolen = sizeof(uint32_t);
+  hdr->opcode = PP_HTONS(ARP_REQUEST);
+  memcpy(&hdr->shwaddr, intf->hwaddr, ETH_HWADDR_LEN);
+  memcpy(&hdr->dipaddr, &target_ip, sizeof(target_ip));
+  intf->linkoutput(intf, p);
+  pbuf_free(p);
+}
+#endif
+
+void WiFiComponent::start_cached_ip_check_() {
+  this->cached_ip_checking_ = true;
+  this->cached_ip_check_started_ = millis();
+#if LWIP_VERSION_MAJOR != 1
+  struct ip_info info {};
+  wifi_get_ip_info(STATION_IF, &info);
+  netif *intf = find_netif(info.ip.addr);
+  if (intf == nullptr)
+    return;
+  arp_watch_stop();
+  arp_watch.ip = info.ip.addr;
+  arp_watch.gateway = info.gw.addr;
+  arp_watch.conflict = false;
+  arp_watch.gateway_seen = false;
+  arp_watch.input = intf->input;
+  arp_watch.intf = intf;
+  intf->input = arp_watch_input;
+  // Probe the cached address and the gateway; answers are only taken from arp_watch_input(), never the ARP table
+  send_arp_probe(intf, info.ip.addr);
+  send_arp_probe(intf, info.gw.addr);
+#endif
+}
+
+bool WiFiComponent::cached_ip_check_due_(uint32_t now) const {
+#if LWIP_VERSION_MAJOR != 1
+  if (arp_watch.conflict)
+    return true;
+#endif
+  return now - this->cached_ip_check_started_ >= CACHED_IP_CHECK_MS;
+}
+
+void WiFiComponent::stop_cached_ip_check_() {
+  this->cached_ip_checking_ = false;
+#if LWIP_VERSION_MAJOR != 1
+  arp_watch_stop();
+#endif
+}
+
+void WiFiComponent::finish_cached_ip_check_() {
+  this->using_cached_ip_ = false;
+
+  bool conflict = false;
+  bool gateway_seen = false;
+#if LWIP_VERSION_MAJOR != 1
+  if (arp_watch.intf != nullptr) {
+    conflict = arp_watch.conflict;
+    gateway_seen = arp_watch.gateway_seen;
+  }
+#endif
+  this->stop_cached_ip_check_();
+
+  if (conflict || !gateway_seen) {
+    ESP_LOGW(TAG, "Cached IP %s, switching to DHCP",
+             conflict ? LOG_STR_LITERAL("is used by another device") : LOG_STR_LITERAL("got no answer from the gateway"));
+    SavedWifiCachedIPSettings save{};
+    this->cached_ip_pref_.save(&save);
+  } else {
+    ESP_LOGD(TAG, "Cached IP confirmed, renewing lease via DHCP");
+  }
+  if (conflict) {
+    // The address belongs to someone else: give it up now instead of keeping it until DHCP binds a new one
+    struct ip_info info {};
+    wifi_set_ip_info(STATION_IF, &info);
+#if LWIP_VERSION_MAJOR != 1
+    // lwIP v2 has to be told as well, see wifi_sta_ip_config_()
+    netif_set_addr(eagle_lwip_getif(STATION_IF), reinterpret_cast<const ip4_addr_t *>(&info.ip),
+                   reinterpret_cast<const ip4_addr_t *>(&info.netmask), reinterpret_cast<const ip4_addr_t *>(&info.gw));
+#endif
+  }
+  // Otherwise the address stays until DHCP binds one; that lease is saved for the next boot
+  if (!this->wifi_sta_ip_config_({})) {
+    ESP_LOGW(TAG, "Starting DHCP client failed");
+  }
+}
+#endif
 bool WiFiComponent::wifi_loop_() {
   this->process_pending_callbacks_();
   return true;
@@ -985,6 +1344,13 @@ void WiFiComponent::process_pending_callbacks_() {
     this->notify_scan_results_listeners_();
   }
 #endif
+
+#ifdef USE_WIFI_CACHED_IP
+  if (this->pending_.save_lease) {
+    this->pending_.save_lease = false;
+    this->save_cached_ip_();
+  }
+#endif
 }
 
 }  // namespace esphome::wifi
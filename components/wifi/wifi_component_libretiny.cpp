@@ -463,6 +463,9 @@ void WiFiComponent::wifi_process_event_(LTWiFiEvent *event) {
       // Note: We don't set CONNECTED state here yet - wait for GOT_IP
       // This matches ESP32 IDF behavior where s_sta_connected is set but
       // wifi_sta_connect_status_() also checks got_ipv4_address_
+#ifdef USE_WIFI_CONNECT_TIMELINE
+      this->timeline_associated_ = millis();
+#endif
 #ifdef USE_WIFI_CONNECT_STATE_LISTENERS
       // Defer listener notification until state machine reaches STA_CONNECTED
       // This ensures wifi.connected condition returns true in listener automations
@@ -555,6 +558,9 @@ void WiFiComponent::wifi_process_event_(LTWiFiEvent *event) {
       ESP_LOGV(TAG, "static_ip=%s gateway=%s", network::IPAddress(WiFi.localIP()).str_to(ip_buf),
                network::IPAddress(WiFi.gatewayIP()).str_to(gw_buf));
       this->sta_state_ = static_cast<uint8_t>(LTWiFiSTAState::CONNECTED);
+#ifdef USE_WIFI_CONNECT_TIMELINE
+      this->timeline_got_ip_ = millis();
+#endif
 #ifdef USE_WIFI_IP_STATE_LISTENERS
       this->notify_ip_state_listeners_();
 #endif
@@ -1,6 +1,6 @@
 import { LitElement, html, css, PropertyValues, nothing } from "lit";
 import { customElement, state, query } from "lit/decorators.js";
-import { getBasePath } from "./esp-entity-table";
+import { getBasePath, resolveStateEvent, DELTA_PROTOCOL_VERSION } from "./esp-entity-table";
 
 import "./esp-entity-table";
 import "./esp-log";
@@ -8,7 +8,7 @@ import "./esp-switch";
 import cssReset from "./css/reset";
 import cssButton from "./css/button";
 
-window.source = new EventSource(getBasePath() + "/events");
+window.source = new EventSource(getBasePath() + "/events?delta=" + DELTA_PROTOCOL_VERSION);
 const ENABLE_LEGACY_FALLBACK = import.meta.env.VITE_LEGACY_FALLBACK === "true";
 
 type ProductUi = {
@@ -92,6 +92,8 @@ export default class EspApp extends LitElement {
   @state() otaFileWarning: string = "";
   @state() sensor4m: boolean | undefined = undefined;
   private disconnectTimer: number | null = null;
+  // State events may be deltas (web_server delta_state_events); keep the merged update entity state here
+  private updateState: Record<string, any> = {};
   @query("#beat")
   beat!: HTMLSpanElement;
 
@@ -154,10 +156,13 @@ export default class EspApp extends LitElement {
       }
     });
     const handleUpdateState = (e: Event) => {
-      const data = JSON.parse((e as MessageEvent).data);
+      let data = resolveStateEvent(JSON.parse((e as MessageEvent).data));
+      if (!data) return;
       const id: string = data.id || "";
       const nameId: string = data.name_id || "";
       if (!id.startsWith("update-") && !nameId.startsWith("update/")) return;
+      const key = nameId || id;
+      data = this.updateState[key] = Object.assign(this.updateState[key] || {}, data);
       if (data.state === "UPDATE AVAILABLE") {
         const url = data.firmware_url || data.release_url;
         if (url) {
@@ -174,8 +179,8 @@ export default class EspApp extends LitElement {
     window.source.addEventListener("state_detail_all", handleUpdateState);
 
     const handle4mState = (e: Event) => {
-      const data = JSON.parse((e as MessageEvent).data);
-      if (data.id === "binary_sensor-4mib" || data.name_id === "binary_sensor/4MiB") {
+      const data = resolveStateEvent(JSON.parse((e as MessageEvent).data));
+      if (data && (data.id === "binary_sensor-4mib" || data.name_id === "binary_sensor/4MiB") && "value" in data) {
         this.sensor4m = data.value === true;
       }
     };
@@ -66,6 +66,25 @@ export function getBasePath() {
 
 let basePath = getBasePath();
 
+// Delta state events (web_server delta_state_events, protocol version 1): full events carry the short entity
+// index "i" next to id/name_id, deltas only carry "i" and the changed fields. Returns the event with id/name_id
+// filled back in, or null for a delta of an entity whose full event has not been seen.
+export const DELTA_PROTOCOL_VERSION = 1;
+const deltaIds = new Map<number, { id?: string; name_id?: string }>();
+
+export function resolveStateEvent(data: any): any {
+  if (typeof data.i !== "number") return data;
+  if (data.id !== undefined || data.name_id !== undefined) {
+    deltaIds.set(data.i, { id: data.id, name_id: data.name_id });
+  } else {
+    const ids = deltaIds.get(data.i);
+    if (!ids) return null;
+    Object.assign(data, ids);
+  }
+  delete data.i;
+  return data;
+}
+
 // ID format detection and parsing helpers
 // New format: "domain/entity_name" or "domain/device_name/entity_name"
 // Old format: "domain-object_id" (deprecated)
@@ -116,7 +135,8 @@ export class EntityTable extends LitElement implements RestAction {
     super.connectedCallback();
     window.source?.addEventListener("state", (e: Event) => {
       const messageEvent = e as MessageEvent;
-      const data = JSON.parse(messageEvent.data);
+      const data = resolveStateEvent(JSON.parse(messageEvent.data));
+      if (!data) return;
       // Prefer name_id (new format) over id (legacy format) for entity identification
       const entityId = data.name_id || data.id;
       let idx = this.entities.findIndex((x) => x.unique_id === entityId);